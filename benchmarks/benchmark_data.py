@@ -0,0 +1,54 @@
+import json
+
+
+def read_benchmark_file(path, statistic="mean", group_by=None):
+    """Read benchmark results from a ``.dat`` file or a JSON file.
+
+    ``.dat`` files are the CSV output of the shell scripts
+    (``name,size,p,avg_time,code,meas``) and are assumed to use
+    ``size - 1`` measurement rounds. JSON files are written by the native
+    ``plaquette_unionfind_benchmark`` executable; ``statistic`` selects which
+    per-shot latency (``mean``, ``median``, ``p99`` or ``p999``) is returned.
+    Since a JSON file may cover a whole grid, ``group_by`` (``"p"``,
+    ``"size"`` or ``"rounds"``) appends that value to the series name so that
+    each plotted line varies a single parameter.
+
+    Returns a list of dicts with the keys ``name``, ``size``, ``p``, ``time``
+    (seconds per shot) and ``rounds``.
+    """
+    if path.endswith(".json"):
+        with open(path, "r") as file:
+            data = json.load(file)
+        name = data.get("decoder", "plaquette-unionfind")
+        if statistic != "mean":
+            name += " (" + statistic + ")"
+        keys = {"p": "p", "size": "distance", "rounds": "rounds"}
+        return [
+            {
+                "name": name
+                if group_by is None
+                else "{} {}={}".format(name, group_by, r[keys[group_by]]),
+                "size": r["distance"],
+                "p": r["p"],
+                "time": r[statistic],
+                "rounds": r["rounds"],
+            }
+            for r in data["results"]
+        ]
+
+    rows = []
+    with open(path, "r") as file:
+        for line in file:
+            line = line.strip().split(",")
+            if len(line) < 4:
+                continue
+            rows.append(
+                {
+                    "name": line[0],
+                    "size": int(line[1]),
+                    "p": float(line[2]),
+                    "time": float(line[3]),
+                    "rounds": max(int(line[1]) - 1, 1),
+                }
+            )
+    return rows
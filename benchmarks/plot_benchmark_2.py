@@ -2,27 +2,28 @@ import matplotlib.pyplot as plt
 import seaborn as sns
 import sys
 
+from benchmark_data import read_benchmark_file
+
 open_file = sys.argv[1]
 save_file = sys.argv[2]
 title = sys.argv[3]
 skip = int(sys.argv[4])
+statistic = sys.argv[5] if len(sys.argv) > 5 else "mean"
 
 print("Reading file: " + open_file)
 print("Saving file: " + save_file)
 print("Title: " + title)
 print("Skip: " + str(skip))
 
-# Read data from file
-with open(open_file, 'r') as file:
-    data = file.readlines()
-    
+# Read data from a .dat file or a JSON file from the native benchmark
+rows = read_benchmark_file(open_file, statistic, group_by="p")
+
 # Process the data
 lines = {}
-for line in data:
-    line = line.strip().split(',')
-    name = line[0]
-    x = int(line[1]) # size of lattice
-    y = (float(line[3]) * 1000) / float(x-1)  # Scale y-axis to milliseconds, divide by n_rounds
+for row in rows:
+    name = row["name"]
+    x = row["size"] # size of lattice
+    y = (row["time"] * 1000) / row["rounds"]  # Scale y-axis to milliseconds, divide by n_rounds
     if name not in lines:
         lines[name] = {'x': [], 'y': []}
     lines[name]['x'].append(x)
@@ -2,5 +2,19 @@
 from .unionfind import UnionFindDecoderInterface
 from .unionfind import UnionFindDecoder
 from .unionfind import PeelingDecoder
+from .unionfind import DecoderStatistics
+from .unionfind import MonteCarloResult
+from .unionfind import FixedWeightResult
+from .unionfind import ThresholdFit
+from .unionfind import ThresholdResult
+from .unionfind import simulate
+from .unionfind import simulate_sweep
+from .unionfind import simulate_adaptive
+from .unionfind import simulate_fixed_weight
+from .unionfind import find_threshold
+from .unionfind import fit_threshold
+from .unionfind import SpaceTimeSampler
+from .unionfind import space_time_probabilities
+from .unionfind import DetectionEventBuilder
 
 __version__ = "0.0.1-alpha.2"
@@ -1,9 +1,17 @@
+#include <fstream>
 #include <functional>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include "DecoderStatistics.hpp"
+#include "DecoderTrace.hpp"
+#include "DetectionEvents.hpp"
 #include "DecodingGraph.hpp"
+#include "ImportanceSampling.hpp"
+#include "MonteCarlo.hpp"
 #include "PeelingDecoder.hpp"
+#include "SpaceTimeSampler.hpp"
+#include "Threshold.hpp"
 #include "Types.hpp"
 #include "UnionFindDecoder.hpp"
 
@@ -15,6 +23,62 @@ namespace py = pybind11;
 
 PYBIND11_MODULE(plaquette_unionfind_bindings, m) {
 
+    m.attr("statistics_enabled") = DecoderStatistics::kEnabled;
+
+#ifdef PLAQUETTE_UNIONFIND_ENABLE_TRACING
+    m.attr("tracing_enabled") = true;
+#else
+    m.attr("tracing_enabled") = false;
+#endif
+    m.def(
+        "write_chrome_trace",
+        [](const std::string &path) {
+            std::ofstream out(path);
+            if (!out) {
+                throw std::runtime_error("Could not open '" + path +
+                                         "' for writing");
+            }
+            TraceRecorder::Get().WriteChromeTrace(out);
+        },
+        "Write the recorded decoder events as Chrome trace-event JSON");
+    m.def(
+        "clear_trace", [] { TraceRecorder::Get().Clear(); },
+        "Drop all recorded decoder events");
+
+    pybind11::class_<DecoderStatistics>(m, "DecoderStatistics")
+        .def(pybind11::init<>())
+        .def_readonly("num_shots", &DecoderStatistics::num_shots)
+        .def_readonly("num_growth_iterations",
+                      &DecoderStatistics::num_growth_iterations)
+        .def_readonly("num_merges", &DecoderStatistics::num_merges)
+        .def_readonly("num_find_calls", &DecoderStatistics::num_find_calls)
+        .def_readonly("find_path_length_total",
+                      &DecoderStatistics::find_path_length_total)
+        .def_readonly("find_path_length_max",
+                      &DecoderStatistics::find_path_length_max)
+        .def_readonly("num_stale_queue_pops",
+                      &DecoderStatistics::num_stale_queue_pops)
+        .def_readonly("boundary_size_total",
+                      &DecoderStatistics::boundary_size_total)
+        .def_readonly("boundary_size_max",
+                      &DecoderStatistics::boundary_size_max)
+        .def_readonly("cluster_size_histogram",
+                      &DecoderStatistics::cluster_size_histogram)
+        .def_property_readonly(
+            "stage_cycles",
+            [](const DecoderStatistics &statistics) {
+                py::dict stage_cycles;
+                for (size_t s = 0; s < DecoderStatistics::kNumStages; s++) {
+                    auto stage = static_cast<DecoderStatistics::Stage>(s);
+                    stage_cycles[DecoderStatistics::GetStageName(stage)] =
+                        statistics.GetStageCycles(stage);
+                }
+                return stage_cycles;
+            })
+        .def("merge", &DecoderStatistics::Merge,
+             "Add the statistics of another decoder")
+        .def("reset", &DecoderStatistics::Reset);
+
     pybind11::class_<PeelingDecoder>(m, "PeelingDecoder")
         .def(pybind11::init<>())
         .def("decode", &PeelingDecoder::Decode);
@@ -29,6 +93,352 @@ PYBIND11_MODULE(plaquette_unionfind_bindings, m) {
              py::overload_cast<std::vector<bool> &, const std::vector<bool> &>(
                  &UnionFindDecoder::Decode),
              "Decode syndrome with erasure")
-        .def("get_modified_erasure", &UnionFindDecoder::GetModifiedErasure);
+        .def("get_modified_erasure", &UnionFindDecoder::GetModifiedErasure)
+        .def("get_statistics", &UnionFindDecoder::GetStatistics,
+             "Get a copy of the decoder statistics")
+        .def("reset_statistics", &UnionFindDecoder::ResetStatistics);
+
+    pybind11::class_<Simulation::MonteCarloResult>(m, "MonteCarloResult")
+        .def_readonly("code", &Simulation::MonteCarloResult::code)
+        .def_readonly("distance", &Simulation::MonteCarloResult::distance)
+        .def_readonly("rounds", &Simulation::MonteCarloResult::rounds)
+        .def_readonly("p", &Simulation::MonteCarloResult::p)
+        .def_readonly("erasure_probability",
+                      &Simulation::MonteCarloResult::erasure_probability)
+        .def_readonly("num_shots", &Simulation::MonteCarloResult::num_shots)
+        .def_readonly("num_failures",
+                      &Simulation::MonteCarloResult::num_failures)
+        .def_readonly("seconds", &Simulation::MonteCarloResult::seconds)
+        .def_readonly("stop_reason",
+                      &Simulation::MonteCarloResult::stop_reason)
+        .def_property_readonly(
+            "logical_error_rate",
+            &Simulation::MonteCarloResult::GetLogicalErrorRate)
+        .def("confidence_interval",
+             py::overload_cast<double>(
+                 &Simulation::MonteCarloResult::GetConfidenceInterval,
+                 py::const_),
+             py::arg("z") = 1.96,
+             "Wilson score interval of the logical error rate")
+        .def(
+            "clopper_pearson_interval",
+            [](const Simulation::MonteCarloResult &result,
+               double confidence) {
+                return result.GetConfidenceInterval(
+                    Simulation::Interval::ClopperPearson, confidence);
+            },
+            py::arg("confidence") = 0.95,
+            "Exact Clopper-Pearson interval of the logical error rate");
+
+    m.def(
+        "simulate",
+        [](const std::string &code, size_t distance, double p, size_t shots,
+           size_t rounds, size_t threads, uint64_t seed, double erasure,
+           size_t chunk_size, bool bit_sliced) {
+            Simulation::MonteCarloOptions options;
+            options.num_shots = shots;
+            options.num_threads = threads;
+            options.seed = seed;
+            options.erasure_probability = erasure;
+            options.chunk_size = chunk_size;
+            options.bit_sliced = bit_sliced;
+            return Simulation::RunMonteCarlo(code, distance, rounds, p,
+                                             options);
+        },
+        py::arg("code"), py::arg("distance"), py::arg("p"),
+        py::arg("shots") = 10000, py::arg("rounds") = 1,
+        py::arg("threads") = 0, py::arg("seed") = 0,
+        py::arg("erasure_probability") = 0.0, py::arg("chunk_size") = 1024,
+        py::arg("bit_sliced") = false,
+        py::call_guard<py::gil_scoped_release>(),
+        "Estimate the logical error rate of a planar, rotated or toric code "
+        "on all threads");
+
+    m.def(
+        "simulate_sweep",
+        [](const std::string &code, size_t distance,
+           const std::vector<double> &probabilities, size_t shots,
+           size_t rounds, size_t threads, uint64_t seed, double erasure,
+           size_t chunk_size) {
+            Simulation::MonteCarloOptions options;
+            options.num_shots = shots;
+            options.num_threads = threads;
+            options.seed = seed;
+            options.erasure_probability = erasure;
+            options.chunk_size = chunk_size;
+            return Simulation::RunMonteCarloSweep(code, distance, rounds,
+                                                  probabilities, options);
+        },
+        py::arg("code"), py::arg("distance"), py::arg("probabilities"),
+        py::arg("shots") = 10000, py::arg("rounds") = 1,
+        py::arg("threads") = 0, py::arg("seed") = 0,
+        py::arg("erasure_probability") = 0.0, py::arg("chunk_size") = 1024,
+        py::call_guard<py::gil_scoped_release>(),
+        "Estimate the logical error rates of a code at several bit-flip "
+        "rates from one set of coupled shots");
+
+    m.def(
+        "simulate_adaptive",
+        [](const std::string &code, size_t distance, double p,
+           size_t max_shots, size_t batch_size, size_t target_failures,
+           double target_relative_error, double max_seconds,
+           const std::string &interval, double confidence, size_t rounds,
+           size_t threads, uint64_t seed, double erasure, size_t chunk_size,
+           bool bit_sliced) {
+            Simulation::MonteCarloOptions options;
+            options.num_threads = threads;
+            options.seed = seed;
+            options.erasure_probability = erasure;
+            options.chunk_size = chunk_size;
+            options.bit_sliced = bit_sliced;
+            Simulation::StoppingRule rule;
+            rule.max_shots = max_shots;
+            rule.batch_size = batch_size;
+            rule.target_failures = target_failures;
+            rule.target_relative_error = target_relative_error;
+            rule.max_seconds = max_seconds;
+            rule.confidence = confidence;
+            if (interval == "wilson") {
+                rule.interval = Simulation::Interval::Wilson;
+            } else if (interval == "clopper-pearson") {
+                rule.interval = Simulation::Interval::ClopperPearson;
+            } else {
+                throw std::invalid_argument("Unknown interval '" + interval +
+                                            "'");
+            }
+            return Simulation::RunMonteCarloAdaptive(code, distance, rounds, p,
+                                                     options, rule);
+        },
+        py::arg("code"), py::arg("distance"), py::arg("p"),
+        py::arg("max_shots") = 1000000, py::arg("batch_size") = 10000,
+        py::arg("target_failures") = 0,
+        py::arg("target_relative_error") = 0.0, py::arg("max_seconds") = 0.0,
+        py::arg("interval") = "wilson", py::arg("confidence") = 0.95,
+        py::arg("rounds") = 1, py::arg("threads") = 0, py::arg("seed") = 0,
+        py::arg("erasure_probability") = 0.0, py::arg("chunk_size") = 1024,
+        py::arg("bit_sliced") = false,
+        py::call_guard<py::gil_scoped_release>(),
+        "Estimate the logical error rate of a code with batches of shots "
+        "until a target number of failures or relative error is reached");
+
+    pybind11::class_<Simulation::FixedWeightResult>(m, "FixedWeightResult")
+        .def_readonly("code", &Simulation::FixedWeightResult::code)
+        .def_readonly("distance", &Simulation::FixedWeightResult::distance)
+        .def_readonly("rounds", &Simulation::FixedWeightResult::rounds)
+        .def_readonly("num_edges", &Simulation::FixedWeightResult::num_edges)
+        .def_readonly("min_weight",
+                      &Simulation::FixedWeightResult::min_weight)
+        .def_readonly("num_shots", &Simulation::FixedWeightResult::num_shots)
+        .def_readonly("num_failures",
+                      &Simulation::FixedWeightResult::num_failures)
+        .def_readonly("seconds", &Simulation::FixedWeightResult::seconds)
+        .def_property_readonly("max_weight",
+                               &Simulation::FixedWeightResult::GetMaxWeight)
+        .def("failure_rate", &Simulation::FixedWeightResult::GetFailureRate,
+             py::arg("weight"), "Sampled failure rate at an error weight")
+        .def("logical_error_rate",
+             &Simulation::FixedWeightResult::GetLogicalErrorRate, py::arg("p"),
+             "Logical error rate at bit-flip rate p")
+        .def("standard_error",
+             &Simulation::FixedWeightResult::GetStandardError, py::arg("p"),
+             "Standard error of the logical error rate at p")
+        .def("truncation_bound",
+             &Simulation::FixedWeightResult::GetTruncationBound, py::arg("p"),
+             "Probability of a weight above the largest sampled one at p")
+        .def("confidence_interval",
+             &Simulation::FixedWeightResult::GetConfidenceInterval,
+             py::arg("p"), py::arg("z") = 1.96,
+             "Confidence interval of the logical error rate at p");
+
+    m.def(
+        "simulate_fixed_weight",
+        [](const std::string &code, size_t distance, size_t max_weight,
+           size_t min_weight, size_t shots_per_weight, size_t rounds,
+           size_t threads, uint64_t seed, size_t chunk_size) {
+            Simulation::FixedWeightOptions options;
+            options.min_weight = min_weight;
+            options.max_weight = max_weight;
+            options.shots_per_weight = shots_per_weight;
+            options.num_threads = threads;
+            options.seed = seed;
+            options.chunk_size = chunk_size;
+            return Simulation::RunFixedWeightMonteCarlo(code, distance, rounds,
+                                                        options);
+        },
+        py::arg("code"), py::arg("distance"), py::arg("max_weight"),
+        py::arg("min_weight") = 0, py::arg("shots_per_weight") = 10000,
+        py::arg("rounds") = 1, py::arg("threads") = 0, py::arg("seed") = 0,
+        py::arg("chunk_size") = 1024,
+        py::call_guard<py::gil_scoped_release>(),
+        "Estimate the failure rate of every error weight, for logical error "
+        "rates far below threshold");
+
+    pybind11::class_<Simulation::ThresholdFit>(m, "ThresholdFit")
+        .def_readonly("converged", &Simulation::ThresholdFit::converged)
+        .def_readonly("threshold", &Simulation::ThresholdFit::threshold)
+        .def_readonly("threshold_error",
+                      &Simulation::ThresholdFit::threshold_error)
+        .def_readonly("nu", &Simulation::ThresholdFit::nu)
+        .def_readonly("nu_error", &Simulation::ThresholdFit::nu_error)
+        .def_readonly("coefficients", &Simulation::ThresholdFit::coefficients)
+        .def_readonly("chi_squared", &Simulation::ThresholdFit::chi_squared)
+        .def_readonly("degrees_of_freedom",
+                      &Simulation::ThresholdFit::degrees_of_freedom);
+
+    pybind11::class_<Simulation::ThresholdResult>(m, "ThresholdResult")
+        .def_readonly("points", &Simulation::ThresholdResult::points)
+        .def_readonly("fit", &Simulation::ThresholdResult::fit)
+        .def_readonly("min_p", &Simulation::ThresholdResult::min_p)
+        .def_readonly("max_p", &Simulation::ThresholdResult::max_p);
+
+    m.def(
+        "find_threshold",
+        [](const std::string &code, const std::vector<size_t> &distances,
+           double min_p, double max_p, size_t num_points,
+           size_t num_iterations, size_t max_shots, size_t batch_size,
+           double target_relative_error, size_t rounds, size_t threads,
+           uint64_t seed, double erasure) {
+            Simulation::ThresholdOptions options;
+            options.distances = distances;
+            options.rounds = rounds;
+            options.min_p = min_p;
+            options.max_p = max_p;
+            options.num_points = num_points;
+            options.num_iterations = num_iterations;
+            options.stopping_rule.max_shots = max_shots;
+            options.stopping_rule.batch_size = batch_size;
+            options.stopping_rule.target_relative_error =
+                target_relative_error;
+            options.monte_carlo.num_threads = threads;
+            options.monte_carlo.seed = seed;
+            options.monte_carlo.erasure_probability = erasure;
+            return Simulation::FindThreshold(code, options);
+        },
+        py::arg("code"), py::arg("distances"), py::arg("min_p") = 0.01,
+        py::arg("max_p") = 0.15, py::arg("num_points") = 6,
+        py::arg("num_iterations") = 3, py::arg("max_shots") = 100000,
+        py::arg("batch_size") = 10000, py::arg("target_relative_error") = 0.05,
+        py::arg("rounds") = 1, py::arg("threads") = 0, py::arg("seed") = 0,
+        py::arg("erasure_probability") = 0.0,
+        py::call_guard<py::gil_scoped_release>(),
+        "Sample logical error rates near the crossing of several distances "
+        "and fit the threshold; rounds=0 means d rounds");
+
+    m.def("fit_threshold", &Simulation::FitThreshold, py::arg("results"),
+          py::arg("initial_threshold") = -1.0,
+          "Fit the threshold of logical error rates of several distances");
+
+    pybind11::class_<SpaceTimeSampler<>>(m, "SpaceTimeSampler")
+        .def(pybind11::init<const DecodingGraph &, std::vector<double>,
+                            std::vector<uint64_t>, int>(),
+             py::arg("graph"), py::arg("edge_probabilities"),
+             py::arg("edge_observables") = std::vector<uint64_t>{},
+             py::arg("seed") = -1)
+        .def_static(
+            "from_detector_error_model",
+            [](const std::string &text, int seed) {
+                return SpaceTimeSampler<>::FromDetectorErrorModel(
+                    DetectorErrorModel::FromString(text),
+                    Xoshiro256PlusPlus(GetSeed(seed)));
+            },
+            py::arg("text"), py::arg("seed") = -1,
+            "Sample the errors of a Stim detector error model")
+        .def(
+            "sample",
+            [](SpaceTimeSampler<> &sampler) {
+                std::vector<bool> syndrome;
+                uint64_t observables = sampler.Sample(syndrome);
+                return std::make_pair(std::move(syndrome), observables);
+            },
+            "Sample a syndrome and the flipped observables")
+        .def(
+            "sample_packed",
+            [](SpaceTimeSampler<> &sampler) {
+                std::vector<uint64_t> detection_events;
+                uint64_t observables = sampler.Sample(detection_events);
+                return std::make_pair(std::move(detection_events),
+                                      observables);
+            },
+            "Sample packed detection events and the flipped observables")
+        .def("get_flipped_edges", &SpaceTimeSampler<>::GetFlippedEdges,
+             "The edges flipped in the last shot")
+        .def(
+            "get_observable_flips",
+            [](const SpaceTimeSampler<> &sampler,
+               const std::vector<bool> &correction) {
+                std::vector<uint8_t> bytes(correction.begin(),
+                                           correction.end());
+                return sampler.GetObservableFlips(bytes);
+            },
+            py::arg("correction"), "Observables flipped by a correction")
+        .def("get_growth_increments", &SpaceTimeSampler<>::GetGrowthIncrements,
+             py::arg("max_growth") = 2.0,
+             "Growth increments weighted by the edge probabilities")
+        .def_property_readonly("num_vertices",
+                               &SpaceTimeSampler<>::GetNumVertices)
+        .def_property_readonly("num_edges", &SpaceTimeSampler<>::GetNumEdges);
+
+    pybind11::class_<DetectionEventBuilder>(m, "DetectionEventBuilder")
+        .def(pybind11::init<const DecodingGraph &, size_t>(),
+             py::arg("graph"), py::arg("num_rounds"))
+        .def(
+            "detection_events",
+            [](DetectionEventBuilder &builder,
+               const std::vector<uint64_t> &measurements,
+               const std::vector<uint64_t> &data_measurements) {
+                std::vector<uint64_t> events;
+                builder.GetDetectionEvents(measurements, data_measurements,
+                                           events);
+                return events;
+            },
+            py::arg("measurements"),
+            py::arg("data_measurements") = std::vector<uint64_t>{},
+            "Packed detection events of packed per-round measurements")
+        .def(
+            "syndrome",
+            [](DetectionEventBuilder &builder,
+               const std::vector<uint64_t> &measurements,
+               const std::vector<uint64_t> &data_measurements) {
+                std::vector<bool> syndrome;
+                builder.GetSyndrome(measurements, data_measurements,
+                                    syndrome);
+                return syndrome;
+            },
+            py::arg("measurements"),
+            py::arg("data_measurements") = std::vector<uint64_t>{},
+            "Decoder syndrome of packed per-round measurements")
+        .def(
+            "decode",
+            [](DetectionEventBuilder &builder, UnionFindDecoder &decoder,
+               const std::vector<uint64_t> &measurements,
+               const std::vector<uint64_t> &data_measurements) {
+                std::vector<bool> syndrome;
+                builder.GetSyndrome(measurements, data_measurements,
+                                    syndrome);
+                return decoder.Decode(syndrome);
+            },
+            py::arg("decoder"), py::arg("measurements"),
+            py::arg("data_measurements") = std::vector<uint64_t>{},
+            "Decode packed per-round measurements")
+        .def_property_readonly("num_round_words",
+                               &DetectionEventBuilder::GetNumRoundWords)
+        .def_property_readonly("num_stabilizers",
+                               &DetectionEventBuilder::GetNumStabilizers)
+        .def_property_readonly("num_qubits",
+                               &DetectionEventBuilder::GetNumQubits);
+
+    m.def(
+        "space_time_probabilities",
+        [](const std::vector<double> &data,
+           const std::vector<double> &measurement, size_t num_qubits,
+           size_t num_stabilizers, size_t num_rounds) {
+            return ErrorModels::GetSpaceTimeProbabilities(
+                data, measurement, num_qubits, num_stabilizers, num_rounds);
+        },
+        py::arg("data_probabilities"), py::arg("measurement_probabilities"),
+        py::arg("num_qubits"), py::arg("num_stabilizers"),
+        py::arg("num_rounds"),
+        "Per-edge error rates of a phenomenological space-time graph from "
+        "per-qubit and per-stabilizer rates");
 }
 } // namespace
@@ -1,13 +1,18 @@
 #pragma once
+#include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <iterator>
+#include <memory_resource>
 #include <vector>
 
 namespace Plaquette {
 /**
  * @brief A lightweight view of a cluster boundary.
+ *
+ * @tparam Row The vector that stores the boundaries.
  */
-class ClusterBoundary {
+template <typename Row = std::vector<int>> class ClusterBoundary {
   public:
     /**
      * @brief Constructs a ClusterBoundary object from a row vector.
@@ -15,7 +20,7 @@ class ClusterBoundary {
      * @param start The starting index of the row.
      * @param end The ending index of the row.
      */
-    ClusterBoundary(std::vector<int> &row, size_t start, size_t end)
+    ClusterBoundary(Row &row, size_t start, size_t end)
         : boundary(row), start_(start), end_(end) {}
 
     /**
@@ -47,23 +52,64 @@ class ClusterBoundary {
      */
     int &operator[](int index) { return boundary[start_ + index]; }
 
+    /**
+     * @brief Index-based iterator over the view.
+     *
+     * The iterator reads through the referenced vector on every access and
+     * dereferences to a copy, so it stays valid when the underlying storage
+     * is reallocated while iterating (e.g. when a cluster grows while its
+     * boundary is being traversed).
+     */
+    class Iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = int;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const int *;
+        using reference = int;
+
+        Iterator(Row &row, size_t index)
+            : row_(&row), index_(index) {}
+
+        int operator*() const { return (*row_)[index_]; }
+        Iterator &operator++() {
+            ++index_;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++index_;
+            return old;
+        }
+        bool operator==(const Iterator &other) const {
+            return index_ == other.index_ && row_ == other.row_;
+        }
+        bool operator!=(const Iterator &other) const {
+            return !(*this == other);
+        }
+
+      private:
+        Row *row_;
+        size_t index_;
+    };
+
     /**
      * @brief Returns an iterator to the start of the lightweight view.
      * @return An iterator to the start of the lightweight view.
      */
-    std::vector<int>::iterator begin() { return boundary.begin() + start_; }
+    Iterator begin() { return Iterator(boundary, start_); }
 
     /**
      * @brief Returns an iterator to the end of the lightweight view.
      * @return An iterator to the end of the lightweight view.
      */
-    std::vector<int>::iterator end() { return boundary.begin() + end_; }
+    Iterator end() { return Iterator(boundary, end_); }
 
   private:
     /**
      * @brief A reference to the row vector.
      */
-    std::vector<int> &boundary;
+    Row &boundary;
 
     /**
      * @brief The starting index of the row.
@@ -79,55 +125,100 @@ class ClusterBoundary {
 /**
  * @brief Stores cluster boundaries for efficient boundary computation of
  *        graph partitions.
+ *
+ * All boundaries live in a single arena. Every cluster owns a contiguous
+ * segment of the arena that starts with a small capacity; when a segment is
+ * full it is copied to the end of the arena with twice the capacity, so
+ * memory grows with the number of boundary vertices actually stored instead
+ * of with the square of the number of vertices. Segments are never reused
+ * within a decoding round, which keeps views returned by GetBoundary()
+ * readable while the cluster keeps growing. Reset() releases all segments
+ * while keeping the arena allocated for the next round.
  */
 class ClusterBoundaries {
 
   private:
     /**
-     * @brief The maximum size of each cluster boundary.
+     * @brief The initial capacity of each cluster boundary.
      */
     size_t max_boundary_size_;
 
     /**
      * @brief The vector that stores the cluster boundary data.
      */
-    std::vector<int> boundary_;
+    std::pmr::vector<int> boundary_;
 
     /**
      * @brief The vector that stores the cluster strides.
      */
-    std::vector<int> cluster_strides_;
+    std::pmr::vector<int> cluster_strides_;
 
     /**
      * @brief The vector that stores the sizes of each cluster boundary.
      */
-    std::vector<size_t> boundary_sizes_;
+    std::pmr::vector<size_t> boundary_sizes_;
+
+    /**
+     * @brief The arena offset and capacity of each cluster boundary.
+     */
+    std::pmr::vector<size_t> boundary_starts_;
+    std::pmr::vector<size_t> boundary_capacities_;
 
     size_t num_clusters_;
 
+    /**
+     * @brief The first unused position of the arena.
+     */
+    size_t arena_end_;
+
+    /**
+     * @brief Moves a full boundary segment to the end of the arena with
+     * twice its capacity.
+     */
+    void Grow_(size_t cluster_stride) {
+        size_t old_start = boundary_starts_[cluster_stride];
+        size_t old_capacity = boundary_capacities_[cluster_stride];
+        size_t new_capacity = std::max<size_t>(
+            2 * old_capacity, std::max<size_t>(max_boundary_size_, 1));
+
+        if (arena_end_ + new_capacity > boundary_.size()) {
+            boundary_.resize(
+                std::max(2 * boundary_.size(), arena_end_ + new_capacity), -1);
+        }
+        std::copy(boundary_.begin() + old_start,
+                  boundary_.begin() + old_start +
+                      boundary_sizes_[cluster_stride],
+                  boundary_.begin() + arena_end_);
+
+        boundary_starts_[cluster_stride] = arena_end_;
+        boundary_capacities_[cluster_stride] = new_capacity;
+        arena_end_ += new_capacity;
+    }
+
+    inline void InitSegment_(size_t cluster_stride) {
+        boundary_sizes_[cluster_stride] = 0;
+        boundary_starts_[cluster_stride] = 0;
+        boundary_capacities_[cluster_stride] = 0;
+    }
+
   public:
     ClusterBoundaries() = default;
 
     /**
      * @brief Constructs a ClusterBoundaries object from a vector of cluster
-     *        indices, the number of vertices, and the maximum boundary size.
+     *        indices, the number of vertices, and the initial boundary size.
      * @param clusters A vector of cluster indices.
      * @param num_vertices The number of vertices in the graph.
-     * @param max_boundary_size The maximum size of each cluster boundary.
+     * @param max_boundary_size The initial capacity of each cluster boundary.
      */
     ClusterBoundaries(
         std::vector<size_t> clusters, size_t num_vertices,
         size_t max_boundary_size,
-        const std::vector<std::pair<size_t, size_t>> &initial = {}) {
-
-        max_boundary_size_ = max_boundary_size;
-        boundary_ = std::vector<int>(clusters.size() * max_boundary_size, -1);
-        boundary_sizes_ = std::vector<size_t>(clusters.size(), 0);
-        cluster_strides_ = std::vector<int>(num_vertices, -1);
-        num_clusters_ = clusters.size();
+        const std::vector<std::pair<size_t, size_t>> &initial = {})
+        : ClusterBoundaries(num_vertices, max_boundary_size) {
 
         for (size_t i = 0; i < clusters.size(); i++) {
-            cluster_strides_[clusters[i]] = i;
+            AddCluster(clusters[i]);
         }
 
         for (auto &i : initial) {
@@ -135,46 +226,65 @@ class ClusterBoundaries {
         }
     }
 
+    /**
+     * @brief Constructs an empty ClusterBoundaries object.
+     * @param num_vertices The number of vertices in the graph.
+     * @param max_boundary_size The initial capacity of each cluster boundary.
+     * @param scratch_size The initial size of the arena.
+     * @param memory_resource The memory resource of all buffers.
+     */
     ClusterBoundaries(size_t num_vertices, size_t max_boundary_size,
-                      size_t scratch_size = 0)
-
-    {
-        num_clusters_ = 0;
-        max_boundary_size_ = max_boundary_size;
-        if (scratch_size == 0)
-            scratch_size = num_vertices * max_boundary_size;
-        boundary_ = std::vector<int>(scratch_size, -1);
-        boundary_sizes_ = std::vector<size_t>(num_vertices, 0);
-        cluster_strides_ = std::vector<int>(num_vertices, -1);
-    }
+                      size_t scratch_size = 0,
+                      std::pmr::memory_resource *memory_resource =
+                          std::pmr::get_default_resource())
+        : max_boundary_size_(max_boundary_size),
+          boundary_(scratch_size == 0 ? num_vertices * max_boundary_size
+                                      : scratch_size,
+                    -1, memory_resource),
+          cluster_strides_(num_vertices, -1, memory_resource),
+          boundary_sizes_(num_vertices, 0, memory_resource),
+          boundary_starts_(num_vertices, 0, memory_resource),
+          boundary_capacities_(num_vertices, 0, memory_resource),
+          num_clusters_(0), arena_end_(0) {}
 
     inline void AddCluster(size_t cluster_id) {
         cluster_strides_[cluster_id] = num_clusters_;
+        InitSegment_(num_clusters_);
         num_clusters_++;
     }
 
+    /**
+     * @brief Removes all clusters while keeping the arena allocated.
+     */
+    inline void Reset() {
+        num_clusters_ = 0;
+        arena_end_ = 0;
+    }
+
     inline bool IsEmpty() { return boundary_.empty(); }
 
     inline void Add(size_t cluster, size_t global_boundary_vertex_id) {
         size_t cluster_stride = cluster_strides_[cluster];
         size_t boundary_stride = boundary_sizes_[cluster_stride];
-        boundary_[cluster_stride * max_boundary_size_ + boundary_stride] =
+        if (boundary_stride == boundary_capacities_[cluster_stride]) {
+            Grow_(cluster_stride);
+        }
+        boundary_[boundary_starts_[cluster_stride] + boundary_stride] =
             global_boundary_vertex_id;
         boundary_sizes_[cluster_stride]++;
     }
 
     inline void Remove(size_t cluster, size_t local_boundary_vertex_id) {
         size_t cluster_stride = cluster_strides_[cluster];
-        boundary_[cluster_stride * max_boundary_size_ +
+        boundary_[boundary_starts_[cluster_stride] +
                   local_boundary_vertex_id] = -1;
     }
 
     inline auto GetBoundary(size_t cluster) {
         size_t cluster_stride = cluster_strides_[cluster];
-        size_t boundary_stride = boundary_sizes_[cluster_stride];
-        return ClusterBoundary(boundary_, cluster_stride * max_boundary_size_,
-                               cluster_stride * max_boundary_size_ +
-                                   boundary_stride);
+        size_t start = boundary_starts_[cluster_stride];
+        return ClusterBoundary(boundary_, start,
+                               start + boundary_sizes_[cluster_stride]);
     }
 
     void Merge(size_t x, size_t y) {
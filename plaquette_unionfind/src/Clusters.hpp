@@ -1,13 +1,19 @@
 #pragma once
 
+#include <memory_resource>
 #include <queue>
 #include <vector>
 
 #include "ClusterBoundary.hpp"
+#include "DecoderStatistics.hpp"
+#include "DecoderTrace.hpp"
 #include "DecodingGraph.hpp"
+#include "GraphConcepts.hpp"
 #include "LatticeVisualizer.hpp"
+#include "PaddedAdjacency.hpp"
 #include "StabilizerCode.hpp"
 #include "Types.hpp"
+#include "VertexState.hpp"
 
 namespace Plaquette {
 
@@ -41,84 +47,190 @@ using PriorityQueue =
  * @brief Represents a set of clusters used in decoding a quantum
  * error-correcting code.
  *
+ * @tparam Graph The decoding graph type, e.g. DecodingGraph or LatticeGraph.
  */
-class Clusters {
+template <DecodingGraphLike Graph> class BasicClusters {
   private:
-    DecodingGraph
-        decoding_graph_; ///< The decoding graph used to construct the clusters.
+    Graph decoding_graph_; ///< The decoding graph used to construct the
+                           ///< clusters.
+    PaddedAdjacency adjacency_; ///< Fixed-width rows of low-degree graphs.
+    bool use_fixed_degree_ = true;
 
     float max_growth_;
-    std::vector<int>
-        vertex_to_cluster_id_;       ///< Mapping from vertex ID to cluster ID.
-    std::vector<float> edge_growth_; ///< The growth of each edge.
-    std::vector<float>
+    VertexState vertex_state_; ///< Parent, cluster parity and growth, and
+                               ///< physical boundary flag of each vertex.
+    std::pmr::vector<float> edge_growth_; ///< The growth of each edge.
+    std::pmr::vector<float>
         edge_growth_increment_; ///< The increment in growth for each edge.
-    std::vector<int> cluster_parity_;     ///< The parity of each cluster.
-    std::vector<bool> fully_grown_edges_; ///< Indicates which edges have
-                                          ///< reached maximum growth.
-
-    std::vector<float>
-        cluster_growth_; ///< The growth (sum of edge lengths) of each cluster.
+    std::pmr::vector<bool> fully_grown_edges_; ///< Indicates which edges have
+                                               ///< reached maximum growth.
     std::vector<bool> syndrome_;
 
     std::vector<size_t> initial_clusters_;
     // std::vector<size_t> num_fully_grown_edges_;
-    std::vector<bool> physical_boundary_vertices_;
     size_t num_physical_boundary_vertices_;
 
     ClusterBoundaries cluster_boundary_;
     PriorityQueue<size_t, float, size_t> grow_queue_;
+    std::vector<size_t> edges_to_fuse_; ///< Reused result of GrowCluster.
+    std::vector<size_t> cluster_sizes_; ///< Scratch of RecordClusterSizes.
+    std::vector<bool> syndrome_visited_; ///< Scratch of InitEdgesRecursive_.
+    std::vector<bool> edges_visited_;    ///< Scratch of InitEdgesRecursive_.
+
+    DecoderStatistics statistics_; ///< Only updated if statistics are enabled.
+
+    /**
+     * @brief Builds fixed-width rows for graphs stored in memory. Graphs that
+     * compute their neighbours do not need them.
+     */
+    static PaddedAdjacency
+    MakePaddedAdjacency_(const Graph &decoding_graph,
+                         std::pmr::memory_resource *memory_resource) {
+        if constexpr (ComputesNeighbours<Graph>) {
+            return PaddedAdjacency();
+        } else {
+            return PaddedAdjacency(decoding_graph, memory_resource);
+        }
+    }
+
+    /**
+     * @brief Calls function with the fixed row width as a compile-time
+     * constant, or with 0 for the CSR rows.
+     */
+    template <typename Function>
+    decltype(auto) DispatchDegree_(Function &&function) const {
+        if (!use_fixed_degree_) {
+            return function(std::integral_constant<size_t, 0>());
+        }
+        return adjacency_.Dispatch(function);
+    }
+
+    /**
+     * @brief Calls function(edge, neighbour) for every edge of a vertex.
+     *
+     * @tparam MaxDegree The row width, or 0 for the rows of the graph.
+     */
+    template <size_t MaxDegree, typename Function>
+    void ForEachNeighbour_(size_t vertex_id, Function &&function) const {
+        if constexpr (MaxDegree == 0) {
+            ForEachNeighbour(decoding_graph_, vertex_id, function);
+        } else {
+            auto row = adjacency_.GetRow<MaxDegree>(vertex_id);
+            size_t num_edges = row.size();
+            for (size_t i = 0; i < MaxDegree; ++i) {
+                if (i < num_edges) {
+                    function(row.GetEdge(i), row.GetVertex(i));
+                }
+            }
+        }
+    }
+
+    template <size_t MaxDegree>
+    bool IsVertexNotFullyGrown_(size_t vertex_id) const {
+        bool not_fully_grown = false;
+        ForEachNeighbour_<MaxDegree>(vertex_id, [&](size_t edge, size_t) {
+            not_fully_grown |= !fully_grown_edges_[edge];
+        });
+        return not_fully_grown;
+    }
 
   public:
     /**
-     * @brief Constructs a new `Clusters`.
+     * @brief Constructs a new cluster set.
      *
      * @param decoding_graph The decoding graph used to construct the clusters.
      * @param initial_cluster_roots The initial cluster roots.
      * @param initial_cluster_edges The initial cluster edges.
      * @param edge_growth_increments The increments in growth for each edge.
      * @param max_growth The maximum growth for each edge.
+     * @param memory_resource The memory resource of the per-vertex and
+     * per-edge arrays, e.g. a HugePageArena. It must outlive the clusters.
      */
-    Clusters(const DecodingGraph &decoding_graph,
-             const std::vector<bool> &syndrome = {},
-             const std::vector<bool> &initial_cluster_edges = {},
-             const std::vector<float> &edge_growth_increment = {},
-             float max_growth = 2.0)
-        : decoding_graph_(decoding_graph), syndrome_(syndrome) {
-
-        syndrome_ = syndrome;
-        max_growth_ = max_growth;
-        cluster_growth_ =
-            std::vector<float>(decoding_graph.GetNumVertices(), 0.0);
-
-        edge_growth_increment_ =
-            edge_growth_increment.empty()
-                ? std::vector<float>(decoding_graph.GetNumEdges(), 1.0)
-                : edge_growth_increment;
-
-        fully_grown_edges_ =
-            initial_cluster_edges.empty()
-                ? std::vector<bool>(decoding_graph.GetNumEdges(), false)
-                : initial_cluster_edges;
-
-        physical_boundary_vertices_ =
-            std::vector<bool>(decoding_graph.GetNumVertices(), false);
-
-        // num_fully_grown_edges_ =
-        // std::vector<size_t>(decoding_graph.GetNumVertices(), 0);
-        edge_growth_ = std::vector<float>(decoding_graph.GetNumEdges(), 0.0);
-        cluster_parity_ = std::vector<int>(decoding_graph.GetNumVertices(), 0);
-        vertex_to_cluster_id_ =
-            std::vector<int>(decoding_graph.GetNumVertices(), -1);
+    BasicClusters(const Graph &decoding_graph,
+                  const std::vector<bool> &syndrome = {},
+                  const std::vector<bool> &initial_cluster_edges = {},
+                  const std::vector<float> &edge_growth_increment = {},
+                  float max_growth = 2.0,
+                  std::pmr::memory_resource *memory_resource =
+                      std::pmr::get_default_resource())
+        : decoding_graph_(decoding_graph),
+          adjacency_(MakePaddedAdjacency_(decoding_graph, memory_resource)),
+          max_growth_(max_growth),
+          vertex_state_(decoding_graph.GetNumVertices(), memory_resource),
+          edge_growth_(decoding_graph.GetNumEdges(), 0.0, memory_resource),
+          edge_growth_increment_(decoding_graph.GetNumEdges(), 1.0,
+                                 memory_resource),
+          fully_grown_edges_(decoding_graph.GetNumEdges(), false,
+                             memory_resource),
+          syndrome_(syndrome),
+          num_physical_boundary_vertices_(0),
+          cluster_boundary_(decoding_graph.GetNumVertices(), 8,
+                            4 * decoding_graph.GetNumVertices(),
+                            memory_resource) {
+
+        if (!edge_growth_increment.empty()) {
+            edge_growth_increment_.assign(edge_growth_increment.begin(),
+                                          edge_growth_increment.end());
+        }
+        if (!initial_cluster_edges.empty()) {
+            fully_grown_edges_.assign(initial_cluster_edges.begin(),
+                                      initial_cluster_edges.end());
+        }
 
+        // Every edge becomes fully grown at most once per decoding round.
+        edges_to_fuse_.reserve(decoding_graph.GetNumEdges());
+        InitEdgesRecursive_(initial_cluster_edges, syndrome);
+        InitClusterRoots_(syndrome);
+    }
+
+    /**
+     * @brief Returns the cluster set to its state before any syndrome or
+     * erasure was added, so it can be reused for another decoding round
+     * without reallocating its buffers.
+     */
+    void Reset() {
+        vertex_state_.Reset();
+        std::fill(edge_growth_.begin(), edge_growth_.end(), 0.0);
+        std::fill(fully_grown_edges_.begin(), fully_grown_edges_.end(), false);
         num_physical_boundary_vertices_ = 0;
+        initial_clusters_.clear();
+        cluster_boundary_.Reset();
+        while (!grow_queue_.empty()) {
+            grow_queue_.pop();
+        }
+    }
 
-        size_t num_vertices = decoding_graph.GetNumVertices();
-        size_t max_boundary_size = num_vertices * 6;
+    /**
+     * @brief Returns true if clusters have been added since the last reset.
+     */
+    bool IsDirty() const { return !initial_clusters_.empty(); }
 
-        cluster_boundary_ = ClusterBoundaries(num_vertices, max_boundary_size);
-        InitEdgesRecursive_(initial_cluster_edges, syndrome);
-        InitClusterRoots_(syndrome);
+    const auto &GetStatistics() const { return statistics_; }
+    auto &GetStatistics() { return statistics_; }
+
+    /**
+     * @brief Adds the size of every cluster to the cluster size histogram of
+     * the statistics. The parent pointers are followed without compressing
+     * them, so the find statistics are not affected.
+     */
+    void RecordClusterSizes() {
+        auto &sizes = cluster_sizes_;
+        sizes.assign(vertex_state_.size(), 0);
+        for (size_t v = 0; v < vertex_state_.size(); v++) {
+            if (vertex_state_.ClusterId(v) == -1) {
+                continue;
+            }
+            size_t root = v;
+            while (static_cast<size_t>(vertex_state_.ClusterId(root)) != root) {
+                root = static_cast<size_t>(vertex_state_.ClusterId(root));
+            }
+            sizes[root]++;
+        }
+        for (auto size : sizes) {
+            if (size > 0) {
+                statistics_.RecordClusterSize(size);
+            }
+        }
     }
 
     auto &GetClusterBoundary() { return cluster_boundary_; }
@@ -128,7 +240,9 @@ class Clusters {
 
     const auto &GetEdgeGrowth() const { return edge_growth_; }
 
-    const auto &GetClusterGrowth() const { return cluster_growth_; }
+    decltype(auto) GetClusterGrowth() const {
+        return vertex_state_.GetGrowths();
+    }
 
     const auto &GetMaxGrowth() const { return max_growth_; }
 
@@ -136,17 +250,21 @@ class Clusters {
         return edge_growth_increment_;
     }
 
-    const auto &GetPhysicalBoundaryVertices() const {
-        return physical_boundary_vertices_;
+    decltype(auto) GetPhysicalBoundaryVertices() const {
+        return vertex_state_.GetPhysicalBoundary();
     }
 
     auto GetNumPhysicalBoundaryVertices() const {
         return num_physical_boundary_vertices_;
     }
 
-    const auto &GetVertexToClusterId() const { return vertex_to_cluster_id_; }
+    decltype(auto) GetVertexToClusterId() const {
+        return vertex_state_.GetClusterIds();
+    }
 
-    const auto &GetClusterParity() const { return cluster_parity_; }
+    decltype(auto) GetClusterParity() const {
+        return vertex_state_.GetParities();
+    }
 
     const auto &GetInitialClusters() const { return initial_clusters_; }
 
@@ -156,7 +274,7 @@ class Clusters {
      *
      * @return The vector of fully grown edges.
      */
-    const std::vector<bool> &GetFullyGrownEdges() const {
+    const auto &GetFullyGrownEdges() const {
         return fully_grown_edges_;
     }
 
@@ -175,13 +293,30 @@ class Clusters {
      * otherwise.
      */
     bool IsVertexNotFullyGrown(size_t vertex_id) const {
-        const auto &edges = decoding_graph_.GetEdgesTouchingVertex(vertex_id);
-        size_t fully_grown = 0;
-        for (size_t edge_id = 0; edge_id < edges.size(); edge_id++) {
-            fully_grown += fully_grown_edges_[edges[edge_id]];
-        }
-        return fully_grown < edges.size();
+        return DispatchDegree_([&](auto max_degree) {
+            return IsVertexNotFullyGrown_<max_degree>(vertex_id);
+        });
+    }
+
+    /**
+     * @brief Enables or disables the fixed-width adjacency rows, e.g. to
+     * compare both code paths. They are enabled by default.
+     */
+    void SetFixedDegreeRows(bool enabled) { use_fixed_degree_ = enabled; }
+
+    /**
+     * @brief Returns the row width the cluster loops are specialized for, or
+     * 0 if they use the rows of the decoding graph.
+     */
+    size_t GetFixedDegree() const {
+        return use_fixed_degree_ ? adjacency_.GetMaxDegree() : 0;
     }
+
+    /**
+     * @brief Returns the fixed-width adjacency rows of the decoding graph.
+     */
+    const auto &GetPaddedAdjacency() const { return adjacency_; }
+
     /**
      * @brief Add an edge to a cluster in the cluster set.
      *
@@ -201,12 +336,12 @@ class Clusters {
                            std::vector<bool> &syndrome_visited) {
         const auto &vertices =
             decoding_graph_.GetVerticesConnectedByEdge(edge_id);
-        vertex_to_cluster_id_[vertices.first] = cluster_id;
-        vertex_to_cluster_id_[vertices.second] = cluster_id;
+        vertex_state_.ClusterId(vertices.first) = cluster_id;
+        vertex_state_.ClusterId(vertices.second) = cluster_id;
 
-        cluster_parity_[cluster_id] +=
+        vertex_state_.Parity(cluster_id) +=
             !syndrome_visited[vertices.first] * syndrome[vertices.first];
-        cluster_parity_[cluster_id] +=
+        vertex_state_.Parity(cluster_id) +=
             !syndrome_visited[vertices.second] * syndrome[vertices.second];
 
         syndrome_visited[vertices.first] = true;
@@ -214,7 +349,7 @@ class Clusters {
 
         edge_growth_[edge_id] = max_growth_;
         fully_grown_edges_[edge_id] = true;
-        cluster_growth_[cluster_id] += max_growth_;
+        vertex_state_.Growth(cluster_id) += max_growth_;
         // num_fully_grown_edges_[cluster_id] += 1;
 
         if (IsVertexNotFullyGrown(vertices.first)) {
@@ -224,14 +359,14 @@ class Clusters {
             cluster_boundary_.Add(cluster_id, vertices.second);
         }
         if (decoding_graph_.IsVertexOnBoundary(vertices.first)) {
-            physical_boundary_vertices_[vertices.first] = true;
+            vertex_state_.SetPhysicalBoundary(vertices.first);
             num_physical_boundary_vertices_++;
-            cluster_parity_[cluster_id] = -1;
+            vertex_state_.Parity(cluster_id) = -1;
         }
         if (decoding_graph_.IsVertexOnBoundary(vertices.second)) {
-            physical_boundary_vertices_[vertices.second] = true;
+            vertex_state_.SetPhysicalBoundary(vertices.second);
             num_physical_boundary_vertices_++;
-            cluster_parity_[cluster_id] = -1;
+            vertex_state_.Parity(cluster_id) = -1;
         }
     }
 
@@ -253,8 +388,10 @@ class Clusters {
         if (initial_edges.empty()) {
             return;
         }
-        std::vector<bool> syndrome_visited(syndrome.size(), false);
-        std::vector<bool> edges_visited(decoding_graph_.GetNumEdges(), false);
+        auto &syndrome_visited = syndrome_visited_;
+        auto &edges_visited = edges_visited_;
+        syndrome_visited.assign(syndrome.size(), false);
+        edges_visited.assign(decoding_graph_.GetNumEdges(), false);
         for (size_t edge_id = 0; edge_id < decoding_graph_.GetNumEdges();
              edge_id++) {
             if (initial_edges[edge_id] and !edges_visited[edge_id]) {
@@ -325,9 +462,9 @@ class Clusters {
      */
     void InitClusterRoots_(const std::vector<bool> &syndrome) {
         for (size_t g = 0; g < syndrome.size(); g++) {
-            if (syndrome[g] && vertex_to_cluster_id_[g] == -1) {
-                vertex_to_cluster_id_[g] = g;
-                cluster_parity_[g] = 1;
+            if (syndrome[g] && vertex_state_.ClusterId(g) == -1) {
+                vertex_state_.ClusterId(g) = g;
+                vertex_state_.Parity(g) = 1;
                 cluster_boundary_.AddCluster(g);
                 cluster_boundary_.Add(g, g);
                 initial_clusters_.emplace_back(g);
@@ -352,46 +489,53 @@ class Clusters {
      *
      * @param cluster_id The ID of the cluster to grow.
      *
-     * @return A vector of IDs of possible edges to fuse.
+     * @return A vector of IDs of possible edges to fuse. It is owned by the
+     * cluster set and overwritten by the next call.
      */
-    std::vector<size_t> GrowCluster(size_t cluster_id) {
-        std::vector<size_t> possible_edges_to_fuse;
-        auto &&cbv = cluster_boundary_.GetBoundary(cluster_id);
+    const std::vector<size_t> &GrowCluster(size_t cluster_id) {
+        return DispatchDegree_(
+            [&](auto max_degree) -> const std::vector<size_t> & {
+                return GrowCluster_<max_degree>(cluster_id);
+            });
+    }
 
-        for (auto &boundary : cbv) {
-            const auto &global_edge_ids =
-                decoding_graph_.GetEdgesTouchingVertex(boundary);
-            const auto &vertex_ids =
-                decoding_graph_.GetVerticesTouchingVertex(boundary);
-            size_t num_edges = global_edge_ids.size();
-            for (size_t i = 0; i < num_edges; ++i) {
-                if (!fully_grown_edges_[global_edge_ids[i]]) {
-                    edge_growth_[global_edge_ids[i]] +=
-                        edge_growth_increment_[global_edge_ids[i]];
-
-                    cluster_growth_[cluster_id] +=
-                        edge_growth_increment_[global_edge_ids[i]];
-
-                    if (edge_growth_[global_edge_ids[i]] >= max_growth_) {
-                        fully_grown_edges_[global_edge_ids[i]] = true;
-                        // num_fully_grown_edges_[cluster_id]++;
-
-                        if (vertex_to_cluster_id_[vertex_ids[i]] == -1) {
-                            vertex_to_cluster_id_[vertex_ids[i]] = cluster_id;
-                            cluster_boundary_.Add(cluster_id, vertex_ids[i]);
-                            if (decoding_graph_.IsVertexOnBoundary(
-                                    vertex_ids[i])) {
-                                cluster_parity_[cluster_id] = -1;
-                                physical_boundary_vertices_[vertex_ids[i]] =
-                                    true;
-                                num_physical_boundary_vertices_++;
-                            }
-                            continue;
+    template <size_t MaxDegree>
+    const std::vector<size_t> &GrowCluster_(size_t cluster_id) {
+        auto &possible_edges_to_fuse = edges_to_fuse_;
+        possible_edges_to_fuse.clear();
+        auto &&cbv = cluster_boundary_.GetBoundary(cluster_id);
+        PLAQUETTE_UNIONFIND_STATISTICS({
+            statistics_.num_growth_iterations++;
+            statistics_.RecordBoundarySize(cbv.size());
+        })
+
+        for (auto boundary : cbv) {
+            ForEachNeighbour_<MaxDegree>(boundary, [&](size_t edge_id,
+                                                       size_t vertex_id) {
+                if (fully_grown_edges_[edge_id]) {
+                    return;
+                }
+                edge_growth_[edge_id] += edge_growth_increment_[edge_id];
+                vertex_state_.Growth(cluster_id) +=
+                    edge_growth_increment_[edge_id];
+
+                if (edge_growth_[edge_id] >= max_growth_) {
+                    fully_grown_edges_[edge_id] = true;
+                    // num_fully_grown_edges_[cluster_id]++;
+
+                    if (vertex_state_.ClusterId(vertex_id) == -1) {
+                        vertex_state_.ClusterId(vertex_id) = cluster_id;
+                        cluster_boundary_.Add(cluster_id, vertex_id);
+                        if (decoding_graph_.IsVertexOnBoundary(vertex_id)) {
+                            vertex_state_.Parity(cluster_id) = -1;
+                            vertex_state_.SetPhysicalBoundary(vertex_id);
+                            num_physical_boundary_vertices_++;
                         }
-                        possible_edges_to_fuse.emplace_back(global_edge_ids[i]);
+                        return;
                     }
+                    possible_edges_to_fuse.emplace_back(edge_id);
                 }
-            }
+            });
         }
         return possible_edges_to_fuse;
     }
@@ -409,14 +553,17 @@ class Clusters {
      * -1 if the vertex does not belong to a cluster.
      */
     int FindClusterRoot(size_t vertex_id) {
-        if (vertex_to_cluster_id_[vertex_id] == -1)
+        if (vertex_state_.ClusterId(vertex_id) == -1)
             return -1;
-        while (vertex_to_cluster_id_.at(vertex_id) != vertex_id) {
+        PLAQUETTE_UNIONFIND_STATISTICS(uint64_t path_length = 0;)
+        while (vertex_state_.ClusterId(vertex_id) != vertex_id) {
+            PLAQUETTE_UNIONFIND_STATISTICS(path_length++;)
             auto old_vertex_id = vertex_id;
-            vertex_id = vertex_to_cluster_id_.at(old_vertex_id);
-            vertex_to_cluster_id_.at(old_vertex_id) =
-                vertex_to_cluster_id_.at(vertex_id);
+            vertex_id = vertex_state_.ClusterId(old_vertex_id);
+            vertex_state_.ClusterId(old_vertex_id) =
+                vertex_state_.ClusterId(vertex_id);
         }
+        PLAQUETTE_UNIONFIND_STATISTICS(statistics_.RecordFindPath(path_length);)
         return vertex_id;
     }
 
@@ -433,12 +580,17 @@ class Clusters {
      * @param y The ID of the second cluster to merge.
      */
     void MergeBoundaryVertices_(size_t x, size_t y) {
-        for (auto &vertex_y : cluster_boundary_.GetBoundary(y)) {
-            const auto &edges =
-                decoding_graph_.GetEdgesTouchingVertex(vertex_y);
-            if (IsVertexNotFullyGrown(vertex_y)) {
+        DispatchDegree_([&](auto max_degree) {
+            MergeBoundaryVertices_<max_degree>(x, y);
+        });
+    }
+
+    template <size_t MaxDegree>
+    void MergeBoundaryVertices_(size_t x, size_t y) {
+        for (auto vertex_y : cluster_boundary_.GetBoundary(y)) {
+            if (IsVertexNotFullyGrown_<MaxDegree>(vertex_y)) {
                 cluster_boundary_.Add(x, vertex_y);
-                vertex_to_cluster_id_[vertex_y] = x;
+                vertex_state_.ClusterId(vertex_y) = x;
             }
         }
     }
@@ -455,9 +607,15 @@ class Clusters {
      * check.
      */
     void CheckBoundaryVertices(size_t cluster_id) {
+        DispatchDegree_([&](auto max_degree) {
+            CheckBoundaryVertices_<max_degree>(cluster_id);
+        });
+    }
+
+    template <size_t MaxDegree> void CheckBoundaryVertices_(size_t cluster_id) {
         auto &&cbv = cluster_boundary_.GetBoundary(cluster_id);
         for (size_t i = 0; i < cbv.size(); i++) {
-            if (!IsVertexNotFullyGrown(cbv[i])) {
+            if (!IsVertexNotFullyGrown_<MaxDegree>(cbv[i])) {
                 cluster_boundary_.Remove(cluster_id, i);
             }
         }
@@ -485,15 +643,17 @@ class Clusters {
         if (cluster_boundary_.GetSize(x) < cluster_boundary_.GetSize(y)) {
             std::swap(x, y);
         }
+        PLAQUETTE_UNIONFIND_STATISTICS(statistics_.num_merges++;)
+        PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event("merge", x);)
 
-        vertex_to_cluster_id_[y] = x;
-        cluster_growth_[x] += cluster_growth_[y];
+        vertex_state_.ClusterId(y) = x;
+        vertex_state_.Growth(x) += vertex_state_.Growth(y);
         // num_fully_grown_edges_[x] += num_fully_grown_edges_[y];
 
-        if (cluster_parity_[x] >= 0 and cluster_parity_[y] >= 0) {
-            cluster_parity_[x] += cluster_parity_[y];
+        if (vertex_state_.Parity(x) >= 0 and vertex_state_.Parity(y) >= 0) {
+            vertex_state_.Parity(x) += vertex_state_.Parity(y);
         } else {
-            cluster_parity_[x] = -1;
+            vertex_state_.Parity(x) = -1;
         }
 
         MergeBoundaryVertices_(x, y);
@@ -504,9 +664,9 @@ class Clusters {
 
     void AddToGrowQueue(size_t cluster_id) {
         auto boundary_size = cluster_boundary_.GetSize(cluster_id);
-        auto edge_length_size = cluster_growth_[cluster_id];
-        if (vertex_to_cluster_id_[cluster_id] == cluster_id and
-            cluster_parity_[cluster_id] % 2 == 1) {
+        auto edge_length_size = vertex_state_.Growth(cluster_id);
+        if (vertex_state_.ClusterId(cluster_id) == cluster_id and
+            vertex_state_.Parity(cluster_id) % 2 == 1) {
             grow_queue_.push({boundary_size, edge_length_size, cluster_id});
         }
     }
@@ -522,10 +682,13 @@ class Clusters {
             auto top_edge_length_size = std::get<1>(top);
             auto top_cluster_id = std::get<2>(top);
 
-            while (vertex_to_cluster_id_[top_cluster_id] != top_cluster_id or
+            while (vertex_state_.ClusterId(top_cluster_id) != top_cluster_id or
                    cluster_boundary_.GetSize(top_cluster_id) !=
                        top_boundary_size or
-                   cluster_growth_[top_cluster_id] != top_edge_length_size) {
+                   vertex_state_.Growth(top_cluster_id) !=
+                       top_edge_length_size) {
+                PLAQUETTE_UNIONFIND_STATISTICS(
+                    statistics_.num_stale_queue_pops++;)
 
                 if (grow_queue_.empty()) {
                     return -1;
@@ -570,7 +733,7 @@ class Clusters {
         size_t k = 0;
         for (size_t cc = 0; cc < initial_clusters_.size(); cc++) {
 
-            if (vertex_to_cluster_id_[initial_clusters_[cc]] !=
+            if (vertex_state_.ClusterId(initial_clusters_[cc]) !=
                 initial_clusters_[cc])
                 continue;
 
@@ -589,10 +752,10 @@ class Clusters {
 
             for (size_t v = 0; v < decoding_graph_.GetNumVertices(); ++v) {
 
-                if (vertex_to_cluster_id_[v] == c) {
+                if (vertex_state_.ClusterId(v) == c) {
                     size_t v_stride = decoding_graph_.GetLocalEdgeStride(v);
 
-                    if (vertex_to_cluster_id_[v] == c and v != c) {
+                    if (vertex_state_.ClusterId(v) == c and v != c) {
                         VertexPrintProps vpp;
                         vpp.vertex = coords[v];
                         vpp.marker = "o";
@@ -644,4 +807,7 @@ class Clusters {
         return lv;
     };
 };
+
+using Clusters = BasicClusters<DecodingGraph>;
+
 }; // namespace Plaquette
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+/**
+ * Decoder statistics are opt-in. When PLAQUETTE_UNIONFIND_ENABLE_STATISTICS is
+ * not defined, every statement wrapped in PLAQUETTE_UNIONFIND_STATISTICS is
+ * removed by the preprocessor, so the decoder hot paths are unchanged.
+ */
+#ifdef PLAQUETTE_UNIONFIND_ENABLE_STATISTICS
+#define PLAQUETTE_UNIONFIND_STATISTICS(statement) statement
+#else
+#define PLAQUETTE_UNIONFIND_STATISTICS(statement)
+#endif
+
+namespace Plaquette {
+
+/**
+ * @brief Reads a cheap monotonically increasing cycle counter.
+ *
+ * This is the time stamp counter on x86 and the steady clock in nanoseconds
+ * elsewhere, so values are only comparable on the same machine.
+ */
+inline uint64_t ReadCycleCounter() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) ||           \
+    defined(_M_IX86)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+/**
+ * @brief Counters and per-stage cycle counts collected by UnionFindDecoder.
+ *
+ * All members are totals over every shot decoded since the last Reset(), so
+ * statistics of several decoders (e.g. one per worker thread) can be combined
+ * with Merge().
+ */
+struct DecoderStatistics {
+
+    /**
+     * @brief True if the library was compiled with statistics enabled.
+     */
+#ifdef PLAQUETTE_UNIONFIND_ENABLE_STATISTICS
+    static constexpr bool kEnabled = true;
+#else
+    static constexpr bool kEnabled = false;
+#endif
+
+    /**
+     * @brief The decoder stages that are timed separately.
+     */
+    enum class Stage {
+        InitErasure,
+        InitClusterRoots,
+        GrowCluster,
+        FindClusterRoot,
+        MergeClusters,
+        CheckBoundaryVertices,
+        SpanningForest,
+        PeelForest,
+        Count
+    };
+    static constexpr size_t kNumStages = static_cast<size_t>(Stage::Count);
+    static constexpr size_t kNumHistogramBuckets = 32;
+
+    std::array<uint64_t, kNumStages> stage_cycles{}; ///< Cycles per stage.
+
+    uint64_t num_shots = 0;             ///< Number of decoded shots.
+    uint64_t num_growth_iterations = 0; ///< Number of grown clusters.
+    uint64_t num_merges = 0;            ///< Number of cluster merges.
+    uint64_t num_find_calls = 0;        ///< Number of FindClusterRoot calls.
+    uint64_t find_path_length_total = 0; ///< Sum of root path lengths.
+    uint64_t find_path_length_max = 0;   ///< Longest root path.
+    uint64_t num_stale_queue_pops = 0; ///< Outdated grow queue entries.
+    uint64_t boundary_size_total = 0;  ///< Sum of boundary sizes when grown.
+    uint64_t boundary_size_max = 0;    ///< Largest boundary that was grown.
+
+    /**
+     * @brief Number of final clusters with between 2^k and 2^(k+1) - 1
+     * vertices in bucket k.
+     */
+    std::array<uint64_t, kNumHistogramBuckets> cluster_size_histogram{};
+
+    /**
+     * @brief Returns the name of a stage, as used in reports.
+     */
+    static const char *GetStageName(Stage stage) {
+        static constexpr std::array<const char *, kNumStages> names = {
+            "init_erasure",    "init_cluster_roots", "grow_cluster",
+            "find_cluster_root", "merge_clusters",   "check_boundary_vertices",
+            "spanning_forest", "peel_forest"};
+        return names[static_cast<size_t>(stage)];
+    }
+
+    /**
+     * @brief Adds the cycles elapsed since start to a stage.
+     */
+    void AddStageCycles(Stage stage, uint64_t start) {
+        stage_cycles[static_cast<size_t>(stage)] += ReadCycleCounter() - start;
+    }
+
+    uint64_t GetStageCycles(Stage stage) const {
+        return stage_cycles[static_cast<size_t>(stage)];
+    }
+
+    void RecordFindPath(uint64_t length) {
+        num_find_calls++;
+        find_path_length_total += length;
+        find_path_length_max = std::max(find_path_length_max, length);
+    }
+
+    void RecordBoundarySize(uint64_t size) {
+        boundary_size_total += size;
+        boundary_size_max = std::max(boundary_size_max, size);
+    }
+
+    void RecordClusterSize(uint64_t size) {
+        size_t bucket = 0;
+        while (size > 1 && bucket + 1 < kNumHistogramBuckets) {
+            size >>= 1;
+            bucket++;
+        }
+        cluster_size_histogram[bucket]++;
+    }
+
+    /**
+     * @brief Adds the statistics of another decoder to these.
+     */
+    void Merge(const DecoderStatistics &other) {
+        for (size_t s = 0; s < kNumStages; s++) {
+            stage_cycles[s] += other.stage_cycles[s];
+        }
+        num_shots += other.num_shots;
+        num_growth_iterations += other.num_growth_iterations;
+        num_merges += other.num_merges;
+        num_find_calls += other.num_find_calls;
+        find_path_length_total += other.find_path_length_total;
+        find_path_length_max =
+            std::max(find_path_length_max, other.find_path_length_max);
+        num_stale_queue_pops += other.num_stale_queue_pops;
+        boundary_size_total += other.boundary_size_total;
+        boundary_size_max =
+            std::max(boundary_size_max, other.boundary_size_max);
+        for (size_t b = 0; b < kNumHistogramBuckets; b++) {
+            cluster_size_histogram[b] += other.cluster_size_histogram[b];
+        }
+    }
+
+    void Reset() { *this = DecoderStatistics(); }
+
+    /**
+     * @brief Writes the statistics as a JSON object.
+     */
+    void WriteJson(std::ostream &out) const {
+        out << "{\"enabled\": " << (kEnabled ? "true" : "false")
+            << ", \"num_shots\": " << num_shots << ", \"stage_cycles\": {";
+        for (size_t s = 0; s < kNumStages; s++) {
+            out << (s == 0 ? "" : ", ") << "\""
+                << GetStageName(static_cast<Stage>(s))
+                << "\": " << stage_cycles[s];
+        }
+        out << "}, \"num_growth_iterations\": " << num_growth_iterations
+            << ", \"num_merges\": " << num_merges
+            << ", \"num_find_calls\": " << num_find_calls
+            << ", \"find_path_length_total\": " << find_path_length_total
+            << ", \"find_path_length_max\": " << find_path_length_max
+            << ", \"num_stale_queue_pops\": " << num_stale_queue_pops
+            << ", \"boundary_size_total\": " << boundary_size_total
+            << ", \"boundary_size_max\": " << boundary_size_max
+            << ", \"cluster_size_histogram\": [";
+        for (size_t b = 0; b < kNumHistogramBuckets; b++) {
+            out << (b == 0 ? "" : ", ") << cluster_size_histogram[b];
+        }
+        out << "]}";
+    }
+};
+
+}; // namespace Plaquette
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+/**
+ * Event tracing is opt-in. When PLAQUETTE_UNIONFIND_ENABLE_TRACING is not
+ * defined, every statement wrapped in PLAQUETTE_UNIONFIND_TRACE is removed by
+ * the preprocessor and the decoder records nothing.
+ */
+#ifdef PLAQUETTE_UNIONFIND_ENABLE_TRACING
+#define PLAQUETTE_UNIONFIND_TRACE(statement) statement
+#else
+#define PLAQUETTE_UNIONFIND_TRACE(statement)
+#endif
+
+namespace Plaquette {
+
+/**
+ * @brief A single complete event of the timeline.
+ */
+struct TraceEvent {
+    const char *name;     ///< Static string naming the event.
+    uint64_t start_ns;    ///< Start time since the recorder was created.
+    uint64_t duration_ns; ///< Duration of the event.
+    int64_t id;           ///< Cluster, edge or shot the event refers to.
+};
+
+/**
+ * @brief Fixed-size ring buffer of the events of one thread. Once full, the
+ * oldest events are overwritten, so a trace always holds the most recent
+ * part of a long run.
+ */
+class TraceBuffer {
+  private:
+    std::vector<TraceEvent> events_;
+    size_t num_recorded_ = 0;
+    size_t thread_index_;
+
+  public:
+    TraceBuffer(size_t capacity, size_t thread_index)
+        : events_(std::max<size_t>(capacity, 1)), thread_index_(thread_index) {}
+
+    void Record(const TraceEvent &event) {
+        events_[num_recorded_ % events_.size()] = event;
+        num_recorded_++;
+    }
+
+    size_t GetThreadIndex() const { return thread_index_; }
+    size_t GetCapacity() const { return events_.size(); }
+    size_t GetNumRecorded() const { return num_recorded_; }
+    size_t GetSize() const { return std::min(num_recorded_, events_.size()); }
+
+    /**
+     * @brief Returns the i-th retained event, oldest first.
+     */
+    const TraceEvent &operator[](size_t i) const {
+        size_t first = num_recorded_ - GetSize();
+        return events_[(first + i) % events_.size()];
+    }
+
+    void Clear() { num_recorded_ = 0; }
+};
+
+/**
+ * @brief Owns the trace buffers of all threads and exports them as Chrome
+ * trace-event JSON, which can be opened in Perfetto or chrome://tracing.
+ *
+ * Each thread lazily gets its own buffer on its first event, so recording
+ * never takes a lock. When a thread exits its buffer is handed to the next
+ * new thread, so short-lived workers of successive batches share one
+ * timeline row per concurrent thread. Buffers must not be exported or cleared
+ * while other threads are still recording.
+ */
+class TraceRecorder {
+  private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers_;
+    std::vector<TraceBuffer *> free_buffers_;
+    size_t buffer_capacity_ = size_t(1) << 16;
+    std::chrono::steady_clock::time_point origin_ =
+        std::chrono::steady_clock::now();
+
+    static void WriteMicroseconds_(std::ostream &out, uint64_t ns) {
+        const char fraction[4] = {char('0' + ns % 1000 / 100),
+                                  char('0' + ns % 100 / 10),
+                                  char('0' + ns % 10), '\0'};
+        out << ns / 1000 << "." << fraction;
+    }
+
+    TraceRecorder() = default;
+
+    /**
+     * @brief Returns the buffer of an exiting thread to the free list.
+     */
+    struct ThreadHandle_ {
+        TraceBuffer *buffer = nullptr;
+        ~ThreadHandle_() {
+            if (buffer != nullptr) {
+                auto &recorder = Get();
+                std::lock_guard<std::mutex> lock(recorder.mutex_);
+                recorder.free_buffers_.push_back(buffer);
+            }
+        }
+    };
+
+  public:
+    /**
+     * @brief Returns the process-wide recorder.
+     */
+    static TraceRecorder &Get() {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    /**
+     * @brief Returns the buffer of the calling thread, creating it on first
+     * use.
+     */
+    TraceBuffer &GetThreadBuffer() {
+        thread_local ThreadHandle_ handle;
+        if (handle.buffer == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_buffers_.empty()) {
+                buffers_.push_back(std::make_unique<TraceBuffer>(
+                    buffer_capacity_, buffers_.size()));
+                handle.buffer = buffers_.back().get();
+            } else {
+                auto lowest = std::min_element(
+                    free_buffers_.begin(), free_buffers_.end(),
+                    [](const TraceBuffer *a, const TraceBuffer *b) {
+                        return a->GetThreadIndex() < b->GetThreadIndex();
+                    });
+                handle.buffer = *lowest;
+                free_buffers_.erase(lowest);
+            }
+        }
+        return *handle.buffer;
+    }
+
+    /**
+     * @brief Sets the number of events kept per thread. Only affects
+     * buffers that have not been created yet.
+     */
+    void SetBufferCapacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_capacity_ = capacity;
+    }
+
+    /**
+     * @brief Nanoseconds since the recorder was created.
+     */
+    uint64_t Now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - origin_)
+            .count();
+    }
+
+    void Record(const char *name, uint64_t start_ns, int64_t id = -1) {
+        GetThreadBuffer().Record({name, start_ns, Now() - start_ns, id});
+    }
+
+    /**
+     * @brief Drops all recorded events, keeping the thread buffers.
+     */
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &buffer : buffers_) {
+            buffer->Clear();
+        }
+    }
+
+    /**
+     * @brief Writes all retained events as a Chrome trace-event JSON object.
+     * Times are converted to the microseconds the format expects.
+     */
+    void WriteChromeTrace(std::ostream &out) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+        bool first = true;
+        for (const auto &buffer : buffers_) {
+            size_t tid = buffer->GetThreadIndex();
+            out << (first ? "\n" : ",\n")
+                << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                << "\"tid\": " << tid
+                << ", \"args\": {\"name\": \"thread " << tid << "\"}}";
+            first = false;
+            for (size_t i = 0; i < buffer->GetSize(); i++) {
+                const auto &event = (*buffer)[i];
+                out << ",\n{\"name\": \"" << event.name
+                    << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+                    << ", \"ts\": ";
+                WriteMicroseconds_(out, event.start_ns);
+                out << ", \"dur\": ";
+                WriteMicroseconds_(out, event.duration_ns);
+                if (event.id >= 0) {
+                    out << ", \"args\": {\"id\": " << event.id << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+    }
+};
+
+/**
+ * @brief Records an event spanning the lifetime of the object.
+ */
+class ScopedTraceEvent {
+  private:
+    const char *name_;
+    int64_t id_;
+    uint64_t start_ns_;
+
+  public:
+    explicit ScopedTraceEvent(const char *name, int64_t id = -1)
+        : name_(name), id_(id), start_ns_(TraceRecorder::Get().Now()) {}
+
+    ~ScopedTraceEvent() { TraceRecorder::Get().Record(name_, start_ns_, id_); }
+
+    ScopedTraceEvent(const ScopedTraceEvent &) = delete;
+    ScopedTraceEvent &operator=(const ScopedTraceEvent &) = delete;
+};
+
+}; // namespace Plaquette
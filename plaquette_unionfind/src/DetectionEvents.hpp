@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+#include "PackedBits.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief Computes the detection events of a phenomenological space-time graph
+ * from raw stabilizer measurements.
+ *
+ * The measurements of a round are a packed bitset with one bit per
+ * stabilizer, and the rounds follow each other in one buffer of
+ * GetNumRoundWords() words per round. The detection event of a stabilizer in
+ * round r is its outcome in round r XOR its outcome in round r - 1, computed
+ * a word at a time; the first round is compared against the +1 outcomes of
+ * the initial state. The final round of the graph is perfect: it is either
+ * the last measured round or, given the final readout of the data qubits,
+ * the parities of the data qubits of every stabilizer, in which case one
+ * round fewer is measured.
+ *
+ * The events are laid out as the vertices of the graph built by
+ * StabilizerCode::BuildSpaceTimeGraph_(), so they are decoded directly.
+ */
+class DetectionEventBuilder {
+
+  private:
+    size_t num_rounds_;         /**< The rounds of the graph */
+    size_t num_stabilizers_;    /**< The stabilizers per round */
+    size_t num_layer_vertices_; /**< The vertices per round */
+    size_t num_qubits_;         /**< The data qubits per round */
+    size_t num_round_words_;    /**< The words of a measured round */
+    /** The data qubits of every stabilizer, for the final readout */
+    std::vector<std::vector<size_t>> stabilizer_qubits_;
+    std::vector<uint64_t> final_round_;  /**< Parities of the data readout */
+    std::vector<uint64_t> round_events_; /**< The events of one round */
+
+    /**
+     * @brief Checks the sizes of the measurements and computes the final
+     * round from the data readout, if given.
+     *
+     * @return The number of measured rounds.
+     */
+    size_t Prepare_(std::span<const uint64_t> measurements,
+                    std::span<const uint64_t> data_measurements) {
+        size_t num_measured_rounds =
+            data_measurements.empty() ? num_rounds_ : num_rounds_ - 1;
+        if (measurements.size() != num_measured_rounds * num_round_words_) {
+            throw std::invalid_argument(
+                "Expected " + std::to_string(num_measured_rounds) +
+                " measured rounds of " + std::to_string(num_round_words_) +
+                " words");
+        }
+        if (!data_measurements.empty()) {
+            if (data_measurements.size() != GetNumPackedWords(num_qubits_)) {
+                throw std::invalid_argument(
+                    "Expected one data measurement per qubit");
+            }
+            final_round_.assign(num_round_words_, 0);
+            for (size_t s = 0; s < num_stabilizers_; s++) {
+                uint64_t parity = 0;
+                for (auto q : stabilizer_qubits_[s]) {
+                    parity ^= data_measurements[q / 64] >> (q % 64);
+                }
+                final_round_[s / 64] |= (parity & 1) << (s % 64);
+            }
+        }
+        return num_measured_rounds;
+    }
+
+    /**
+     * @brief Calls function(r, events) with the packed detection events of
+     * every round r.
+     */
+    template <typename Function>
+    void ForEachRound_(std::span<const uint64_t> measurements,
+                       size_t num_measured_rounds, Function &&function) {
+        round_events_.resize(num_round_words_);
+        uint64_t last_mask =
+            num_stabilizers_ % 64 == 0
+                ? ~uint64_t{0}
+                : (uint64_t{1} << (num_stabilizers_ % 64)) - 1;
+        for (size_t r = 0; r < num_rounds_; r++) {
+            const uint64_t *current =
+                r < num_measured_rounds
+                    ? measurements.data() + r * num_round_words_
+                    : final_round_.data();
+            if (r == 0) {
+                std::copy(current, current + num_round_words_,
+                          round_events_.begin());
+            } else {
+                const uint64_t *previous =
+                    measurements.data() + (r - 1) * num_round_words_;
+                for (size_t w = 0; w < num_round_words_; w++) {
+                    round_events_[w] = current[w] ^ previous[w];
+                }
+            }
+            if (num_round_words_ > 0) {
+                round_events_.back() &= last_mask;
+            }
+            function(r, std::span<const uint64_t>(round_events_));
+        }
+    }
+
+  public:
+    /**
+     * @brief Reads the layout of a space-time graph as built by
+     * StabilizerCode::BuildSpaceTimeGraph_().
+     *
+     * @param graph The X or Z stabilizer decoding graph of a code.
+     * @param num_rounds The number of rounds of the graph.
+     */
+    DetectionEventBuilder(const DecodingGraph &graph, size_t num_rounds)
+        : num_rounds_(num_rounds) {
+        size_t num_vertices = graph.GetNumVertices();
+        if (num_rounds == 0 || num_vertices % num_rounds != 0) {
+            throw std::invalid_argument(
+                "The graph does not have the given number of rounds");
+        }
+        num_layer_vertices_ = num_vertices / num_rounds;
+        num_stabilizers_ = 0;
+        while (num_stabilizers_ < num_layer_vertices_ &&
+               !graph.IsVertexOnBoundary(num_stabilizers_)) {
+            num_stabilizers_++;
+        }
+        size_t num_time_edges = (num_rounds - 1) * num_stabilizers_;
+        if (graph.GetNumEdges() < num_time_edges ||
+            (graph.GetNumEdges() - num_time_edges) % num_rounds != 0) {
+            throw std::invalid_argument(
+                "The graph is not a phenomenological space-time graph");
+        }
+        num_qubits_ = (graph.GetNumEdges() - num_time_edges) / num_rounds;
+        num_round_words_ = GetNumPackedWords(num_stabilizers_);
+
+        // The space-like edges of the first round are the data qubits.
+        stabilizer_qubits_.resize(num_stabilizers_);
+        for (size_t q = 0; q < num_qubits_; q++) {
+            auto [v0, v1] = graph.GetVerticesConnectedByEdge(q);
+            for (auto v : {v0, v1}) {
+                if (v < num_stabilizers_) {
+                    stabilizer_qubits_[v].push_back(q);
+                }
+            }
+        }
+    }
+
+    size_t GetNumRounds() const { return num_rounds_; }
+    size_t GetNumStabilizers() const { return num_stabilizers_; }
+    size_t GetNumQubits() const { return num_qubits_; }
+    size_t GetNumVertices() const { return num_rounds_ * num_layer_vertices_; }
+
+    /**
+     * @brief Returns the number of words of the measurements of one round.
+     */
+    size_t GetNumRoundWords() const { return num_round_words_; }
+
+    /**
+     * @brief Computes packed detection events.
+     *
+     * @param measurements The measured rounds, GetNumRoundWords() words each:
+     * all rounds of the graph, or one round fewer with a data readout.
+     * @param data_measurements The final readout of the data qubits, packed,
+     * or empty if the last measured round is the perfect one.
+     * @param events Receives bit v % 64 of word v / 64 for every vertex v of
+     * the graph that fires.
+     */
+    void GetDetectionEvents(std::span<const uint64_t> measurements,
+                            std::span<const uint64_t> data_measurements,
+                            std::vector<uint64_t> &events) {
+        size_t num_measured_rounds =
+            Prepare_(measurements, data_measurements);
+        events.assign(GetNumPackedWords(GetNumVertices()), 0);
+        ForEachRound_(measurements, num_measured_rounds,
+                      [&](size_t r, std::span<const uint64_t> round_events) {
+                          XorPackedBits(round_events, num_stabilizers_,
+                                        events, r * num_layer_vertices_);
+                      });
+    }
+
+    /**
+     * @brief Computes the detection events as a syndrome with one flag per
+     * vertex, as taken by Decoders::UnionFindDecoder::Decode().
+     */
+    void GetSyndrome(std::span<const uint64_t> measurements,
+                     std::span<const uint64_t> data_measurements,
+                     std::vector<bool> &syndrome) {
+        size_t num_measured_rounds =
+            Prepare_(measurements, data_measurements);
+        syndrome.assign(GetNumVertices(), false);
+        ForEachRound_(measurements, num_measured_rounds,
+                      [&](size_t r, std::span<const uint64_t> round_events) {
+                          size_t offset = r * num_layer_vertices_;
+                          for (size_t w = 0; w < round_events.size(); w++) {
+                              for (uint64_t word = round_events[w]; word != 0;
+                                   word &= word - 1) {
+                                  syndrome[offset + 64 * w +
+                                           std::countr_zero(word)] = true;
+                              }
+                          }
+                      });
+    }
+};
+
+}; // namespace Plaquette
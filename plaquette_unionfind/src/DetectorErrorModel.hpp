@@ -0,0 +1,566 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+#include "Utils.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief A decoding graph built from a Stim detector error model (.dem).
+ *
+ * The text format is parsed into an instruction tree once, and `repeat` blocks
+ * are then expanded by replaying the already parsed body with shifted detector
+ * offsets. Every detector becomes a vertex of the decoding graph. Errors that
+ * flip a single detector are attached to a boundary vertex owned by that
+ * detector; boundary vertices are numbered after all detectors. Errors with
+ * more than two detectors must be decomposed with `^` separators (Stim's
+ * `decompose_errors=True`), in which case each component becomes an edge.
+ *
+ * Parallel edges are merged by combining their probabilities as independent
+ * flips. If the merged errors flip different observables, the observables of
+ * the more likely error are kept.
+ *
+ * Errors (or decomposed components) that flip observables but no detector,
+ * such as `error(0.01) L0`, have no edge in the graph. They are kept as
+ * undetectable errors, merged by observable mask.
+ *
+ * Since merged edges no longer describe the errors that formed them, every
+ * `error` instruction is also kept as an error mechanism for sampling: it
+ * flips all of its component edges and observables at once, so decomposed
+ * errors stay correlated and keep their own observables.
+ */
+class DetectorErrorModel {
+
+  public:
+    /**
+     * @brief An error that flips observables without flipping any detector.
+     */
+    struct UndetectableError {
+        double probability; ///< Probability of the error.
+        uint64_t observables; ///< Bitmask of the flipped observables.
+    };
+
+    /**
+     * @brief The flips of a single `error` instruction.
+     */
+    struct ErrorMechanism {
+        double probability; ///< Probability of the error.
+        std::vector<uint32_t> edges; ///< The edges flipped by the error.
+        uint64_t observables; ///< Bitmask of the flipped observables.
+    };
+
+  private:
+    /**
+     * @brief A single parsed instruction of the detector error model.
+     */
+    struct Instruction {
+        enum class Type { Error, Detector, LogicalObservable, Shift, Repeat };
+
+        Type type;
+        std::vector<double> args;
+        std::vector<uint64_t> targets;
+        uint64_t repeat_count = 0;
+        std::vector<Instruction> block;
+        size_t line_number = 0;
+    };
+
+    static constexpr uint64_t kObservableFlag = uint64_t(1) << 63;
+    static constexpr uint64_t kSeparator = ~uint64_t(0);
+    static constexpr uint32_t kBoundary = ~uint32_t(0);
+
+    DecodingGraph decoding_graph_; ///< The decoding graph of the model.
+    std::vector<double> edge_probabilities_; ///< Error probability per edge.
+    std::vector<float>
+        edge_growth_increments_; ///< Log-likelihood growth per edge.
+    std::vector<uint64_t>
+        edge_observables_; ///< Bitmask of observables flipped by each edge.
+    std::vector<std::vector<double>>
+        detector_coords_; ///< Shifted coordinates of each detector.
+    std::vector<UndetectableError>
+        undetectable_errors_; ///< Errors that flip no detector.
+    std::vector<ErrorMechanism>
+        error_mechanisms_; ///< One entry per expanded error instruction.
+
+    size_t num_detectors_ = 0;
+    size_t num_observables_ = 0;
+    size_t num_boundary_vertices_ = 0;
+
+    // State used while expanding the instruction tree.
+    uint64_t detector_offset_ = 0;
+    std::vector<double> coord_offset_;
+    std::vector<std::pair<uint32_t, uint32_t>> edge_keys_;
+    std::unordered_map<uint64_t, size_t> edge_lookup_;
+    std::unordered_map<uint64_t, size_t> undetectable_lookup_;
+
+    [[noreturn]] static void ThrowParseError_(size_t line_number,
+                                              const std::string &message) {
+        throw std::runtime_error("Detector error model line " +
+                                 std::to_string(line_number) + ": " + message);
+    }
+
+    static std::string Trim_(const std::string &s) {
+        size_t start = s.find_first_not_of(" \t\r");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = s.find_last_not_of(" \t\r");
+        return s.substr(start, end - start + 1);
+    }
+
+    static uint64_t ParseIndex_(const std::string &token, size_t offset,
+                                size_t line_number) {
+        if (token.size() <= offset ||
+            !std::isdigit(static_cast<unsigned char>(token[offset]))) {
+            ThrowParseError_(line_number, "malformed target '" + token + "'");
+        }
+        size_t pos = 0;
+        uint64_t value = 0;
+        try {
+            value = std::stoull(token.substr(offset), &pos);
+        } catch (const std::exception &) {
+            pos = 0;
+        }
+        if (pos != token.size() - offset) {
+            ThrowParseError_(line_number, "malformed target '" + token + "'");
+        }
+        return value;
+    }
+
+    /**
+     * @brief Parses one line of the form `name[tag](args) targets`.
+     */
+    static Instruction ParseInstruction_(const std::string &line,
+                                         size_t line_number) {
+        size_t name_end = line.find_first_of(" \t([");
+        std::string name = line.substr(0, name_end);
+        size_t pos = name_end == std::string::npos ? line.size() : name_end;
+
+        if (pos < line.size() && line[pos] == '[') {
+            pos = line.find(']', pos);
+            if (pos == std::string::npos) {
+                ThrowParseError_(line_number, "unterminated tag");
+            }
+            pos++;
+        }
+
+        Instruction instruction;
+        instruction.line_number = line_number;
+        if (pos < line.size() && line[pos] == '(') {
+            size_t close = line.find(')', pos);
+            if (close == std::string::npos) {
+                ThrowParseError_(line_number, "unterminated arguments");
+            }
+            std::stringstream args(line.substr(pos + 1, close - pos - 1));
+            std::string arg;
+            while (std::getline(args, arg, ',')) {
+                try {
+                    instruction.args.push_back(std::stod(Trim_(arg)));
+                } catch (const std::exception &) {
+                    ThrowParseError_(line_number, "malformed argument");
+                }
+            }
+            pos = close + 1;
+        }
+
+        std::stringstream rest(line.substr(pos));
+        std::string token;
+
+        if (name == "error") {
+            instruction.type = Instruction::Type::Error;
+        } else if (name == "detector") {
+            instruction.type = Instruction::Type::Detector;
+        } else if (name == "logical_observable") {
+            instruction.type = Instruction::Type::LogicalObservable;
+        } else if (name == "shift_detectors") {
+            instruction.type = Instruction::Type::Shift;
+            while (rest >> token) {
+                instruction.targets.push_back(
+                    ParseIndex_(token, 0, line_number));
+            }
+            return instruction;
+        } else if (name == "repeat") {
+            instruction.type = Instruction::Type::Repeat;
+            rest >> token;
+            instruction.repeat_count = ParseIndex_(token, 0, line_number);
+            if (instruction.repeat_count == 0) {
+                ThrowParseError_(line_number, "repeat count must be positive");
+            }
+            return instruction;
+        } else {
+            ThrowParseError_(line_number, "unknown instruction '" + name + "'");
+        }
+
+        // Detectors repeated within a component cancel before the size of
+        // the component is checked.
+        std::vector<uint64_t> component;
+        auto check_component = [&]() {
+            if (component.size() > 2 &&
+                instruction.type == Instruction::Type::Error) {
+                ThrowParseError_(line_number,
+                                 "errors with more than two detectors must "
+                                 "be decomposed with '^'");
+            }
+            component.clear();
+        };
+        while (rest >> token) {
+            if (token == "^") {
+                check_component();
+                instruction.targets.push_back(kSeparator);
+            } else if (token[0] == 'D') {
+                uint64_t index = ParseIndex_(token, 1, line_number);
+                instruction.targets.push_back(index);
+                auto it = std::find(component.begin(), component.end(), index);
+                if (it == component.end()) {
+                    component.push_back(index);
+                } else {
+                    component.erase(it);
+                }
+            } else if (token[0] == 'L') {
+                uint64_t index = ParseIndex_(token, 1, line_number);
+                if (index >= 64) {
+                    ThrowParseError_(line_number,
+                                     "at most 64 observables are supported");
+                }
+                instruction.targets.push_back(kObservableFlag | index);
+            } else {
+                ThrowParseError_(line_number,
+                                 "unknown target '" + token + "'");
+            }
+        }
+        check_component();
+
+        if (instruction.type == Instruction::Type::Error &&
+            (instruction.args.size() != 1 || instruction.args[0] < 0.0 ||
+             instruction.args[0] > 1.0)) {
+            ThrowParseError_(line_number, "error takes one probability");
+        }
+        return instruction;
+    }
+
+    /**
+     * @brief Parses a block of instructions up to the matching closing brace.
+     */
+    static std::vector<Instruction> ParseBlock_(std::istream &in,
+                                                size_t &line_number,
+                                                bool nested) {
+        std::vector<Instruction> block;
+        std::string line;
+        while (std::getline(in, line)) {
+            line_number++;
+            line = Trim_(line.substr(0, line.find('#')));
+            if (line.empty()) {
+                continue;
+            }
+            if (line == "}") {
+                if (!nested) {
+                    ThrowParseError_(line_number, "unmatched '}'");
+                }
+                return block;
+            }
+
+            bool opens_block = line.back() == '{';
+            if (opens_block) {
+                line = Trim_(line.substr(0, line.size() - 1));
+            }
+            auto instruction = ParseInstruction_(line, line_number);
+            if (opens_block != (instruction.type ==
+                                Instruction::Type::Repeat)) {
+                ThrowParseError_(line_number, "misplaced block");
+            }
+            if (opens_block) {
+                instruction.block = ParseBlock_(in, line_number, true);
+            }
+            block.push_back(std::move(instruction));
+        }
+        if (nested) {
+            ThrowParseError_(line_number, "missing '}'");
+        }
+        return block;
+    }
+
+    /**
+     * @brief Adds an edge or merges it into its parallel edge.
+     *
+     * @return The index of the edge.
+     */
+    size_t AddEdge_(uint32_t u, uint32_t v, double probability,
+                    uint64_t observables) {
+        if (v != kBoundary && u > v) {
+            std::swap(u, v);
+        }
+        uint64_t key = (uint64_t(u) << 32) | v;
+        auto it = edge_lookup_.find(key);
+        if (it == edge_lookup_.end()) {
+            edge_lookup_.emplace(key, edge_keys_.size());
+            edge_keys_.emplace_back(u, v);
+            edge_probabilities_.push_back(probability);
+            edge_observables_.push_back(observables);
+            return edge_keys_.size() - 1;
+        }
+
+        size_t e = it->second;
+        double q = edge_probabilities_[e];
+        if (probability > q) {
+            edge_observables_[e] = observables;
+        }
+        edge_probabilities_[e] = q * (1 - probability) + probability * (1 - q);
+        return e;
+    }
+
+    void AddUndetectableError_(double probability, uint64_t observables) {
+        if (observables == 0) {
+            return;
+        }
+        auto it = undetectable_lookup_.find(observables);
+        if (it == undetectable_lookup_.end()) {
+            undetectable_lookup_.emplace(observables,
+                                         undetectable_errors_.size());
+            undetectable_errors_.push_back({probability, observables});
+            return;
+        }
+
+        double &q = undetectable_errors_[it->second].probability;
+        q = q * (1 - probability) + probability * (1 - q);
+    }
+
+    /**
+     * @brief Returns the shifted index of a detector target, checking that
+     * it fits below the boundary marker.
+     */
+    uint32_t GetDetector_(uint64_t target, size_t line_number) const {
+        if (target >= kBoundary || detector_offset_ >= kBoundary - target) {
+            ThrowParseError_(line_number, "detector out of range");
+        }
+        return static_cast<uint32_t>(target + detector_offset_);
+    }
+
+    void ApplyError_(const Instruction &instruction) {
+        double probability = instruction.args[0];
+        if (probability == 0.0) {
+            return;
+        }
+
+        ErrorMechanism mechanism{probability, {}, 0};
+        std::vector<uint32_t> detectors;
+        uint64_t observables = 0;
+        auto flush = [&]() {
+            mechanism.observables ^= observables;
+            if (detectors.empty()) {
+                AddUndetectableError_(probability, observables);
+            } else {
+                uint32_t v = detectors.size() == 1 ? kBoundary : detectors[1];
+                auto e = static_cast<uint32_t>(
+                    AddEdge_(detectors[0], v, probability, observables));
+                // Components on the same edge cancel.
+                auto it = std::find(mechanism.edges.begin(),
+                                    mechanism.edges.end(), e);
+                if (it == mechanism.edges.end()) {
+                    mechanism.edges.push_back(e);
+                } else {
+                    mechanism.edges.erase(it);
+                }
+            }
+            detectors.clear();
+            observables = 0;
+        };
+
+        for (const auto &target : instruction.targets) {
+            if (target == kSeparator) {
+                flush();
+            } else if (target & kObservableFlag) {
+                uint64_t index = target & ~kObservableFlag;
+                observables ^= uint64_t(1) << index;
+                num_observables_ =
+                    std::max<size_t>(num_observables_, index + 1);
+            } else {
+                uint32_t detector =
+                    GetDetector_(target, instruction.line_number);
+                num_detectors_ =
+                    std::max<size_t>(num_detectors_, detector + 1);
+                auto it =
+                    std::find(detectors.begin(), detectors.end(), detector);
+                if (it == detectors.end()) {
+                    detectors.push_back(detector);
+                } else {
+                    detectors.erase(it);
+                }
+            }
+        }
+        flush();
+        if (!mechanism.edges.empty() || mechanism.observables != 0) {
+            error_mechanisms_.push_back(std::move(mechanism));
+        }
+    }
+
+    void Execute_(const std::vector<Instruction> &block) {
+        for (const auto &instruction : block) {
+            switch (instruction.type) {
+            case Instruction::Type::Error:
+                ApplyError_(instruction);
+                break;
+            case Instruction::Type::Detector:
+                for (const auto &target : instruction.targets) {
+                    uint32_t detector =
+                        GetDetector_(target, instruction.line_number);
+                    num_detectors_ =
+                        std::max<size_t>(num_detectors_, detector + 1);
+                    if (detector_coords_.size() <= detector) {
+                        detector_coords_.resize(detector + 1);
+                    }
+                    auto &coords = detector_coords_[detector];
+                    coords = instruction.args;
+                    for (size_t i = 0;
+                         i < coords.size() && i < coord_offset_.size(); i++) {
+                        coords[i] += coord_offset_[i];
+                    }
+                }
+                break;
+            case Instruction::Type::LogicalObservable:
+                for (const auto &target : instruction.targets) {
+                    num_observables_ = std::max<size_t>(
+                        num_observables_, (target & ~kObservableFlag) + 1);
+                }
+                break;
+            case Instruction::Type::Shift:
+                if (coord_offset_.size() < instruction.args.size()) {
+                    coord_offset_.resize(instruction.args.size(), 0.0);
+                }
+                for (size_t i = 0; i < instruction.args.size(); i++) {
+                    coord_offset_[i] += instruction.args[i];
+                }
+                for (const auto &target : instruction.targets) {
+                    if (target >= kBoundary - detector_offset_) {
+                        ThrowParseError_(instruction.line_number,
+                                         "detector out of range");
+                    }
+                    detector_offset_ += target;
+                }
+                break;
+            case Instruction::Type::Repeat:
+                for (uint64_t r = 0; r < instruction.repeat_count; r++) {
+                    Execute_(instruction.block);
+                }
+                break;
+            }
+        }
+    }
+
+  public:
+    DetectorErrorModel() = default;
+
+    /**
+     * @brief Parses a detector error model from a stream.
+     *
+     * @param in The stream containing the detector error model text.
+     */
+    explicit DetectorErrorModel(std::istream &in) {
+        size_t line_number = 0;
+        Execute_(ParseBlock_(in, line_number, false));
+
+        detector_coords_.resize(num_detectors_);
+
+        std::vector<std::pair<size_t, size_t>> edges;
+        edges.reserve(edge_keys_.size());
+        std::vector<size_t> boundary_vertex(num_detectors_, 0);
+        for (const auto &[u, v] : edge_keys_) {
+            if (v == kBoundary) {
+                boundary_vertex[u] = num_detectors_ + num_boundary_vertices_;
+                num_boundary_vertices_++;
+                edges.emplace_back(u, boundary_vertex[u]);
+            } else {
+                edges.emplace_back(u, v);
+            }
+        }
+
+        size_t num_vertices = num_detectors_ + num_boundary_vertices_;
+        std::vector<bool> vertex_boundary(num_vertices, false);
+        for (size_t v = num_detectors_; v < num_vertices; v++) {
+            vertex_boundary[v] = true;
+        }
+
+        decoding_graph_ = DecodingGraph(num_vertices, edges, vertex_boundary);
+        edge_growth_increments_ =
+            Utils::GetGrowthIncrementsFromProbabilities(edge_probabilities_);
+
+        edge_keys_.clear();
+        edge_lookup_.clear();
+        undetectable_lookup_.clear();
+    }
+
+    /**
+     * @brief Parses a detector error model from a string.
+     */
+    static DetectorErrorModel FromString(const std::string &text) {
+        std::istringstream in(text);
+        return DetectorErrorModel(in);
+    }
+
+    /**
+     * @brief Parses a detector error model from a file.
+     */
+    static DetectorErrorModel FromFile(const std::string &path) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("Could not open detector error model " +
+                                     path);
+        }
+        return DetectorErrorModel(in);
+    }
+
+    const auto &GetDecodingGraph() const { return decoding_graph_; }
+    const auto &GetEdgeProbabilities() const { return edge_probabilities_; }
+    const auto &GetEdgeGrowthIncrements() const {
+        return edge_growth_increments_;
+    }
+    const auto &GetEdgeObservables() const { return edge_observables_; }
+    const auto &GetDetectorCoords() const { return detector_coords_; }
+    const auto &GetUndetectableErrors() const { return undetectable_errors_; }
+    const auto &GetErrorMechanisms() const { return error_mechanisms_; }
+    size_t GetNumDetectors() const { return num_detectors_; }
+    size_t GetNumObservables() const { return num_observables_; }
+    size_t GetNumBoundaryVertices() const { return num_boundary_vertices_; }
+
+    /**
+     * @brief Pads detection events with the boundary vertices so they can be
+     * passed to the decoder as a syndrome.
+     *
+     * @param detection_events One entry per detector.
+     * @return The syndrome over all vertices of the decoding graph.
+     */
+    std::vector<bool>
+    GetSyndrome(const std::vector<bool> &detection_events) const {
+        std::vector<bool> syndrome(decoding_graph_.GetNumVertices(), false);
+        for (size_t d = 0; d < detection_events.size() && d < num_detectors_;
+             d++) {
+            syndrome[d] = detection_events[d];
+        }
+        return syndrome;
+    }
+
+    /**
+     * @brief Computes the observables flipped by a set of edges.
+     *
+     * @param correction One entry per edge, as returned by the decoder.
+     * @return A bitmask of flipped observables.
+     */
+    uint64_t GetObservableFlips(const std::vector<bool> &correction) const {
+        uint64_t flips = 0;
+        for (size_t e = 0; e < correction.size(); e++) {
+            if (correction[e]) {
+                flips ^= edge_observables_[e];
+            }
+        }
+        return flips;
+    }
+};
+}; // namespace Plaquette
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <random>
+#include <span>
+#include <stdexcept>
 #include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include "DecodingGraph.hpp"
+#include "PackedBits.hpp"
+#include "Random.hpp"
 #include "Types.hpp"
+#include "Utils.hpp"
 
 namespace Plaquette {
 namespace ErrorModels {
@@ -59,13 +69,8 @@ class ErasureErrorModel {
 
         for (size_t i = 0; i < num_qubits_; i++) {
             auto error = dist(generator_) < probability_;
-            if (error) {
-                erasure_[i] = true;
-                auto bit_flip = dist(generator_) < 0.5;
-                if (bit_flip) {
-                    bit_flip_error_[i] = true;
-                }
-            }
+            erasure_[i] = error;
+            bit_flip_error_[i] = error && dist(generator_) < 0.5;
         }
 
         return std::make_tuple(bit_flip_error_, erasure_);
@@ -122,5 +127,745 @@ class BitFlipErrorModel {
     }
 };
 
+/**
+ * @brief Enumerates the successes of independent trials with probability p by
+ * drawing the gaps between them from a geometric distribution.
+ *
+ * The number of failures before the next success is floor(log(U) / log(1 - p))
+ * for U uniform in (0, 1], so n trials cost about n * p random numbers and
+ * logarithms instead of n random numbers.
+ */
+class GeometricSkipper {
+
+  private:
+    double probability_;
+    double inverse_log_; /**< 1 / log(1 - p), negative. */
+
+  public:
+    explicit GeometricSkipper(double probability)
+        : probability_(probability),
+          inverse_log_(probability > 0.0 && probability < 1.0
+                           ? 1.0 / std::log1p(-probability)
+                           : 0.0) {}
+
+    /**
+     * @brief Calls function(i) for every success among the trials
+     * 0 .. num_trials - 1, in increasing order.
+     */
+    template <typename Generator, typename Function>
+    void ForEachSuccess(Generator &generator, size_t num_trials,
+                        Function &&function) const {
+        if (probability_ <= 0.0) {
+            return;
+        }
+        if (probability_ >= 1.0) {
+            for (size_t i = 0; i < num_trials; i++) {
+                function(i);
+            }
+            return;
+        }
+        size_t i = 0;
+        while (i < num_trials) {
+            double skip = std::log(1.0 - generator.NextDouble()) * inverse_log_;
+            if (skip >= static_cast<double>(num_trials - i)) {
+                return;
+            }
+            i += static_cast<size_t>(skip);
+            function(i);
+            i++;
+        }
+    }
+};
+
+/**
+ * @brief A bit-flip error model that jumps from error to error.
+ *
+ * It samples the same distribution as BitFlipErrorModel with a
+ * GeometricSkipper on a xoshiro256++ generator, so its cost scales with the
+ * number of errors rather than the number of qubits, and writes the errors as
+ * a sorted list of qubit indices, a packed bitset or a std::vector<bool>
+ * provided by the caller. Seeds behave as in BitFlipErrorModel: a fixed seed
+ * reproduces the same errors and -1 seeds from the current time. The random
+ * streams differ from those of BitFlipErrorModel.
+ *
+ * With a PhiloxGenerator, seeking the generator to a shot before sampling
+ * makes the errors of that shot a pure function of (seed, shot).
+ *
+ * @tparam Generator A generator with operator() and NextDouble(), such as
+ * Xoshiro256PlusPlus or PhiloxGenerator.
+ */
+template <typename Generator = Xoshiro256PlusPlus>
+class GeometricBitFlipErrorModel {
+
+  private:
+    size_t num_qubits_;          /**< The number of qubits */
+    GeometricSkipper skipper_;   /**< Draws the gaps between errors */
+    Generator generator_;
+
+  public:
+    /**
+     * @brief Constructor for the GeometricBitFlipErrorModel class.
+     *
+     * @param num_qubits The number of qubits to model.
+     * @param probability The probability of a bit-flip error.
+     * @param seed Optional parameter for seeding the random number generator.
+     * Default is -1.
+     */
+    GeometricBitFlipErrorModel(size_t num_qubits, double probability,
+                               int seed = -1)
+        : num_qubits_(num_qubits), skipper_(probability),
+          generator_(GetSeed(seed)) {}
+
+    /**
+     * @brief Constructs the model around a given generator.
+     */
+    GeometricBitFlipErrorModel(size_t num_qubits, double probability,
+                               Generator generator)
+        : num_qubits_(num_qubits), skipper_(probability),
+          generator_(std::move(generator)) {}
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return generator_; }
+
+    /**
+     * @brief Samples the indices of the flipped qubits in increasing order.
+     */
+    void GetErrors(std::vector<size_t> &flipped) {
+        flipped.clear();
+        skipper_.ForEachSuccess(generator_, num_qubits_,
+                                [&](size_t q) { flipped.push_back(q); });
+    }
+
+    /**
+     * @brief Samples the errors into a packed bitset, bit q % 64 of word
+     * q / 64 for qubit q.
+     */
+    void GetPackedErrors(std::vector<uint64_t> &words) {
+        words.assign(GetNumPackedWords(num_qubits_), 0);
+        skipper_.ForEachSuccess(generator_, num_qubits_, [&](size_t q) {
+            SetPackedBit(words, q);
+        });
+    }
+
+    /**
+     * @brief Samples the errors into a vector with one flag per qubit.
+     */
+    void GetErrors(std::vector<bool> &errors) {
+        errors.assign(num_qubits_, false);
+        skipper_.ForEachSuccess(generator_, num_qubits_,
+                                [&](size_t q) { errors[q] = true; });
+    }
+
+    std::vector<bool> GetErrors() {
+        std::vector<bool> errors;
+        GetErrors(errors);
+        return errors;
+    }
+};
+
+/**
+ * @brief An erasure error model that jumps from erasure to erasure.
+ *
+ * Like ErasureErrorModel, every qubit is erased with the given probability and
+ * an erased qubit is flipped with probability 1/2. Erasures are found with a
+ * GeometricSkipper and the flips are taken from the bits of a single random
+ * word per 64 erasures of a sample. Seeds and generators behave as in
+ * GeometricBitFlipErrorModel.
+ */
+template <typename Generator = Xoshiro256PlusPlus>
+class GeometricErasureErrorModel {
+
+  private:
+    size_t num_qubits_;        /**< The number of qubits */
+    GeometricSkipper skipper_; /**< Draws the gaps between erasures */
+    Generator generator_;
+    uint64_t flip_bits_ = 0; /**< Unused random bits for the flips */
+    int num_flip_bits_ = 0;  /**< The number of unused bits */
+
+    bool NextFlip_() {
+        if (num_flip_bits_ == 0) {
+            flip_bits_ = generator_();
+            num_flip_bits_ = 64;
+        }
+        bool flip = flip_bits_ & 1;
+        flip_bits_ >>= 1;
+        num_flip_bits_--;
+        return flip;
+    }
+
+  public:
+    /**
+     * @brief Constructor for the GeometricErasureErrorModel class.
+     *
+     * @param num_qubits The number of qubits to generate errors for.
+     * @param probability The probability of an erasure.
+     * @param seed Optional parameter for seeding the random number generator.
+     * Default is -1.
+     */
+    GeometricErasureErrorModel(size_t num_qubits, double probability,
+                               int seed = -1)
+        : num_qubits_(num_qubits), skipper_(probability),
+          generator_(GetSeed(seed)) {}
+
+    /**
+     * @brief Constructs the model around a given generator.
+     */
+    GeometricErasureErrorModel(size_t num_qubits, double probability,
+                               Generator generator)
+        : num_qubits_(num_qubits), skipper_(probability),
+          generator_(std::move(generator)) {}
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return generator_; }
+
+    /**
+     * @brief Samples the erased qubits and the erased qubits that were
+     * flipped, both in increasing order.
+     */
+    void GetErrors(std::vector<size_t> &erased, std::vector<size_t> &flipped) {
+        erased.clear();
+        flipped.clear();
+        num_flip_bits_ = 0;
+        skipper_.ForEachSuccess(generator_, num_qubits_, [&](size_t q) {
+            erased.push_back(q);
+            if (NextFlip_()) {
+                flipped.push_back(q);
+            }
+        });
+    }
+
+    /**
+     * @brief Samples the erasures and flips into packed bitsets.
+     */
+    void GetPackedErrors(std::vector<uint64_t> &erasure,
+                         std::vector<uint64_t> &flips) {
+        erasure.assign(GetNumPackedWords(num_qubits_), 0);
+        flips.assign(erasure.size(), 0);
+        num_flip_bits_ = 0;
+        skipper_.ForEachSuccess(generator_, num_qubits_, [&](size_t q) {
+            uint64_t bit = uint64_t{1} << (q % 64);
+            erasure[q / 64] |= bit;
+            if (NextFlip_()) {
+                flips[q / 64] |= bit;
+            }
+        });
+    }
+
+    /**
+     * @brief Generates errors for the set of qubits.
+     *
+     * @return A tuple containing the vectors of bools representing if each
+     * qubit has experienced a bit flip error and if it has been erased.
+     */
+    std::tuple<std::vector<bool>, std::vector<bool>> GetErrors() {
+        std::vector<bool> flips(num_qubits_, false);
+        std::vector<bool> erasure(num_qubits_, false);
+        num_flip_bits_ = 0;
+        skipper_.ForEachSuccess(generator_, num_qubits_, [&](size_t q) {
+            erasure[q] = true;
+            flips[q] = NextFlip_();
+        });
+        return std::make_tuple(std::move(flips), std::move(erasure));
+    }
+};
+
+/**
+ * @brief Bit-flip errors at several error rates from the same random draws.
+ *
+ * Every qubit conceptually draws one uniform value U and is flipped at rate p
+ * if U < p, so the errors at a lower rate are a subset of the errors at any
+ * higher rate. Only the qubits with U below the largest rate are visited,
+ * with a GeometricSkipper, and U is drawn for those alone. The errors are
+ * returned as increments: the qubits that are flipped at rate p_k but not at
+ * p_{k-1}.
+ *
+ * @tparam Generator As for GeometricBitFlipErrorModel.
+ */
+template <typename Generator = Xoshiro256PlusPlus>
+class CoupledBitFlipErrorModel {
+
+  private:
+    size_t num_qubits_;                 /**< The number of qubits */
+    std::vector<double> probabilities_; /**< The rates, in increasing order */
+    GeometricSkipper skipper_;          /**< Visits the qubits below p_max */
+    Generator generator_;
+
+    static double GetMaxProbability_(const std::vector<double> &probabilities) {
+        if (!std::is_sorted(probabilities.begin(), probabilities.end())) {
+            throw std::invalid_argument(
+                "Coupled error rates must be in increasing order");
+        }
+        return probabilities.empty() ? 0.0 : probabilities.back();
+    }
+
+  public:
+    /**
+     * @brief Constructor for the CoupledBitFlipErrorModel class.
+     *
+     * @param num_qubits The number of qubits to model.
+     * @param probabilities The bit-flip probabilities, in increasing order.
+     * @param generator The random number generator.
+     */
+    CoupledBitFlipErrorModel(size_t num_qubits,
+                             std::vector<double> probabilities,
+                             Generator generator)
+        : num_qubits_(num_qubits), probabilities_(std::move(probabilities)),
+          skipper_(GetMaxProbability_(probabilities_)),
+          generator_(std::move(generator)) {}
+
+    CoupledBitFlipErrorModel(size_t num_qubits,
+                             std::vector<double> probabilities, int seed = -1)
+        : CoupledBitFlipErrorModel(num_qubits, std::move(probabilities),
+                                   Generator(GetSeed(seed))) {}
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return generator_; }
+
+    /**
+     * @brief Samples the errors at all rates.
+     *
+     * @param increments Receives one list per rate, in increasing order of
+     * qubit index. The errors at rate p_k are the union of the lists 0 to k.
+     */
+    void GetErrors(std::vector<std::vector<size_t>> &increments) {
+        increments.resize(probabilities_.size());
+        for (auto &increment : increments) {
+            increment.clear();
+        }
+        if (probabilities_.empty()) {
+            return;
+        }
+        double max_probability = probabilities_.back();
+        skipper_.ForEachSuccess(generator_, num_qubits_, [&](size_t q) {
+            double value = max_probability * generator_.NextDouble();
+            size_t k = std::upper_bound(probabilities_.begin(),
+                                        probabilities_.end(), value) -
+                       probabilities_.begin();
+            increments[std::min(k, probabilities_.size() - 1)].push_back(q);
+        });
+    }
+};
+
+/**
+ * @brief Errors of a fixed weight: a uniformly random set of exactly weight
+ * qubits is flipped.
+ *
+ * Conditioned on its weight, i.i.d. bit-flip noise is uniform over the
+ * subsets of that size, so sampling each weight separately and reweighting
+ * with the binomial distribution recovers the noise at any rate, see
+ * Simulation::RunFixedWeightMonteCarlo(). Subsets are drawn with Floyd's
+ * algorithm in O(weight) random numbers.
+ *
+ * @tparam Generator As for GeometricBitFlipErrorModel.
+ */
+template <typename Generator = Xoshiro256PlusPlus>
+class FixedWeightErrorModel {
+
+  private:
+    size_t num_qubits_;            /**< The number of qubits */
+    size_t weight_;                /**< The number of flipped qubits */
+    std::vector<uint8_t> chosen_;  /**< Marks the qubits of a sample */
+    Generator generator_;
+
+  public:
+    /**
+     * @brief Constructor for the FixedWeightErrorModel class.
+     *
+     * @param num_qubits The number of qubits to model.
+     * @param weight The number of flipped qubits, at most num_qubits.
+     * @param generator The random number generator.
+     */
+    FixedWeightErrorModel(size_t num_qubits, size_t weight,
+                          Generator generator)
+        : num_qubits_(num_qubits), weight_(0), chosen_(num_qubits, 0),
+          generator_(std::move(generator)) {
+        SetWeight(weight);
+    }
+
+    FixedWeightErrorModel(size_t num_qubits, size_t weight, int seed = -1)
+        : FixedWeightErrorModel(num_qubits, weight, Generator(GetSeed(seed))) {}
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return generator_; }
+
+    void SetWeight(size_t weight) {
+        if (weight > num_qubits_) {
+            throw std::invalid_argument(
+                "The error weight exceeds the number of qubits");
+        }
+        weight_ = weight;
+    }
+
+    size_t GetWeight() const { return weight_; }
+
+    /**
+     * @brief Samples the flipped qubits.
+     *
+     * @param flipped Receives the weight flipped qubits in increasing order.
+     */
+    void GetErrors(std::vector<size_t> &flipped) {
+        flipped.clear();
+        for (size_t j = num_qubits_ - weight_; j < num_qubits_; j++) {
+            size_t q = std::min(
+                j, static_cast<size_t>(generator_.NextDouble() * (j + 1)));
+            if (chosen_[q]) {
+                q = j;
+            }
+            chosen_[q] = 1;
+            flipped.push_back(q);
+        }
+        for (auto q : flipped) {
+            chosen_[q] = 0;
+        }
+        std::sort(flipped.begin(), flipped.end());
+    }
+};
+
+/**
+ * @brief Enumerates the successes of independent trials with a probability
+ * per trial, by grouping the trials into rate buckets.
+ *
+ * Trials with probabilities in [2^-k, 2^-(k-1)) share bucket k, which is
+ * skipped through with a GeometricSkipper at the largest probability q of
+ * the bucket. Every trial it lands on succeeds with probability p / q > 1/2,
+ * so a sample costs O(#buckets + sum of p) random numbers rather than one
+ * per trial, as for uniform rates. Rates below 2^-64 share the last bucket
+ * and trials of rate 0 are never visited.
+ */
+class BucketedSkipper {
+
+  private:
+    static constexpr int max_bucket_ = 64;
+
+    struct Bucket_ {
+        double probability = 0.0;      /**< The largest rate of the bucket */
+        std::vector<size_t> trials;    /**< The trials, in increasing order */
+        std::vector<double> acceptance; /**< p / q, empty if all equal q */
+    };
+
+    std::vector<Bucket_> buckets_;
+    std::vector<GeometricSkipper> skippers_;
+
+  public:
+    /**
+     * @brief Groups the trials by rate.
+     *
+     * @param probabilities The probability of every trial, in [0, 1].
+     */
+    explicit BucketedSkipper(std::span<const double> probabilities) {
+        // Bucket 0 holds the certain trials, bucket k > 0 the rates in
+        // [2^-k, 2^-(k-1)).
+        std::vector<int> bucket_index(max_bucket_ + 1, -1);
+        for (size_t i = 0; i < probabilities.size(); i++) {
+            double p = probabilities[i];
+            if (!(p >= 0.0 && p <= 1.0)) {
+                throw std::invalid_argument(
+                    "Error probabilities must be in [0, 1]");
+            }
+            if (p == 0.0) {
+                continue;
+            }
+            int k = p == 1.0 ? 0 : std::min(-std::ilogb(p), max_bucket_);
+            if (bucket_index[k] < 0) {
+                bucket_index[k] = static_cast<int>(buckets_.size());
+                buckets_.emplace_back();
+            }
+            auto &bucket = buckets_[bucket_index[k]];
+            bucket.probability = std::max(bucket.probability, p);
+            bucket.trials.push_back(i);
+        }
+        for (auto &bucket : buckets_) {
+            bool uniform = true;
+            for (auto i : bucket.trials) {
+                uniform = uniform && probabilities[i] == bucket.probability;
+            }
+            if (!uniform) {
+                bucket.acceptance.reserve(bucket.trials.size());
+                for (auto i : bucket.trials) {
+                    bucket.acceptance.push_back(probabilities[i] /
+                                                bucket.probability);
+                }
+            }
+            skippers_.emplace_back(bucket.probability);
+        }
+    }
+
+    size_t GetNumBuckets() const { return buckets_.size(); }
+
+    /**
+     * @brief Samples the successful trials in increasing order.
+     */
+    template <typename Generator>
+    void GetSuccesses(Generator &generator,
+                      std::vector<size_t> &successes) const {
+        successes.clear();
+        // Every bucket yields its trials in increasing order, so its run is
+        // merged into the sorted successes of the previous buckets.
+        size_t run_begin = 0;
+        ForEachSuccess(generator, [&](size_t i) {
+            if (!successes.empty() && i < successes.back()) {
+                std::inplace_merge(successes.begin(),
+                                   successes.begin() + run_begin,
+                                   successes.end());
+                run_begin = successes.size();
+            }
+            successes.push_back(i);
+        });
+        std::inplace_merge(successes.begin(), successes.begin() + run_begin,
+                           successes.end());
+    }
+
+    /**
+     * @brief Calls function(i) for every successful trial i. Trials are
+     * visited bucket by bucket, in increasing order within a bucket.
+     */
+    template <typename Generator, typename Function>
+    void ForEachSuccess(Generator &generator, Function &&function) const {
+        for (size_t b = 0; b < buckets_.size(); b++) {
+            const auto &bucket = buckets_[b];
+            skippers_[b].ForEachSuccess(
+                generator, bucket.trials.size(), [&](size_t j) {
+                    if (bucket.acceptance.empty() ||
+                        generator.NextDouble() < bucket.acceptance[j]) {
+                        function(bucket.trials[j]);
+                    }
+                });
+        }
+    }
+};
+
+/**
+ * @brief A bit-flip error model with its own error rate for every qubit.
+ *
+ * Calibrated devices have a rate per qubit, and per round in space-time
+ * graphs, see GetSpaceTimeProbabilities(). The qubits are sampled with a
+ * BucketedSkipper, so the cost still scales with the number of errors
+ * rather than the number of qubits. Seeds and generators behave as in
+ * GeometricBitFlipErrorModel, and a decoder weighted by the same rates is
+ * built from GetGrowthIncrements().
+ *
+ * @tparam Generator As for GeometricBitFlipErrorModel.
+ */
+template <typename Generator = Xoshiro256PlusPlus>
+class HeterogeneousBitFlipErrorModel {
+
+  private:
+    std::vector<double> probabilities_; /**< The rate of every qubit */
+    BucketedSkipper skipper_;           /**< Visits the flipped qubits */
+    Generator generator_;
+
+  public:
+    /**
+     * @brief Constructor for the HeterogeneousBitFlipErrorModel class.
+     *
+     * @param probabilities The bit-flip probability of every qubit.
+     * @param generator The random number generator.
+     */
+    HeterogeneousBitFlipErrorModel(std::vector<double> probabilities,
+                                   Generator generator)
+        : probabilities_(std::move(probabilities)), skipper_(probabilities_),
+          generator_(std::move(generator)) {}
+
+    explicit HeterogeneousBitFlipErrorModel(std::vector<double> probabilities,
+                                            int seed = -1)
+        : HeterogeneousBitFlipErrorModel(std::move(probabilities),
+                                         Generator(GetSeed(seed))) {}
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return generator_; }
+
+    const std::vector<double> &GetProbabilities() const {
+        return probabilities_;
+    }
+
+    /**
+     * @brief Returns the growth increments of a decoder weighted by the
+     * error rates, see Utils::GetGrowthIncrementsFromProbabilities().
+     */
+    std::vector<float> GetGrowthIncrements(float max_growth = 2.0) const {
+        return Utils::GetGrowthIncrementsFromProbabilities(probabilities_,
+                                                           max_growth);
+    }
+
+    /**
+     * @brief Samples the indices of the flipped qubits in increasing order.
+     */
+    void GetErrors(std::vector<size_t> &flipped) {
+        skipper_.GetSuccesses(generator_, flipped);
+    }
+
+    /**
+     * @brief Samples the errors into a packed bitset, bit q % 64 of word
+     * q / 64 for qubit q.
+     */
+    void GetPackedErrors(std::vector<uint64_t> &words) {
+        words.assign(GetNumPackedWords(probabilities_.size()), 0);
+        skipper_.ForEachSuccess(generator_,
+                                [&](size_t q) { SetPackedBit(words, q); });
+    }
+
+    /**
+     * @brief Samples the errors into a vector with one flag per qubit.
+     */
+    void GetErrors(std::vector<bool> &errors) {
+        errors.assign(probabilities_.size(), false);
+        skipper_.ForEachSuccess(generator_,
+                                [&](size_t q) { errors[q] = true; });
+    }
+
+    std::vector<bool> GetErrors() {
+        std::vector<bool> errors;
+        GetErrors(errors);
+        return errors;
+    }
+};
+
+/**
+ * @brief An erasure error model with its own erasure rate for every qubit.
+ *
+ * As in GeometricErasureErrorModel, an erased qubit is flipped with
+ * probability 1/2, but the erasures are sampled with a BucketedSkipper.
+ *
+ * @tparam Generator As for GeometricBitFlipErrorModel.
+ */
+template <typename Generator = Xoshiro256PlusPlus>
+class HeterogeneousErasureErrorModel {
+
+  private:
+    std::vector<double> probabilities_; /**< The erasure rate of every qubit */
+    BucketedSkipper skipper_;           /**< Visits the erased qubits */
+    Generator generator_;
+    std::vector<size_t> erased_;  /**< Scratch for GetPackedErrors() */
+    std::vector<size_t> flipped_; /**< Scratch for GetPackedErrors() */
+
+  public:
+    /**
+     * @brief Constructor for the HeterogeneousErasureErrorModel class.
+     *
+     * @param probabilities The erasure probability of every qubit.
+     * @param generator The random number generator.
+     */
+    HeterogeneousErasureErrorModel(std::vector<double> probabilities,
+                                   Generator generator)
+        : probabilities_(std::move(probabilities)), skipper_(probabilities_),
+          generator_(std::move(generator)) {}
+
+    explicit HeterogeneousErasureErrorModel(std::vector<double> probabilities,
+                                            int seed = -1)
+        : HeterogeneousErasureErrorModel(std::move(probabilities),
+                                         Generator(GetSeed(seed))) {}
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return generator_; }
+
+    const std::vector<double> &GetProbabilities() const {
+        return probabilities_;
+    }
+
+    /**
+     * @brief Samples the erased qubits and the erased qubits that were
+     * flipped, both in increasing order.
+     */
+    void GetErrors(std::vector<size_t> &erased, std::vector<size_t> &flipped) {
+        skipper_.GetSuccesses(generator_, erased);
+        flipped.clear();
+        // The flips are drawn in qubit order, 64 per random word.
+        uint64_t flip_bits = 0;
+        for (size_t i = 0; i < erased.size(); i++) {
+            if (i % 64 == 0) {
+                flip_bits = generator_();
+            }
+            if ((flip_bits >> (i % 64)) & 1) {
+                flipped.push_back(erased[i]);
+            }
+        }
+    }
+
+    /**
+     * @brief Samples the erasures and flips into packed bitsets, drawing
+     * the same errors as GetErrors() from the same generator state.
+     */
+    void GetPackedErrors(std::vector<uint64_t> &erasure,
+                         std::vector<uint64_t> &flips) {
+        GetErrors(erased_, flipped_);
+        erasure.assign(GetNumPackedWords(probabilities_.size()), 0);
+        flips.assign(erasure.size(), 0);
+        for (auto q : erased_) {
+            SetPackedBit(erasure, q);
+        }
+        for (auto q : flipped_) {
+            SetPackedBit(flips, q);
+        }
+    }
+};
+
+/**
+ * @brief Lays out the error rates of a phenomenological space-time graph,
+ * see StabilizerCode::BuildSpaceTimeGraph_(), one per edge.
+ *
+ * @param data_probabilities The rate of every data qubit, either once for
+ * all rounds (num_qubits rates) or per round (num_rounds * num_qubits rates,
+ * round by round).
+ * @param measurement_probabilities The measurement error rate of every
+ * stabilizer, either once for all rounds (num_stabilizers rates) or per
+ * imperfect round ((num_rounds - 1) * num_stabilizers rates). The final
+ * round is perfect and has no time-like edges.
+ * @param num_qubits The number of data qubits per round.
+ * @param num_stabilizers The number of stabilizers per round.
+ * @param num_rounds The number of measurement rounds.
+ * @return The rate of every space-like edge followed by the rate of every
+ * time-like edge.
+ */
+inline std::vector<double>
+GetSpaceTimeProbabilities(std::span<const double> data_probabilities,
+                          std::span<const double> measurement_probabilities,
+                          size_t num_qubits, size_t num_stabilizers,
+                          size_t num_rounds) {
+    if (num_rounds == 0) {
+        throw std::invalid_argument("num_rounds must be at least 1");
+    }
+    size_t num_measurements = (num_rounds - 1) * num_stabilizers;
+    bool data_per_round = data_probabilities.size() == num_rounds * num_qubits;
+    if (!data_per_round && data_probabilities.size() != num_qubits) {
+        throw std::invalid_argument(
+            "Expected one data error rate per qubit, or per qubit and round");
+    }
+    bool measurement_per_round =
+        measurement_probabilities.size() == num_measurements;
+    if (!measurement_per_round &&
+        measurement_probabilities.size() != num_stabilizers) {
+        throw std::invalid_argument("Expected one measurement error rate per "
+                                    "stabilizer, or per stabilizer and round");
+    }
+
+    std::vector<double> probabilities;
+    probabilities.reserve(num_rounds * num_qubits + num_measurements);
+    for (size_t r = 0; r < num_rounds; r++) {
+        size_t offset = data_per_round ? r * num_qubits : 0;
+        probabilities.insert(probabilities.end(),
+                             data_probabilities.begin() + offset,
+                             data_probabilities.begin() + offset + num_qubits);
+    }
+    for (size_t r = 0; r + 1 < num_rounds; r++) {
+        size_t offset = measurement_per_round ? r * num_stabilizers : 0;
+        probabilities.insert(
+            probabilities.end(), measurement_probabilities.begin() + offset,
+            measurement_probabilities.begin() + offset + num_stabilizers);
+    }
+    return probabilities;
+}
+
 }; // namespace ErrorModels
 }; // namespace Plaquette
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+
+#include "DecodingGraph.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief The interface the decoder needs from a decoding graph.
+ *
+ * DecodingGraph satisfies it with CSR rows stored in memory, LatticeGraph
+ * computes the same queries from coordinates. The rows returned for a vertex
+ * or an edge only need size() and operator[], so they may be views or small
+ * values.
+ */
+template <typename Graph>
+concept DecodingGraphLike = requires(const Graph &graph, size_t id) {
+    { graph.GetNumVertices() } -> std::convertible_to<size_t>;
+    { graph.GetNumEdges() } -> std::convertible_to<size_t>;
+    { graph.IsVertexOnBoundary(id) } -> std::convertible_to<bool>;
+    {
+        graph.GetVerticesConnectedByEdge(id).first
+    } -> std::convertible_to<size_t>;
+    {
+        graph.GetVerticesConnectedByEdge(id).second
+    } -> std::convertible_to<size_t>;
+    { graph.GetEdgesTouchingVertex(id).size() } -> std::convertible_to<size_t>;
+    { graph.GetEdgesTouchingVertex(id)[0] } -> std::convertible_to<size_t>;
+    { graph.GetVerticesTouchingVertex(id)[0] } -> std::convertible_to<size_t>;
+    { graph.GetEdgesTouchingEdge(id).size() } -> std::convertible_to<size_t>;
+    { graph.GetEdgesTouchingEdge(id)[0] } -> std::convertible_to<size_t>;
+};
+
+/**
+ * @brief A decoding graph that enumerates the edges and neighbours of a
+ * vertex itself, with ForEachNeighbour(vertex, function), instead of handing
+ * out stored rows.
+ */
+template <typename Graph>
+concept ComputesNeighbours =
+    DecodingGraphLike<Graph> &&
+    requires(const Graph &graph, size_t id, void (*function)(size_t, size_t)) {
+        graph.ForEachNeighbour(id, function);
+    };
+
+/**
+ * @brief Calls function(edge, neighbour) for every edge of a vertex, in the
+ * order of GetEdgesTouchingVertex().
+ */
+template <DecodingGraphLike Graph, typename Function>
+inline void ForEachNeighbour(const Graph &graph, size_t vertex_id,
+                             Function &&function) {
+    if constexpr (ComputesNeighbours<Graph>) {
+        graph.ForEachNeighbour(vertex_id, function);
+    } else {
+        const auto &edges = graph.GetEdgesTouchingVertex(vertex_id);
+        const auto &vertices = graph.GetVerticesTouchingVertex(vertex_id);
+        size_t num_edges = edges.size();
+        for (size_t i = 0; i < num_edges; ++i) {
+            function(edges[i], vertices[i]);
+        }
+    }
+}
+
+static_assert(DecodingGraphLike<DecodingGraph>);
+
+}; // namespace Plaquette
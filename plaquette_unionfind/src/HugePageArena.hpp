@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace Plaquette {
+
+/**
+ * @brief A monotonic memory resource that carves allocations out of large,
+ * 2 MiB aligned chunks.
+ *
+ * The per-vertex and per-edge arrays of a decoder are touched at scattered
+ * indices on every shot, so on large graphs they miss the TLB once they span
+ * more 4 KiB pages than it has entries. Placing them in an arena backed by
+ * 2 MiB transparent huge pages covers them with a few TLB entries instead.
+ * On Linux, chunks are mapped with mmap and marked with
+ * madvise(MADV_HUGEPAGE); whether the kernel actually backs them with huge
+ * pages depends on /sys/kernel/mm/transparent_hugepage/enabled. Elsewhere,
+ * or with use_huge_pages disabled, chunks are still 2 MiB aligned but use
+ * ordinary pages.
+ *
+ * Every allocation is aligned to at least a cache line. Deallocation is a
+ * no-op: memory is returned when the arena is destroyed, so the arena must
+ * outlive every container that uses it. Like
+ * std::pmr::monotonic_buffer_resource it is not thread-safe; give each decoder
+ * thread its own arena.
+ */
+class HugePageArena : public std::pmr::memory_resource {
+
+  public:
+    static constexpr size_t kHugePageSize = size_t{1} << 21;
+    static constexpr size_t kMinAlignment = 64;
+
+  private:
+    struct Chunk {
+        void *data;
+        size_t size;
+    };
+
+    size_t chunk_size_;   ///< The size of chunks shared by small allocations.
+    bool use_huge_pages_; ///< Whether chunks are advised as huge pages.
+    std::vector<Chunk> chunks_;
+    std::byte *cursor_ = nullptr; ///< The first free byte of the last chunk.
+    std::byte *end_ = nullptr;    ///< The end of the last shared chunk.
+    size_t bytes_allocated_ = 0;
+    size_t bytes_reserved_ = 0;
+
+    static size_t RoundUp_(size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    void *MapChunk_(size_t size) {
+#ifdef _WIN32
+        void *data = ::operator new(size, std::align_val_t(kHugePageSize));
+#else
+        // Over-map by one huge page and trim, so the chunk is 2 MiB aligned
+        // and can be backed by huge pages from its first byte.
+        size_t mapped_size = size + kHugePageSize;
+        void *mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        auto address = reinterpret_cast<uintptr_t>(mapped);
+        auto aligned = RoundUp_(address, kHugePageSize);
+        if (aligned > address) {
+            munmap(mapped, aligned - address);
+        }
+        size_t tail = address + mapped_size - (aligned + size);
+        if (tail > 0) {
+            munmap(reinterpret_cast<void *>(aligned + size), tail);
+        }
+        void *data = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+        if (use_huge_pages_) {
+            madvise(data, size, MADV_HUGEPAGE);
+        }
+#endif
+#endif
+        chunks_.push_back({data, size});
+        bytes_reserved_ += size;
+        return data;
+    }
+
+    static void UnmapChunk_(const Chunk &chunk) {
+#ifdef _WIN32
+        ::operator delete(chunk.data, std::align_val_t(kHugePageSize));
+#else
+        munmap(chunk.data, chunk.size);
+#endif
+    }
+
+  protected:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+        alignment = std::max(alignment, kMinAlignment);
+        bytes = std::max<size_t>(bytes, 1);
+        bytes_allocated_ += bytes;
+
+        // Large arrays get chunks of their own, so they do not waste the
+        // rest of the shared chunk.
+        if (bytes > chunk_size_ / 2) {
+            return MapChunk_(RoundUp_(bytes, kHugePageSize));
+        }
+
+        auto address = reinterpret_cast<uintptr_t>(cursor_);
+        auto aligned = RoundUp_(address, alignment);
+        if (cursor_ == nullptr ||
+            aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+            cursor_ = static_cast<std::byte *>(MapChunk_(chunk_size_));
+            end_ = cursor_ + chunk_size_;
+            aligned = reinterpret_cast<uintptr_t>(cursor_);
+        }
+        cursor_ = reinterpret_cast<std::byte *>(aligned + bytes);
+        return reinterpret_cast<void *>(aligned);
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+        noexcept override {
+        return this == &other;
+    }
+
+  public:
+    /**
+     * @brief Constructs an empty arena. No memory is mapped until the first
+     * allocation.
+     *
+     * @param chunk_size The size of the chunks that small allocations share,
+     * rounded up to a multiple of 2 MiB.
+     * @param use_huge_pages Whether to ask the kernel for transparent huge
+     * pages. Disabling it keeps the arena layout, which isolates the effect
+     * of huge pages in benchmarks.
+     */
+    explicit HugePageArena(size_t chunk_size = kHugePageSize,
+                           bool use_huge_pages = true)
+        : chunk_size_(
+              RoundUp_(std::max<size_t>(chunk_size, 1), kHugePageSize)),
+          use_huge_pages_(use_huge_pages) {}
+
+    HugePageArena(const HugePageArena &) = delete;
+    HugePageArena &operator=(const HugePageArena &) = delete;
+
+    ~HugePageArena() override {
+        for (const auto &chunk : chunks_) {
+            UnmapChunk_(chunk);
+        }
+    }
+
+    bool UsesHugePages() const { return use_huge_pages_; }
+
+    /**
+     * @brief Returns the number of bytes handed out, including memory of
+     * containers that have since released it.
+     */
+    size_t GetBytesAllocated() const { return bytes_allocated_; }
+
+    /**
+     * @brief Returns the number of bytes mapped for chunks.
+     */
+    size_t GetBytesReserved() const { return bytes_reserved_; }
+};
+
+}; // namespace Plaquette
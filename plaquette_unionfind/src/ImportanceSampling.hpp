@@ -0,0 +1,260 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ErrorModels.hpp"
+#include "MonteCarlo.hpp"
+#include "StabilizerCode.hpp"
+#include "UnionFindDecoder.hpp"
+
+namespace Plaquette {
+namespace Simulation {
+
+/**
+ * @brief Returns the binomial probability of k successes in n trials with
+ * success probability p.
+ */
+inline double GetBinomialProbability(size_t n, size_t k, double p) {
+    if (k > n) {
+        return 0.0;
+    }
+    if (p <= 0.0) {
+        return k == 0 ? 1.0 : 0.0;
+    }
+    if (p >= 1.0) {
+        return k == n ? 1.0 : 0.0;
+    }
+    double log_probability =
+        std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0) +
+        k * std::log(p) + (n - k) * std::log1p(-p);
+    return std::exp(log_probability);
+}
+
+/**
+ * @brief The settings of a fixed-weight estimate of logical error rates.
+ */
+struct FixedWeightOptions {
+    /// The smallest sampled weight, 0 for (distance + 1) / 2. Lighter errors
+    /// are assumed never to fail, which holds for (distance + 1) / 2 as the
+    /// decoder corrects every error of weight below d / 2.
+    size_t min_weight = 0;
+    /// The largest sampled weight, see FixedWeightResult::GetTruncationBound.
+    size_t max_weight = 0;
+    size_t shots_per_weight = 10000;
+    size_t num_threads = 0; ///< 0 uses std::thread::hardware_concurrency().
+    uint64_t seed = 0;
+    size_t chunk_size = 1024;
+};
+
+/**
+ * @brief The failure counts of every sampled error weight, from which logical
+ * error rates at any bit-flip rate are estimated.
+ *
+ * With n edges, i.i.d. flips at rate p have weight w with the binomial
+ * probability B(w; n, p) and, given their weight, are uniform over the
+ * subsets of that size. The logical error rate is therefore the sum over w of
+ * B(w; n, p) f(w), where f(w) is the failure rate at weight w, and the
+ * estimate replaces f(w) by the sampled failure fractions. It is unbiased up
+ * to truncation: the weights above the largest sampled one are left out, so
+ * it is low by at most GetTruncationBound(). Far below threshold the few
+ * failing weights carry a tiny binomial weight but are sampled as often as
+ * any other, so rates of 10^-9 and below are resolved with a few 10^5 decodes
+ * instead of 10^10 or more.
+ */
+struct FixedWeightResult {
+    std::string code;
+    size_t distance = 0;
+    size_t rounds = 0;
+    size_t num_edges = 0;      ///< The number of edges n that may flip.
+    size_t min_weight = 0;     ///< The weight of the first entries below.
+    std::vector<size_t> num_shots;    ///< The shots of every weight.
+    std::vector<size_t> num_failures; ///< The failures of every weight.
+    double seconds = 0.0; ///< Wall-clock time of sampling and decoding.
+
+    size_t GetMaxWeight() const { return min_weight + num_shots.size() - 1; }
+
+    /**
+     * @brief Returns the sampled failure rate at a weight.
+     */
+    double GetFailureRate(size_t weight) const {
+        if (weight < min_weight || weight > GetMaxWeight()) {
+            throw std::invalid_argument("The weight was not sampled");
+        }
+        size_t k = weight - min_weight;
+        return num_shots[k] == 0 ? 0.0
+                                 : static_cast<double>(num_failures[k]) /
+                                       num_shots[k];
+    }
+
+    /**
+     * @brief Returns the estimated logical error rate at bit-flip rate p,
+     * without the weights above the largest sampled one.
+     */
+    double GetLogicalErrorRate(double p) const {
+        double rate = 0.0;
+        for (size_t k = 0; k < num_shots.size(); k++) {
+            rate += GetBinomialProbability(num_edges, min_weight + k, p) *
+                    GetFailureRate(min_weight + k);
+        }
+        return rate;
+    }
+
+    /**
+     * @brief Returns the standard error of GetLogicalErrorRate().
+     *
+     * Weights without failures add no variance, so the error is only
+     * meaningful once the weights that dominate the rate have failed a few
+     * times.
+     */
+    double GetStandardError(double p) const {
+        double variance = 0.0;
+        for (size_t k = 0; k < num_shots.size(); k++) {
+            if (num_shots[k] == 0) {
+                continue;
+            }
+            double probability =
+                GetBinomialProbability(num_edges, min_weight + k, p);
+            double f = GetFailureRate(min_weight + k);
+            variance +=
+                probability * probability * f * (1.0 - f) / num_shots[k];
+        }
+        return std::sqrt(variance);
+    }
+
+    /**
+     * @brief Returns the probability of a weight above the largest sampled
+     * one, which bounds the contribution of the unsampled heavy errors.
+     */
+    double GetTruncationBound(double p) const {
+        double bound = 0.0;
+        for (size_t w = GetMaxWeight() + 1; w <= num_edges; w++) {
+            double probability = GetBinomialProbability(num_edges, w, p);
+            bound += probability;
+            if (w > num_edges * p && probability < 1e-18 * bound) {
+                break;
+            }
+        }
+        return bound;
+    }
+
+    /**
+     * @brief Returns a normal confidence interval of the logical error rate
+     * at p, widened upwards by the truncation bound.
+     */
+    std::pair<double, double> GetConfidenceInterval(double p,
+                                                    double z = 1.96) const {
+        double rate = GetLogicalErrorRate(p);
+        double half_width = z * GetStandardError(p);
+        return {std::max(0.0, rate - half_width),
+                std::min(1.0, rate + half_width + GetTruncationBound(p))};
+    }
+};
+
+/**
+ * @brief Estimates the failure rate of every error weight from min_weight to
+ * max_weight, for logical error rates at any low bit-flip rate.
+ *
+ * Every shot flips a uniformly random set of exactly w edges of the Z
+ * stabilizer decoding graph, drawn by an ErrorModels::FixedWeightErrorModel
+ * from substream 5 of a PhiloxGenerator sought to (w << 40) + i for the i-th
+ * shot of weight w. Adding weights or shots therefore extends an earlier run
+ * rather than changing it, and the counts do not depend on the threads or
+ * the chunk size. Shots are decoded and checked as in RunMonteCarloChunk().
+ *
+ * @param code The code, which is only read and may be shared.
+ * @param options The weights, shots and threads.
+ */
+template <typename Code>
+FixedWeightResult RunFixedWeightMonteCarlo(const Code &code,
+                                           const FixedWeightOptions &options) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+    size_t min_weight = options.min_weight == 0
+                            ? (code.GetCodeDistance() + 1) / 2
+                            : options.min_weight;
+    if (min_weight > options.max_weight ||
+        options.max_weight > num_edges) {
+        throw std::invalid_argument(
+            "The weights must satisfy min_weight <= max_weight <= #edges");
+    }
+    if (options.shots_per_weight >= (uint64_t{1} << 40)) {
+        throw std::invalid_argument("Too many shots per weight");
+    }
+    size_t num_weights = options.max_weight - min_weight + 1;
+
+    FixedWeightResult result;
+    result.num_edges = num_edges;
+    result.min_weight = min_weight;
+    result.num_shots.assign(num_weights, options.shots_per_weight);
+    if (options.shots_per_weight == 0) {
+        result.num_failures.assign(num_weights, 0);
+        return result;
+    }
+
+    // The shots of all weights are numbered consecutively and spread over
+    // the threads like the shots of a single rate.
+    MonteCarloOptions monte_carlo;
+    monte_carlo.num_shots = num_weights * options.shots_per_weight;
+    monte_carlo.num_threads = options.num_threads;
+    monte_carlo.seed = options.seed;
+    size_t chunk_size = std::max<size_t>(1, options.chunk_size);
+
+    auto start = std::chrono::steady_clock::now();
+    result.num_failures = RunChunksInParallel(
+        graph, monte_carlo, chunk_size, num_weights,
+        [&](Decoders::UnionFindDecoder &decoder,
+            std::vector<uint8_t> &correction, size_t first_shot,
+            size_t num_shots, std::vector<size_t> &failures) {
+            ErrorModels::FixedWeightErrorModel model(
+                num_edges, 0, PhiloxGenerator(options.seed));
+            std::vector<size_t> errors;
+            std::vector<bool> syndrome;
+            for (size_t shot = first_shot; shot < first_shot + num_shots;
+                 shot++) {
+                size_t k = shot / options.shots_per_weight;
+                size_t weight = min_weight + k;
+                uint64_t index = shot % options.shots_per_weight;
+                model.SetWeight(weight);
+                model.GetGenerator().Seek((uint64_t{weight} << 40) | index, 5);
+                model.GetErrors(errors);
+
+                code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z,
+                                     syndrome);
+                decoder.Decode(syndrome, correction);
+                if (code.MeasureResidualLogical(errors, correction,
+                                                StabilizerCode::Channel::Z)) {
+                    failures[k]++;
+                }
+            }
+        });
+    result.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    return result;
+}
+
+/**
+ * @brief Builds a code by name ("planar", "rotated" or "toric") and
+ * estimates the failure rate of every error weight, see
+ * RunFixedWeightMonteCarlo().
+ */
+inline FixedWeightResult
+RunFixedWeightMonteCarlo(const std::string &code, size_t distance,
+                         size_t rounds, const FixedWeightOptions &options) {
+    auto result = WithCode(code, distance, rounds, [&](const auto &c) {
+        return RunFixedWeightMonteCarlo(c, options);
+    });
+    result.code = code;
+    result.distance = distance;
+    result.rounds = rounds;
+    return result;
+}
+
+}; // namespace Simulation
+}; // namespace Plaquette
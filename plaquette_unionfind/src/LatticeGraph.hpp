@@ -0,0 +1,296 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+#include "GraphConcepts.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief The decoding graph of a toric or planar code, with optional
+ * measurement rounds, computed from coordinates instead of stored.
+ *
+ * The graph only keeps its dimensions. Neighbours, edge ids and boundary
+ * flags are derived with index arithmetic whenever they are queried, so a
+ * large lattice needs no graph memory and the neighbours of a vertex are
+ * computed in registers instead of being streamed from CSR rows.
+ *
+ * Vertices and edges are numbered exactly like the Z stabilizer graphs of
+ * ToricCode (periodic) and PlanarCode (open), and every row lists its edges
+ * in increasing order like the CSR rows of a DecodingGraph. Decoding on a
+ * LatticeGraph therefore gives the same corrections as decoding on the graph
+ * of the corresponding code, and the code can still be used to sample
+ * syndromes and measure logicals.
+ *
+ * For a lattice of size L, the stabilizers of one round form a grid of
+ * rows j and columns i with vertex id j * L + i, L rows in the periodic case
+ * and L - 1 in the open case. Open lattices add L boundary vertices above and
+ * L below the grid. With several rounds, vertices are numbered round by
+ * round and all space-like edges come before all time-like ones, which join
+ * each stabilizer to itself in the next round.
+ */
+class LatticeGraph {
+
+  public:
+    static constexpr size_t kMaxDegree = 6;
+
+    /**
+     * @brief A small row of ids returned by value.
+     */
+    template <size_t Capacity> class Row {
+      public:
+        size_t size() const { return size_; }
+        size_t operator[](size_t i) const { return ids_[i]; }
+        void push_back(size_t id) { ids_[size_++] = id; }
+
+      private:
+        std::array<size_t, Capacity> ids_;
+        size_t size_ = 0;
+    };
+
+  private:
+    size_t lattice_size_;
+    bool periodic_;
+    size_t num_rounds_;
+    size_t num_rows_;           ///< Stabilizer rows per round.
+    size_t num_stabilizers_;    ///< Stabilizers per round.
+    size_t num_layer_vertices_; ///< Vertices per round.
+    size_t num_layer_edges_;    ///< Space-like edges per round.
+    size_t num_space_edges_;    ///< Space-like edges of all rounds.
+    size_t edge_row_stride_;    ///< Edge ids per stabilizer row.
+
+    /**
+     * @brief Divides two ids in 32 bits, which is several times faster than
+     * a 64-bit division on common CPUs. The constructor checks that all ids
+     * fit.
+     */
+    static size_t Divide_(size_t numerator, size_t denominator) {
+        return static_cast<uint32_t>(numerator) /
+               static_cast<uint32_t>(denominator);
+    }
+
+    size_t GetRound_(size_t vertex_id) const {
+        return num_rounds_ == 1 ? 0 : Divide_(vertex_id, num_layer_vertices_);
+    }
+
+  public:
+    /**
+     * @brief Constructs the graph of a lattice.
+     *
+     * @param lattice_size The code distance L, at least 3 for periodic and 2
+     * for open lattices.
+     * @param periodic Whether the lattice is a torus (ToricCode) or has
+     * rough boundaries at the top and bottom (PlanarCode).
+     * @param num_rounds The number of measurement rounds.
+     */
+    LatticeGraph(size_t lattice_size, bool periodic, size_t num_rounds = 1)
+        : lattice_size_(lattice_size), periodic_(periodic),
+          num_rounds_(num_rounds) {
+        if (lattice_size < (periodic ? 3 : 2)) {
+            throw std::invalid_argument(
+                periodic ? "A periodic LatticeGraph requires lattice_size >= 3"
+                         : "An open LatticeGraph requires lattice_size >= 2");
+        }
+        if (num_rounds < 1) {
+            throw std::invalid_argument(
+                "LatticeGraph requires num_rounds >= 1");
+        }
+        size_t L = lattice_size;
+        num_rows_ = periodic ? L : L - 1;
+        num_stabilizers_ = num_rows_ * L;
+        num_layer_vertices_ = num_stabilizers_ + (periodic ? 0 : 2 * L);
+        num_layer_edges_ = periodic ? 2 * L * L : L * L + (L - 1) * (L - 1);
+        num_space_edges_ = num_rounds * num_layer_edges_;
+        edge_row_stride_ = periodic ? 2 * L : 2 * L - 1;
+        if (GetNumEdges() > std::numeric_limits<uint32_t>::max() ||
+            GetNumVertices() > std::numeric_limits<uint32_t>::max()) {
+            throw std::invalid_argument(
+                "LatticeGraph ids must fit in 32 bits");
+        }
+    }
+
+    size_t GetLatticeSize() const { return lattice_size_; }
+    bool IsPeriodic() const { return periodic_; }
+    size_t GetNumRounds() const { return num_rounds_; }
+
+    size_t GetNumVertices() const {
+        return num_rounds_ * num_layer_vertices_;
+    }
+
+    size_t GetNumEdges() const {
+        return num_space_edges_ + (num_rounds_ - 1) * num_stabilizers_;
+    }
+
+    bool IsVertexOnBoundary(size_t vertex_id) const {
+        return vertex_id - GetRound_(vertex_id) * num_layer_vertices_ >=
+               num_stabilizers_;
+    }
+
+    /**
+     * @brief Calls function(edge, neighbour) for every edge of a vertex, in
+     * increasing edge order.
+     */
+    template <typename Function>
+    void ForEachNeighbour(size_t vertex_id, Function &&function) const {
+        size_t L = lattice_size_;
+        size_t round = GetRound_(vertex_id);
+        size_t u = vertex_id - round * num_layer_vertices_;
+        size_t offset = vertex_id - u;
+        size_t edges = round * num_layer_edges_;
+
+        if (u >= num_stabilizers_) {
+            // A boundary vertex has a single edge to the nearest row.
+            size_t i = u - num_stabilizers_;
+            if (i < L) {
+                function(edges + i, offset + i);
+            } else {
+                i -= L;
+                function(edges + (L - 1) * edge_row_stride_ + i,
+                         offset + (num_rows_ - 1) * L + i);
+            }
+            return;
+        }
+
+        size_t j = Divide_(u, L);
+        size_t i = u - j * L;
+        size_t row_edges = edges + j * edge_row_stride_;
+        if (periodic_) {
+            // Horizontal edge (j, i) joins columns i - 1 and i, vertical edge
+            // (j, i) joins rows j and j + 1, both modulo L.
+            if (j > 0) {
+                function(row_edges - L + i, offset + u - L);
+            }
+            if (i == L - 1) {
+                function(row_edges, offset + j * L);
+            }
+            function(row_edges + i, offset + (i == 0 ? u + L - 1 : u - 1));
+            if (i < L - 1) {
+                function(row_edges + i + 1, offset + u + 1);
+            }
+            function(row_edges + L + i, offset + (j == L - 1 ? i : u + L));
+            if (j == 0) {
+                function(edges + (2 * L - 1) * L + i,
+                         offset + (L - 1) * L + i);
+            }
+        } else {
+            // Vertical edge (j, i) joins row j - 1 (or the top boundary) and
+            // row j (or the bottom boundary), horizontal edge (j, i) joins
+            // columns i and i + 1.
+            function(row_edges + i,
+                     j == 0 ? offset + num_stabilizers_ + i : offset + u - L);
+            if (i > 0) {
+                function(row_edges + L + i - 1, offset + u - 1);
+            }
+            if (i < L - 1) {
+                function(row_edges + L + i, offset + u + 1);
+            }
+            function(row_edges + edge_row_stride_ + i,
+                     j == num_rows_ - 1 ? offset + num_stabilizers_ + L + i
+                                        : offset + u + L);
+        }
+
+        size_t time_edges = num_space_edges_ + u;
+        if (round > 0) {
+            function(time_edges + (round - 1) * num_stabilizers_,
+                     vertex_id - num_layer_vertices_);
+        }
+        if (round + 1 < num_rounds_) {
+            function(time_edges + round * num_stabilizers_,
+                     vertex_id + num_layer_vertices_);
+        }
+    }
+
+    Row<kMaxDegree> GetEdgesTouchingVertex(size_t vertex_id) const {
+        Row<kMaxDegree> row;
+        ForEachNeighbour(vertex_id,
+                         [&](size_t edge, size_t) { row.push_back(edge); });
+        return row;
+    }
+
+    Row<kMaxDegree> GetVerticesTouchingVertex(size_t vertex_id) const {
+        Row<kMaxDegree> row;
+        ForEachNeighbour(vertex_id, [&](size_t, size_t neighbour) {
+            row.push_back(neighbour);
+        });
+        return row;
+    }
+
+    /**
+     * @brief Returns the edges that share a vertex with an edge, excluding
+     * the edge itself.
+     */
+    Row<2 * (kMaxDegree - 1)> GetEdgesTouchingEdge(size_t edge_id) const {
+        Row<2 * (kMaxDegree - 1)> row;
+        auto [first, second] = GetVerticesConnectedByEdge(edge_id);
+        auto add = [&](size_t edge, size_t) {
+            if (edge != edge_id) {
+                row.push_back(edge);
+            }
+        };
+        ForEachNeighbour(first, add);
+        ForEachNeighbour(second, add);
+        return row;
+    }
+
+    std::pair<size_t, size_t>
+    GetVerticesConnectedByEdge(size_t edge_id) const {
+        size_t L = lattice_size_;
+        if (edge_id >= num_space_edges_) {
+            size_t t = edge_id - num_space_edges_;
+            size_t round = Divide_(t, num_stabilizers_);
+            size_t v = t - round * num_stabilizers_ +
+                       round * num_layer_vertices_;
+            return {v, v + num_layer_vertices_};
+        }
+
+        size_t round =
+            num_rounds_ == 1 ? 0 : Divide_(edge_id, num_layer_edges_);
+        size_t e = edge_id - round * num_layer_edges_;
+        size_t offset = round * num_layer_vertices_;
+        size_t j = Divide_(e, edge_row_stride_);
+        size_t k = e - j * edge_row_stride_;
+        if (periodic_) {
+            if (k < L) {
+                return {offset + j * L + (k == 0 ? L - 1 : k - 1),
+                        offset + j * L + k};
+            }
+            k -= L;
+            size_t next_row = j + 1 == L ? 0 : j + 1;
+            return {offset + j * L + k, offset + next_row * L + k};
+        }
+        if (k < L) {
+            size_t upper = j == 0 ? num_stabilizers_ + k : (j - 1) * L + k;
+            size_t lower =
+                j == num_rows_ ? num_stabilizers_ + L + k : j * L + k;
+            return {offset + upper, offset + lower};
+        }
+        k -= L;
+        return {offset + j * L + k, offset + j * L + k + 1};
+    }
+
+    /**
+     * @brief Builds the explicit DecodingGraph with the same numbering, e.g.
+     * for code that needs stored rows.
+     */
+    DecodingGraph ToDecodingGraph() const {
+        std::vector<std::pair<size_t, size_t>> edges(GetNumEdges());
+        for (size_t e = 0; e < edges.size(); e++) {
+            edges[e] = GetVerticesConnectedByEdge(e);
+        }
+        std::vector<bool> vertex_boundary(GetNumVertices());
+        for (size_t v = 0; v < vertex_boundary.size(); v++) {
+            vertex_boundary[v] = IsVertexOnBoundary(v);
+        }
+        return DecodingGraph(GetNumVertices(), edges, vertex_boundary);
+    }
+};
+
+static_assert(ComputesNeighbours<LatticeGraph>);
+
+}; // namespace Plaquette
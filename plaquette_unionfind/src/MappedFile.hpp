@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Plaquette {
+
+/**
+ * @brief A read-only view of a whole file.
+ *
+ * On POSIX systems the file is memory-mapped and the kernel is told that it
+ * will be read sequentially, so large sample files are streamed from the page
+ * cache without being copied. Elsewhere the file is read into memory.
+ */
+class MappedFile {
+
+  private:
+    const char *data_ = nullptr; ///< The start of the file contents.
+    size_t size_ = 0;            ///< The size of the file in bytes.
+#ifdef _WIN32
+    std::vector<char> buffer_; ///< The file contents.
+#endif
+
+  public:
+    /**
+     * @brief Maps a file into memory.
+     *
+     * @param path The path of the file.
+     */
+    explicit MappedFile(const std::string &path) {
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Could not open '" + path + "'");
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open '" + path + "'");
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw std::runtime_error("Could not stat '" + path + "'");
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ > 0) {
+            void *address = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map '" + path + "'");
+            }
+            madvise(address, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char *>(address);
+        }
+        close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data_ != nullptr) {
+            munmap(const_cast<char *>(data_), size_);
+        }
+#endif
+    }
+
+    /**
+     * @brief Returns the start of the file contents.
+     */
+    const char *GetData() const { return data_; }
+
+    /**
+     * @brief Returns the size of the file in bytes.
+     */
+    size_t GetSize() const { return size_; }
+};
+
+}; // namespace Plaquette
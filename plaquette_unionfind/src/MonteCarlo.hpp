@@ -0,0 +1,828 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ErrorModels.hpp"
+#include "PackedBits.hpp"
+#include "PlanarCode.hpp"
+#include "Random.hpp"
+#include "RotatedPlanarCode.hpp"
+#include "StabilizerCode.hpp"
+#include "ToricCode.hpp"
+#include "UnionFindDecoder.hpp"
+
+namespace Plaquette {
+namespace Simulation {
+
+/**
+ * @brief Returns the Wilson score interval of a binomial proportion.
+ *
+ * Unlike the normal approximation it stays inside [0, 1] and is meaningful
+ * for zero failures, which is the common case at low error rates.
+ *
+ * @param num_successes The number of successes, e.g. logical failures.
+ * @param num_trials The number of trials.
+ * @param z The standard normal quantile, 1.96 for 95% confidence.
+ * @return The lower and upper bound.
+ */
+inline std::pair<double, double>
+GetWilsonInterval(size_t num_successes, size_t num_trials, double z = 1.96) {
+    if (num_trials == 0) {
+        return {0.0, 1.0};
+    }
+    double n = static_cast<double>(num_trials);
+    double rate = num_successes / n;
+    double z2 = z * z;
+    double denominator = 1.0 + z2 / n;
+    double center = (rate + z2 / (2.0 * n)) / denominator;
+    double half_width =
+        z * std::sqrt(rate * (1.0 - rate) / n + z2 / (4.0 * n * n)) /
+        denominator;
+    // center and half_width are equal in exact arithmetic when there are no
+    // successes or no failures, so the bound is not left to rounding.
+    double low =
+        num_successes == 0 ? 0.0 : std::max(0.0, center - half_width);
+    double high = num_successes == num_trials
+                      ? 1.0
+                      : std::min(1.0, center + half_width);
+    return {low, high};
+}
+
+/**
+ * @brief Returns the two-sided standard normal quantile z, with
+ * P(|Z| <= z) = confidence, e.g. 1.96 for 0.95.
+ */
+inline double GetNormalQuantile(double confidence) {
+    double low = 0.0;
+    double high = 40.0;
+    for (int i = 0; i < 200; i++) {
+        double z = 0.5 * (low + high);
+        if (std::erfc(z / std::sqrt(2.0)) > 1.0 - confidence) {
+            low = z;
+        } else {
+            high = z;
+        }
+    }
+    return 0.5 * (low + high);
+}
+
+/**
+ * @brief Returns the regularized incomplete beta function I_x(a, b), by the
+ * continued fraction of Numerical Recipes (section 6.4).
+ */
+inline double GetRegularizedIncompleteBeta(double x, double a, double b) {
+    if (x <= 0.0) {
+        return 0.0;
+    }
+    if (x >= 1.0) {
+        return 1.0;
+    }
+    auto continued_fraction = [](double x, double a, double b) {
+        constexpr double kTiny = 1e-300;
+        double c = 1.0;
+        double d = 1.0 - (a + b) * x / (a + 1.0);
+        d = 1.0 / (std::abs(d) < kTiny ? kTiny : d);
+        double h = d;
+        for (int m = 1; m <= 1000; m++) {
+            for (int step = 0; step < 2; step++) {
+                double numerator =
+                    step == 0
+                        ? m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m))
+                        : -(a + m) * (a + b + m) * x /
+                              ((a + 2 * m) * (a + 2 * m + 1));
+                d = 1.0 + numerator * d;
+                d = 1.0 / (std::abs(d) < kTiny ? kTiny : d);
+                c = 1.0 + numerator / c;
+                c = std::abs(c) < kTiny ? kTiny : c;
+                h *= d * c;
+                if (step == 1 && std::abs(d * c - 1.0) < 1e-15) {
+                    return h;
+                }
+            }
+        }
+        return h;
+    };
+    double log_front = std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                       a * std::log(x) + b * std::log1p(-x);
+    if (x < (a + 1.0) / (a + b + 2.0)) {
+        return std::exp(log_front) * continued_fraction(x, a, b) / a;
+    }
+    return 1.0 - std::exp(log_front) * continued_fraction(1.0 - x, b, a) / b;
+}
+
+/**
+ * @brief Returns the exact Clopper-Pearson interval of a binomial
+ * proportion.
+ *
+ * It inverts the binomial tails and so never covers less than the requested
+ * confidence, at the price of being wider than the Wilson interval.
+ *
+ * @param num_successes The number of successes, e.g. logical failures.
+ * @param num_trials The number of trials.
+ * @param confidence The confidence level, e.g. 0.95.
+ * @return The lower and upper bound.
+ */
+inline std::pair<double, double>
+GetClopperPearsonInterval(size_t num_successes, size_t num_trials,
+                          double confidence = 0.95) {
+    if (num_trials == 0) {
+        return {0.0, 1.0};
+    }
+    double k = static_cast<double>(num_successes);
+    double n = static_cast<double>(num_trials);
+    double alpha = 1.0 - confidence;
+    // The x with I_x(a, b) = target, by bisection.
+    auto inverse_beta = [](double target, double a, double b) {
+        double low = 0.0;
+        double high = 1.0;
+        for (int i = 0; i < 100; i++) {
+            double x = 0.5 * (low + high);
+            if (GetRegularizedIncompleteBeta(x, a, b) < target) {
+                low = x;
+            } else {
+                high = x;
+            }
+        }
+        return 0.5 * (low + high);
+    };
+    double low =
+        num_successes == 0 ? 0.0 : inverse_beta(alpha / 2, k, n - k + 1.0);
+    double high = num_successes == num_trials
+                      ? 1.0
+                      : inverse_beta(1.0 - alpha / 2, k + 1.0, n - k);
+    return {low, high};
+}
+
+/**
+ * @brief The confidence intervals of a logical error rate.
+ */
+enum class Interval { Wilson, ClopperPearson };
+
+inline std::pair<double, double> GetInterval(size_t num_successes,
+                                             size_t num_trials,
+                                             Interval interval,
+                                             double confidence) {
+    if (interval == Interval::ClopperPearson) {
+        return GetClopperPearsonInterval(num_successes, num_trials,
+                                         confidence);
+    }
+    return GetWilsonInterval(num_successes, num_trials,
+                             GetNormalQuantile(confidence));
+}
+
+/**
+ * @brief The settings of a Monte Carlo estimate of a logical error rate.
+ */
+struct MonteCarloOptions {
+    size_t num_shots = 10000;
+    size_t num_threads = 0; ///< 0 uses every hardware thread.
+    uint64_t seed = 0;
+    /// The probability that an edge is erased. Erased edges flip with
+    /// probability 1/2 instead of p and are passed to the decoder.
+    double erasure_probability = 0.0;
+    /// The number of shots a thread claims at once. The noise of every shot
+    /// is a pure function of the seed and the shot index, so the result
+    /// depends on neither the number of threads nor the chunk size.
+    size_t chunk_size = 1024;
+    /// Samples, measures and checks 64 shots at a time in bit-sliced words,
+    /// see RunBitSlicedMonteCarloChunk(). The chunk size is rounded up to a
+    /// multiple of 64. The shots differ from those of the default mode but
+    /// are reproducible in the same way.
+    bool bit_sliced = false;
+    /// The index of the first shot, e.g. to continue an earlier run with
+    /// more shots. A multiple of 64 when bit-sliced.
+    size_t first_shot = 0;
+};
+
+/**
+ * @brief The logical failure count of one (code, distance, rounds, p) point.
+ */
+struct MonteCarloResult {
+    std::string code;
+    size_t distance = 0;
+    size_t rounds = 1;
+    double p = 0.0;
+    double erasure_probability = 0.0;
+    size_t num_shots = 0;
+    size_t num_failures = 0;
+    double seconds = 0.0; ///< Wall-clock time of sampling and decoding.
+    /// Why RunMonteCarloAdaptive() stopped: "target_failures",
+    /// "target_relative_error", "max_shots" or "max_seconds".
+    std::string stop_reason;
+
+    double GetLogicalErrorRate() const {
+        return num_shots == 0 ? 0.0
+                              : static_cast<double>(num_failures) / num_shots;
+    }
+
+    /**
+     * @brief Returns the Wilson score interval of the logical error rate.
+     *
+     * @param z The standard normal quantile, 1.96 for 95% confidence.
+     */
+    std::pair<double, double> GetConfidenceInterval(double z = 1.96) const {
+        return GetWilsonInterval(num_failures, num_shots, z);
+    }
+
+    /**
+     * @brief Returns a Wilson or Clopper-Pearson interval of the logical
+     * error rate at a confidence level, e.g. 0.95.
+     */
+    std::pair<double, double> GetConfidenceInterval(Interval interval,
+                                                    double confidence) const {
+        return GetInterval(num_failures, num_shots, interval, confidence);
+    }
+};
+
+/**
+ * @brief Samples the shots first_shot .. first_shot + num_shots - 1, decodes
+ * them and returns the number of logical failures.
+ *
+ * Errors are bit flips with probability p on every edge of the Z stabilizer
+ * decoding graph, i.e. X errors on data qubits and, for several rounds,
+ * measurement errors. A shot fails if the residual error after correction
+ * flips the measurement of a logical Z operator.
+ *
+ * The bit flips and erasures of shot i are drawn from substreams 0 and 1 of a
+ * PhiloxGenerator keyed by the seed and sought to shot i.
+ */
+template <typename Code>
+size_t RunMonteCarloChunk(const Code &code, double p,
+                          const MonteCarloOptions &options,
+                          Decoders::UnionFindDecoder &decoder,
+                          size_t first_shot, size_t num_shots,
+                          std::vector<uint8_t> &correction) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+    ErrorModels::GeometricBitFlipErrorModel bit_flip_model(
+        num_edges, p, PhiloxGenerator(options.seed));
+    ErrorModels::GeometricErasureErrorModel erasure_model(
+        num_edges, options.erasure_probability, PhiloxGenerator(options.seed));
+    bool with_erasure = options.erasure_probability > 0.0;
+
+    // Errors stay sparse from sampling to the residual check, so only the
+    // decoder itself touches every edge.
+    std::vector<size_t> errors;
+    std::vector<size_t> bit_flips;
+    std::vector<size_t> erased;
+    std::vector<size_t> erasure_flips;
+    std::vector<bool> erasure;
+    std::vector<bool> syndrome;
+    size_t num_failures = 0;
+    for (size_t shot = first_shot; shot < first_shot + num_shots; shot++) {
+        bit_flip_model.GetGenerator().Seek(shot, 0);
+        bit_flip_model.GetErrors(errors);
+        if (with_erasure) {
+            // Erased edges take the flips of the erasure channel instead.
+            erasure_model.GetGenerator().Seek(shot, 1);
+            erasure_model.GetErrors(erased, erasure_flips);
+            bit_flips.clear();
+            std::set_difference(errors.begin(), errors.end(), erased.begin(),
+                                erased.end(), std::back_inserter(bit_flips));
+            bit_flips.insert(bit_flips.end(), erasure_flips.begin(),
+                             erasure_flips.end());
+            std::swap(errors, bit_flips);
+            erasure.assign(num_edges, false);
+            for (auto e : erased) {
+                erasure[e] = true;
+            }
+        }
+
+        code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z, syndrome);
+        if (with_erasure) {
+            decoder.Decode(syndrome, erasure, correction);
+        } else {
+            decoder.Decode(syndrome, correction);
+        }
+        if (code.MeasureResidualLogical(errors, correction,
+                                        StabilizerCode::Channel::Z)) {
+            num_failures++;
+        }
+    }
+    return num_failures;
+}
+
+/**
+ * @brief Samples, decodes and checks the shots first_shot ..
+ * first_shot + num_shots - 1 in batches of 64, bit-sliced across shots.
+ *
+ * Every edge and vertex holds a 64-bit word with one bit per shot of a batch.
+ * The noise of batch b = first_shot / 64 + i is drawn as one packed bitset of
+ * 64 * #edges bits from substreams 2 and 3 of a PhiloxGenerator sought to b,
+ * so that sampling, syndrome extraction and the parity of the logical
+ * operators cost one pass over the words for all 64 shots. Only the shots
+ * with a non-trivial syndrome are decoded, one at a time; for the others the
+ * correction is empty.
+ *
+ * @param first_shot The first shot, a multiple of 64.
+ */
+template <typename Code>
+size_t RunBitSlicedMonteCarloChunk(const Code &code, double p,
+                                   const MonteCarloOptions &options,
+                                   Decoders::UnionFindDecoder &decoder,
+                                   size_t first_shot, size_t num_shots,
+                                   std::vector<uint8_t> &correction) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+    size_t num_vertices = graph.GetNumVertices();
+    ErrorModels::GeometricBitFlipErrorModel bit_flip_model(
+        64 * num_edges, p, PhiloxGenerator(options.seed));
+    ErrorModels::GeometricErasureErrorModel erasure_model(
+        64 * num_edges, options.erasure_probability,
+        PhiloxGenerator(options.seed));
+    bool with_erasure = options.erasure_probability > 0.0;
+
+    std::vector<uint64_t> error_words;
+    std::vector<uint64_t> erasure_words;
+    std::vector<uint64_t> flip_words;
+    std::vector<uint64_t> syndrome_words;
+    std::vector<uint64_t> logical_words;
+    std::array<std::vector<size_t>, 64> defects;
+    std::array<std::vector<size_t>, 64> erased;
+    std::vector<bool> syndrome;
+    std::vector<bool> erasure;
+    size_t num_failures = 0;
+    for (size_t begin = first_shot; begin < first_shot + num_shots;
+         begin += 64) {
+        size_t num_lanes = std::min<size_t>(64, first_shot + num_shots - begin);
+        uint64_t lane_mask =
+            num_lanes == 64 ? ~uint64_t{0} : (uint64_t{1} << num_lanes) - 1;
+
+        bit_flip_model.GetGenerator().Seek(begin / 64, 2);
+        bit_flip_model.GetPackedErrors(error_words);
+        if (with_erasure) {
+            erasure_model.GetGenerator().Seek(begin / 64, 3);
+            erasure_model.GetPackedErrors(erasure_words, flip_words);
+            for (size_t e = 0; e < num_edges; e++) {
+                error_words[e] =
+                    (error_words[e] & ~erasure_words[e]) | flip_words[e];
+            }
+            UnpackBitSlices(erasure_words, lane_mask, erased);
+        }
+        code.MeasureBitSlicedSyndrome(error_words,
+                                      StabilizerCode::Stabilizer::Z,
+                                      syndrome_words);
+        code.MeasureBitSlicedLogicals(error_words, StabilizerCode::Channel::Z,
+                                      logical_words);
+        UnpackBitSlices(syndrome_words, lane_mask, defects);
+
+        for (size_t lane = 0; lane < num_lanes; lane++) {
+            uint64_t flips = 0;
+            for (size_t l = 0; l < logical_words.size(); l++) {
+                flips |= ((logical_words[l] >> lane) & 1) << l;
+            }
+            if (!defects[lane].empty()) {
+                syndrome.assign(num_vertices, false);
+                for (auto v : defects[lane]) {
+                    syndrome[v] = true;
+                }
+                if (with_erasure) {
+                    erasure.assign(num_edges, false);
+                    for (auto e : erased[lane]) {
+                        erasure[e] = true;
+                    }
+                    decoder.Decode(syndrome, erasure, correction);
+                } else {
+                    decoder.Decode(syndrome, correction);
+                }
+                flips ^= code.MeasureLogicalFlips(correction,
+                                                  StabilizerCode::Channel::Z);
+            }
+            if (flips != 0) {
+                num_failures++;
+            }
+        }
+    }
+    return num_failures;
+}
+
+/**
+ * @brief Splits the shots into chunks and runs them on all threads.
+ *
+ * Worker threads claim chunks of chunk_size shots from a shared counter and
+ * own one decoder and correction buffer each, which are reused for all of
+ * their shots.
+ *
+ * @param run_chunk Called as run_chunk(decoder, correction, first_shot,
+ * num_shots, failures), where failures has one counter per point.
+ * @return The summed failure counts of every point.
+ */
+template <typename RunChunk>
+std::vector<size_t> RunChunksInParallel(const DecodingGraph &graph,
+                                        const MonteCarloOptions &options,
+                                        size_t chunk_size, size_t num_points,
+                                        RunChunk &&run_chunk) {
+    size_t num_chunks = (options.num_shots + chunk_size - 1) / chunk_size;
+    size_t num_threads = options.num_threads;
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::max<size_t>(1, std::min(num_threads, num_chunks));
+
+    std::atomic<size_t> next_chunk = 0;
+    std::vector<std::vector<size_t>> num_failures(
+        num_threads, std::vector<size_t>(num_points, 0));
+
+    auto worker = [&](size_t thread) {
+        Decoders::UnionFindDecoder decoder(graph);
+        std::vector<uint8_t> correction(graph.GetNumEdges());
+        for (size_t chunk = next_chunk++; chunk < num_chunks;
+             chunk = next_chunk++) {
+            size_t begin = options.first_shot + chunk * chunk_size;
+            size_t end = std::min(begin + chunk_size,
+                                  options.first_shot + options.num_shots);
+            run_chunk(decoder, correction, begin, end - begin,
+                      num_failures[thread]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < num_threads; t++) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    std::vector<size_t> total(num_points, 0);
+    for (const auto &failures : num_failures) {
+        for (size_t i = 0; i < num_points; i++) {
+            total[i] += failures[i];
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Estimates the logical error rate of a code under bit-flip (and
+ * optionally erasure) noise at rate p.
+ *
+ * The noise of every shot depends only on the seed and the shot index, see
+ * RunMonteCarloChunk(), and the shots are spread over the threads by
+ * RunChunksInParallel().
+ *
+ * @param code The code, which is only read and may be shared.
+ * @param p The bit-flip probability of every edge.
+ * @param options The number of shots, threads and the seed.
+ * @return The failure count; the code name and distance are left to the
+ * caller.
+ */
+template <typename Code>
+MonteCarloResult RunMonteCarlo(const Code &code, double p,
+                               const MonteCarloOptions &options) {
+    if (p < 0.0 || p > 1.0 || options.erasure_probability < 0.0 ||
+        options.erasure_probability > 1.0) {
+        throw std::invalid_argument("Error probabilities must be in [0, 1]");
+    }
+    size_t chunk_size = std::max<size_t>(1, options.chunk_size);
+    if (options.bit_sliced) {
+        chunk_size = (chunk_size + 63) / 64 * 64;
+        if (options.first_shot % 64 != 0) {
+            throw std::invalid_argument(
+                "Bit-sliced runs must start at a multiple of 64 shots");
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto num_failures = RunChunksInParallel(
+        code.GetZStabilizerDecodingGraph(), options, chunk_size, 1,
+        [&](Decoders::UnionFindDecoder &decoder,
+            std::vector<uint8_t> &correction, size_t first_shot,
+            size_t num_shots, std::vector<size_t> &failures) {
+            if (options.bit_sliced) {
+                failures[0] += RunBitSlicedMonteCarloChunk(
+                    code, p, options, decoder, first_shot, num_shots,
+                    correction);
+            } else {
+                failures[0] +=
+                    RunMonteCarloChunk(code, p, options, decoder, first_shot,
+                                       num_shots, correction);
+            }
+        });
+    auto end = std::chrono::steady_clock::now();
+
+    MonteCarloResult result;
+    result.p = p;
+    result.erasure_probability = options.erasure_probability;
+    result.num_shots = options.num_shots;
+    result.num_failures = num_failures[0];
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return result;
+}
+
+/**
+ * @brief Samples and decodes the shots first_shot .. first_shot + num_shots - 1
+ * at every rate of a sweep from the same random draws.
+ *
+ * The bit flips of shot i come from a CoupledBitFlipErrorModel on substream 4
+ * of a PhiloxGenerator sought to i, so the errors at one rate are a subset of
+ * the errors at every higher rate. Erasures are drawn once per shot, as in
+ * RunMonteCarloChunk(), and shared by all rates. The syndrome is updated
+ * incrementally from one rate to the next, and a rate is only decoded if its
+ * errors differ from those of the previous rate; otherwise it shares its
+ * outcome.
+ *
+ * @param probabilities The bit-flip rates, in increasing order.
+ * @param failures Receives the failure count of every rate.
+ */
+template <typename Code>
+void RunMonteCarloSweepChunk(const Code &code,
+                             const std::vector<double> &probabilities,
+                             const MonteCarloOptions &options,
+                             Decoders::UnionFindDecoder &decoder,
+                             size_t first_shot, size_t num_shots,
+                             std::vector<uint8_t> &correction,
+                             std::vector<size_t> &failures) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+    ErrorModels::CoupledBitFlipErrorModel bit_flip_model(
+        num_edges, probabilities, PhiloxGenerator(options.seed));
+    ErrorModels::GeometricErasureErrorModel erasure_model(
+        num_edges, options.erasure_probability, PhiloxGenerator(options.seed));
+    bool with_erasure = options.erasure_probability > 0.0;
+
+    std::vector<std::vector<size_t>> increments;
+    std::vector<size_t> added;
+    std::vector<size_t> errors;
+    std::vector<size_t> erased;
+    std::vector<bool> erasure(num_edges, false);
+    std::vector<bool> base_syndrome;
+    std::vector<bool> syndrome;
+    for (size_t shot = first_shot; shot < first_shot + num_shots; shot++) {
+        bit_flip_model.GetGenerator().Seek(shot, 4);
+        bit_flip_model.GetErrors(increments);
+        errors.clear();
+        if (with_erasure) {
+            for (auto e : erased) {
+                erasure[e] = false;
+            }
+            erasure_model.GetGenerator().Seek(shot, 1);
+            erasure_model.GetErrors(erased, errors);
+            for (auto e : erased) {
+                erasure[e] = true;
+            }
+        }
+        code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z,
+                             base_syndrome);
+
+        bool failed = false;
+        for (size_t k = 0; k < probabilities.size(); k++) {
+            // Erased edges take the flips of the erasure channel instead.
+            added.clear();
+            for (auto e : increments[k]) {
+                if (!erasure[e]) {
+                    added.push_back(e);
+                }
+            }
+            if (k == 0 || !added.empty()) {
+                errors.insert(errors.end(), added.begin(), added.end());
+                code.ToggleSyndrome(added, StabilizerCode::Stabilizer::Z,
+                                    base_syndrome);
+                failed = false;
+                if (!errors.empty()) {
+                    syndrome = base_syndrome;
+                    if (with_erasure) {
+                        decoder.Decode(syndrome, erasure, correction);
+                    } else {
+                        decoder.Decode(syndrome, correction);
+                    }
+                    failed = code.MeasureResidualLogical(
+                        errors, correction, StabilizerCode::Channel::Z);
+                }
+            }
+            failures[k] += failed;
+        }
+    }
+}
+
+/**
+ * @brief Estimates the logical error rates of a code at several bit-flip
+ * rates from one set of coupled shots.
+ *
+ * Every shot is sampled once for the whole sweep, see
+ * RunMonteCarloSweepChunk(), so a sweep costs far less than independent runs
+ * at every rate and the differences between neighbouring rates have a lower
+ * variance. Like RunMonteCarlo() the result does not depend on the number of
+ * threads or the chunk size. Bit-sliced sampling is not supported.
+ *
+ * @param probabilities The bit-flip rates, in any order.
+ * @return One result per rate, in the order of probabilities. The seconds
+ * are those of the whole sweep.
+ */
+template <typename Code>
+std::vector<MonteCarloResult>
+RunMonteCarloSweep(const Code &code, const std::vector<double> &probabilities,
+                   const MonteCarloOptions &options) {
+    if (options.erasure_probability < 0.0 ||
+        options.erasure_probability > 1.0 ||
+        std::any_of(probabilities.begin(), probabilities.end(),
+                    [](double p) { return p < 0.0 || p > 1.0; })) {
+        throw std::invalid_argument("Error probabilities must be in [0, 1]");
+    }
+    if (options.bit_sliced) {
+        throw std::invalid_argument(
+            "Coupled sweeps do not support bit-sliced sampling");
+    }
+    std::vector<size_t> order(probabilities.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return probabilities[a] < probabilities[b];
+    });
+    std::vector<double> sorted_probabilities;
+    for (auto i : order) {
+        sorted_probabilities.push_back(probabilities[i]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto num_failures = RunChunksInParallel(
+        code.GetZStabilizerDecodingGraph(), options,
+        std::max<size_t>(1, options.chunk_size), probabilities.size(),
+        [&](Decoders::UnionFindDecoder &decoder,
+            std::vector<uint8_t> &correction, size_t first_shot,
+            size_t num_shots, std::vector<size_t> &failures) {
+            RunMonteCarloSweepChunk(code, sorted_probabilities, options,
+                                    decoder, first_shot, num_shots,
+                                    correction, failures);
+        });
+    auto end = std::chrono::steady_clock::now();
+
+    std::vector<MonteCarloResult> results(probabilities.size());
+    for (size_t k = 0; k < order.size(); k++) {
+        auto &result = results[order[k]];
+        result.p = sorted_probabilities[k];
+        result.erasure_probability = options.erasure_probability;
+        result.num_shots = options.num_shots;
+        result.num_failures = num_failures[k];
+        result.seconds = std::chrono::duration<double>(end - start).count();
+    }
+    return results;
+}
+
+/**
+ * @brief The targets and budgets of RunMonteCarloAdaptive().
+ *
+ * A point stops at the first check, after every batch, at which a target is
+ * met or a budget is used up. Targets of 0 are disabled.
+ */
+struct StoppingRule {
+    size_t max_shots = 1000000; ///< The budget of shots per point.
+    size_t batch_size = 10000;  ///< The number of shots between checks.
+    size_t target_failures = 0; ///< Stop after this many failures.
+    /// Stop once the half width of the interval is at most this fraction of
+    /// the logical error rate, e.g. 0.1.
+    double target_relative_error = 0.0;
+    double max_seconds = 0.0; ///< The time budget per point.
+    Interval interval = Interval::Wilson;
+    double confidence = 0.95;
+};
+
+/**
+ * @brief Estimates the logical error rate of a code with as many shots as a
+ * stopping rule requires.
+ *
+ * Batches of StoppingRule::batch_size shots are run with RunMonteCarlo(),
+ * each continuing where the previous one ended. As the noise of a shot only
+ * depends on the seed and its index, the result equals that of a single run
+ * with the final number of shots. Runs with rare failures stop at the budget
+ * and runs with frequent failures stop as soon as their interval is tight.
+ *
+ * @param code The code, which is only read and may be shared.
+ * @param p The bit-flip probability of every edge.
+ * @param options The threads, seed and noise; num_shots is ignored.
+ * @param rule The targets and budgets.
+ */
+template <typename Code>
+MonteCarloResult RunMonteCarloAdaptive(const Code &code, double p,
+                                       const MonteCarloOptions &options,
+                                       const StoppingRule &rule) {
+    if (rule.batch_size == 0 || rule.max_shots == 0) {
+        throw std::invalid_argument(
+            "The batch size and shot budget must be positive");
+    }
+    size_t batch_size = rule.batch_size;
+    if (options.bit_sliced) {
+        batch_size = (batch_size + 63) / 64 * 64;
+    }
+
+    MonteCarloResult result;
+    result.p = p;
+    result.erasure_probability = options.erasure_probability;
+    MonteCarloOptions batch_options = options;
+    while (true) {
+        batch_options.first_shot = options.first_shot + result.num_shots;
+        batch_options.num_shots =
+            std::min(batch_size, rule.max_shots - result.num_shots);
+        auto batch = RunMonteCarlo(code, p, batch_options);
+        result.num_shots += batch.num_shots;
+        result.num_failures += batch.num_failures;
+        result.seconds += batch.seconds;
+
+        auto [low, high] =
+            result.GetConfidenceInterval(rule.interval, rule.confidence);
+        double rate = result.GetLogicalErrorRate();
+        if (rule.target_failures > 0 &&
+            result.num_failures >= rule.target_failures) {
+            result.stop_reason = "target_failures";
+        } else if (rule.target_relative_error > 0.0 && rate > 0.0 &&
+                   (high - low) / 2.0 <= rule.target_relative_error * rate) {
+            result.stop_reason = "target_relative_error";
+        } else if (result.num_shots >= rule.max_shots) {
+            result.stop_reason = "max_shots";
+        } else if (rule.max_seconds > 0.0 &&
+                   result.seconds >= rule.max_seconds) {
+            result.stop_reason = "max_seconds";
+        } else {
+            continue;
+        }
+        return result;
+    }
+}
+
+/**
+ * @brief Builds the code called name ("planar", "rotated" or "toric") and
+ * returns function(code).
+ */
+template <typename Function>
+auto WithCode(const std::string &name, size_t distance, size_t rounds,
+              Function &&function) {
+    if (name == "planar") {
+        return function(PlanarCode(distance, rounds));
+    }
+    if (name == "rotated") {
+        return function(RotatedPlanarCode(distance, rounds));
+    }
+    if (name == "toric") {
+        return function(ToricCode(distance, rounds));
+    }
+    throw std::invalid_argument("Unknown code '" + name + "'");
+}
+
+/**
+ * @brief Builds a code by name ("planar", "rotated" or "toric") and estimates
+ * its logical error rate.
+ */
+inline MonteCarloResult RunMonteCarlo(const std::string &code, size_t distance,
+                                      size_t rounds, double p,
+                                      const MonteCarloOptions &options) {
+    auto result = WithCode(code, distance, rounds, [&](const auto &c) {
+        return RunMonteCarlo(c, p, options);
+    });
+    result.code = code;
+    result.distance = distance;
+    result.rounds = rounds;
+    return result;
+}
+
+/**
+ * @brief Builds a code by name and estimates its logical error rate until a
+ * stopping rule is met, see RunMonteCarloAdaptive().
+ */
+inline MonteCarloResult RunMonteCarloAdaptive(const std::string &code,
+                                              size_t distance, size_t rounds,
+                                              double p,
+                                              const MonteCarloOptions &options,
+                                              const StoppingRule &rule) {
+    auto result = WithCode(code, distance, rounds, [&](const auto &c) {
+        return RunMonteCarloAdaptive(c, p, options, rule);
+    });
+    result.code = code;
+    result.distance = distance;
+    result.rounds = rounds;
+    return result;
+}
+
+/**
+ * @brief Builds a code by name and estimates its logical error rates at
+ * several coupled bit-flip rates, see RunMonteCarloSweep().
+ */
+inline std::vector<MonteCarloResult>
+RunMonteCarloSweep(const std::string &code, size_t distance, size_t rounds,
+                   const std::vector<double> &probabilities,
+                   const MonteCarloOptions &options) {
+    auto results = WithCode(code, distance, rounds, [&](const auto &c) {
+        return RunMonteCarloSweep(c, probabilities, options);
+    });
+    for (auto &result : results) {
+        result.code = code;
+        result.distance = distance;
+        result.rounds = rounds;
+    }
+    return results;
+}
+
+}; // namespace Simulation
+}; // namespace Plaquette
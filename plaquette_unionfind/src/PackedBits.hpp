@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Plaquette {
+
+/**
+ * Helpers for bitsets packed into 64-bit words, with bit i stored as bit
+ * i % 64 of word i / 64. Error models, syndromes and detection events use
+ * this layout so that they can be combined a word at a time.
+ */
+
+/**
+ * @brief Returns the number of 64-bit words of a packed bitset.
+ */
+inline size_t GetNumPackedWords(size_t num_bits) {
+    return (num_bits + 63) / 64;
+}
+
+inline bool GetPackedBit(const std::vector<uint64_t> &words, size_t i) {
+    return (words[i / 64] >> (i % 64)) & 1;
+}
+
+inline void SetPackedBit(std::vector<uint64_t> &words, size_t i) {
+    words[i / 64] |= uint64_t{1} << (i % 64);
+}
+
+inline void FlipPackedBit(std::vector<uint64_t> &words, size_t i) {
+    words[i / 64] ^= uint64_t{1} << (i % 64);
+}
+
+/**
+ * @brief XORs the first num_bits bits of a packed bitset into another one,
+ * starting at bit offset of the destination, a word at a time.
+ *
+ * Words of the destination that only the unset high bits of the source would
+ * reach are left untouched, so the destination only needs to hold
+ * offset + num_bits bits.
+ */
+inline void XorPackedBits(std::span<const uint64_t> source, size_t num_bits,
+                          std::vector<uint64_t> &words, size_t offset) {
+    size_t base = offset / 64;
+    size_t shift = offset % 64;
+    size_t num_words = GetNumPackedWords(num_bits);
+    for (size_t w = 0; w < num_words; w++) {
+        uint64_t word = source[w];
+        if (w + 1 == num_words && num_bits % 64 != 0) {
+            word &= (uint64_t{1} << (num_bits % 64)) - 1;
+        }
+        words[base + w] ^= word << shift;
+        if (shift != 0 && (word >> (64 - shift)) != 0) {
+            words[base + w + 1] ^= word >> (64 - shift);
+        }
+    }
+}
+
+/**
+ * @brief Splits bit-sliced words, in which bit k of words[i] belongs to shot
+ * k, into a sorted list of indices per shot.
+ *
+ * This costs one pass over the words plus one step per set bit.
+ *
+ * @param words One word per index.
+ * @param lane_mask The shots to extract.
+ * @param lists Receives the indices whose bit is set, per shot.
+ */
+inline void UnpackBitSlices(std::span<const uint64_t> words, uint64_t lane_mask,
+                            std::array<std::vector<size_t>, 64> &lists) {
+    for (auto &list : lists) {
+        list.clear();
+    }
+    for (size_t i = 0; i < words.size(); i++) {
+        for (uint64_t word = words[i] & lane_mask; word != 0;
+             word &= word - 1) {
+            lists[std::countr_zero(word)].push_back(i);
+        }
+    }
+}
+
+}; // namespace Plaquette
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief The edges and neighbours of every vertex of a decoding graph, stored
+ * in rows of a fixed width.
+ *
+ * Lattice codes have a small maximum degree (4 for 2D and 6 for 3D toric and
+ * planar codes). When the maximum degree of a graph is at most one of the
+ * supported widths, every vertex gets a row with its degree followed by that
+ * many edge and neighbour slots, padded to the width. Loops over a row then
+ * have a compile-time trip count, which the compiler fully unrolls, and a
+ * vertex's neighbourhood is one contiguous block instead of two CSR ranges.
+ * Graphs of higher degree are not padded and keep using the CSR rows of the
+ * DecodingGraph.
+ *
+ * Dispatch() calls a function with the row width as a compile-time constant
+ * (0 for graphs without padded rows), so hot code is instantiated once per
+ * width and the choice is made once per call instead of once per vertex.
+ */
+class PaddedAdjacency {
+
+  public:
+    static constexpr size_t kSupportedDegrees[] = {4, 6, 8};
+
+    /**
+     * @brief A read-only view of the row of a vertex.
+     */
+    template <size_t MaxDegree> class Row {
+      public:
+        explicit Row(const uint32_t *data) : data_(data) {}
+        size_t size() const { return data_[0]; }
+        uint32_t GetEdge(size_t i) const { return data_[1 + i]; }
+        uint32_t GetVertex(size_t i) const { return data_[1 + MaxDegree + i]; }
+
+      private:
+        const uint32_t *data_;
+    };
+
+  private:
+    size_t max_degree_ = 0; ///< The row width, or 0 without padded rows.
+    std::pmr::vector<uint32_t> rows_;
+
+  public:
+    PaddedAdjacency() = default;
+
+    /**
+     * @brief Builds padded rows for a graph whose maximum degree does not
+     * exceed the largest supported width; otherwise no rows are built and
+     * GetMaxDegree() returns 0.
+     */
+    PaddedAdjacency(const DecodingGraph &decoding_graph,
+                    std::pmr::memory_resource *memory_resource =
+                        std::pmr::get_default_resource())
+        : rows_(memory_resource) {
+        size_t num_vertices = decoding_graph.GetNumVertices();
+        if (decoding_graph.GetNumEdges() >=
+                std::numeric_limits<uint32_t>::max() ||
+            num_vertices >= std::numeric_limits<uint32_t>::max()) {
+            return;
+        }
+        size_t graph_degree = 0;
+        for (size_t v = 0; v < num_vertices; v++) {
+            graph_degree = std::max(
+                graph_degree, decoding_graph.GetEdgesTouchingVertex(v).size());
+        }
+        for (auto width : kSupportedDegrees) {
+            if (graph_degree <= width) {
+                max_degree_ = width;
+                break;
+            }
+        }
+        if (max_degree_ == 0) {
+            return;
+        }
+
+        size_t row_size = 2 * max_degree_ + 1;
+        rows_.assign(num_vertices * row_size, 0);
+        for (size_t v = 0; v < num_vertices; v++) {
+            const auto &edges = decoding_graph.GetEdgesTouchingVertex(v);
+            const auto &vertices = decoding_graph.GetVerticesTouchingVertex(v);
+            uint32_t *row = rows_.data() + v * row_size;
+            row[0] = edges.size();
+            for (size_t i = 0; i < edges.size(); i++) {
+                row[1 + i] = edges[i];
+                row[1 + max_degree_ + i] = vertices[i];
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the row width, or 0 if the graph has no padded rows.
+     */
+    size_t GetMaxDegree() const { return max_degree_; }
+
+    template <size_t MaxDegree> Row<MaxDegree> GetRow(size_t vertex) const {
+        return Row<MaxDegree>(rows_.data() + vertex * (2 * MaxDegree + 1));
+    }
+
+    /**
+     * @brief Calls function(std::integral_constant<size_t, MaxDegree>()) with
+     * the row width of this graph, or with 0 if it has no padded rows.
+     */
+    template <typename Function>
+    decltype(auto) Dispatch(Function &&function) const {
+        switch (max_degree_) {
+        case 4:
+            return function(std::integral_constant<size_t, 4>());
+        case 6:
+            return function(std::integral_constant<size_t, 6>());
+        case 8:
+            return function(std::integral_constant<size_t, 8>());
+        default:
+            return function(std::integral_constant<size_t, 0>());
+        }
+    }
+};
+
+}; // namespace Plaquette
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "DecodingGraph.hpp"
+#include "GraphConcepts.hpp"
 #include "LatticeVisualizer.hpp"
 #include "SpanningForest.hpp"
 #include "Types.hpp"
@@ -34,8 +35,28 @@ class PeelingDecoder {
                                  std::vector<bool> &syndrome,
                                  const std::vector<size_t> &tree,
                                  std::vector<size_t> &vertex_count) {
-        size_t tree_size = tree.size();
         std::vector<bool> error_edges(decoding_graph.GetNumEdges(), false);
+        PeelForestInto(decoding_graph, syndrome, tree, vertex_count,
+                       error_edges);
+        return error_edges;
+    }
+
+    /**
+     * @brief Peels a spanning forest and marks the error edges in a
+     * caller-provided correction, which must be cleared beforehand. The
+     * syndrome is consumed and vertex_count is left at zero.
+     *
+     * @tparam Graph Any DecodingGraphLike graph.
+     * @tparam Correction Any type indexable by edge id whose elements are
+     * assignable from bool, e.g. std::vector<bool> or std::span<uint8_t>.
+     */
+    template <DecodingGraphLike Graph, typename Correction>
+    void PeelForestInto(const Graph &decoding_graph,
+                        std::vector<bool> &syndrome,
+                        const std::vector<size_t> &tree,
+                        std::vector<size_t> &vertex_count,
+                        Correction &&error_edges) {
+        size_t tree_size = tree.size();
         for (size_t j = 0; j < tree_size; ++j) {
 
             // iterate backwards through the tree
@@ -62,8 +83,6 @@ class PeelingDecoder {
                 syndrome[v] = !syndrome[v];
             }
         }
-
-        return error_edges;
     }
 };
 
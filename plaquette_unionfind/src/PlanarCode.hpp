@@ -0,0 +1,156 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+#include "StabilizerCode.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief A class representing a planar (unrotated surface) code with
+ * optional repeated measurement rounds.
+ *
+ * The code lives on a (2L - 1) x (2L - 1) grid: data qubits sit where x + y
+ * is even, X stabilizers at odd x and even y, and Z stabilizers at even x and
+ * odd y. The Z stabilizer graph has rough boundaries at the top and bottom,
+ * the X stabilizer graph at the left and right.
+ *
+ * With n_rounds > 1 both decoding graphs become phenomenological space-time
+ * graphs, see StabilizerCode::BuildSpaceTimeGraph_().
+ *
+ * Everything is built with index arithmetic only, so construction is linear in
+ * the size of the graphs.
+ */
+class PlanarCode : public StabilizerCode {
+
+  private:
+    size_t lattice_size_; ///< The size of the lattice.
+    size_t num_rounds_;   ///< The number of measurement rounds.
+
+    /**
+     * @brief Returns the index of the data qubit at grid coordinate (x, y).
+     */
+    size_t QubitIndex_(size_t x, size_t y) const {
+        size_t row_start = (y / 2) * (2 * lattice_size_ - 1) +
+                           (y % 2 == 1 ? lattice_size_ : 0);
+        return row_start + x / 2;
+    }
+
+  public:
+    /**
+     * @brief Construct a planar code of a given size.
+     *
+     * @param lattice_size The code distance L, at least 2.
+     * @param num_rounds The number of stabilizer measurement rounds.
+     */
+    PlanarCode(size_t lattice_size, size_t num_rounds = 1)
+        : lattice_size_(lattice_size), num_rounds_(num_rounds) {
+        if (lattice_size < 2) {
+            throw std::invalid_argument("PlanarCode requires lattice_size >= 2");
+        }
+        if (num_rounds < 1) {
+            throw std::invalid_argument("PlanarCode requires num_rounds >= 1");
+        }
+
+        size_t L = lattice_size;
+        size_t width = 2 * L - 1;
+        size_t num_stabilizers = L * (L - 1);
+        size_t num_layer_vertices = num_stabilizers + 2 * L;
+
+        // Vertex ids of the stabilizers and boundaries within one round.
+        auto z_vertex = [&](long x, long y) -> size_t {
+            if (y < 0) {
+                return num_stabilizers + x / 2;
+            }
+            if (y >= static_cast<long>(width)) {
+                return num_stabilizers + L + x / 2;
+            }
+            return ((y - 1) / 2) * L + x / 2;
+        };
+        auto x_vertex = [&](long x, long y) -> size_t {
+            if (x < 0) {
+                return num_stabilizers + y / 2;
+            }
+            if (x >= static_cast<long>(width)) {
+                return num_stabilizers + L + y / 2;
+            }
+            return (y / 2) * (L - 1) + (x - 1) / 2;
+        };
+
+        size_t num_qubits = L * L + (L - 1) * (L - 1);
+        qubit_coords_.reserve(num_qubits);
+        std::vector<std::pair<size_t, size_t>> z_edges;
+        std::vector<std::pair<size_t, size_t>> x_edges;
+        z_edges.reserve(num_qubits);
+        x_edges.reserve(num_qubits);
+
+        for (long y = 0; y < static_cast<long>(width); y++) {
+            for (long x = y % 2; x < static_cast<long>(width); x += 2) {
+                qubit_coords_.emplace_back(x, y);
+                if (y % 2 == 0) {
+                    z_edges.emplace_back(z_vertex(x, y - 1),
+                                         z_vertex(x, y + 1));
+                    x_edges.emplace_back(x_vertex(x - 1, y),
+                                         x_vertex(x + 1, y));
+                } else {
+                    z_edges.emplace_back(z_vertex(x - 1, y),
+                                         z_vertex(x + 1, y));
+                    x_edges.emplace_back(x_vertex(x, y - 1),
+                                         x_vertex(x, y + 1));
+                }
+            }
+        }
+
+        for (size_t y = 1; y < width; y += 2) {
+            for (size_t x = 0; x < width; x += 2) {
+                z_stabilizer_coords_.emplace_back(x, y);
+            }
+        }
+        for (size_t y = 0; y < width; y += 2) {
+            for (size_t x = 1; x < width; x += 2) {
+                x_stabilizer_coords_.emplace_back(x, y);
+            }
+        }
+
+        z_stabilizer_decoding_graph_ = BuildSpaceTimeGraph_(
+            z_edges, num_stabilizers, num_layer_vertices, num_rounds);
+        x_stabilizer_decoding_graph_ = BuildSpaceTimeGraph_(
+            x_edges, num_stabilizers, num_layer_vertices, num_rounds);
+
+        // Logical X runs down the left column and logical Z along the top
+        // row. Errors on the Z (X) graph flip the logical Z (X) measurement if
+        // an odd number of error chains ends on the top (left) boundary,
+        // summed over all rounds.
+        std::vector<size_t> top_qubits;
+        std::vector<size_t> left_qubits;
+        for (size_t x = 0; x < width; x += 2) {
+            top_qubits.push_back(QubitIndex_(x, 0));
+        }
+        for (size_t y = 0; y < width; y += 2) {
+            left_qubits.push_back(QubitIndex_(0, y));
+        }
+        logical_x_qubits_ = {
+            RepeatLogical_(left_qubits, num_qubits, num_rounds)};
+        logical_z_qubits_ = {
+            RepeatLogical_(top_qubits, num_qubits, num_rounds)};
+        IndexLogicals_();
+    }
+
+    /**
+     * @brief Get the number of data qubits in the code.
+     */
+    size_t GetNumOfQubits() const { return qubit_coords_.size(); }
+
+    /**
+     * @brief Get the number of measurement rounds.
+     */
+    size_t GetNumRounds() const { return num_rounds_; }
+
+    /**
+     * @brief Get the code distance, which is the lattice size.
+     */
+    size_t GetCodeDistance() const { return lattice_size_; }
+};
+}; // namespace Plaquette
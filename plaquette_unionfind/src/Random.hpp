@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+
+namespace Plaquette {
+
+/**
+ * @brief Mixes a 64-bit value with the SplitMix64 finalizer, which turns
+ * consecutive values into well separated seeds.
+ *
+ * SplitMix64(seed + i * 0x9e3779b97f4a7c15) is the i-th output of a
+ * SplitMix64 generator started at seed.
+ */
+inline uint64_t SplitMix64(uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+/**
+ * @brief The xoshiro256++ generator of Blackman and Vigna.
+ *
+ * It passes the usual statistical test suites, keeps 32 bytes of state
+ * instead of the 2.5 KB of std::mt19937 and produces a 64-bit output in about
+ * a nanosecond. The state is filled from a SplitMix64 sequence, as the
+ * authors recommend, and Jump() advances it by 2^128 outputs to start
+ * non-overlapping streams. It satisfies UniformRandomBitGenerator, so it can
+ * also drive the standard distributions.
+ */
+class Xoshiro256PlusPlus {
+
+  private:
+    std::array<uint64_t, 4> state_;
+
+    static uint64_t RotateLeft_(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+  public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256PlusPlus(uint64_t seed = 0) {
+        for (size_t i = 0; i < state_.size(); i++) {
+            state_[i] = SplitMix64(seed + i * 0x9e3779b97f4a7c15ULL);
+        }
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        uint64_t result =
+            RotateLeft_(state_[0] + state_[3], 23) + state_[0];
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = RotateLeft_(state_[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Returns a uniform double in [0, 1) with 53 random bits.
+     */
+    double NextDouble() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+    /**
+     * @brief Advances the generator by 2^128 outputs.
+     */
+    void Jump() {
+        constexpr std::array<uint64_t, 4> kJump = {
+            0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+            0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+        std::array<uint64_t, 4> jumped = {0, 0, 0, 0};
+        for (auto word : kJump) {
+            for (int bit = 0; bit < 64; bit++) {
+                if (word & (uint64_t{1} << bit)) {
+                    for (size_t i = 0; i < state_.size(); i++) {
+                        jumped[i] ^= state_[i];
+                    }
+                }
+                (*this)();
+            }
+        }
+        state_ = jumped;
+    }
+};
+
+/**
+ * @brief The Philox4x32-10 block function of Salmon et al., "Parallel random
+ * numbers: as easy as 1, 2, 3" (SC 2011).
+ *
+ * It maps a 128-bit counter and a 64-bit key to 128 random bits with ten
+ * rounds of multiplications and is a bijection of the counter for every key,
+ * so distinct counters never produce correlated blocks.
+ */
+inline std::array<uint32_t, 4> Philox4x32(std::array<uint32_t, 4> counter,
+                                          std::array<uint32_t, 2> key) {
+    constexpr uint64_t kMultiplier0 = 0xD2511F53;
+    constexpr uint64_t kMultiplier1 = 0xCD9E8D57;
+    constexpr uint32_t kWeyl0 = 0x9E3779B9;
+    constexpr uint32_t kWeyl1 = 0xBB67AE85;
+    for (int round = 0; round < 10; round++) {
+        if (round > 0) {
+            key[0] += kWeyl0;
+            key[1] += kWeyl1;
+        }
+        uint64_t product0 = kMultiplier0 * counter[0];
+        uint64_t product1 = kMultiplier1 * counter[2];
+        counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                   static_cast<uint32_t>(product1),
+                   static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                   static_cast<uint32_t>(product0)};
+    }
+    return counter;
+}
+
+/**
+ * @brief A counter-based generator whose output is a pure function of
+ * (seed, shot, substream).
+ *
+ * The seed is the Philox key and the counter holds the shot index, a
+ * substream index and a block index, so Seek() jumps to the start of any
+ * shot in constant time. Sampling shot i with Seek(i) gives bit-identical
+ * noise however the shots are split between threads or processes. Every
+ * (shot, substream) pair yields up to 2^33 outputs before the block index
+ * wraps.
+ */
+class PhiloxGenerator {
+
+  private:
+    std::array<uint32_t, 2> key_;
+    /// The block index, the substream and the low and high shot words.
+    std::array<uint32_t, 4> counter_;
+    std::array<uint32_t, 4> block_;
+    size_t num_used_ = 4; ///< The number of words of block_ already returned.
+
+  public:
+    using result_type = uint64_t;
+
+    explicit PhiloxGenerator(uint64_t seed, uint64_t shot = 0,
+                             uint32_t substream = 0)
+        : key_{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {
+        Seek(shot, substream);
+    }
+
+    /**
+     * @brief Restarts the generator at the first output of a shot.
+     */
+    void Seek(uint64_t shot, uint32_t substream = 0) {
+        counter_ = {0, substream, static_cast<uint32_t>(shot),
+                    static_cast<uint32_t>(shot >> 32)};
+        num_used_ = 4;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        if (num_used_ == 4) {
+            block_ = Philox4x32(counter_, key_);
+            counter_[0]++;
+            num_used_ = 0;
+        }
+        uint64_t result = block_[num_used_] |
+                          (static_cast<uint64_t>(block_[num_used_ + 1]) << 32);
+        num_used_ += 2;
+        return result;
+    }
+
+    /**
+     * @brief Returns a uniform double in [0, 1) with 53 random bits.
+     */
+    double NextDouble() { return ((*this)() >> 11) * 0x1.0p-53; }
+};
+
+/**
+ * @brief Returns the seed of a generator with the conventions of the error
+ * models: -1 seeds from the current time, any other value is used as is.
+ */
+inline uint64_t GetSeed(int seed) {
+    return seed == -1 ? static_cast<uint64_t>(time(NULL))
+                      : static_cast<uint64_t>(seed);
+}
+
+}; // namespace Plaquette
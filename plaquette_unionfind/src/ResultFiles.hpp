@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "MonteCarlo.hpp"
+
+namespace Plaquette {
+namespace Simulation {
+
+/**
+ * @brief The failure count of a contiguous range of shots of one point, as
+ * appended to a result file.
+ *
+ * As the noise of every shot depends only on the seed and its index, records
+ * of the same point with disjoint shot ranges can be summed in any order,
+ * whichever process or machine produced them.
+ */
+struct ShotRecord {
+    std::string code;
+    size_t distance = 0;
+    size_t rounds = 0;
+    double p = 0.0;
+    double erasure_probability = 0.0;
+    uint64_t seed = 0;
+    bool bit_sliced = false;
+    bool coupled = false; ///< Sampled by RunMonteCarloSweep().
+    size_t planned_shots = 0; ///< The shots of the point over all shards.
+    size_t first_shot = 0;
+    size_t num_shots = 0;
+    size_t num_failures = 0;
+    double seconds = 0.0;
+
+    /**
+     * @brief Returns the fields that identify the point, i.e. everything
+     * but the shot range and its counts.
+     */
+    auto GetKey() const {
+        return std::make_tuple(code, distance, rounds, p, erasure_probability,
+                               seed, bit_sliced, coupled, planned_shots);
+    }
+};
+
+/**
+ * @brief Returns the shots [begin, end) of shard index of num_shards that
+ * split num_shots shots.
+ *
+ * Shards are as even as possible in units of alignment shots, e.g. 64 for
+ * bit-sliced runs, and together cover every shot exactly once.
+ */
+inline std::pair<size_t, size_t> GetShardRange(size_t num_shots, size_t index,
+                                               size_t num_shards,
+                                               size_t alignment = 1) {
+    if (num_shards == 0 || index >= num_shards || alignment == 0) {
+        throw std::invalid_argument("Invalid shard " + std::to_string(index) +
+                                    " of " + std::to_string(num_shards));
+    }
+    size_t num_units = (num_shots + alignment - 1) / alignment;
+    size_t begin = num_units * index / num_shards * alignment;
+    size_t end = num_units * (index + 1) / num_shards * alignment;
+    return {std::min(begin, num_shots), std::min(end, num_shots)};
+}
+
+/**
+ * @brief Formats a record as a single line of JSON, without the newline.
+ *
+ * Rates are written with 17 significant digits, so they are read back
+ * exactly and the records of one point always share their key.
+ */
+inline std::string FormatShotRecord(const ShotRecord &record) {
+    char p[32];
+    char erasure[32];
+    char seconds[32];
+    std::snprintf(p, sizeof(p), "%.17g", record.p);
+    std::snprintf(erasure, sizeof(erasure), "%.17g",
+                  record.erasure_probability);
+    std::snprintf(seconds, sizeof(seconds), "%.6g", record.seconds);
+    std::ostringstream line;
+    line << "{\"code\": \"" << record.code
+         << "\", \"distance\": " << record.distance
+         << ", \"rounds\": " << record.rounds << ", \"p\": " << p
+         << ", \"erasure\": " << erasure << ", \"seed\": " << record.seed
+         << ", \"bit_sliced\": " << (record.bit_sliced ? "true" : "false")
+         << ", \"coupled\": " << (record.coupled ? "true" : "false")
+         << ", \"planned_shots\": " << record.planned_shots
+         << ", \"first_shot\": " << record.first_shot
+         << ", \"shots\": " << record.num_shots
+         << ", \"failures\": " << record.num_failures
+         << ", \"seconds\": " << seconds << "}";
+    return line.str();
+}
+
+/**
+ * @brief Parses a line written by FormatShotRecord().
+ *
+ * @return False if the line is not a complete record, e.g. the last line of
+ * a file whose writer was interrupted.
+ */
+inline bool ParseShotRecord(const std::string &line, ShotRecord &record) {
+    size_t begin = line.find('{');
+    size_t end = line.rfind('}');
+    if (begin == std::string::npos || end == std::string::npos ||
+        end < begin) {
+        return false;
+    }
+    // The records are flat objects of strings, numbers and booleans.
+    std::map<std::string, std::string> fields;
+    size_t position = begin + 1;
+    while (true) {
+        size_t key_begin = line.find('"', position);
+        if (key_begin == std::string::npos || key_begin > end) {
+            break;
+        }
+        size_t key_end = line.find('"', key_begin + 1);
+        size_t colon = line.find(':', key_end);
+        if (key_end == std::string::npos || colon == std::string::npos) {
+            return false;
+        }
+        size_t value_begin = line.find_first_not_of(' ', colon + 1);
+        if (value_begin == std::string::npos) {
+            return false;
+        }
+        size_t value_end;
+        if (line[value_begin] == '"') {
+            value_begin++;
+            value_end = line.find('"', value_begin);
+            position = value_end + 1;
+        } else {
+            value_end = line.find_first_of(",}", value_begin);
+            position = value_end;
+        }
+        if (value_end == std::string::npos) {
+            return false;
+        }
+        fields[line.substr(key_begin + 1, key_end - key_begin - 1)] =
+            line.substr(value_begin, value_end - value_begin);
+    }
+
+    auto get = [&](const char *name) -> const std::string & {
+        auto found = fields.find(name);
+        if (found == fields.end()) {
+            throw std::invalid_argument(std::string("Missing field ") + name);
+        }
+        return found->second;
+    };
+    try {
+        record.code = get("code");
+        record.distance = std::stoul(get("distance"));
+        record.rounds = std::stoul(get("rounds"));
+        record.p = std::stod(get("p"));
+        record.erasure_probability = std::stod(get("erasure"));
+        record.seed = std::stoull(get("seed"));
+        record.bit_sliced = get("bit_sliced") == "true";
+        record.coupled = get("coupled") == "true";
+        record.planned_shots = std::stoul(get("planned_shots"));
+        record.first_shot = std::stoul(get("first_shot"));
+        record.num_shots = std::stoul(get("shots"));
+        record.num_failures = std::stoul(get("failures"));
+        record.seconds = std::stod(get("seconds"));
+    } catch (const std::exception &) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the records of a result file, skipping incomplete lines.
+ *
+ * A missing file has no records.
+ */
+inline std::vector<ShotRecord> ReadShotRecords(const std::string &path) {
+    std::vector<ShotRecord> records;
+    std::ifstream in(path);
+    std::string line;
+    ShotRecord record;
+    while (std::getline(in, line)) {
+        if (ParseShotRecord(line, record)) {
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+/**
+ * @brief Appends records to a result file, one line each, and flushes it.
+ *
+ * A line is only ever appended, so a file interrupted at any time keeps its
+ * complete records and at most one partial line, which readers skip.
+ */
+class ShotRecordWriter {
+
+  private:
+    std::ofstream out_;
+    bool at_line_start_ = true;
+
+  public:
+    explicit ShotRecordWriter(const std::string &path) {
+        // A partial last line from an interrupted run is terminated first.
+        {
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (in && in.tellg() > 0) {
+                in.seekg(-1, std::ios::end);
+                at_line_start_ = in.get() == '\n';
+            }
+        }
+        out_.open(path, std::ios::app);
+        if (!out_) {
+            throw std::runtime_error("Could not open '" + path +
+                                     "' for appending");
+        }
+    }
+
+    void Write(const ShotRecord &record) {
+        if (!at_line_start_) {
+            out_ << "\n";
+            at_line_start_ = true;
+        }
+        out_ << FormatShotRecord(record) << "\n";
+        out_.flush();
+        if (!out_) {
+            throw std::runtime_error("Could not write a result record");
+        }
+    }
+};
+
+/**
+ * @brief Returns the first shot of [begin, end) that the records of a point
+ * do not cover yet, for resuming an interrupted run.
+ *
+ * Records are expected to cover [begin, resume) contiguously, as a run
+ * writes them in order; records outside [begin, end) belong to other
+ * shards and are ignored.
+ */
+inline size_t GetResumeShot(const std::vector<ShotRecord> &records,
+                            const ShotRecord &point, size_t begin,
+                            size_t end) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (const auto &record : records) {
+        if (record.GetKey() == point.GetKey() && record.first_shot >= begin &&
+            record.first_shot < end) {
+            ranges.emplace_back(record.first_shot,
+                                record.first_shot + record.num_shots);
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+    size_t resume = begin;
+    for (const auto &[first, last] : ranges) {
+        if (first != resume) {
+            throw std::invalid_argument(
+                "The records of a point do not cover its shots contiguously");
+        }
+        resume = last;
+    }
+    return std::min(resume, end);
+}
+
+/**
+ * @brief Sums the records of every point into results, in the order in which
+ * the points first appear.
+ *
+ * Throws if two records of a point share a shot, e.g. when the same shard
+ * file is merged twice, since the shot would be counted twice. The records of
+ * a point must also cover its shots [0, planned_shots) without gaps, as the
+ * shards of a run do together; a missing or interrupted shard, including the
+ * last one, would otherwise give a result with fewer shots that looks
+ * complete.
+ *
+ * @param records The records of all points.
+ * @param gaps If null, missing shots are an error. Otherwise the points are
+ * merged regardless and every missing range is described in gaps.
+ * @param begin The first shot to cover, e.g. the beginning of a shard when
+ * merging the records of one shard.
+ * @param end One past the last shot to cover. By default the planned shots
+ * of every point.
+ */
+inline std::vector<MonteCarloResult>
+MergeShotRecords(const std::vector<ShotRecord> &records,
+                 std::vector<std::string> *gaps = nullptr, size_t begin = 0,
+                 size_t end = std::numeric_limits<size_t>::max()) {
+    using Key = decltype(records.front().GetKey());
+    std::map<Key, size_t> index;
+    std::vector<MonteCarloResult> results;
+    std::vector<std::vector<std::pair<size_t, size_t>>> ranges;
+    std::vector<size_t> ends;
+    for (const auto &record : records) {
+        auto [found, inserted] =
+            index.try_emplace(record.GetKey(), results.size());
+        if (inserted) {
+            MonteCarloResult result;
+            result.code = record.code;
+            result.distance = record.distance;
+            result.rounds = record.rounds;
+            result.p = record.p;
+            result.erasure_probability = record.erasure_probability;
+            results.push_back(result);
+            ranges.emplace_back();
+            ends.push_back(std::min(end, record.planned_shots));
+        }
+        auto &result = results[found->second];
+        result.num_shots += record.num_shots;
+        result.num_failures += record.num_failures;
+        result.seconds += record.seconds;
+        ranges[found->second].emplace_back(
+            record.first_shot, record.first_shot + record.num_shots);
+    }
+    for (size_t r = 0; r < results.size(); r++) {
+        auto &point_ranges = ranges[r];
+        std::sort(point_ranges.begin(), point_ranges.end());
+        auto report_gap = [&](size_t first, size_t last) {
+            std::ostringstream gap;
+            gap << results[r].code << " d=" << results[r].distance
+                << " rounds=" << results[r].rounds << " p=" << results[r].p
+                << ": shots [" << first << ", " << last << ") are missing";
+            if (gaps == nullptr) {
+                throw std::invalid_argument(gap.str());
+            }
+            gaps->push_back(gap.str());
+        };
+        size_t covered = begin;
+        for (const auto &[first, last] : point_ranges) {
+            if (first < covered) {
+                throw std::invalid_argument(
+                    "Overlapping shots in the records of a point");
+            }
+            if (first > covered) {
+                report_gap(covered, first);
+            }
+            covered = last;
+        }
+        if (covered > ends[r]) {
+            throw std::invalid_argument(
+                "The records of a point exceed its planned shots");
+        }
+        if (covered < ends[r]) {
+            report_gap(covered, ends[r]);
+        }
+    }
+    return results;
+}
+
+}; // namespace Simulation
+}; // namespace Plaquette
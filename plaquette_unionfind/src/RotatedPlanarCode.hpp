@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+#include "StabilizerCode.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief A class representing a rotated planar (surface) code with optional
+ * repeated measurement rounds.
+ *
+ * The d x d data qubits sit at grid coordinate (2c + 1, 2r + 1) and are
+ * numbered r * d + c. Stabilizers sit on the faces (i, j), 0 <= i, j <= d, at
+ * grid coordinate (2j, 2i) between the qubits (i - 1 .. i, j - 1 .. j). Inner
+ * faces alternate between Z (i + j even) and X (i + j odd) stabilizers, and
+ * the weight-two faces complete them: Z faces on the left and right, X faces
+ * at the top and bottom. Stabilizers of each type are numbered row by row.
+ *
+ * The Z stabilizer graph therefore has boundaries at the top and bottom, with
+ * one boundary vertex per column, and the X stabilizer graph at the left and
+ * right, with one per row. With n_rounds > 1 both decoding graphs become
+ * phenomenological space-time graphs, see
+ * StabilizerCode::BuildSpaceTimeGraph_().
+ *
+ * Everything is built with index arithmetic only, so construction is linear in
+ * the size of the graphs.
+ */
+class RotatedPlanarCode : public StabilizerCode {
+
+  private:
+    size_t distance_;   ///< The code distance d.
+    size_t num_rounds_; ///< The number of measurement rounds.
+
+  public:
+    /**
+     * @brief Construct a rotated planar code of a given distance.
+     *
+     * @param distance The code distance d, at least 2.
+     * @param num_rounds The number of stabilizer measurement rounds.
+     */
+    RotatedPlanarCode(size_t distance, size_t num_rounds = 1)
+        : distance_(distance), num_rounds_(num_rounds) {
+        if (distance < 2) {
+            throw std::invalid_argument(
+                "RotatedPlanarCode requires distance >= 2");
+        }
+        if (num_rounds < 1) {
+            throw std::invalid_argument(
+                "RotatedPlanarCode requires num_rounds >= 1");
+        }
+
+        size_t d = distance;
+        size_t num_faces = (d + 1) * (d + 1);
+        size_t num_qubits = d * d;
+
+        // Vertex ids of the faces of either type, row by row.
+        std::vector<size_t> face_vertex(num_faces);
+        size_t num_z = 0;
+        size_t num_x = 0;
+        for (size_t i = 0; i <= d; i++) {
+            for (size_t j = 0; j <= d; j++) {
+                bool inner_row = i > 0 && i < d;
+                bool inner_column = j > 0 && j < d;
+                if ((i + j) % 2 == 0 && inner_row) {
+                    face_vertex[i * (d + 1) + j] = num_z++;
+                    z_stabilizer_coords_.emplace_back(2 * j, 2 * i);
+                } else if ((i + j) % 2 == 1 && inner_column) {
+                    face_vertex[i * (d + 1) + j] = num_x++;
+                    x_stabilizer_coords_.emplace_back(2 * j, 2 * i);
+                }
+            }
+        }
+
+        // Qubit (r, c) joins the Z face of rows r and r + 1, which lie in
+        // neighbouring columns, or a top or bottom boundary vertex. Likewise
+        // it joins the X face of columns c and c + 1, or a left or right
+        // boundary vertex.
+        auto z_vertex = [&](size_t i, size_t c) -> size_t {
+            if (i == 0) {
+                return num_z + c;
+            }
+            if (i == d) {
+                return num_z + d + c;
+            }
+            size_t j = (i + c) % 2 == 0 ? c : c + 1;
+            return face_vertex[i * (d + 1) + j];
+        };
+        auto x_vertex = [&](size_t r, size_t j) -> size_t {
+            if (j == 0) {
+                return num_x + r;
+            }
+            if (j == d) {
+                return num_x + d + r;
+            }
+            size_t i = (r + j) % 2 == 1 ? r : r + 1;
+            return face_vertex[i * (d + 1) + j];
+        };
+
+        qubit_coords_.reserve(num_qubits);
+        std::vector<std::pair<size_t, size_t>> z_edges;
+        std::vector<std::pair<size_t, size_t>> x_edges;
+        z_edges.reserve(num_qubits);
+        x_edges.reserve(num_qubits);
+        for (size_t r = 0; r < d; r++) {
+            for (size_t c = 0; c < d; c++) {
+                qubit_coords_.emplace_back(2 * c + 1, 2 * r + 1);
+                z_edges.emplace_back(z_vertex(r, c), z_vertex(r + 1, c));
+                x_edges.emplace_back(x_vertex(r, c), x_vertex(r, c + 1));
+            }
+        }
+
+        z_stabilizer_decoding_graph_ =
+            BuildSpaceTimeGraph_(z_edges, num_z, num_z + 2 * d, num_rounds);
+        x_stabilizer_decoding_graph_ =
+            BuildSpaceTimeGraph_(x_edges, num_x, num_x + 2 * d, num_rounds);
+
+        // Logical X runs down the left column and logical Z along the top
+        // row. Errors on the Z (X) graph flip the logical Z (X) measurement if
+        // an odd number of error chains ends on the top (left) boundary,
+        // summed over all rounds.
+        std::vector<size_t> top_qubits(d);
+        std::vector<size_t> left_qubits(d);
+        for (size_t k = 0; k < d; k++) {
+            top_qubits[k] = k;
+            left_qubits[k] = k * d;
+        }
+        logical_x_qubits_ = {
+            RepeatLogical_(left_qubits, num_qubits, num_rounds)};
+        logical_z_qubits_ = {
+            RepeatLogical_(top_qubits, num_qubits, num_rounds)};
+        IndexLogicals_();
+    }
+
+    /**
+     * @brief Get the number of data qubits in the code.
+     */
+    size_t GetNumOfQubits() const { return qubit_coords_.size(); }
+
+    /**
+     * @brief Get the number of measurement rounds.
+     */
+    size_t GetNumRounds() const { return num_rounds_; }
+
+    /**
+     * @brief Get the code distance.
+     */
+    size_t GetCodeDistance() const { return distance_; }
+};
+}; // namespace Plaquette
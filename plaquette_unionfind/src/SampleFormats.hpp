@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace Plaquette {
+
+/**
+ * @brief The Stim sample formats supported for detection events and
+ * observable flips.
+ *
+ * - `01`: one ASCII '0'/'1' character per bit, each shot terminated by a
+ *   newline.
+ * - `b8`: bits packed little-endian into bytes, each shot padded to a whole
+ *   number of bytes.
+ * - `r8`: every byte is the number of zeros before the next one; a byte of
+ *   255 continues the run without a one. Each shot ends with an implicit one
+ *   just past its last bit.
+ */
+enum class SampleFormat { ZeroOne, B8, R8 };
+
+/**
+ * @brief Parses the name of a sample format as used on Stim's command line.
+ *
+ * @param name One of "01", "b8" or "r8".
+ * @return The corresponding format.
+ */
+inline SampleFormat ParseSampleFormat(const std::string &name) {
+    if (name == "01") {
+        return SampleFormat::ZeroOne;
+    }
+    if (name == "b8") {
+        return SampleFormat::B8;
+    }
+    if (name == "r8") {
+        return SampleFormat::R8;
+    }
+    throw std::invalid_argument("Unsupported sample format '" + name +
+                                "', expected one of 01, b8, r8");
+}
+
+/**
+ * @brief Reads shots of a fixed number of bits from a byte buffer.
+ *
+ * The reader does not own the buffer, which is typically a memory-mapped
+ * file. Shots are decoded one at a time, so arbitrarily large inputs can be
+ * streamed with a single reusable shot vector.
+ */
+class SampleReader {
+
+  private:
+    const unsigned char *data_; ///< Start of the input buffer.
+    size_t size_;               ///< Size of the input buffer in bytes.
+    size_t position_;           ///< Offset of the next unread byte.
+    size_t num_bits_;           ///< Number of bits per shot.
+    SampleFormat format_;       ///< Format of the input buffer.
+
+    [[noreturn]] void Fail_(const std::string &message) const {
+        throw std::runtime_error("Malformed " + FormatName_() +
+                                 " sample data at byte " +
+                                 std::to_string(position_) + ": " + message);
+    }
+
+    std::string FormatName_() const {
+        switch (format_) {
+        case SampleFormat::ZeroOne:
+            return "01";
+        case SampleFormat::B8:
+            return "b8";
+        default:
+            return "r8";
+        }
+    }
+
+    void ReadZeroOne_(std::vector<bool> &bits) {
+        for (size_t i = 0; i < num_bits_; i++) {
+            if (position_ >= size_) {
+                Fail_("unexpected end of data");
+            }
+            char c = data_[position_++];
+            if (c != '0' && c != '1') {
+                Fail_("expected '0' or '1'");
+            }
+            bits[i] = c == '1';
+        }
+        if (position_ < size_ && data_[position_] == '\r') {
+            position_++;
+        }
+        if (position_ >= size_ || data_[position_] != '\n') {
+            Fail_("expected a newline after " + std::to_string(num_bits_) +
+                  " bits");
+        }
+        position_++;
+    }
+
+    void ReadB8_(std::vector<bool> &bits) {
+        size_t num_bytes = (num_bits_ + 7) / 8;
+        if (position_ + num_bytes > size_) {
+            Fail_("unexpected end of data");
+        }
+        for (size_t i = 0; i < num_bits_; i++) {
+            bits[i] = (data_[position_ + i / 8] >> (i % 8)) & 1;
+        }
+        position_ += num_bytes;
+    }
+
+    void ReadR8_(std::vector<bool> &bits) {
+        std::fill(bits.begin(), bits.end(), false);
+        size_t bit = 0;
+        while (true) {
+            if (position_ >= size_) {
+                Fail_("unexpected end of data");
+            }
+            unsigned char run = data_[position_++];
+            bit += run;
+            if (run == 255) {
+                continue;
+            }
+            if (bit == num_bits_) {
+                return;
+            }
+            if (bit > num_bits_) {
+                Fail_("run length exceeds the shot size");
+            }
+            bits[bit++] = true;
+        }
+    }
+
+  public:
+    /**
+     * @brief Constructs a reader over a byte buffer.
+     *
+     * @param data The start of the buffer.
+     * @param size The size of the buffer in bytes.
+     * @param num_bits The number of bits per shot.
+     * @param format The format of the buffer.
+     */
+    SampleReader(const char *data, size_t size, size_t num_bits,
+                 SampleFormat format)
+        : data_(reinterpret_cast<const unsigned char *>(data)), size_(size),
+          position_(0), num_bits_(num_bits), format_(format) {}
+
+    /**
+     * @brief Returns true when all shots have been read.
+     */
+    bool IsAtEnd() const { return position_ >= size_; }
+
+    /**
+     * @brief Returns the offset of the next unread byte.
+     */
+    size_t GetPosition() const { return position_; }
+
+    /**
+     * @brief Reads the next shot.
+     *
+     * @param bits Resized to the number of bits per shot and overwritten.
+     * @return False if there are no shots left.
+     */
+    bool ReadShot(std::vector<bool> &bits) {
+        if (IsAtEnd()) {
+            return false;
+        }
+        bits.resize(num_bits_);
+        switch (format_) {
+        case SampleFormat::ZeroOne:
+            ReadZeroOne_(bits);
+            break;
+        case SampleFormat::B8:
+            ReadB8_(bits);
+            break;
+        case SampleFormat::R8:
+            ReadR8_(bits);
+            break;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Appends a single shot to an output buffer.
+ *
+ * @param out The buffer to append to.
+ * @param bits The bits of the shot.
+ * @param format The format to write.
+ */
+inline void WriteShot(std::string &out, const std::vector<bool> &bits,
+                      SampleFormat format) {
+    switch (format) {
+    case SampleFormat::ZeroOne:
+        for (bool b : bits) {
+            out.push_back(b ? '1' : '0');
+        }
+        out.push_back('\n');
+        break;
+    case SampleFormat::B8: {
+        size_t offset = out.size();
+        out.resize(offset + (bits.size() + 7) / 8, '\0');
+        for (size_t i = 0; i < bits.size(); i++) {
+            if (bits[i]) {
+                out[offset + i / 8] |= static_cast<char>(1 << (i % 8));
+            }
+        }
+        break;
+    }
+    case SampleFormat::R8: {
+        size_t run = 0;
+        auto flush_run = [&out, &run]() {
+            for (; run >= 255; run -= 255) {
+                out.push_back(static_cast<char>(255));
+            }
+            out.push_back(static_cast<char>(run));
+            run = 0;
+        };
+        for (bool b : bits) {
+            if (b) {
+                flush_run();
+            } else {
+                run++;
+            }
+        }
+        flush_run();
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Appends a shot given as a bitmask of up to 64 bits.
+ *
+ * @param out The buffer to append to.
+ * @param mask The bits of the shot, bit i being the i-th entry.
+ * @param num_bits The number of bits in the shot.
+ * @param format The format to write.
+ */
+inline void WriteShot(std::string &out, uint64_t mask, size_t num_bits,
+                      SampleFormat format) {
+    std::vector<bool> bits(num_bits);
+    for (size_t i = 0; i < num_bits; i++) {
+        bits[i] = (mask >> i) & 1;
+    }
+    WriteShot(out, bits, format);
+}
+
+}; // namespace Plaquette
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "DecodingGraph.hpp"
+#include "DetectorErrorModel.hpp"
+#include "ErrorModels.hpp"
+#include "PackedBits.hpp"
+#include "StabilizerCode.hpp"
+#include "Utils.hpp"
+
+namespace Plaquette {
+
+/**
+ * @brief Samples the detection events and observable flips of independent
+ * error mechanisms on a space-time decoding graph.
+ *
+ * By default every edge of the graph is a mechanism that flips its two
+ * vertices and a set of observables, and fails independently with its own
+ * probability: data errors on space-like edges, measurement errors on
+ * time-like edges and any further edges of the graph, such as the diagonal
+ * edges of hook errors. The flipped mechanisms are drawn with an
+ * ErrorModels::HeterogeneousBitFlipErrorModel, so a shot costs O(#flipped
+ * mechanisms), and the endpoints of their edges are XORed into the detection
+ * events. Boundary vertices never fire, so the events are a syndrome that
+ * Decoders::UnionFindDecoder decodes directly.
+ *
+ * A detector error model is sampled over its error mechanisms instead, see
+ * DetectorErrorModel::GetErrorMechanisms(). A mechanism flips all edges of a
+ * decomposed error together, or no edge for an undetectable error, and the
+ * observables of the error rather than those of the merged edges.
+ *
+ * @tparam Generator As for ErrorModels::GeometricBitFlipErrorModel.
+ */
+template <typename Generator = Xoshiro256PlusPlus> class SpaceTimeSampler {
+
+  private:
+    static constexpr uint32_t kBoundary_ = std::numeric_limits<uint32_t>::max();
+
+    /** The endpoints of every edge, kBoundary_ for boundary vertices */
+    std::vector<std::pair<uint32_t, uint32_t>> edge_vertices_;
+    std::vector<uint64_t> edge_observables_; /**< Observable mask per edge */
+    std::vector<double> edge_probabilities_; /**< Error rate per edge */
+    /**
+     * Mechanism m flips the edges [mechanism_offsets_[m],
+     * mechanism_offsets_[m + 1]) of mechanism_edges_. Empty if every
+     * mechanism is a single edge.
+     */
+    std::vector<size_t> mechanism_offsets_;
+    std::vector<uint32_t> mechanism_edges_;
+    std::vector<uint64_t> mechanism_observables_;
+    size_t num_vertices_;
+    ErrorModels::HeterogeneousBitFlipErrorModel<Generator> model_;
+    std::vector<size_t> flipped_mechanisms_;
+    std::vector<size_t> flipped_edges_; /**< The edges of the last shot */
+
+    static std::vector<double> GetMechanismProbabilities_(
+        const std::vector<double> &edge_probabilities,
+        const std::vector<DetectorErrorModel::ErrorMechanism> *mechanisms) {
+        if (mechanisms == nullptr) {
+            return edge_probabilities;
+        }
+        std::vector<double> probabilities;
+        probabilities.reserve(mechanisms->size());
+        for (const auto &mechanism : *mechanisms) {
+            probabilities.push_back(mechanism.probability);
+        }
+        return probabilities;
+    }
+
+    SpaceTimeSampler(
+        const DecodingGraph &graph, std::vector<double> edge_probabilities,
+        std::vector<uint64_t> edge_observables,
+        const std::vector<DetectorErrorModel::ErrorMechanism> *mechanisms,
+        Generator generator)
+        : edge_observables_(std::move(edge_observables)),
+          edge_probabilities_(std::move(edge_probabilities)),
+          num_vertices_(graph.GetNumVertices()),
+          model_(GetMechanismProbabilities_(edge_probabilities_, mechanisms),
+                 std::move(generator)) {
+        size_t num_edges = graph.GetNumEdges();
+        if (edge_probabilities_.size() != num_edges) {
+            throw std::invalid_argument(
+                "Expected one error probability per edge");
+        }
+        if (edge_observables_.size() > num_edges) {
+            throw std::invalid_argument(
+                "More observable masks than edges were given");
+        }
+        edge_observables_.resize(num_edges, 0);
+        edge_vertices_.reserve(num_edges);
+        auto vertex = [&](size_t v) {
+            return graph.IsVertexOnBoundary(v) ? kBoundary_
+                                               : static_cast<uint32_t>(v);
+        };
+        for (size_t e = 0; e < num_edges; e++) {
+            auto [v0, v1] = graph.GetVerticesConnectedByEdge(e);
+            edge_vertices_.emplace_back(vertex(v0), vertex(v1));
+        }
+
+        if (mechanisms != nullptr) {
+            mechanism_offsets_.reserve(mechanisms->size() + 1);
+            mechanism_offsets_.push_back(0);
+            for (const auto &mechanism : *mechanisms) {
+                for (auto e : mechanism.edges) {
+                    if (e >= num_edges) {
+                        throw std::invalid_argument(
+                            "An error mechanism flips an unknown edge");
+                    }
+                    mechanism_edges_.push_back(e);
+                }
+                mechanism_offsets_.push_back(mechanism_edges_.size());
+                mechanism_observables_.push_back(mechanism.observables);
+            }
+        }
+    }
+
+    /**
+     * @brief Draws the mechanisms of a shot into flipped_edges_.
+     *
+     * @return The flipped observables.
+     */
+    uint64_t SampleEdges_() {
+        uint64_t observables = 0;
+        if (mechanism_offsets_.empty()) {
+            model_.GetErrors(flipped_edges_);
+            for (auto e : flipped_edges_) {
+                observables ^= edge_observables_[e];
+            }
+            return observables;
+        }
+
+        model_.GetErrors(flipped_mechanisms_);
+        flipped_edges_.clear();
+        for (auto m : flipped_mechanisms_) {
+            observables ^= mechanism_observables_[m];
+            flipped_edges_.insert(
+                flipped_edges_.end(),
+                mechanism_edges_.begin() + mechanism_offsets_[m],
+                mechanism_edges_.begin() + mechanism_offsets_[m + 1]);
+        }
+        // Edges flipped by two mechanisms cancel.
+        std::sort(flipped_edges_.begin(), flipped_edges_.end());
+        size_t n = 0;
+        for (size_t i = 0; i < flipped_edges_.size(); i++) {
+            if (i + 1 < flipped_edges_.size() &&
+                flipped_edges_[i] == flipped_edges_[i + 1]) {
+                i++;
+            } else {
+                flipped_edges_[n++] = flipped_edges_[i];
+            }
+        }
+        flipped_edges_.resize(n);
+        return observables;
+    }
+
+  public:
+    /**
+     * @brief Constructor for the SpaceTimeSampler class.
+     *
+     * @param graph The decoding graph.
+     * @param edge_probabilities The error probability of every edge.
+     * @param edge_observables For every edge, the observables it flips with
+     * bit l set for observable l. May be shorter than the number of edges,
+     * the missing edges flip no observable.
+     * @param generator The random number generator.
+     */
+    SpaceTimeSampler(const DecodingGraph &graph,
+                     std::vector<double> edge_probabilities,
+                     std::vector<uint64_t> edge_observables,
+                     Generator generator)
+        : SpaceTimeSampler(graph, std::move(edge_probabilities),
+                           std::move(edge_observables), nullptr,
+                           std::move(generator)) {}
+
+    SpaceTimeSampler(const DecodingGraph &graph,
+                     std::vector<double> edge_probabilities,
+                     std::vector<uint64_t> edge_observables, int seed = -1)
+        : SpaceTimeSampler(graph, std::move(edge_probabilities),
+                           std::move(edge_observables),
+                           Generator(GetSeed(seed))) {}
+
+    /**
+     * @brief Samples the error mechanisms of a detector error model, whose
+     * detectors are the first vertices of its graph.
+     */
+    static SpaceTimeSampler
+    FromDetectorErrorModel(const DetectorErrorModel &model,
+                           Generator generator) {
+        return SpaceTimeSampler(model.GetDecodingGraph(),
+                                model.GetEdgeProbabilities(),
+                                model.GetEdgeObservables(),
+                                &model.GetErrorMechanisms(),
+                                std::move(generator));
+    }
+
+    /**
+     * @brief Samples X errors on the Z stabilizer decoding graph of a code,
+     * with the Z logical operators as observables.
+     *
+     * @param code The code, e.g. with several rounds for phenomenological
+     * noise.
+     * @param edge_probabilities The error probability of every edge, see
+     * ErrorModels::GetSpaceTimeProbabilities() for space-time graphs.
+     * @param generator The random number generator.
+     */
+    static SpaceTimeSampler FromCode(const StabilizerCode &code,
+                                     std::vector<double> edge_probabilities,
+                                     Generator generator) {
+        return SpaceTimeSampler(
+            code.GetZStabilizerDecodingGraph(), std::move(edge_probabilities),
+            code.GetLogicalEdgeMasks(StabilizerCode::Channel::Z),
+            std::move(generator));
+    }
+
+    /**
+     * @brief Returns the generator, e.g. to seek a PhiloxGenerator to a shot.
+     */
+    Generator &GetGenerator() { return model_.GetGenerator(); }
+
+    size_t GetNumVertices() const { return num_vertices_; }
+    size_t GetNumEdges() const { return edge_vertices_.size(); }
+
+    const std::vector<double> &GetEdgeProbabilities() const {
+        return edge_probabilities_;
+    }
+
+    /**
+     * @brief Returns the growth increments of a decoder weighted by the edge
+     * probabilities.
+     */
+    std::vector<float> GetGrowthIncrements(float max_growth = 2.0) const {
+        return Utils::GetGrowthIncrementsFromProbabilities(edge_probabilities_,
+                                                           max_growth);
+    }
+
+    /**
+     * @brief Returns the edges flipped in the last shot, in increasing order.
+     */
+    const std::vector<size_t> &GetFlippedEdges() const {
+        return flipped_edges_;
+    }
+
+    /**
+     * @brief Samples a shot into packed detection events.
+     *
+     * @param detection_events Receives bit v % 64 of word v / 64 for every
+     * vertex v that fires, GetNumPackedWords(GetNumVertices()) words.
+     * @return The flipped observables, bit l for observable l.
+     */
+    uint64_t Sample(std::vector<uint64_t> &detection_events) {
+        uint64_t observables = SampleEdges_();
+        detection_events.assign(GetNumPackedWords(num_vertices_), 0);
+        for (auto e : flipped_edges_) {
+            auto [v0, v1] = edge_vertices_[e];
+            if (v0 != kBoundary_) {
+                FlipPackedBit(detection_events, v0);
+            }
+            if (v1 != kBoundary_) {
+                FlipPackedBit(detection_events, v1);
+            }
+        }
+        return observables;
+    }
+
+    /**
+     * @brief Samples a shot into a syndrome with one flag per vertex, as
+     * taken by Decoders::UnionFindDecoder::Decode().
+     *
+     * @return The flipped observables, bit l for observable l.
+     */
+    uint64_t Sample(std::vector<bool> &syndrome) {
+        uint64_t observables = SampleEdges_();
+        syndrome.assign(num_vertices_, false);
+        for (auto e : flipped_edges_) {
+            auto [v0, v1] = edge_vertices_[e];
+            if (v0 != kBoundary_) {
+                syndrome[v0].flip();
+            }
+            if (v1 != kBoundary_) {
+                syndrome[v1].flip();
+            }
+        }
+        return observables;
+    }
+
+    /**
+     * @brief Returns the observables flipped by a correction with one
+     * element (0 or 1) per edge, as written by the decoders. A shot fails if
+     * this differs from the observables returned by Sample().
+     */
+    uint64_t GetObservableFlips(std::span<const uint8_t> correction) const {
+        uint64_t observables = 0;
+        for (size_t e = 0; e < correction.size(); e++) {
+            if (correction[e]) {
+                observables ^= edge_observables_[e];
+            }
+        }
+        return observables;
+    }
+};
+
+}; // namespace Plaquette
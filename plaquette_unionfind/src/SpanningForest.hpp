@@ -1,11 +1,36 @@
 #pragma once
 
 #include "DecodingGraph.hpp"
+#include "GraphConcepts.hpp"
+#include "PaddedAdjacency.hpp"
 #include "Types.hpp"
+#include <algorithm>
 #include <vector>
 
 namespace Plaquette {
 
+/**
+ * @brief The buffers used to build a spanning forest. Keeping one workspace
+ * per decoder lets every shot reuse them instead of allocating.
+ */
+struct SpanningForestWorkspace {
+    std::vector<bool> visited;
+    std::vector<size_t> vertex_count;
+    std::vector<size_t> spanning_forest;
+
+    explicit SpanningForestWorkspace(size_t num_vertices = 0)
+        : visited(num_vertices, false), vertex_count(num_vertices, 0) {
+        // A forest has fewer edges than vertices, so this never grows.
+        spanning_forest.reserve(num_vertices);
+    }
+
+    void Reset() {
+        std::fill(visited.begin(), visited.end(), false);
+        std::fill(vertex_count.begin(), vertex_count.end(), 0);
+        spanning_forest.clear();
+    }
+};
+
 void GetSpanningTreeDFS(
     const DecodingGraph &decoding_graph,
     const Types::UnorderedMap<size_t, Types::UnorderedSet<size_t>>
@@ -188,53 +213,79 @@ auto GetSpanningForestCacheFriendly(const DecodingGraph &decoding_graph,
     return std::make_pair(spanning_forest, vertex_count);
 }
 
-void GetSpanningTreeCacheFriendlySeeded(const DecodingGraph &decoding_graph,
-                                        const std::vector<bool> &edge_list,
+template <DecodingGraphLike Graph, typename EdgeFlags, typename SeedFlags>
+void GetSpanningTreeCacheFriendlySeeded(const Graph &decoding_graph,
+                                        const EdgeFlags &edge_list,
                                         std::vector<bool> &visited,
-                                        // std::vector<bool> & evisited,
                                         std::vector<size_t> &spanning_tree,
                                         std::vector<size_t> &vertex_count,
-                                        size_t seed,
-                                        const std::vector<bool> &seeds) {
+                                        size_t seed, const SeedFlags &seeds) {
     visited[seed] = true;
-    const auto &vertex_vneighbours =
-        decoding_graph.GetVerticesTouchingVertex(seed);
-    const auto &vertex_eneighbours =
-        decoding_graph.GetEdgesTouchingVertex(seed);
+    ForEachNeighbour(
+        decoding_graph, seed, [&](size_t eneighbour, size_t vneighbour) {
+            if (edge_list[eneighbour] && !visited[vneighbour] and
+                !seeds[vneighbour]) {
+                spanning_tree.push_back(eneighbour);
+                ++vertex_count[seed];
+                ++vertex_count[vneighbour];
+                GetSpanningTreeCacheFriendlySeeded(decoding_graph, edge_list,
+                                                   visited, spanning_tree,
+                                                   vertex_count, vneighbour,
+                                                   seeds);
+            }
+        });
+}
 
-    for (size_t i = 0; i < vertex_vneighbours.size(); i++) {
-        const auto &vneighbour = vertex_vneighbours[i];
-        const auto &eneighbour = vertex_eneighbours[i];
-        if (edge_list[eneighbour] /*&& !evisited[eneighbour]*/ &&
-            !visited[vneighbour] and !seeds[vneighbour]) {
+/**
+ * @brief The depth-first search of GetSpanningTreeCacheFriendlySeeded over
+ * the fixed-width rows of a PaddedAdjacency.
+ */
+template <size_t MaxDegree, typename EdgeFlags, typename SeedFlags>
+void GetSpanningTreeFixedDegreeSeeded(const PaddedAdjacency &adjacency,
+                                      const EdgeFlags &edge_list,
+                                      std::vector<bool> &visited,
+                                      std::vector<size_t> &spanning_tree,
+                                      std::vector<size_t> &vertex_count,
+                                      size_t seed, const SeedFlags &seeds) {
+    visited[seed] = true;
+    auto row = adjacency.GetRow<MaxDegree>(seed);
+    size_t degree = row.size();
+    for (size_t i = 0; i < MaxDegree; i++) {
+        if (i >= degree) {
+            break;
+        }
+        size_t vneighbour = row.GetVertex(i);
+        size_t eneighbour = row.GetEdge(i);
+        if (edge_list[eneighbour] && !visited[vneighbour] &&
+            !seeds[vneighbour]) {
             spanning_tree.push_back(eneighbour);
-            // evisited[eneighbour] = true;
             ++vertex_count[seed];
             ++vertex_count[vneighbour];
-            GetSpanningTreeCacheFriendlySeeded(
-                decoding_graph, edge_list, visited,
-                /*evisited,*/
-                spanning_tree, vertex_count, vneighbour, seeds);
+            GetSpanningTreeFixedDegreeSeeded<MaxDegree>(
+                adjacency, edge_list, visited, spanning_tree, vertex_count,
+                vneighbour, seeds);
         }
     }
 }
 
-auto GetSpanningForestCacheFriendlySeeded(const DecodingGraph &decoding_graph,
-                                          const std::vector<bool> &edge_list,
-                                          const std::vector<bool> &seeds,
-                                          size_t seeds_size) {
-
-    size_t num_vertices = decoding_graph.GetNumVertices();
-    std::vector<bool> visited(num_vertices, false);
-    std::vector<size_t> vertex_count(num_vertices, 0);
-    std::vector<size_t> spanning_forest;
+/**
+ * @brief Grows a tree with grow_tree(vertex) from every seed, and then from
+ * every vertex of an edge in edge_list that no tree reached.
+ */
+template <DecodingGraphLike Graph, typename EdgeFlags, typename SeedFlags,
+          typename GrowTree>
+void GetSpanningForestSeeded_(const Graph &decoding_graph,
+                              const EdgeFlags &edge_list,
+                              const SeedFlags &seeds, size_t seeds_size,
+                              SpanningForestWorkspace &workspace,
+                              GrowTree &&grow_tree) {
+    workspace.Reset();
+    auto &visited = workspace.visited;
 
     if (seeds_size != 0) {
         for (size_t i = 0; i < seeds.size(); i++) {
             if (seeds[i] and !visited[i]) {
-                GetSpanningTreeCacheFriendlySeeded(decoding_graph, edge_list,
-                                                   visited, spanning_forest,
-                                                   vertex_count, i, seeds);
+                grow_tree(i);
             }
         }
     }
@@ -243,19 +294,81 @@ auto GetSpanningForestCacheFriendlySeeded(const DecodingGraph &decoding_graph,
         if (edge_list[e]) {
             const auto &[v1, v2] = decoding_graph.GetVerticesConnectedByEdge(e);
             if (!visited[v1]) {
-                GetSpanningTreeCacheFriendlySeeded(
-                    decoding_graph, edge_list, visited,
-                    /*evisited,*/ spanning_forest, vertex_count, v1, seeds);
+                grow_tree(v1);
             }
             if (!visited[v2]) {
-                GetSpanningTreeCacheFriendlySeeded(
-                    decoding_graph, edge_list, visited,
-                    /* evisited,*/ spanning_forest, vertex_count, v2, seeds);
+                grow_tree(v2);
             }
         }
     }
+}
 
-    return std::make_pair(spanning_forest, vertex_count);
+/**
+ * @brief Builds a spanning forest of the edges in edge_list into a reusable
+ * workspace, starting from the seed vertices (if any) so that trees are
+ * rooted at them.
+ *
+ * @param seeds A flag per vertex marking the seeds.
+ * @param seeds_size The number of seeds; 0 skips the seeding pass.
+ * @param workspace Receives the forest edges and the number of forest edges
+ * touching each vertex. It is reset first.
+ *
+ * @tparam Graph Any DecodingGraphLike graph.
+ * @tparam EdgeFlags, SeedFlags Vectors of bool with any allocator.
+ */
+template <DecodingGraphLike Graph, typename EdgeFlags, typename SeedFlags>
+void GetSpanningForestCacheFriendlySeeded(const Graph &decoding_graph,
+                                          const EdgeFlags &edge_list,
+                                          const SeedFlags &seeds,
+                                          size_t seeds_size,
+                                          SpanningForestWorkspace &workspace) {
+    GetSpanningForestSeeded_(
+        decoding_graph, edge_list, seeds, seeds_size, workspace,
+        [&](size_t seed) {
+            GetSpanningTreeCacheFriendlySeeded(
+                decoding_graph, edge_list, workspace.visited,
+                workspace.spanning_forest, workspace.vertex_count, seed, seeds);
+        });
+}
+
+/**
+ * @brief The same as above, but traverses the fixed-width rows of adjacency
+ * if it has any. The forest is identical.
+ */
+template <DecodingGraphLike Graph, typename EdgeFlags, typename SeedFlags>
+void GetSpanningForestCacheFriendlySeeded(const Graph &decoding_graph,
+                                          const PaddedAdjacency &adjacency,
+                                          const EdgeFlags &edge_list,
+                                          const SeedFlags &seeds,
+                                          size_t seeds_size,
+                                          SpanningForestWorkspace &workspace) {
+    adjacency.Dispatch([&](auto max_degree) {
+        if constexpr (max_degree == 0) {
+            GetSpanningForestCacheFriendlySeeded(decoding_graph, edge_list,
+                                                 seeds, seeds_size, workspace);
+        } else {
+            GetSpanningForestSeeded_(
+                decoding_graph, edge_list, seeds, seeds_size, workspace,
+                [&](size_t seed) {
+                    GetSpanningTreeFixedDegreeSeeded<max_degree>(
+                        adjacency, edge_list, workspace.visited,
+                        workspace.spanning_forest, workspace.vertex_count,
+                        seed, seeds);
+                });
+        }
+    });
+}
+
+template <DecodingGraphLike Graph, typename EdgeFlags, typename SeedFlags>
+auto GetSpanningForestCacheFriendlySeeded(const Graph &decoding_graph,
+                                          const EdgeFlags &edge_list,
+                                          const SeedFlags &seeds,
+                                          size_t seeds_size) {
+    SpanningForestWorkspace workspace(decoding_graph.GetNumVertices());
+    GetSpanningForestCacheFriendlySeeded(decoding_graph, edge_list, seeds,
+                                         seeds_size, workspace);
+    return std::make_pair(std::move(workspace.spanning_forest),
+                          std::move(workspace.vertex_count));
 }
 
 }; // namespace Plaquette
@@ -1,10 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <limits>
+#include <span>
+#include <stdexcept>
 #include <vector>
 
 #include "DecodingGraph.hpp"
+#include "PackedBits.hpp"
 #include "Types.hpp"
 
 namespace Plaquette {
@@ -22,12 +26,112 @@ class StabilizerCode {
     std::vector<std::pair<int, int>> z_stabilizer_coords_;
     std::vector<std::pair<int, int>> qubit_coords_;
 
-    // In terms of Z stabilizer edge Ids
+    // In terms of X stabilizer edge Ids, measured with Channel::X on the
+    // residual Z errors of the X stabilizer graph
     std::vector<std::vector<size_t>> logical_x_qubits_;
 
-    // In terms of X stabilizer edge Ids
+    // In terms of Z stabilizer edge Ids, measured with Channel::Z on the
+    // residual X errors of the Z stabilizer graph
     std::vector<std::vector<size_t>> logical_z_qubits_;
 
+    // Bit l of word e is set if edge e is in the support of logical l, so
+    // that the parity of a sparse error is a XOR over its edges. Filled by
+    // IndexLogicals_().
+    std::vector<uint64_t> logical_x_edge_masks_;
+    std::vector<uint64_t> logical_z_edge_masks_;
+
+    /**
+     * @brief Indexes the supports of the logical operators by edge for the
+     * sparse MeasureLogical(). Subclasses call it once their logicals are
+     * set.
+     */
+    void IndexLogicals_() {
+        auto index = [](const std::vector<std::vector<size_t>> &logicals,
+                        std::vector<uint64_t> &masks) {
+            if (logicals.size() > 64) {
+                throw std::invalid_argument(
+                    "At most 64 logical operators are supported");
+            }
+            masks.clear();
+            for (size_t l = 0; l < logicals.size(); l++) {
+                for (auto e : logicals[l]) {
+                    if (e >= masks.size()) {
+                        masks.resize(e + 1, 0);
+                    }
+                    masks[e] |= uint64_t{1} << l;
+                }
+            }
+        };
+        index(logical_x_qubits_, logical_x_edge_masks_);
+        index(logical_z_qubits_, logical_z_edge_masks_);
+    }
+
+    /**
+     * @brief Builds the phenomenological space-time decoding graph of one
+     * stabilizer type in O(V + E).
+     *
+     * Every round is a copy of the single-round graph, with its own boundary
+     * vertices, and the same stabilizer in consecutive rounds is joined by a
+     * time-like edge. Edges are numbered round by round, with all space-like
+     * edges (edge id = round * num_qubits + qubit) before all time-like ones
+     * (round * num_stabilizers + stabilizer). The final round is assumed to
+     * be perfect.
+     *
+     * @param layer_edges The edges of a single round, one per data qubit, in
+     * terms of the vertices of that round.
+     * @param num_stabilizers The number of stabilizers per round. Vertices
+     * below this index are stabilizers, the rest of a round are boundaries.
+     * @param num_layer_vertices The number of vertices per round.
+     * @param num_rounds The number of measurement rounds.
+     */
+    static DecodingGraph BuildSpaceTimeGraph_(
+        const std::vector<std::pair<size_t, size_t>> &layer_edges,
+        size_t num_stabilizers, size_t num_layer_vertices, size_t num_rounds) {
+        size_t num_qubits = layer_edges.size();
+        size_t num_vertices = num_rounds * num_layer_vertices;
+
+        std::vector<std::pair<size_t, size_t>> edges;
+        edges.reserve(num_rounds * num_qubits +
+                      (num_rounds - 1) * num_stabilizers);
+        for (size_t r = 0; r < num_rounds; r++) {
+            size_t offset = r * num_layer_vertices;
+            for (const auto &edge : layer_edges) {
+                edges.emplace_back(edge.first + offset, edge.second + offset);
+            }
+        }
+        for (size_t r = 0; r + 1 < num_rounds; r++) {
+            size_t offset = r * num_layer_vertices;
+            for (size_t s = 0; s < num_stabilizers; s++) {
+                edges.emplace_back(s + offset, s + offset + num_layer_vertices);
+            }
+        }
+
+        std::vector<bool> vertex_boundary(num_vertices, false);
+        for (size_t r = 0; r < num_rounds; r++) {
+            for (size_t v = num_stabilizers; v < num_layer_vertices; v++) {
+                vertex_boundary[r * num_layer_vertices + v] = true;
+            }
+        }
+        return DecodingGraph(num_vertices, edges, vertex_boundary);
+    }
+
+    /**
+     * @brief Repeats a logical operator, given by the qubits of one round, in
+     * every round of a space-time graph with num_qubits qubits per round.
+     */
+    static std::vector<size_t>
+    RepeatLogical_(const std::vector<size_t> &layer_qubits, size_t num_qubits,
+                   size_t num_rounds) {
+        std::vector<size_t> qubits;
+        qubits.reserve(num_rounds * layer_qubits.size());
+        for (size_t r = 0; r < num_rounds; r++) {
+            for (auto q : layer_qubits) {
+                qubits.push_back(r * num_qubits + q);
+            }
+        }
+        return qubits;
+    }
+
   public:
     /**
      * @brief Default constructor.
@@ -58,6 +162,15 @@ class StabilizerCode {
     const auto &GetLogicalXQubits() const { return logical_x_qubits_; }
     const auto &GetLogicalZQubits() const { return logical_z_qubits_; }
 
+    /**
+     * @brief Returns one word per edge with bit l set if the edge is in
+     * logical operator l of the channel. Edges past the end are in none.
+     */
+    const std::vector<uint64_t> &GetLogicalEdgeMasks(Channel channel) const {
+        return channel == Channel::X ? logical_x_edge_masks_
+                                     : logical_z_edge_masks_;
+    }
+
     /**
      * @brief Determines whether the stabilizer code is periodic.
      *
@@ -89,12 +202,17 @@ class StabilizerCode {
      * @brief Measures the logical operator of the stabilizer code in the
      * specified channel.
      *
+     * The parity is taken over the support of the logical operators, so
+     * X errors on the edges of the Z stabilizer graph, e.g. the residual of a
+     * decoded Z syndrome, are checked with Channel::Z and Z errors on the X
+     * stabilizer graph with Channel::X.
+     *
      * @param errors The error vector.
      * @param channel The channel (X or Z) to measure.
      * @return True if the measurement outcome is -1, false otherwise.
      */
     bool MeasureLogical(const std::vector<bool> &errors,
-                        const Channel &channel) {
+                        const Channel &channel) const {
         assert(channel == Channel::Z || channel == Channel::X);
         if (channel == Channel::X) {
             for (size_t l = 0; l < logical_x_qubits_.size(); ++l) {
@@ -124,6 +242,97 @@ class StabilizerCode {
         return false;
     }
 
+    /**
+     * @brief Measures the logical operators on a sparse error in
+     * O(#errors).
+     *
+     * @param flipped_edges The flipped edges. An edge listed twice cancels
+     * out, so the concatenation of an error and a correction is their sum.
+     * @param channel The channel (X or Z) to measure, as for the dense
+     * overload.
+     * @return True if any logical measurement outcome is -1.
+     */
+    bool MeasureLogical(std::span<const size_t> flipped_edges,
+                        const Channel &channel) const {
+        const auto &masks = channel == Channel::X ? logical_x_edge_masks_
+                                                  : logical_z_edge_masks_;
+        uint64_t parity = 0;
+        for (auto e : flipped_edges) {
+            if (e < masks.size()) {
+                parity ^= masks[e];
+            }
+        }
+        return parity != 0;
+    }
+
+    /**
+     * @brief Checks whether a correction leaves a logical error behind, for
+     * a sparse error and a dense correction as written by the decoders.
+     *
+     * Only the edges of the error and of the logical supports are read, so
+     * this costs O(#errors + d * rounds) rather than O(#edges).
+     *
+     * @param flipped_edges The flipped edges.
+     * @param correction One element (0 or 1) per edge.
+     * @param channel The channel (X or Z) to measure.
+     * @return True if the residual error flips any logical measurement.
+     */
+    bool MeasureResidualLogical(std::span<const size_t> flipped_edges,
+                                std::span<const uint8_t> correction,
+                                const Channel &channel) const {
+        const auto &masks = channel == Channel::X ? logical_x_edge_masks_
+                                                  : logical_z_edge_masks_;
+        uint64_t parity = MeasureLogicalFlips(correction, channel);
+        for (auto e : flipped_edges) {
+            if (e < masks.size()) {
+                parity ^= masks[e];
+            }
+        }
+        return parity != 0;
+    }
+
+    /**
+     * @brief Returns the logical operators flipped by a dense correction,
+     * with bit l set if logical l is flipped. Only the logical supports are
+     * read.
+     */
+    uint64_t MeasureLogicalFlips(std::span<const uint8_t> correction,
+                                 const Channel &channel) const {
+        const auto &logicals =
+            channel == Channel::X ? logical_x_qubits_ : logical_z_qubits_;
+        uint64_t parity = 0;
+        for (size_t l = 0; l < logicals.size(); l++) {
+            for (auto e : logicals[l]) {
+                if (correction[e]) {
+                    parity ^= uint64_t{1} << l;
+                }
+            }
+        }
+        return parity;
+    }
+
+    /**
+     * @brief Measures the logical operators of 64 shots at once.
+     *
+     * @param error_words One word per edge, with bit k set if the edge is
+     * flipped in shot k.
+     * @param channel The channel (X or Z) to measure.
+     * @param parity_words Receives one word per logical operator, with bit k
+     * set if the operator is flipped in shot k.
+     */
+    void MeasureBitSlicedLogicals(std::span<const uint64_t> error_words,
+                                  const Channel &channel,
+                                  std::vector<uint64_t> &parity_words) const {
+        const auto &logicals =
+            channel == Channel::X ? logical_x_qubits_ : logical_z_qubits_;
+        parity_words.assign(logicals.size(), 0);
+        for (size_t l = 0; l < logicals.size(); l++) {
+            for (auto e : logicals[l]) {
+                parity_words[l] ^= error_words[e];
+            }
+        }
+    }
+
     /**
      * @brief Measures the syndrome of the stabilizer code in the specified
      * channel.
@@ -162,5 +371,104 @@ class StabilizerCode {
 
         return syndrome;
     }
+
+    /**
+     * @brief Measures the syndrome of a sparse error in O(#errors) into a
+     * reusable packed buffer (see PackedBits.hpp).
+     *
+     * Every flipped edge toggles its two end points, skipping boundary
+     * vertices. Apart from clearing the buffer, one word per 64 vertices,
+     * nothing depends on the size of the graph.
+     *
+     * @param flipped_edges The flipped edges; an edge listed twice cancels.
+     * @param stab The stabilizer type whose decoding graph the edges are in.
+     * @param syndrome Receives one bit per vertex.
+     */
+    void MeasureSyndrome(std::span<const size_t> flipped_edges,
+                         const Stabilizer &stab,
+                         std::vector<uint64_t> &syndrome) const {
+        const auto &decoding_graph = stab == Stabilizer::X
+                                         ? x_stabilizer_decoding_graph_
+                                         : z_stabilizer_decoding_graph_;
+        syndrome.assign(GetNumPackedWords(decoding_graph.GetNumVertices()), 0);
+        for (auto e : flipped_edges) {
+            const auto &[u, v] = decoding_graph.GetVerticesConnectedByEdge(e);
+            if (!decoding_graph.IsVertexOnBoundary(u)) {
+                FlipPackedBit(syndrome, u);
+            }
+            if (!decoding_graph.IsVertexOnBoundary(v)) {
+                FlipPackedBit(syndrome, v);
+            }
+        }
+    }
+
+    /**
+     * @brief Measures the syndrome of a sparse error into a reusable
+     * std::vector<bool>, as taken by the decoders.
+     */
+    void MeasureSyndrome(std::span<const size_t> flipped_edges,
+                         const Stabilizer &stab,
+                         std::vector<bool> &syndrome) const {
+        const auto &decoding_graph = stab == Stabilizer::X
+                                         ? x_stabilizer_decoding_graph_
+                                         : z_stabilizer_decoding_graph_;
+        syndrome.assign(decoding_graph.GetNumVertices(), false);
+        ToggleSyndrome(flipped_edges, stab, syndrome);
+    }
+
+    /**
+     * @brief Adds the syndrome of more flipped edges to a syndrome, e.g. to
+     * build the syndromes of nested errors incrementally.
+     */
+    void ToggleSyndrome(std::span<const size_t> flipped_edges,
+                        const Stabilizer &stab,
+                        std::vector<bool> &syndrome) const {
+        const auto &decoding_graph = stab == Stabilizer::X
+                                         ? x_stabilizer_decoding_graph_
+                                         : z_stabilizer_decoding_graph_;
+        for (auto e : flipped_edges) {
+            const auto &[u, v] = decoding_graph.GetVerticesConnectedByEdge(e);
+            if (!decoding_graph.IsVertexOnBoundary(u)) {
+                syndrome[u].flip();
+            }
+            if (!decoding_graph.IsVertexOnBoundary(v)) {
+                syndrome[v].flip();
+            }
+        }
+    }
+
+    /**
+     * @brief Measures the syndromes of 64 shots at once.
+     *
+     * Every edge XORs its word into its two end points, so a single pass
+     * over the edges measures 64 shots.
+     *
+     * @param error_words One word per edge, with bit k set if the edge is
+     * flipped in shot k.
+     * @param stab The stabilizer type whose decoding graph the edges are in.
+     * @param syndrome_words Receives one word per vertex, with bit k set if
+     * the vertex is a defect in shot k. Boundary vertices stay zero.
+     */
+    void MeasureBitSlicedSyndrome(std::span<const uint64_t> error_words,
+                                  const Stabilizer &stab,
+                                  std::vector<uint64_t> &syndrome_words) const {
+        const auto &decoding_graph = stab == Stabilizer::X
+                                         ? x_stabilizer_decoding_graph_
+                                         : z_stabilizer_decoding_graph_;
+        syndrome_words.assign(decoding_graph.GetNumVertices(), 0);
+        for (size_t e = 0; e < error_words.size(); e++) {
+            if (error_words[e] == 0) {
+                continue;
+            }
+            const auto &[u, v] = decoding_graph.GetVerticesConnectedByEdge(e);
+            syndrome_words[u] ^= error_words[e];
+            syndrome_words[v] ^= error_words[e];
+        }
+        for (size_t v = 0; v < syndrome_words.size(); v++) {
+            if (decoding_graph.IsVertexOnBoundary(v)) {
+                syndrome_words[v] = 0;
+            }
+        }
+    }
 };
 }; // namespace Plaquette
@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "MonteCarlo.hpp"
+
+namespace Plaquette {
+namespace Simulation {
+
+/**
+ * @brief A finite-size scaling fit of logical error rates near threshold.
+ *
+ * The rates of all distances d are fitted to the ansatz
+ * P_L = A + B x + C x^2 with x = (p - p_th) d^(1 / nu), which makes the
+ * curves of different distances cross at p_th. Errors are the standard
+ * errors of the weighted least-squares fit, scaled up by the reduced
+ * chi-squared when the ansatz does not describe the data to within the
+ * statistical errors.
+ */
+struct ThresholdFit {
+    bool converged = false;
+    double threshold = 0.0;
+    double threshold_error = 0.0;
+    double nu = 0.0;
+    double nu_error = 0.0;
+    std::array<double, 3> coefficients = {0.0, 0.0, 0.0}; ///< A, B and C.
+    double chi_squared = 0.0;
+    size_t degrees_of_freedom = 0;
+};
+
+/**
+ * @brief Returns the p at which the logical error rate of distance
+ * large_distance overtakes that of small_distance, or a negative value if the
+ * sampled curves do not cross.
+ *
+ * The difference of the two rates is interpolated linearly between the
+ * neighbouring p at which both distances were sampled.
+ */
+inline double FindCrossing(const std::vector<MonteCarloResult> &results,
+                           size_t small_distance, size_t large_distance) {
+    std::map<double, std::pair<double, double>> rates;
+    std::map<double, int> found;
+    for (const auto &result : results) {
+        if (result.distance == small_distance) {
+            rates[result.p].first = result.GetLogicalErrorRate();
+            found[result.p] |= 1;
+        } else if (result.distance == large_distance) {
+            rates[result.p].second = result.GetLogicalErrorRate();
+            found[result.p] |= 2;
+        }
+    }
+    double previous_p = -1.0;
+    double previous_difference = 0.0;
+    for (const auto &[p, rate] : rates) {
+        if (found[p] != 3) {
+            continue;
+        }
+        double difference = rate.second - rate.first;
+        if (previous_p >= 0.0 && previous_difference < 0.0 &&
+            difference >= 0.0) {
+            return previous_p + (p - previous_p) * -previous_difference /
+                                    (difference - previous_difference);
+        }
+        previous_p = p;
+        previous_difference = difference;
+    }
+    return -1.0;
+}
+
+/**
+ * @brief Solves the linear system matrix * x = rhs in place by Gaussian
+ * elimination with partial pivoting. Returns false if it is singular.
+ */
+template <size_t N>
+bool SolveLinearSystem(std::array<std::array<double, N>, N> matrix,
+                       std::array<double, N> &rhs) {
+    for (size_t col = 0; col < N; col++) {
+        size_t pivot = col;
+        for (size_t row = col + 1; row < N; row++) {
+            if (std::abs(matrix[row][col]) > std::abs(matrix[pivot][col])) {
+                pivot = row;
+            }
+        }
+        if (!(std::abs(matrix[pivot][col]) > 0.0)) {
+            return false;
+        }
+        std::swap(matrix[col], matrix[pivot]);
+        std::swap(rhs[col], rhs[pivot]);
+        for (size_t row = col + 1; row < N; row++) {
+            double factor = matrix[row][col] / matrix[col][col];
+            for (size_t k = col; k < N; k++) {
+                matrix[row][k] -= factor * matrix[col][k];
+            }
+            rhs[row] -= factor * rhs[col];
+        }
+    }
+    for (size_t col = N; col-- > 0;) {
+        for (size_t k = col + 1; k < N; k++) {
+            rhs[col] -= matrix[col][k] * rhs[k];
+        }
+        rhs[col] /= matrix[col][col];
+    }
+    return true;
+}
+
+/**
+ * @brief Fits the threshold of logical error rates of several distances, see
+ * ThresholdFit.
+ *
+ * Points without failures or without successes carry no error estimate and
+ * are left out. The fit starts at the crossing of the smallest and largest
+ * distance, or at initial_threshold if they do not cross, and is refined with
+ * Levenberg-Marquardt steps.
+ *
+ * @param results The rates, of at least two distances.
+ * @param initial_threshold The starting point if the curves do not cross.
+ */
+inline ThresholdFit FitThreshold(const std::vector<MonteCarloResult> &results,
+                                 double initial_threshold = -1.0) {
+    constexpr size_t kNumParameters = 5;
+    using Vector = std::array<double, kNumParameters>;
+    using Matrix = std::array<Vector, kNumParameters>;
+
+    struct Point {
+        double p;
+        double log_distance;
+        double rate;
+        double weight;
+    };
+    std::vector<Point> points;
+    size_t min_distance = std::numeric_limits<size_t>::max();
+    size_t max_distance = 0;
+    for (const auto &result : results) {
+        if (result.num_failures == 0 ||
+            result.num_failures == result.num_shots) {
+            continue;
+        }
+        double rate = result.GetLogicalErrorRate();
+        double variance = rate * (1.0 - rate) / result.num_shots;
+        double log_distance = std::log(static_cast<double>(result.distance));
+        points.push_back({result.p, log_distance, rate, 1.0 / variance});
+        min_distance = std::min(min_distance, result.distance);
+        max_distance = std::max(max_distance, result.distance);
+    }
+    ThresholdFit fit;
+    if (points.size() <= kNumParameters || min_distance == max_distance) {
+        return fit;
+    }
+
+    // Parameters: p_th, nu, A, B, C.
+    double crossing = FindCrossing(results, min_distance, max_distance);
+    if (crossing < 0.0) {
+        crossing = initial_threshold;
+    }
+    if (crossing < 0.0) {
+        double sum = 0.0;
+        for (const auto &point : points) {
+            sum += point.p;
+        }
+        crossing = sum / points.size();
+    }
+    Vector parameters = {crossing, 1.5, 0.0, 0.0, 0.0};
+
+    // Returns the ansatz at a point and writes its gradient.
+    auto evaluate = [](const Vector &parameters, const Point &point,
+                       Vector &gradient) {
+        double scale = std::exp(point.log_distance / parameters[1]);
+        double x = (point.p - parameters[0]) * scale;
+        double slope = parameters[3] + 2 * parameters[4] * x;
+        gradient = {-slope * scale,
+                    -slope * x * point.log_distance /
+                        (parameters[1] * parameters[1]),
+                    1.0, x, x * x};
+        return parameters[2] + parameters[3] * x + parameters[4] * x * x;
+    };
+    auto chi_squared = [&](const Vector &parameters) {
+        double sum = 0.0;
+        Vector gradient;
+        for (const auto &point : points) {
+            double residual =
+                point.rate - evaluate(parameters, point, gradient);
+            sum += point.weight * residual * residual;
+        }
+        return sum;
+    };
+    auto normal_equations = [&](const Vector &parameters, Matrix &matrix,
+                                Vector &rhs) {
+        matrix = {};
+        rhs = {};
+        Vector gradient;
+        for (const auto &point : points) {
+            double residual =
+                point.rate - evaluate(parameters, point, gradient);
+            for (size_t i = 0; i < kNumParameters; i++) {
+                rhs[i] += point.weight * gradient[i] * residual;
+                for (size_t j = 0; j < kNumParameters; j++) {
+                    matrix[i][j] += point.weight * gradient[i] * gradient[j];
+                }
+            }
+        }
+    };
+
+    // The coefficients are linear, so they are solved for exactly at the
+    // starting threshold before the joint fit.
+    {
+        Matrix matrix;
+        Vector rhs;
+        normal_equations(parameters, matrix, rhs);
+        std::array<std::array<double, 3>, 3> linear;
+        std::array<double, 3> linear_rhs;
+        for (size_t i = 0; i < 3; i++) {
+            linear_rhs[i] = rhs[i + 2];
+            for (size_t j = 0; j < 3; j++) {
+                linear[i][j] = matrix[i + 2][j + 2];
+            }
+        }
+        if (!SolveLinearSystem(linear, linear_rhs)) {
+            return fit;
+        }
+        for (size_t i = 0; i < 3; i++) {
+            parameters[i + 2] = linear_rhs[i];
+        }
+    }
+
+    double lambda = 1e-3;
+    double current = chi_squared(parameters);
+    for (int iteration = 0; iteration < 200; iteration++) {
+        Matrix matrix;
+        Vector step;
+        normal_equations(parameters, matrix, step);
+        for (size_t i = 0; i < kNumParameters; i++) {
+            matrix[i][i] *= 1.0 + lambda;
+        }
+        if (!SolveLinearSystem(matrix, step)) {
+            return fit;
+        }
+        Vector candidate = parameters;
+        for (size_t i = 0; i < kNumParameters; i++) {
+            candidate[i] += step[i];
+        }
+        double next = candidate[1] > 0.0 ? chi_squared(candidate) : INFINITY;
+        if (next <= current) {
+            bool done = current - next <= 1e-10 * current;
+            parameters = candidate;
+            current = next;
+            lambda = std::max(lambda / 10, 1e-12);
+            if (done) {
+                fit.converged = true;
+                break;
+            }
+        } else {
+            lambda *= 10;
+            if (lambda > 1e12) {
+                fit.converged = true;
+                break;
+            }
+        }
+    }
+
+    // Standard errors from the inverse of the normal matrix.
+    Matrix matrix;
+    Vector rhs;
+    normal_equations(parameters, matrix, rhs);
+    fit.degrees_of_freedom = points.size() - kNumParameters;
+    fit.chi_squared = current;
+    double scale =
+        std::max(1.0, current / static_cast<double>(fit.degrees_of_freedom));
+    std::array<double, 2> variances;
+    for (size_t i = 0; i < 2; i++) {
+        Vector unit = {};
+        unit[i] = 1.0;
+        if (!SolveLinearSystem(matrix, unit)) {
+            fit.converged = false;
+            return fit;
+        }
+        variances[i] = unit[i] * scale;
+    }
+    fit.threshold = parameters[0];
+    fit.nu = parameters[1];
+    fit.threshold_error = std::sqrt(std::max(0.0, variances[0]));
+    fit.nu_error = std::sqrt(std::max(0.0, variances[1]));
+    fit.coefficients = {parameters[2], parameters[3], parameters[4]};
+    return fit;
+}
+
+/**
+ * @brief The settings of FindThreshold().
+ */
+struct ThresholdOptions {
+    std::vector<size_t> distances = {5, 7, 9};
+    size_t rounds = 1; ///< The rounds of every code; 0 means d rounds.
+    double min_p = 0.01; ///< The first window of bit-flip rates.
+    double max_p = 0.15;
+    size_t num_points = 6; ///< The new rates of every iteration.
+    size_t num_iterations = 3;
+    /// The shots of every point in each iteration. Points that stay in the
+    /// window are continued with the same rule in later iterations.
+    StoppingRule stopping_rule;
+    /// The seed, noise and threads. Points run in parallel, one per thread.
+    MonteCarloOptions monte_carlo;
+};
+
+/**
+ * @brief The sampled points and the final fit of FindThreshold().
+ */
+struct ThresholdResult {
+    std::vector<MonteCarloResult> points; ///< Ordered by distance and p.
+    ThresholdFit fit;
+    double min_p = 0.0; ///< The last window of bit-flip rates.
+    double max_p = 0.0;
+};
+
+/**
+ * @brief Locates the threshold of a code family by sampling near the
+ * crossing of the logical error rates of several distances.
+ *
+ * Every iteration samples num_points evenly spaced rates of the current
+ * window for all distances with RunMonteCarloAdaptive(), and continues the
+ * points of earlier iterations that lie in the window, so shots accumulate
+ * where the curves cross. The rates are fitted with FitThreshold() and the
+ * window is halved around the estimate, but kept at least four standard
+ * errors wide. The points of an iteration run in parallel, one per thread,
+ * and since the noise of every shot depends only on the seed and its index,
+ * the result does not depend on the number of threads.
+ *
+ * @param code The code family: "planar", "rotated" or "toric".
+ */
+inline ThresholdResult FindThreshold(const std::string &code,
+                                     const ThresholdOptions &options) {
+    if (options.distances.size() < 2) {
+        throw std::invalid_argument("A threshold needs at least two distances");
+    }
+    if (!(0.0 < options.min_p && options.min_p < options.max_p &&
+          options.max_p < 1.0)) {
+        throw std::invalid_argument(
+            "The rates must satisfy 0 < min_p < max_p < 1");
+    }
+    if (options.num_points < 2) {
+        throw std::invalid_argument("At least two rates per iteration");
+    }
+
+    // Continued points start where they stopped, at a multiple of 64 shots
+    // when bit-sliced.
+    StoppingRule rule = options.stopping_rule;
+    if (options.monte_carlo.bit_sliced) {
+        rule.max_shots = (rule.max_shots + 63) / 64 * 64;
+    }
+
+    ThresholdResult result;
+    result.min_p = options.min_p;
+    result.max_p = options.max_p;
+    std::map<std::pair<size_t, double>, MonteCarloResult> points;
+    for (size_t iteration = 0; iteration < options.num_iterations;
+         iteration++) {
+        // The points to sample: new rates and those already in the window.
+        std::vector<std::pair<size_t, double>> keys;
+        for (size_t i = 0; i < options.num_points; i++) {
+            double p = result.min_p + (result.max_p - result.min_p) * i /
+                                          (options.num_points - 1);
+            for (auto distance : options.distances) {
+                if (points.count({distance, p}) == 0) {
+                    keys.emplace_back(distance, p);
+                }
+            }
+        }
+        for (const auto &[key, point] : points) {
+            if (key.second >= result.min_p && key.second <= result.max_p) {
+                keys.push_back(key);
+            }
+        }
+
+        size_t num_threads = options.monte_carlo.num_threads;
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        num_threads = std::max<size_t>(1, std::min(num_threads, keys.size()));
+        std::vector<MonteCarloResult> batches(keys.size());
+        std::atomic<size_t> next_key = 0;
+        auto worker = [&]() {
+            MonteCarloOptions monte_carlo = options.monte_carlo;
+            monte_carlo.num_threads = 1;
+            for (size_t k = next_key++; k < keys.size(); k = next_key++) {
+                auto [distance, p] = keys[k];
+                auto found = points.find(keys[k]);
+                monte_carlo.first_shot =
+                    found == points.end() ? 0 : found->second.num_shots;
+                size_t rounds = options.rounds == 0 ? distance : options.rounds;
+                batches[k] = RunMonteCarloAdaptive(code, distance, rounds, p,
+                                                   monte_carlo, rule);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < num_threads; t++) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : workers) {
+            thread.join();
+        }
+
+        // Continued points extend the shots of earlier iterations.
+        for (size_t k = 0; k < keys.size(); k++) {
+            auto found = points.find(keys[k]);
+            if (found == points.end()) {
+                points[keys[k]] = batches[k];
+                continue;
+            }
+            auto &point = found->second;
+            point.num_shots += batches[k].num_shots;
+            point.num_failures += batches[k].num_failures;
+            point.seconds += batches[k].seconds;
+            point.stop_reason = batches[k].stop_reason;
+        }
+
+        // The ansatz only holds close to the threshold, so only the points
+        // of the window are fitted.
+        result.points.clear();
+        std::vector<MonteCarloResult> window;
+        for (const auto &[key, point] : points) {
+            result.points.push_back(point);
+            if (key.second >= result.min_p && key.second <= result.max_p) {
+                window.push_back(point);
+            }
+        }
+        double center = 0.5 * (result.min_p + result.max_p);
+        result.fit = FitThreshold(window, center);
+        if (iteration + 1 == options.num_iterations) {
+            break;
+        }
+        if (result.fit.converged && result.fit.threshold > result.min_p &&
+            result.fit.threshold < result.max_p) {
+            center = result.fit.threshold;
+        }
+        double half_width = std::max(0.25 * (result.max_p - result.min_p),
+                                     2.0 * result.fit.threshold_error);
+        result.min_p = std::max(options.min_p, center - half_width);
+        result.max_p = std::min(options.max_p, center + half_width);
+    }
+    return result;
+}
+
+}; // namespace Simulation
+}; // namespace Plaquette
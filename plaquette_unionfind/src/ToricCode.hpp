@@ -1,8 +1,7 @@
 #pragma once
 
 #include <iostream>
-#include <unordered_map>
-#include <unordered_set>
+#include <stdexcept>
 #include <vector>
 
 #include "DecodingGraph.hpp"
@@ -19,22 +18,29 @@ namespace Plaquette {
  * additional methods specific to the toric code, such as coordinate
  * transformations, lattice building, and visualization methods.
  *
+ * The code lives on a periodic 2L x 2L grid scanned from the top row down:
+ * data qubits sit where x + y is odd, X stabilizers at even x and y, and Z
+ * stabilizers at odd x and y. Qubits and stabilizers are numbered in scan
+ * order, so every id follows from its coordinate and the graphs are built in
+ * linear time without lookups. With n_rounds > 1 both decoding graphs become
+ * phenomenological space-time graphs, see
+ * StabilizerCode::BuildSpaceTimeGraph_().
  */
 class ToricCode : public StabilizerCode {
 
   private:
     size_t lattice_size_; ///< The size of the lattice.
-    std::unordered_map<int, size_t>
-        linearized_qubit_coord_to_edge_id_; ///< A map from linearized qubit
-                                            ///< coordinates to edge IDs.
-    std::unordered_map<int, size_t>
-        linearized_x_stab_coord_to_vertex_id_; ///< A map from linearized
-                                               ///< X-stabilizer coordinates to
-                                               ///< vertex IDs.
-    std::unordered_map<int, size_t>
-        linearized_z_stab_coord_to_vertex_id_; ///< A map from linearized
-                                               ///< Z-stabilizer coordinates to
-                                               ///< vertex IDs.
+    size_t num_rounds_;   ///< The number of measurement rounds.
+
+    /**
+     * @brief Returns the vertex id of the stabilizer at grid coordinate
+     * (x, y), wrapped around the torus. X and Z stabilizers are both numbered
+     * row by row in scan order.
+     */
+    size_t StabilizerIndex_(int x, int y) {
+        size_t row = 2 * lattice_size_ - 1 - ModuloCoord(y);
+        return (row / 2) * lattice_size_ + ModuloCoord(x) / 2;
+    }
 
   public:
     /**
@@ -84,116 +90,99 @@ class ToricCode : public StabilizerCode {
      *
      * @return The number of qubits in the code.
      */
-    size_t GetNumOfQubits() {
-        return linearized_qubit_coord_to_edge_id_.size();
-    }
+    size_t GetNumOfQubits() const { return qubit_coords_.size(); }
+
+    /**
+     * @brief Get the number of measurement rounds.
+     */
+    size_t GetNumRounds() const { return num_rounds_; }
+
+    /**
+     * @brief Get the code distance, which is the lattice size.
+     */
+    size_t GetCodeDistance() const { return lattice_size_; }
 
     /**
      * @brief Construct a toric code of a given size.
      *
      * @param lattice_size The size of the toric lattice.
+     * @param num_rounds The number of stabilizer measurement rounds.
      */
-    ToricCode(size_t lattice_size) {
-        lattice_size_ = lattice_size;
-        size_t num_vertices = lattice_size * lattice_size;
-        std::vector<bool> vertex_boundary_type(num_vertices, 0);
+    ToricCode(size_t lattice_size, size_t num_rounds = 1)
+        : lattice_size_(lattice_size), num_rounds_(num_rounds) {
+        if (num_rounds < 1) {
+            throw std::invalid_argument("ToricCode requires num_rounds >= 1");
+        }
+        size_t num_stabilizers = lattice_size * lattice_size;
+        size_t num_qubits = 2 * num_stabilizers;
+        int width = 2 * lattice_size;
+
+        qubit_coords_.reserve(num_qubits);
+        x_stabilizer_coords_.reserve(num_stabilizers);
+        z_stabilizer_coords_.reserve(num_stabilizers);
+        std::vector<std::pair<size_t, size_t>> x_dgraph_edges;
+        std::vector<std::pair<size_t, size_t>> z_dgraph_edges;
+        x_dgraph_edges.reserve(num_qubits);
+        z_dgraph_edges.reserve(num_qubits);
 
         // Build lattice
-        for (int y = 2 * lattice_size - 1; y >= 0; y--) {
-            for (int x = 0; x < 2 * lattice_size; x++) {
-                auto coord = std::make_pair(x, y);
-                auto linear_coord = LinearizeCoord(coord);
-                if (x % 2 == 0) {
-                    if (y % 2 == 0) {
-                        // X stabilizer
-                        x_stabilizer_coords_.push_back(std::make_pair(x, y));
-                        linearized_x_stab_coord_to_vertex_id_[linear_coord] =
-                            x_stabilizer_coords_.size() - 1;
-                    } else {
-                        // qubit
-                        qubit_coords_.push_back(std::make_pair(x, y));
-                        linearized_qubit_coord_to_edge_id_[linear_coord] =
-                            qubit_coords_.size() - 1;
-                    }
+        for (int y = width - 1; y >= 0; y--) {
+            for (int x = 0; x < width; x++) {
+                if (x % 2 == 0 && y % 2 == 0) {
+                    x_stabilizer_coords_.emplace_back(x, y);
+                } else if (x % 2 == 1 && y % 2 == 1) {
+                    z_stabilizer_coords_.emplace_back(x, y);
+                } else if (x % 2 == 0) {
+                    // Qubit on a horizontal Z edge and a vertical X edge.
+                    qubit_coords_.emplace_back(x, y);
+                    x_dgraph_edges.emplace_back(StabilizerIndex_(x, y + 1),
+                                                StabilizerIndex_(x, y - 1));
+                    z_dgraph_edges.emplace_back(StabilizerIndex_(x - 1, y),
+                                                StabilizerIndex_(x + 1, y));
                 } else {
-                    if (y % 2 == 0) {
-                        // qubit
-                        qubit_coords_.push_back(std::make_pair(x, y));
-                        linearized_qubit_coord_to_edge_id_[linear_coord] =
-                            qubit_coords_.size() - 1;
-                    } else {
-                        // Z stabilizer
-                        z_stabilizer_coords_.push_back(std::make_pair(x, y));
-                        linearized_z_stab_coord_to_vertex_id_[linear_coord] =
-                            z_stabilizer_coords_.size() - 1;
-                    }
+                    // Qubit on a horizontal X edge and a vertical Z edge.
+                    qubit_coords_.emplace_back(x, y);
+                    x_dgraph_edges.emplace_back(StabilizerIndex_(x - 1, y),
+                                                StabilizerIndex_(x + 1, y));
+                    z_dgraph_edges.emplace_back(StabilizerIndex_(x, y + 1),
+                                                StabilizerIndex_(x, y - 1));
                 }
             }
         }
 
-        std::vector<std::pair<size_t, size_t>> x_dgraph_edges(
-            qubit_coords_.size());
-        std::vector<std::pair<size_t, size_t>> z_dgraph_edges(
-            qubit_coords_.size());
-
-        for (int i = 0; i < qubit_coords_.size(); i++) {
-            auto qub = qubit_coords_[i];
-            std::vector<std::pair<int, int>> dx = {
-                {-1, 0}, {1, 0}, {0, 1}, {0, -1}};
-            std::vector<size_t> x_vertices;
-            std::vector<size_t> z_vertices;
-
-            for (size_t j = 0; j < dx.size(); j++) {
-                std::pair<int, int> stab_coord;
-                stab_coord.first = qub.first + dx[j].first;
-                stab_coord.second = qub.second + dx[j].second;
-
-                if (linearized_x_stab_coord_to_vertex_id_.contains(
-                        LinearizeCoord(stab_coord))) {
-                    x_vertices.push_back(
-                        linearized_x_stab_coord_to_vertex_id_[LinearizeCoord(
-                            stab_coord)]);
-                }
-                if (linearized_z_stab_coord_to_vertex_id_.contains(
-                        LinearizeCoord(stab_coord))) {
-                    z_vertices.push_back(
-                        linearized_z_stab_coord_to_vertex_id_[LinearizeCoord(
-                            stab_coord)]);
-                }
-            }
-            if (x_vertices.size()) {
-                assert(x_vertices.size() == 2);
-                x_dgraph_edges[i] =
-                    std::make_pair(x_vertices[0], x_vertices[1]);
-            }
-            if (z_vertices.size()) {
-                assert(z_vertices.size() == 2);
-                z_dgraph_edges[i] =
-                    std::make_pair(z_vertices[0], z_vertices[1]);
-            }
-        }
-
-        x_stabilizer_decoding_graph_ =
-            DecodingGraph(num_vertices, x_dgraph_edges, vertex_boundary_type);
-        z_stabilizer_decoding_graph_ =
-            DecodingGraph(num_vertices, z_dgraph_edges, vertex_boundary_type);
+        x_stabilizer_decoding_graph_ = BuildSpaceTimeGraph_(
+            x_dgraph_edges, num_stabilizers, num_stabilizers, num_rounds);
+        z_stabilizer_decoding_graph_ = BuildSpaceTimeGraph_(
+            z_dgraph_edges, num_stabilizers, num_stabilizers, num_rounds);
 
-        logical_x_qubits_.resize(2, std::vector<size_t>(lattice_size));
+        std::vector<std::vector<size_t>> logical_x_qubits(
+            2, std::vector<size_t>(lattice_size));
         for (size_t i = 0; i < lattice_size; i++) {
-            logical_x_qubits_[0][i] =
+            logical_x_qubits[0][i] =
                 2 * lattice_size * lattice_size - 1 - i - lattice_size;
         }
         for (size_t i = 0; i < lattice_size; i++) {
-            logical_x_qubits_[1][i] = 2 * i * lattice_size + lattice_size;
+            logical_x_qubits[1][i] = 2 * i * lattice_size + lattice_size;
         }
 
-        logical_z_qubits_.resize(2, std::vector<size_t>(lattice_size));
+        std::vector<std::vector<size_t>> logical_z_qubits(
+            2, std::vector<size_t>(lattice_size));
         for (size_t i = 0; i < lattice_size; i++) {
-            logical_z_qubits_[0][i] = 2 * lattice_size * lattice_size - 1 - i;
+            logical_z_qubits[0][i] = 2 * lattice_size * lattice_size - 1 - i;
         }
         for (size_t i = 0; i < lattice_size; i++) {
-            logical_z_qubits_[1][i] = 2 * i * lattice_size;
+            logical_z_qubits[1][i] = 2 * i * lattice_size;
+        }
+
+        for (const auto &logical : logical_x_qubits) {
+            logical_x_qubits_.push_back(
+                RepeatLogical_(logical, num_qubits, num_rounds));
+        }
+        for (const auto &logical : logical_z_qubits) {
+            logical_z_qubits_.push_back(
+                RepeatLogical_(logical, num_qubits, num_rounds));
         }
+        IndexLogicals_();
     }
 
     void FixEdgeCoordsForVisual(std::pair<float, float> &vertex_0,
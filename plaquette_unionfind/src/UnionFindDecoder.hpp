@@ -1,9 +1,17 @@
 #pragma once
 
 #include "Clusters.hpp"
+#include "DecoderStatistics.hpp"
+#include "DecoderTrace.hpp"
 #include "DecodingGraph.hpp"
+#include "GraphConcepts.hpp"
 #include "PeelingDecoder.hpp"
 
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+
 namespace Plaquette {
 namespace Decoders {
 
@@ -15,12 +23,42 @@ namespace Decoders {
  * correct errors in the code. The decoder can handle both erasure and
  * weight-1 errors, and supports the use of weights and max-growth parameters
  * to control the cluster growth.
+ *
+ * All scratch memory is owned by the decoder and reused, so once a decoder
+ * has seen a few shots, decoding into a caller-provided buffer with
+ * Decode(syndrome, correction) does not allocate.
+ *
+ * The decoder is templated on the graph type. UnionFindDecoder decodes a
+ * DecodingGraph stored in memory; BasicUnionFindDecoder<LatticeGraph> decodes
+ * toric and planar lattices whose neighbours are computed on the fly.
+ *
+ * @tparam Graph A type satisfying DecodingGraphLike.
  */
-class UnionFindDecoder {
+template <DecodingGraphLike Graph> class BasicUnionFindDecoder {
 
   private:
-    Clusters cluster_set_;         /**< The union-find cluster set. */
-    DecodingGraph decoding_graph_; /**< The decoding graph. */
+    BasicClusters<Graph> cluster_set_; /**< The union-find cluster set. */
+    Graph decoding_graph_;             /**< The decoding graph. */
+
+    std::vector<size_t> new_roots_; /**< Roots touched by an iteration. */
+    std::pmr::vector<bool> is_new_root_; /**< Flags of new_roots_. */
+    SpanningForestWorkspace forest_workspace_; /**< Peeling scratch. */
+
+    using Stage = DecoderStatistics::Stage;
+
+    void CheckCorrectionSize_(size_t size) const {
+        if (size != decoding_graph_.GetNumEdges()) {
+            throw std::invalid_argument(
+                "The correction must have one element per edge");
+        }
+    }
+
+    void AddNewRoot_(size_t root) {
+        if (!is_new_root_[root]) {
+            is_new_root_[root] = true;
+            new_roots_.push_back(root);
+        }
+    }
 
   public:
     /**
@@ -31,12 +69,23 @@ class UnionFindDecoder {
      * @param erasure The erasure pattern of the code.
      * @param weights (optional) The weights of the edges in the decoding graph.
      * @param max_growth (optional) The maximum growth factor for the clusters.
+     * @param memory_resource (optional) The memory resource of the
+     * per-vertex and per-edge arrays of the clusters, e.g. a HugePageArena.
+     * It must outlive the decoder.
      */
-    UnionFindDecoder(const DecodingGraph &decoding_graph,
-                     const std::vector<float> &edge_increments = {},
-                     float max_growth = 2.0)
-        : cluster_set_(decoding_graph, {}, {}, edge_increments, max_growth),
-          decoding_graph_(decoding_graph) {}
+    BasicUnionFindDecoder(const Graph &decoding_graph,
+                          const std::vector<float> &edge_increments = {},
+                          float max_growth = 2.0,
+                          std::pmr::memory_resource *memory_resource =
+                              std::pmr::get_default_resource())
+        : cluster_set_(decoding_graph, {}, {}, edge_increments, max_growth,
+                       memory_resource),
+          decoding_graph_(decoding_graph),
+          is_new_root_(decoding_graph.GetNumVertices(), false,
+                       memory_resource),
+          forest_workspace_(decoding_graph.GetNumVertices()) {
+        new_roots_.reserve(decoding_graph.GetNumVertices());
+    }
 
     /**
      * @brief Get the union-find cluster set.
@@ -55,6 +104,17 @@ class UnionFindDecoder {
         return cluster_set_.GetFullyGrownEdges();
     }
 
+    /**
+     * @brief Get the statistics collected since construction or the last call
+     * to ResetStatistics(). All counters stay zero unless the decoder was
+     * compiled with PLAQUETTE_UNIONFIND_ENABLE_STATISTICS.
+     */
+    const DecoderStatistics &GetStatistics() const {
+        return cluster_set_.GetStatistics();
+    }
+
+    void ResetStatistics() { cluster_set_.GetStatistics().Reset(); }
+
     /**
      * @brief Perform one iteration of syndrome validation for a given cluster.
      *
@@ -65,23 +125,41 @@ class UnionFindDecoder {
      * @param cluster_id The ID of the cluster to validate.
      */
     void SyndromeValidationIteration(size_t cluster_id) {
-        const auto &&edges_to_fuse = cluster_set_.GrowCluster(cluster_id);
-        std::unordered_set<size_t> new_roots = {cluster_id};
+        PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event(
+            "syndrome_validation_iteration", cluster_id);)
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            auto &statistics = cluster_set_.GetStatistics();
+            uint64_t start = ReadCycleCounter();)
+        const auto &edges_to_fuse = cluster_set_.GrowCluster(cluster_id);
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            statistics.AddStageCycles(Stage::GrowCluster, start);)
+        new_roots_.clear();
+        AddNewRoot_(cluster_id);
         for (const auto &edge_id : edges_to_fuse) {
-            auto &vertices =
+            const auto &vertices =
                 decoding_graph_.GetVerticesConnectedByEdge(edge_id);
-            auto &u = vertices.first;
-            auto &v = vertices.second;
+            const auto &u = vertices.first;
+            const auto &v = vertices.second;
+            PLAQUETTE_UNIONFIND_STATISTICS(start = ReadCycleCounter();)
             auto &&u_root = cluster_set_.FindClusterRoot(u);
             auto &&v_root = cluster_set_.FindClusterRoot(v);
+            PLAQUETTE_UNIONFIND_STATISTICS(
+                statistics.AddStageCycles(Stage::FindClusterRoot, start);)
             if (u_root != v_root) {
-                new_roots.insert(cluster_set_.MergeClusters(u_root, v_root));
+                PLAQUETTE_UNIONFIND_STATISTICS(start = ReadCycleCounter();)
+                AddNewRoot_(cluster_set_.MergeClusters(u_root, v_root));
+                PLAQUETTE_UNIONFIND_STATISTICS(
+                    statistics.AddStageCycles(Stage::MergeClusters, start);)
             }
         }
-        for (const auto &root : new_roots) {
+        PLAQUETTE_UNIONFIND_STATISTICS(start = ReadCycleCounter();)
+        for (auto root : new_roots_) {
             cluster_set_.CheckBoundaryVertices(root);
             cluster_set_.AddToGrowQueue(root);
+            is_new_root_[root] = false;
         }
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            statistics.AddStageCycles(Stage::CheckBoundaryVertices, start);)
     }
 
     /**
@@ -98,34 +176,140 @@ class UnionFindDecoder {
         }
     }
 
+    /**
+     * @brief Clears the clusters of the previous decoding round. This is
+     * called automatically when a new syndrome is set, so a single decoder
+     * can be reused for many shots.
+     */
+    inline void Reset() {
+        if (cluster_set_.IsDirty()) {
+            cluster_set_.Reset();
+        }
+    }
+
     inline void SetSyndromeAndErasure(const std::vector<bool> &syndrome,
                                       const std::vector<bool> &erasure) {
+        Reset();
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            auto &statistics = cluster_set_.GetStatistics();
+            uint64_t start = ReadCycleCounter();)
         cluster_set_.InitEdgesRecursive_(erasure, syndrome);
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            statistics.AddStageCycles(Stage::InitErasure, start);
+            start = ReadCycleCounter();)
         cluster_set_.InitClusterRoots_(syndrome);
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            statistics.AddStageCycles(Stage::InitClusterRoots, start);)
     }
 
     inline void SetSyndrome(const std::vector<bool> &syndrome) {
+        Reset();
+        PLAQUETTE_UNIONFIND_STATISTICS(uint64_t start = ReadCycleCounter();)
         cluster_set_.InitClusterRoots_(syndrome);
+        PLAQUETTE_UNIONFIND_STATISTICS(
+            cluster_set_.GetStatistics().AddStageCycles(Stage::InitClusterRoots,
+                                                        start);)
+    }
+
+    /**
+     * @brief Peels the grown clusters into a correction. This is the last
+     * step of Decode(), after SetSyndrome() and SyndromeValidation().
+     *
+     * @param syndrome The syndrome of the code, which is consumed.
+     * @param correction Receives one flag per edge. Anything indexable by
+     * edge id with elements assignable from bool can be used, and it is
+     * cleared first.
+     */
+    template <typename Correction>
+    void Peel(std::vector<bool> &syndrome, Correction &&correction) {
+        PeelingDecoder peeling_decoder;
+        std::fill(correction.begin(), correction.end(), false);
+
+        PLAQUETTE_UNIONFIND_STATISTICS(uint64_t start = ReadCycleCounter();)
+        PLAQUETTE_UNIONFIND_TRACE(auto &recorder = TraceRecorder::Get();
+                                  uint64_t trace_start = recorder.Now();)
+        if (cluster_set_.GetFixedDegree() != 0) {
+            GetSpanningForestCacheFriendlySeeded(
+                decoding_graph_, cluster_set_.GetPaddedAdjacency(),
+                cluster_set_.GetFullyGrownEdges(),
+                cluster_set_.GetPhysicalBoundaryVertices(),
+                cluster_set_.GetNumPhysicalBoundaryVertices(),
+                forest_workspace_);
+        } else {
+            GetSpanningForestCacheFriendlySeeded(
+                decoding_graph_, cluster_set_.GetFullyGrownEdges(),
+                cluster_set_.GetPhysicalBoundaryVertices(),
+                cluster_set_.GetNumPhysicalBoundaryVertices(),
+                forest_workspace_);
+        }
+        PLAQUETTE_UNIONFIND_STATISTICS({
+            auto &statistics = cluster_set_.GetStatistics();
+            statistics.AddStageCycles(Stage::SpanningForest, start);
+            start = ReadCycleCounter();
+        })
+        PLAQUETTE_UNIONFIND_TRACE(
+            recorder.Record("spanning_forest", trace_start);
+            trace_start = recorder.Now();)
+        peeling_decoder.PeelForestInto(
+            decoding_graph_, syndrome, forest_workspace_.spanning_forest,
+            forest_workspace_.vertex_count, correction);
+        PLAQUETTE_UNIONFIND_TRACE(recorder.Record("peel_forest", trace_start);)
+        PLAQUETTE_UNIONFIND_STATISTICS({
+            auto &statistics = cluster_set_.GetStatistics();
+            statistics.AddStageCycles(Stage::PeelForest, start);
+            statistics.num_shots++;
+            cluster_set_.RecordClusterSizes();
+        })
+    }
+
+    std::vector<bool> Peel(std::vector<bool> &syndrome) {
+        std::vector<bool> correction(decoding_graph_.GetNumEdges(), false);
+        Peel(syndrome, correction);
+        return correction;
     }
 
     std::vector<bool> Decode(std::vector<bool> &syndrome) {
+        PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event("decode");)
         SetSyndrome(syndrome);
         SyndromeValidation();
-        return PeelingDecoder().Decode(
-            decoding_graph_, syndrome, cluster_set_.GetFullyGrownEdges(),
-            cluster_set_.GetPhysicalBoundaryVertices(),
-            cluster_set_.GetNumPhysicalBoundaryVertices());
+        return Peel(syndrome);
     }
 
     std::vector<bool> Decode(std::vector<bool> &syndrome,
                              const std::vector<bool> &erasure) {
+        PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event("decode");)
+        SetSyndromeAndErasure(syndrome, erasure);
+        SyndromeValidation();
+        return Peel(syndrome);
+    }
+
+    /**
+     * @brief Decodes a syndrome into a caller-provided correction with one
+     * byte (0 or 1) per edge. Apart from the first few shots, which size the
+     * internal buffers, this does not allocate.
+     *
+     * @param syndrome The syndrome of the code, which is consumed.
+     * @param correction The output, with one element per edge.
+     */
+    void Decode(std::vector<bool> &syndrome, std::span<uint8_t> correction) {
+        PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event("decode");)
+        CheckCorrectionSize_(correction.size());
+        SetSyndrome(syndrome);
+        SyndromeValidation();
+        Peel(syndrome, correction);
+    }
+
+    void Decode(std::vector<bool> &syndrome, const std::vector<bool> &erasure,
+                std::span<uint8_t> correction) {
+        PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event("decode");)
+        CheckCorrectionSize_(correction.size());
         SetSyndromeAndErasure(syndrome, erasure);
         SyndromeValidation();
-        return PeelingDecoder().Decode(
-            decoding_graph_, syndrome, cluster_set_.GetFullyGrownEdges(),
-            cluster_set_.GetPhysicalBoundaryVertices(),
-            cluster_set_.GetNumPhysicalBoundaryVertices());
+        Peel(syndrome, correction);
     }
 };
+
+using UnionFindDecoder = BasicUnionFindDecoder<DecodingGraph>;
+
 }; // namespace Decoders
 }; // namespace Plaquette
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 namespace Plaquette {
@@ -12,5 +15,43 @@ std::vector<bool> SetXor(std::vector<bool> a, std::vector<bool> b) {
     }
     return result;
 }
+
+/**
+ * @brief Converts independent edge error probabilities into growth increments
+ * for the union-find decoder.
+ *
+ * Every edge is given the log-likelihood weight log((1 - p) / p). The lightest
+ * edge grows by 1.0 per iteration and heavier edges grow proportionally
+ * slower, so uniform probabilities reproduce the unweighted decoder. Edges with
+ * p >= 0.5 carry no information and are grown in a single step.
+ *
+ * @param probabilities The error probability of each edge.
+ * @param max_growth The growth at which an edge is considered fully grown.
+ * @return The growth increment of each edge.
+ */
+inline std::vector<float>
+GetGrowthIncrementsFromProbabilities(const std::vector<double> &probabilities,
+                                     float max_growth = 2.0) {
+    std::vector<double> weights(probabilities.size(), 0.0);
+    double min_weight = 0.0;
+    for (size_t e = 0; e < probabilities.size(); e++) {
+        double p =
+            std::max(probabilities[e], std::numeric_limits<double>::min());
+        if (p < 0.5) {
+            weights[e] = std::log((1.0 - p) / p);
+            if (min_weight == 0.0 || weights[e] < min_weight) {
+                min_weight = weights[e];
+            }
+        }
+    }
+
+    std::vector<float> increments(probabilities.size(), max_growth);
+    for (size_t e = 0; e < probabilities.size(); e++) {
+        if (weights[e] > 0.0) {
+            increments[e] = static_cast<float>(min_weight / weights[e]);
+        }
+    }
+    return increments;
+}
 }; // namespace Utils
 }; // namespace Plaquette
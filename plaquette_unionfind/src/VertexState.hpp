@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <memory_resource>
+#include <vector>
+
+namespace Plaquette {
+
+/**
+ * @brief The per-vertex state of a cluster set, with one array per field.
+ *
+ * Vertex v stores the parent in the union-find forest; if v is a cluster
+ * root it also stores the parity and growth of that cluster. Physical
+ * boundary flags are kept per vertex.
+ */
+class VertexStateArrays {
+
+  private:
+    std::pmr::vector<int> cluster_ids_;
+    std::pmr::vector<int> parities_;
+    std::pmr::vector<float> growths_;
+    std::pmr::vector<bool> physical_boundary_;
+
+  public:
+    static constexpr const char *kLayoutName = "arrays";
+
+    VertexStateArrays(size_t num_vertices,
+                      std::pmr::memory_resource *memory_resource)
+        : cluster_ids_(num_vertices, -1, memory_resource),
+          parities_(num_vertices, 0, memory_resource),
+          growths_(num_vertices, 0.0, memory_resource),
+          physical_boundary_(num_vertices, false, memory_resource) {}
+
+    void Reset() {
+        std::fill(cluster_ids_.begin(), cluster_ids_.end(), -1);
+        std::fill(parities_.begin(), parities_.end(), 0);
+        std::fill(growths_.begin(), growths_.end(), 0.0);
+        std::fill(physical_boundary_.begin(), physical_boundary_.end(), false);
+    }
+
+    size_t size() const { return cluster_ids_.size(); }
+
+    int &ClusterId(size_t v) { return cluster_ids_[v]; }
+    int ClusterId(size_t v) const { return cluster_ids_[v]; }
+    int &Parity(size_t v) { return parities_[v]; }
+    float &Growth(size_t v) { return growths_[v]; }
+    float Growth(size_t v) const { return growths_[v]; }
+    bool IsPhysicalBoundary(size_t v) const { return physical_boundary_[v]; }
+    void SetPhysicalBoundary(size_t v) { physical_boundary_[v] = true; }
+
+    const auto &GetClusterIds() const { return cluster_ids_; }
+    const auto &GetParities() const { return parities_; }
+    const auto &GetGrowths() const { return growths_; }
+    const auto &GetPhysicalBoundary() const { return physical_boundary_; }
+};
+
+/**
+ * @brief The per-vertex state of a cluster set, packed into one 16-byte
+ * record per vertex.
+ *
+ * Growing and merging clusters reads and writes the parent, parity and
+ * growth of the same vertex together, which touches one cache line here
+ * instead of one per array.
+ */
+class PackedVertexState {
+
+  public:
+    struct alignas(16) Record {
+        int cluster_id = -1;
+        int parity = 0;
+        float growth = 0.0;
+        bool is_physical_boundary = false;
+    };
+    static_assert(sizeof(Record) == 16);
+
+    /**
+     * @brief A read-only view of one field of all records, indexable like
+     * the corresponding array of VertexStateArrays.
+     */
+    template <typename T, T Record::*Field> class FieldView {
+      public:
+        explicit FieldView(const std::pmr::vector<Record> &records)
+            : records_(&records) {}
+        T operator[](size_t v) const { return (*records_)[v].*Field; }
+        size_t size() const { return records_->size(); }
+
+      private:
+        const std::pmr::vector<Record> *records_;
+    };
+
+  private:
+    std::pmr::vector<Record> records_;
+
+  public:
+    static constexpr const char *kLayoutName = "packed";
+
+    PackedVertexState(size_t num_vertices,
+                      std::pmr::memory_resource *memory_resource)
+        : records_(num_vertices, Record{}, memory_resource) {}
+
+    void Reset() { std::fill(records_.begin(), records_.end(), Record{}); }
+
+    size_t size() const { return records_.size(); }
+
+    int &ClusterId(size_t v) { return records_[v].cluster_id; }
+    int ClusterId(size_t v) const { return records_[v].cluster_id; }
+    int &Parity(size_t v) { return records_[v].parity; }
+    float &Growth(size_t v) { return records_[v].growth; }
+    float Growth(size_t v) const { return records_[v].growth; }
+    bool IsPhysicalBoundary(size_t v) const {
+        return records_[v].is_physical_boundary;
+    }
+    void SetPhysicalBoundary(size_t v) {
+        records_[v].is_physical_boundary = true;
+    }
+
+    auto GetClusterIds() const {
+        return FieldView<int, &Record::cluster_id>(records_);
+    }
+    auto GetParities() const {
+        return FieldView<int, &Record::parity>(records_);
+    }
+    auto GetGrowths() const {
+        return FieldView<float, &Record::growth>(records_);
+    }
+    auto GetPhysicalBoundary() const {
+        return FieldView<bool, &Record::is_physical_boundary>(records_);
+    }
+};
+
+/**
+ * @brief The per-vertex state layout used by Clusters, selected at compile
+ * time with PLAQUETTE_UNIONFIND_PACKED_VERTEX_STATE.
+ */
+#ifdef PLAQUETTE_UNIONFIND_PACKED_VERTEX_STATE
+using VertexState = PackedVertexState;
+#else
+using VertexState = VertexStateArrays;
+#endif
+
+}; // namespace Plaquette
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Plaquette {
+
+/**
+ * @brief Hardware performance counters of the calling thread, read with
+ * Linux perf_event_open.
+ *
+ * Every counter is opened as an event of its own, so a counter the kernel,
+ * hypervisor or container refuses (e.g. LLC misses in a VM, or everything
+ * with a restrictive perf_event_paranoid) is simply reported as unavailable
+ * while the others keep working, and a counter the PMU cannot fit does not
+ * stop the others from being scheduled. A counter that is opened but never
+ * scheduled has not counted anything and is unavailable as well. On other
+ * platforms no counter is available.
+ *
+ * Counters are enabled once and read per snapshot; the difference of two
+ * snapshots is the count of the code in between. Values are scaled up if the
+ * kernel had to multiplex a counter.
+ */
+class PerfCounters {
+  public:
+    enum Counter {
+        Cycles,
+        Instructions,
+        L1DMisses,
+        LLCMisses,
+        DTLBMisses,
+        BranchMisses,
+        NumCounters
+    };
+
+    using Snapshot = std::array<uint64_t, NumCounters>;
+
+  private:
+    std::array<int, NumCounters> fds_;
+    std::array<bool, NumCounters> available_{}; ///< Opened counters.
+    /** Counters that were scheduled by the time of a Read() */
+    mutable std::array<bool, NumCounters> scheduled_{};
+
+#ifdef __linux__
+    static perf_event_attr GetAttr_(Counter counter) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        auto cache = [](uint64_t id, uint64_t result) {
+            return id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+        };
+        switch (counter) {
+        case Cycles:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case Instructions:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case L1DMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case LLCMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_LL,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case DTLBMisses:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_DTLB,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        default:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        }
+        return attr;
+    }
+#endif
+
+  public:
+    /**
+     * @brief Opens and enables all counters that are available.
+     */
+    PerfCounters() {
+        fds_.fill(-1);
+#ifdef __linux__
+        for (int c = 0; c < NumCounters; c++) {
+            auto attr = GetAttr_(static_cast<Counter>(c));
+            int fd = static_cast<int>(
+                syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fd < 0) {
+                continue;
+            }
+            fds_[c] = fd;
+            available_[c] = true;
+        }
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @brief Returns whether the counter is open and had been scheduled in a
+     * Read(), i.e. whether its values are counts.
+     */
+    bool IsAvailable(Counter counter) const {
+        return available_[counter] && scheduled_[counter];
+    }
+
+    /**
+     * @brief Returns whether any counter could be opened.
+     */
+    bool IsAnyAvailable() const {
+        for (bool available : available_) {
+            if (available) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static const char *GetName(Counter counter) {
+        static constexpr std::array<const char *, NumCounters> names = {
+            "cycles",     "instructions", "l1d_misses",
+            "llc_misses", "dtlb_misses",  "branch_misses"};
+        return names[counter];
+    }
+
+    /**
+     * @brief Reads the current value of all counters. Unavailable counters,
+     * and counters that have not been scheduled yet, read as zero.
+     */
+    Snapshot Read() const {
+        Snapshot snapshot{};
+#ifdef __linux__
+        for (int c = 0; c < NumCounters; c++) {
+            if (fds_[c] < 0) {
+                continue;
+            }
+            // value, time_enabled, time_running
+            std::array<uint64_t, 3> buffer{};
+            if (read(fds_[c], buffer.data(), sizeof(buffer)) <
+                    static_cast<ssize_t>(sizeof(buffer)) ||
+                buffer[2] == 0) {
+                continue;
+            }
+            scheduled_[c] = true;
+            double scale = buffer[2] < buffer[1]
+                               ? static_cast<double>(buffer[1]) / buffer[2]
+                               : 1.0;
+            snapshot[c] = static_cast<uint64_t>(buffer[0] * scale);
+        }
+#endif
+        return snapshot;
+    }
+};
+
+}; // namespace Plaquette
@@ -0,0 +1,489 @@
+/**
+ * @file decode_benchmark.cpp
+ * @brief In-process end-to-end decoding benchmark.
+ *
+ * Usage:
+ *
+ *     plaquette_unionfind_benchmark [--code planar|rotated|toric]
+ *         [--distances 5,7,9] [--rounds 1,d] [--p 0.01,0.05]
+ *         [--shots N] [--warmup N] [--seed S] [--out results.json] [--perf]
+ *         [--memory default,arena,hugepages] [--no-fixed-degree]
+ *         [--graph explicit,implicit]
+ *
+ * For every point of the (distance, rounds, p) grid the code is built once,
+ * all syndromes are sampled up front with phenomenological bit-flip noise
+ * (data and measurement errors both at rate p) and only the calls to
+ * UnionFindDecoder::Decode are timed, after a number of untimed warmup shots.
+ * A rounds value of "d" means as many rounds as the distance.
+ *
+ * With --perf, the measured shots are decoded a second time, stage by stage,
+ * while reading hardware performance counters (cycles, instructions, L1D,
+ * LLC and dTLB misses, branch misses) with perf_event_open. The per-shot
+ * averages of every stage are added to the results; counters the system does
+ * not allow or never schedules are reported as null, so the benchmark also
+ * runs in containers.
+ * The latencies are always taken from the first, uninstrumented pass.
+ *
+ * --memory selects where the decoder keeps its per-vertex and per-edge
+ * arrays: the default heap, a HugePageArena with ordinary pages, or a
+ * HugePageArena backed by transparent huge pages. Listing several repeats
+ * every point with each of them, which together with --perf shows the effect
+ * of huge pages on dTLB misses for large 3D graphs, e.g.
+ *
+ *     plaquette_unionfind_benchmark --distances 31,41 --rounds d --perf
+ *         --memory default,arena,hugepages
+ *
+ * On lattice codes the decoder specializes its inner loops for the maximum
+ * vertex degree of the graph, which is reported as fixed_degree;
+ * --no-fixed-degree forces the generic loops for comparison.
+ *
+ * --graph selects the decoding graph: the explicit CSR graph of the code, or
+ * a LatticeGraph with the same numbering that computes neighbours from
+ * coordinates. Both decode to the same corrections, so listing both compares
+ * stored against computed adjacency on the same shots. LatticeGraph covers
+ * the planar and toric codes only.
+ *
+ * The per-vertex state layout is chosen at compile time; the build also
+ * produces plaquette_unionfind_benchmark_packed with
+ * PLAQUETTE_UNIONFIND_PACKED_VERTEX_STATE, and the layout is recorded in the
+ * results, so running both compares the layouts across graph sizes.
+ *
+ * The results are written as JSON, which the plot scripts in `benchmarks/`
+ * accept in place of the older `.dat` files.
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ErrorModels.hpp"
+#include "HugePageArena.hpp"
+#include "LatticeGraph.hpp"
+#include "PerfCounters.hpp"
+#include "PlanarCode.hpp"
+#include "RotatedPlanarCode.hpp"
+#include "StabilizerCode.hpp"
+#include "ToricCode.hpp"
+#include "UnionFindDecoder.hpp"
+
+using namespace Plaquette;
+using namespace Plaquette::Decoders;
+using namespace Plaquette::ErrorModels;
+
+namespace {
+
+struct Options {
+    std::string code = "planar";
+    std::vector<size_t> distances = {5, 9, 13, 17};
+    std::vector<std::string> rounds = {"1"};
+    std::vector<double> probabilities = {0.01, 0.05};
+    size_t num_shots = 10000;
+    size_t num_warmup = 1000;
+    int seed = 123456789;
+    std::string out_path = "-";
+    bool perf = false;
+    std::vector<std::string> memory = {"default"};
+    bool fixed_degree = true;
+    std::vector<std::string> graphs = {"explicit"};
+};
+
+/**
+ * @brief The decoding stages measured with --perf. Decode is their sum.
+ */
+enum PerfStage { SetSyndrome, SyndromeValidation, Peel, Decode, NumPerfStages };
+constexpr std::array<const char *, NumPerfStages> kPerfStageNames = {
+    "set_syndrome", "syndrome_validation", "peel", "decode"};
+
+using PerfTotals =
+    std::array<std::array<double, PerfCounters::NumCounters>, NumPerfStages>;
+
+struct Result {
+    std::string memory;
+    std::string graph;
+    size_t distance;
+    size_t rounds;
+    double p;
+    size_t num_vertices;
+    size_t num_edges;
+    size_t fixed_degree;
+    size_t num_logical_failures;
+    std::vector<double> latencies; ///< Seconds per shot.
+    PerfTotals perf;               ///< Counter averages per shot.
+};
+
+void PrintUsage(const char *program) {
+    std::cerr
+        << "Usage: " << program
+        << " [--code planar|rotated|toric] [--distances 5,7,9]\n"
+           "       [--rounds 1,d] [--p 0.01,0.05] [--shots N] [--warmup N]\n"
+           "       [--seed S] [--out results.json] [--perf]\n"
+           "       [--memory default,arena,hugepages] [--no-fixed-degree]\n"
+           "       [--graph explicit,implicit]\n";
+}
+
+std::vector<std::string> SplitList(const std::string &value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    if (items.empty()) {
+        throw std::invalid_argument("Empty list '" + value + "'");
+    }
+    return items;
+}
+
+Options ParseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if (arg == "--perf") {
+            options.perf = true;
+            continue;
+        }
+        if (arg == "--no-fixed-degree") {
+            options.fixed_degree = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--code") {
+            if (value != "planar" && value != "rotated" &&
+                value != "toric") {
+                throw std::invalid_argument("Unknown code '" + value + "'");
+            }
+            options.code = value;
+        } else if (arg == "--distances") {
+            options.distances.clear();
+            for (const auto &item : SplitList(value)) {
+                options.distances.push_back(std::stoul(item));
+            }
+        } else if (arg == "--rounds") {
+            options.rounds = SplitList(value);
+        } else if (arg == "--p") {
+            options.probabilities.clear();
+            for (const auto &item : SplitList(value)) {
+                options.probabilities.push_back(std::stod(item));
+            }
+        } else if (arg == "--shots") {
+            options.num_shots = std::max(1ul, std::stoul(value));
+        } else if (arg == "--warmup") {
+            options.num_warmup = std::stoul(value);
+        } else if (arg == "--seed") {
+            options.seed = std::stoi(value);
+        } else if (arg == "--out") {
+            options.out_path = value;
+        } else if (arg == "--memory") {
+            options.memory = SplitList(value);
+            for (const auto &memory : options.memory) {
+                if (memory != "default" && memory != "arena" &&
+                    memory != "hugepages") {
+                    throw std::invalid_argument("Unknown memory '" + memory +
+                                                "'");
+                }
+            }
+        } else if (arg == "--graph") {
+            options.graphs = SplitList(value);
+            for (const auto &graph : options.graphs) {
+                if (graph != "explicit" && graph != "implicit") {
+                    throw std::invalid_argument("Unknown graph '" + graph +
+                                                "'");
+                }
+            }
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+size_t ParseRounds(const std::string &rounds, size_t distance) {
+    if (rounds == "d") {
+        return distance;
+    }
+    return std::stoul(rounds);
+}
+
+/**
+ * @brief Decodes the measured shots stage by stage and returns the average
+ * counter values per shot of every stage.
+ */
+template <typename Decoder>
+PerfTotals MeasurePerf(const PerfCounters &counters, Decoder &decoder,
+                       const std::vector<std::vector<bool>> &syndromes,
+                       size_t first_shot) {
+    PerfTotals totals{};
+    std::vector<bool> syndrome;
+    for (size_t s = first_shot; s < syndromes.size(); s++) {
+        syndrome = syndromes[s];
+        std::array<PerfCounters::Snapshot, NumPerfStages> snapshots;
+        auto start = counters.Read();
+        decoder.SetSyndrome(syndrome);
+        snapshots[SetSyndrome] = counters.Read();
+        decoder.SyndromeValidation();
+        snapshots[SyndromeValidation] = counters.Read();
+        decoder.Peel(syndrome);
+        snapshots[Peel] = counters.Read();
+        snapshots[Decode] = snapshots[Peel];
+
+        for (size_t stage = 0; stage < NumPerfStages; stage++) {
+            const auto &before = (stage == SetSyndrome || stage == Decode)
+                                     ? start
+                                     : snapshots[stage - 1];
+            for (size_t c = 0; c < PerfCounters::NumCounters; c++) {
+                totals[stage][c] += snapshots[stage][c] - before[c];
+            }
+        }
+    }
+    size_t num_shots = syndromes.size() - first_shot;
+    for (auto &stage : totals) {
+        for (auto &value : stage) {
+            value /= num_shots;
+        }
+    }
+    return totals;
+}
+
+/**
+ * @brief Decodes all samples, timing the shots after the warmup, and counts
+ * the logical failures.
+ */
+template <typename Decoder, typename Code>
+void TimeShots(const Options &options, const PerfCounters *counters,
+               Decoder &decoder, Code &code,
+               const std::vector<std::vector<bool>> &errors,
+               const std::vector<std::vector<bool>> &syndromes,
+               Result &result) {
+    decoder.GetClusterSet().SetFixedDegreeRows(options.fixed_degree);
+    result.fixed_degree = decoder.GetClusterSet().GetFixedDegree();
+    std::vector<bool> syndrome;
+    for (size_t s = 0; s < syndromes.size(); s++) {
+        // Decoding consumes the syndrome, so copy it outside the timed region.
+        syndrome = syndromes[s];
+        auto start = std::chrono::steady_clock::now();
+        auto correction = decoder.Decode(syndrome);
+        auto end = std::chrono::steady_clock::now();
+        if (s < options.num_warmup) {
+            continue;
+        }
+        result.latencies.push_back(
+            std::chrono::duration<double>(end - start).count());
+
+        for (size_t e = 0; e < correction.size(); e++) {
+            correction[e] = correction[e] ^ errors[s][e];
+        }
+        if (code.MeasureLogical(correction, StabilizerCode::Channel::Z)) {
+            result.num_logical_failures++;
+        }
+    }
+
+    if (counters != nullptr) {
+        result.perf =
+            MeasurePerf(*counters, decoder, syndromes, options.num_warmup);
+    }
+}
+
+template <typename Code>
+Result RunPoint(const Options &options, const PerfCounters *counters,
+                const std::string &memory, const std::string &graph_type,
+                Code &code, size_t distance, size_t rounds, double p) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_samples = options.num_warmup + options.num_shots;
+
+    BitFlipErrorModel error_model(graph.GetNumEdges(), p, options.seed);
+    std::vector<std::vector<bool>> errors(num_samples);
+    std::vector<std::vector<bool>> syndromes(num_samples);
+    for (size_t s = 0; s < num_samples; s++) {
+        errors[s] = error_model.GetErrors();
+        syndromes[s] =
+            code.MeasureSyndrome(errors[s], StabilizerCode::Stabilizer::Z);
+    }
+
+    Result result{memory, graph_type, distance, rounds, p,
+                  graph.GetNumVertices(), graph.GetNumEdges(), 0, 0, {}, {}};
+    result.latencies.reserve(options.num_shots);
+
+    std::unique_ptr<HugePageArena> arena;
+    if (memory != "default") {
+        arena = std::make_unique<HugePageArena>(HugePageArena::kHugePageSize,
+                                                memory == "hugepages");
+    }
+    auto *memory_resource =
+        arena ? arena.get() : std::pmr::get_default_resource();
+    if (graph_type == "implicit") {
+        // Numbered like the Z stabilizer graph of the code.
+        LatticeGraph lattice(distance, options.code == "toric", rounds);
+        BasicUnionFindDecoder<LatticeGraph> decoder(lattice, {}, 2.0,
+                                                    memory_resource);
+        TimeShots(options, counters, decoder, code, errors, syndromes,
+                  result);
+    } else {
+        UnionFindDecoder decoder(graph, {}, 2.0, memory_resource);
+        TimeShots(options, counters, decoder, code, errors, syndromes,
+                  result);
+    }
+    return result;
+}
+
+double Percentile(const std::vector<double> &sorted, double q) {
+    size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+void WritePerf(std::ostream &out, const PerfCounters &counters,
+               const PerfTotals &perf) {
+    out << ",\n     \"perf\": {";
+    for (size_t stage = 0; stage < NumPerfStages; stage++) {
+        out << (stage == 0 ? "" : ", ") << "\"" << kPerfStageNames[stage]
+            << "\": {";
+        for (size_t c = 0; c < PerfCounters::NumCounters; c++) {
+            auto counter = static_cast<PerfCounters::Counter>(c);
+            out << (c == 0 ? "" : ", ") << "\""
+                << PerfCounters::GetName(counter) << "\": ";
+            if (counters.IsAvailable(counter)) {
+                out << perf[stage][c];
+            } else {
+                out << "null";
+            }
+        }
+        out << "}";
+    }
+    out << "}";
+}
+
+void WriteResults(std::ostream &out, const Options &options,
+                  const PerfCounters *counters,
+                  const std::vector<Result> &results) {
+    out << "{\n  \"benchmark\": \"plaquette_unionfind_benchmark\",\n"
+        << "  \"decoder\": \"plaquette-unionfind\",\n"
+        << "  \"vertex_state\": \"" << VertexState::kLayoutName << "\",\n"
+        << "  \"code\": \"" << options.code << "\",\n"
+        << "  \"noise\": \"phenomenological\",\n"
+        << "  \"time_unit\": \"s\",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        auto sorted = r.latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double total = std::accumulate(sorted.begin(), sorted.end(), 0.0);
+
+        out << (i == 0 ? "\n" : ",\n") << "    {\"memory\": \"" << r.memory
+            << "\", \"graph\": \"" << r.graph
+            << "\", \"distance\": " << r.distance
+            << ", \"rounds\": " << r.rounds << ", \"p\": " << r.p
+            << ", \"num_vertices\": " << r.num_vertices
+            << ", \"num_edges\": " << r.num_edges
+            << ", \"fixed_degree\": " << r.fixed_degree
+            << ", \"shots\": " << sorted.size()
+            << ", \"warmup\": " << options.num_warmup
+            << ", \"logical_failures\": " << r.num_logical_failures
+            << ",\n     \"mean\": " << total / sorted.size()
+            << ", \"median\": " << Percentile(sorted, 0.5)
+            << ", \"p99\": " << Percentile(sorted, 0.99)
+            << ", \"p999\": " << Percentile(sorted, 0.999)
+            << ", \"min\": " << sorted.front()
+            << ", \"max\": " << sorted.back()
+            << ", \"shots_per_second\": " << sorted.size() / total;
+        if (counters != nullptr) {
+            WritePerf(out, *counters, r.perf);
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+Result RunCode(const Options &options, const PerfCounters *counters,
+               const std::string &memory, const std::string &graph,
+               size_t distance, size_t rounds, double p) {
+    if (options.code == "toric") {
+        ToricCode code(distance, rounds);
+        return RunPoint(options, counters, memory, graph, code, distance,
+                        rounds, p);
+    }
+    if (options.code == "rotated") {
+        if (graph == "implicit") {
+            throw std::invalid_argument(
+                "There is no implicit graph for the rotated planar code");
+        }
+        RotatedPlanarCode code(distance, rounds);
+        return RunPoint(options, counters, memory, graph, code, distance,
+                        rounds, p);
+    }
+    PlanarCode code(distance, rounds);
+    return RunPoint(options, counters, memory, graph, code, distance, rounds,
+                    p);
+}
+
+int Run(const Options &options) {
+    std::unique_ptr<PerfCounters> counters;
+    if (options.perf) {
+        counters = std::make_unique<PerfCounters>();
+        if (!counters->IsAnyAvailable()) {
+            std::cerr << "warning: no hardware performance counters are "
+                         "available, ignoring --perf\n";
+            counters.reset();
+        }
+    }
+
+    std::vector<Result> results;
+    for (auto distance : options.distances) {
+        for (const auto &rounds_value : options.rounds) {
+            size_t rounds = ParseRounds(rounds_value, distance);
+            for (auto p : options.probabilities) {
+                for (const auto &memory : options.memory) {
+                    for (const auto &graph : options.graphs) {
+                        std::cerr << options.code << " d=" << distance
+                                  << " rounds=" << rounds << " p=" << p
+                                  << " memory=" << memory
+                                  << " graph=" << graph << "\n";
+                        results.push_back(RunCode(options, counters.get(),
+                                                  memory, graph, distance,
+                                                  rounds, p));
+                    }
+                }
+            }
+        }
+    }
+
+    if (options.out_path == "-") {
+        WriteResults(std::cout, options, counters.get(), results);
+        return 0;
+    }
+    std::ofstream out(options.out_path);
+    if (!out) {
+        throw std::runtime_error("Could not open '" + options.out_path +
+                                 "' for writing");
+    }
+    out.precision(9);
+    WriteResults(out, options, counters.get(), results);
+    return out ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    try {
+        std::cout.precision(9);
+        return Run(ParseOptions(argc, argv));
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+}
@@ -0,0 +1,608 @@
+/**
+ * @file micro_benchmarks.cpp
+ * @brief Google Benchmark micro-benchmarks for the individual decoder stages.
+ *
+ * Every benchmark is registered for the toric code and the single-round
+ * planar and rotated planar codes at several distances and error rates, and
+ * is named
+ * `<Stage>/<code>/d:<distance>/p:<error rate>`, so that e.g.
+ *
+ *     plaquette_unionfind_micro_benchmarks --benchmark_filter=GrowCluster/toric
+ *
+ * runs a single stage. Syndromes are sampled once per (code, d, p) and reused.
+ *
+ * The cluster stages (GrowCluster, FindClusterRoot, MergeClusters,
+ * CheckBoundaryVertices) are measured inside a replay of the syndrome
+ * validation loop of UnionFindDecoder, so they see the same cluster states as
+ * during decoding. Only the selected stage is timed, with the cost of reading
+ * the clock subtracted, and the reported time is the total time spent in that
+ * stage per shot. The `calls` counter gives the number of calls per shot.
+ *
+ * BuildCode/<code>/d:<distance>/rounds:<distance> times the construction of
+ * a code with both of its space-time decoding graphs, which is dominated by
+ * the DecodingGraph constructor rather than by the code generators.
+ *
+ * MeasureSyndromeSparse measures the same errors as MeasureSyndrome, given
+ * as lists of flipped edges, into a packed syndrome; both report edges/s.
+ *
+ * Sampler/<model>/<format>/p:<error rate> compares the error models on
+ * 10^5 edges: `mt19937` is the per-qubit BitFlipErrorModel or
+ * ErasureErrorModel, and `sparse`, `packed` and `bool` are the geometric
+ * skip-ahead models writing index lists, packed bitsets or a reused
+ * std::vector<bool>. Items are sampled edges, so items/s is samples/s.
+ * Sampler/Heterogeneous/sparse/p:<error rate> samples edges whose rates are
+ * spread log-uniformly over [p / 10, p] with the bucketed skip-ahead model.
+ *
+ * SpaceTimeSampler/planar/d:<distance>/p:<error rate> samples the detection
+ * events and logical flips of phenomenological noise on d rounds, data and
+ * measurement errors at rate p, into a packed buffer; items are shots.
+ *
+ * DetectionEvents/planar/d:<distance>/rounds:<distance> computes the packed
+ * detection events of d - 1 rounds of random stabilizer measurements and a
+ * data readout; items are stabilizer measurements.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Clusters.hpp"
+#include "DetectionEvents.hpp"
+#include "ErrorModels.hpp"
+#include "PeelingDecoder.hpp"
+#include "PlanarCode.hpp"
+#include "RotatedPlanarCode.hpp"
+#include "SpaceTimeSampler.hpp"
+#include "SpanningForest.hpp"
+#include "ToricCode.hpp"
+
+using namespace Plaquette;
+using namespace Plaquette::Decoders;
+using namespace Plaquette::ErrorModels;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kNumSamples = 256;
+constexpr int kSeed = 1234;
+
+const std::vector<size_t> kDistances = {5, 9, 17, 33};
+const std::vector<double> kProbabilities = {0.01, 0.05};
+
+constexpr size_t kSamplerEdges = 100000;
+const std::vector<double> kSamplerProbabilities = {1e-4, 1e-3, 1e-2, 0.1};
+
+/**
+ * @brief Returns the time needed to read the clock twice, which is subtracted
+ * from every manually timed region.
+ */
+double GetTimerOverhead() {
+    static const double overhead = [] {
+        std::vector<double> samples(10001);
+        for (auto &sample : samples) {
+            auto start = Clock::now();
+            auto end = Clock::now();
+            sample = std::chrono::duration<double>(end - start).count();
+        }
+        std::nth_element(samples.begin(),
+                         samples.begin() + samples.size() / 2, samples.end());
+        return samples[samples.size() / 2];
+    }();
+    return overhead;
+}
+
+/**
+ * @brief Accumulates the time of the regions it is asked to time.
+ */
+class StageTimer {
+  private:
+    double elapsed_ = 0.0;
+    size_t num_calls_ = 0;
+
+  public:
+    template <typename Function> auto Time(Function &&function) {
+        auto start = Clock::now();
+        if constexpr (std::is_void_v<decltype(function())>) {
+            function();
+            Stop_(start);
+        } else {
+            auto result = function();
+            Stop_(start);
+            return result;
+        }
+    }
+
+    void Stop_(Clock::time_point start) {
+        auto end = Clock::now();
+        double elapsed = std::chrono::duration<double>(end - start).count();
+        elapsed_ += std::max(0.0, elapsed - GetTimerOverhead());
+        num_calls_++;
+    }
+
+    double GetElapsed() const { return elapsed_; }
+    size_t GetNumCalls() const { return num_calls_; }
+};
+
+/**
+ * @brief A code together with pre-sampled errors, erasures and syndromes.
+ */
+template <typename Code> struct Workload {
+    Code code;
+    std::vector<std::vector<bool>> errors;
+    std::vector<std::vector<bool>> erasures;
+    std::vector<std::vector<bool>> syndromes;
+
+    Workload(size_t distance, double p) : code(distance) {
+        const auto &graph = code.GetZStabilizerDecodingGraph();
+        BitFlipErrorModel error_model(graph.GetNumEdges(), p, kSeed);
+        ErasureErrorModel erasure_model(graph.GetNumEdges(), p, kSeed + 1);
+        for (size_t s = 0; s < kNumSamples; s++) {
+            errors.push_back(error_model.GetErrors());
+            erasures.push_back(std::get<1>(erasure_model.GetErrors()));
+            syndromes.push_back(code.MeasureSyndrome(
+                errors.back(), StabilizerCode::Stabilizer::Z));
+        }
+    }
+
+    const DecodingGraph &GetGraph() const {
+        return code.GetZStabilizerDecodingGraph();
+    }
+};
+
+template <typename Code>
+const Workload<Code> &GetWorkload(size_t distance, double p) {
+    using Key = std::pair<size_t, double>;
+    static std::map<Key, std::unique_ptr<Workload<Code>>> cache;
+    auto &workload = cache[{distance, p}];
+    if (!workload) {
+        workload = std::make_unique<Workload<Code>>(distance, p);
+    }
+    return *workload;
+}
+
+enum class Stage { Grow, FindRoot, Merge, CheckBoundary };
+
+/**
+ * @brief Replays UnionFindDecoder::SyndromeValidation, timing only one stage.
+ */
+void ValidateTimingStage(Clusters &clusters, const DecodingGraph &graph,
+                         Stage stage, StageTimer &timer) {
+    auto time_if = [&](Stage s, auto &&function) {
+        if (s == stage) {
+            return timer.Time(function);
+        }
+        return function();
+    };
+
+    int cluster_id = clusters.GetSmallestClusterWithOddParity();
+    while (cluster_id != -1) {
+        const auto *edges_to_fuse = time_if(
+            Stage::Grow, [&] { return &clusters.GrowCluster(cluster_id); });
+        std::vector<size_t> new_roots = {static_cast<size_t>(cluster_id)};
+        for (auto edge_id : *edges_to_fuse) {
+            const auto &vertices = graph.GetVerticesConnectedByEdge(edge_id);
+            auto roots = time_if(Stage::FindRoot, [&] {
+                return std::make_pair(
+                    clusters.FindClusterRoot(vertices.first),
+                    clusters.FindClusterRoot(vertices.second));
+            });
+            if (roots.first != roots.second) {
+                new_roots.push_back(time_if(Stage::Merge, [&] {
+                    return clusters.MergeClusters(roots.first, roots.second);
+                }));
+            }
+        }
+        std::sort(new_roots.begin(), new_roots.end());
+        new_roots.erase(std::unique(new_roots.begin(), new_roots.end()),
+                        new_roots.end());
+        for (auto root : new_roots) {
+            time_if(Stage::CheckBoundary, [&] {
+                clusters.CheckBoundaryVertices(root);
+                return 0;
+            });
+            clusters.AddToGrowQueue(root);
+        }
+        cluster_id = clusters.GetSmallestClusterWithOddParity();
+    }
+}
+
+template <typename Code>
+void BM_ClusterStage(benchmark::State &state, size_t distance, double p,
+                     Stage stage) {
+    const auto &workload = GetWorkload<Code>(distance, p);
+    const auto &graph = workload.GetGraph();
+    Clusters clusters(graph);
+    size_t num_calls = 0;
+    size_t s = 0;
+    for (auto _ : state) {
+        const auto &syndrome = workload.syndromes[s++ % kNumSamples];
+        clusters.Reset();
+        clusters.InitClusterRoots_(syndrome);
+        StageTimer timer;
+        ValidateTimingStage(clusters, graph, stage, timer);
+        state.SetIterationTime(timer.GetElapsed());
+        num_calls += timer.GetNumCalls();
+    }
+    state.counters["calls"] =
+        benchmark::Counter(num_calls, benchmark::Counter::kAvgIterations);
+}
+
+template <typename Code>
+void BM_InitEdgesRecursive(benchmark::State &state, size_t distance,
+                           double p) {
+    const auto &workload = GetWorkload<Code>(distance, p);
+    Clusters clusters(workload.GetGraph());
+    size_t s = 0;
+    for (auto _ : state) {
+        const auto &erasure = workload.erasures[s % kNumSamples];
+        const auto &syndrome = workload.syndromes[s++ % kNumSamples];
+        clusters.Reset();
+        StageTimer timer;
+        timer.Time([&] { clusters.InitEdgesRecursive_(erasure, syndrome); });
+        state.SetIterationTime(timer.GetElapsed());
+    }
+}
+
+template <typename Code>
+void BM_SpanningForest(benchmark::State &state, size_t distance, double p) {
+    const auto &workload = GetWorkload<Code>(distance, p);
+    const auto &graph = workload.GetGraph();
+    Clusters clusters(graph);
+    size_t s = 0;
+    for (auto _ : state) {
+        clusters.Reset();
+        clusters.InitClusterRoots_(workload.syndromes[s++ % kNumSamples]);
+        StageTimer unused;
+        ValidateTimingStage(clusters, graph, Stage::Grow, unused);
+
+        StageTimer timer;
+        auto forest = timer.Time([&] {
+            return GetSpanningForestCacheFriendlySeeded(
+                graph, clusters.GetFullyGrownEdges(),
+                clusters.GetPhysicalBoundaryVertices(),
+                clusters.GetNumPhysicalBoundaryVertices());
+        });
+        benchmark::DoNotOptimize(forest);
+        state.SetIterationTime(timer.GetElapsed());
+    }
+}
+
+template <typename Code>
+void BM_PeelForest(benchmark::State &state, size_t distance, double p) {
+    const auto &workload = GetWorkload<Code>(distance, p);
+    const auto &graph = workload.GetGraph();
+    Clusters clusters(graph);
+    size_t s = 0;
+    for (auto _ : state) {
+        auto syndrome = workload.syndromes[s++ % kNumSamples];
+        clusters.Reset();
+        clusters.InitClusterRoots_(syndrome);
+        StageTimer unused;
+        ValidateTimingStage(clusters, graph, Stage::Grow, unused);
+        auto [tree, vertex_count] = GetSpanningForestCacheFriendlySeeded(
+            graph, clusters.GetFullyGrownEdges(),
+            clusters.GetPhysicalBoundaryVertices(),
+            clusters.GetNumPhysicalBoundaryVertices());
+
+        StageTimer timer;
+        auto correction = timer.Time([&] {
+            return PeelingDecoder().PeelForest(graph, syndrome, tree,
+                                               vertex_count);
+        });
+        benchmark::DoNotOptimize(correction);
+        state.SetIterationTime(timer.GetElapsed());
+    }
+}
+
+template <typename Code>
+void BM_MeasureSyndrome(benchmark::State &state, size_t distance, double p) {
+    const auto &workload = GetWorkload<Code>(distance, p);
+    size_t s = 0;
+    for (auto _ : state) {
+        auto syndrome = workload.code.MeasureSyndrome(
+            workload.errors[s++ % kNumSamples], StabilizerCode::Stabilizer::Z);
+        benchmark::DoNotOptimize(syndrome);
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            workload.GetGraph().GetNumEdges());
+}
+
+template <typename Code>
+void BM_MeasureSyndromeSparse(benchmark::State &state, size_t distance,
+                              double p) {
+    const auto &workload = GetWorkload<Code>(distance, p);
+    std::vector<std::vector<size_t>> flipped(kNumSamples);
+    for (size_t s = 0; s < kNumSamples; s++) {
+        const auto &errors = workload.errors[s];
+        for (size_t e = 0; e < errors.size(); e++) {
+            if (errors[e]) {
+                flipped[s].push_back(e);
+            }
+        }
+    }
+    std::vector<uint64_t> syndrome;
+    size_t s = 0;
+    for (auto _ : state) {
+        workload.code.MeasureSyndrome(flipped[s++ % kNumSamples],
+                                      StabilizerCode::Stabilizer::Z, syndrome);
+        benchmark::DoNotOptimize(syndrome);
+    }
+    state.SetItemsProcessed(state.iterations() *
+                            workload.GetGraph().GetNumEdges());
+}
+
+template <typename Code>
+void BM_BitFlipErrorModel(benchmark::State &state, size_t distance, double p) {
+    const auto &graph = GetWorkload<Code>(distance, p).GetGraph();
+    size_t num_edges = graph.GetNumEdges();
+    BitFlipErrorModel error_model(num_edges, p, kSeed);
+    for (auto _ : state) {
+        auto errors = error_model.GetErrors();
+        benchmark::DoNotOptimize(errors);
+    }
+    state.SetItemsProcessed(state.iterations() * num_edges);
+}
+
+template <typename Code>
+void BM_ErasureErrorModel(benchmark::State &state, size_t distance, double p) {
+    const auto &graph = GetWorkload<Code>(distance, p).GetGraph();
+    size_t num_edges = graph.GetNumEdges();
+    ErasureErrorModel erasure_model(num_edges, p, kSeed);
+    for (auto _ : state) {
+        auto errors = erasure_model.GetErrors();
+        benchmark::DoNotOptimize(errors);
+    }
+    state.SetItemsProcessed(state.iterations() * num_edges);
+}
+
+enum class SamplerFormat { Mt19937, Sparse, Packed, Bool };
+
+void BM_BitFlipSampler(benchmark::State &state, double p,
+                       SamplerFormat format) {
+    BitFlipErrorModel error_model(kSamplerEdges, p, kSeed);
+    GeometricBitFlipErrorModel geometric_model(kSamplerEdges, p, kSeed);
+    std::vector<size_t> flipped;
+    std::vector<uint64_t> words;
+    std::vector<bool> errors;
+    for (auto _ : state) {
+        switch (format) {
+        case SamplerFormat::Mt19937:
+            errors = error_model.GetErrors();
+            break;
+        case SamplerFormat::Sparse:
+            geometric_model.GetErrors(flipped);
+            break;
+        case SamplerFormat::Packed:
+            geometric_model.GetPackedErrors(words);
+            break;
+        case SamplerFormat::Bool:
+            geometric_model.GetErrors(errors);
+            break;
+        }
+        benchmark::DoNotOptimize(errors);
+        benchmark::DoNotOptimize(flipped);
+        benchmark::DoNotOptimize(words);
+    }
+    state.SetItemsProcessed(state.iterations() * kSamplerEdges);
+}
+
+void BM_ErasureSampler(benchmark::State &state, double p,
+                       SamplerFormat format) {
+    ErasureErrorModel erasure_model(kSamplerEdges, p, kSeed);
+    GeometricErasureErrorModel geometric_model(kSamplerEdges, p, kSeed);
+    std::vector<size_t> erased;
+    std::vector<size_t> flipped;
+    std::vector<uint64_t> erasure_words;
+    std::vector<uint64_t> flip_words;
+    for (auto _ : state) {
+        switch (format) {
+        case SamplerFormat::Mt19937:
+            benchmark::DoNotOptimize(erasure_model.GetErrors());
+            break;
+        case SamplerFormat::Sparse:
+            geometric_model.GetErrors(erased, flipped);
+            break;
+        case SamplerFormat::Packed:
+            geometric_model.GetPackedErrors(erasure_words, flip_words);
+            break;
+        case SamplerFormat::Bool:
+            benchmark::DoNotOptimize(geometric_model.GetErrors());
+            break;
+        }
+        benchmark::DoNotOptimize(erased);
+        benchmark::DoNotOptimize(erasure_words);
+    }
+    state.SetItemsProcessed(state.iterations() * kSamplerEdges);
+}
+
+void BM_HeterogeneousSampler(benchmark::State &state, double p) {
+    std::vector<double> probabilities(kSamplerEdges);
+    for (size_t e = 0; e < kSamplerEdges; e++) {
+        double exponent = static_cast<double>(e % 97) / 96;
+        probabilities[e] = p * std::pow(10.0, -exponent);
+    }
+    HeterogeneousBitFlipErrorModel model(probabilities, kSeed);
+    std::vector<size_t> flipped;
+    for (auto _ : state) {
+        model.GetErrors(flipped);
+        benchmark::DoNotOptimize(flipped);
+    }
+    state.SetItemsProcessed(state.iterations() * kSamplerEdges);
+}
+
+void BM_SpaceTimeSampler(benchmark::State &state, size_t distance, double p) {
+    PlanarCode code(distance, distance);
+    std::vector<double> probabilities(
+        code.GetZStabilizerDecodingGraph().GetNumEdges(), p);
+    auto sampler = SpaceTimeSampler<>::FromCode(code, probabilities,
+                                                Xoshiro256PlusPlus(kSeed));
+    std::vector<uint64_t> detection_events;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(sampler.Sample(detection_events));
+        benchmark::DoNotOptimize(detection_events);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_DetectionEvents(benchmark::State &state, size_t distance) {
+    PlanarCode code(distance, distance);
+    DetectionEventBuilder builder(code.GetZStabilizerDecodingGraph(),
+                                  distance);
+    Xoshiro256PlusPlus generator(kSeed);
+    std::vector<uint64_t> measurements((distance - 1) *
+                                       builder.GetNumRoundWords());
+    std::vector<uint64_t> data_measurements(
+        GetNumPackedWords(builder.GetNumQubits()));
+    for (auto &word : measurements) {
+        word = generator();
+    }
+    for (auto &word : data_measurements) {
+        word = generator();
+    }
+    std::vector<uint64_t> events;
+    for (auto _ : state) {
+        builder.GetDetectionEvents(measurements, data_measurements, events);
+        benchmark::DoNotOptimize(events);
+    }
+    state.SetItemsProcessed(state.iterations() * distance *
+                            builder.GetNumStabilizers());
+}
+
+void RegisterSamplers() {
+    const std::vector<std::pair<std::string, SamplerFormat>> formats = {
+        {"mt19937", SamplerFormat::Mt19937},
+        {"sparse", SamplerFormat::Sparse},
+        {"packed", SamplerFormat::Packed},
+        {"bool", SamplerFormat::Bool}};
+    for (auto p : kSamplerProbabilities) {
+        for (const auto &[format_name, format] : formats) {
+            std::ostringstream suffix;
+            suffix << "/" << format_name << "/p:" << p;
+            benchmark::RegisterBenchmark(
+                ("Sampler/BitFlip" + suffix.str()).c_str(), BM_BitFlipSampler,
+                p, format);
+            benchmark::RegisterBenchmark(
+                ("Sampler/Erasure" + suffix.str()).c_str(), BM_ErasureSampler,
+                p, format);
+        }
+        std::ostringstream name;
+        name << "Sampler/Heterogeneous/sparse/p:" << p;
+        benchmark::RegisterBenchmark(name.str().c_str(),
+                                     BM_HeterogeneousSampler, p);
+    }
+    for (auto distance : kDistances) {
+        for (auto p : kProbabilities) {
+            std::ostringstream name;
+            name << "SpaceTimeSampler/planar/d:" << distance << "/p:" << p;
+            benchmark::RegisterBenchmark(name.str().c_str(),
+                                         BM_SpaceTimeSampler, distance, p);
+        }
+        std::ostringstream name;
+        name << "DetectionEvents/planar/d:" << distance
+             << "/rounds:" << distance;
+        benchmark::RegisterBenchmark(name.str().c_str(), BM_DetectionEvents,
+                                     distance);
+    }
+}
+
+template <typename Code>
+void BM_BuildCode(benchmark::State &state, size_t distance, size_t rounds) {
+    size_t num_edges = 0;
+    for (auto _ : state) {
+        Code code(distance, rounds);
+        num_edges = code.GetZStabilizerDecodingGraph().GetNumEdges() +
+                    code.GetXStabilizerDecodingGraph().GetNumEdges();
+        benchmark::DoNotOptimize(code);
+    }
+    state.SetItemsProcessed(state.iterations() * num_edges);
+}
+
+template <typename Code> void RegisterBuild(const std::string &code_name) {
+    for (auto distance : kDistances) {
+        size_t rounds = distance;
+        std::ostringstream name;
+        name << "BuildCode/" << code_name << "/d:" << distance
+             << "/rounds:" << rounds;
+        benchmark::RegisterBenchmark(name.str().c_str(), BM_BuildCode<Code>,
+                                     distance, rounds)
+            ->Unit(benchmark::kMillisecond);
+    }
+}
+
+template <typename Code> void RegisterAll(const std::string &code_name) {
+    const std::vector<std::pair<std::string, Stage>> cluster_stages = {
+        {"GrowCluster", Stage::Grow},
+        {"FindClusterRoot", Stage::FindRoot},
+        {"MergeClusters", Stage::Merge},
+        {"CheckBoundaryVertices", Stage::CheckBoundary}};
+
+    for (auto distance : kDistances) {
+        for (auto p : kProbabilities) {
+            std::ostringstream suffix_stream;
+            suffix_stream << "/" << code_name << "/d:" << distance
+                          << "/p:" << p;
+            std::string suffix = suffix_stream.str();
+            auto name = [&suffix](const std::string &stage) {
+                return stage + suffix;
+            };
+
+            for (const auto &[stage_name, stage] : cluster_stages) {
+                benchmark::RegisterBenchmark(name(stage_name).c_str(),
+                                             BM_ClusterStage<Code>, distance,
+                                             p, stage)
+                    ->UseManualTime();
+            }
+            benchmark::RegisterBenchmark(name("InitEdgesRecursive_").c_str(),
+                                         BM_InitEdgesRecursive<Code>, distance,
+                                         p)
+                ->UseManualTime();
+            benchmark::RegisterBenchmark(
+                name("GetSpanningForestCacheFriendlySeeded").c_str(),
+                BM_SpanningForest<Code>, distance, p)
+                ->UseManualTime();
+            benchmark::RegisterBenchmark(name("PeelForest").c_str(),
+                                         BM_PeelForest<Code>, distance, p)
+                ->UseManualTime();
+            benchmark::RegisterBenchmark(name("MeasureSyndrome").c_str(),
+                                         BM_MeasureSyndrome<Code>, distance,
+                                         p);
+            benchmark::RegisterBenchmark(
+                name("MeasureSyndromeSparse").c_str(),
+                BM_MeasureSyndromeSparse<Code>, distance, p);
+            benchmark::RegisterBenchmark(name("BitFlipErrorModel").c_str(),
+                                         BM_BitFlipErrorModel<Code>, distance,
+                                         p);
+            benchmark::RegisterBenchmark(name("ErasureErrorModel").c_str(),
+                                         BM_ErasureErrorModel<Code>, distance,
+                                         p);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    GetTimerOverhead();
+    benchmark::AddCustomContext("vertex_state", VertexState::kLayoutName);
+    RegisterAll<ToricCode>("toric");
+    RegisterAll<PlanarCode>("planar");
+    RegisterAll<RotatedPlanarCode>("rotated");
+    RegisterBuild<ToricCode>("toric");
+    RegisterBuild<PlanarCode>("planar");
+    RegisterBuild<RotatedPlanarCode>("rotated");
+    RegisterSamplers();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
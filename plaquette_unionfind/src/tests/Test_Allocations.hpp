@@ -0,0 +1,158 @@
+#include "ErrorModels.hpp"
+#include "HugePageArena.hpp"
+#include "PlanarCode.hpp"
+#include "ToricCode.hpp"
+#include "UnionFindDecoder.hpp"
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Counts every heap allocation of the test runner. The replacements have to
+// live in exactly one translation unit, which runner.cpp is.
+namespace {
+std::atomic<size_t> num_allocations{0};
+
+void *CountedAllocate(std::size_t size) {
+    num_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+} // namespace
+
+void *operator new(std::size_t size) { return CountedAllocate(size); }
+void *operator new[](std::size_t size) { return CountedAllocate(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+using namespace Plaquette;
+using namespace Plaquette::ErrorModels;
+
+namespace {
+template <typename Code>
+void RequireAllocationFreeDecoding(Code &code, double p, bool with_erasure) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+    size_t num_shots = 100;
+
+    std::vector<std::vector<bool>> syndromes;
+    std::vector<std::vector<bool>> erasures;
+    for (size_t s = 0; s < num_shots; s++) {
+        ErasureErrorModel erasure_model(num_edges, with_erasure ? p : 0.0,
+                                        1000 + s);
+        const auto &[erasure_errors, erasure] = erasure_model.GetErrors();
+        BitFlipErrorModel bit_flip_model(num_edges, p, 5000 + s, erasure);
+        auto errors = Utils::SetXor(bit_flip_model.GetErrors(), erasure_errors);
+        syndromes.push_back(
+            code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z));
+        erasures.push_back(erasure);
+    }
+
+    Decoders::UnionFindDecoder decoder(graph);
+    std::vector<uint8_t> correction(num_edges);
+    std::vector<bool> syndrome(graph.GetNumVertices());
+
+    // The first pass sizes the internal buffers and checks the results.
+    for (size_t s = 0; s < num_shots; s++) {
+        syndrome = syndromes[s];
+        decoder.Decode(syndrome, erasures[s], correction);
+
+        std::vector<bool> syndrome_copy = syndromes[s];
+        Decoders::UnionFindDecoder reference(graph);
+        auto expected = reference.Decode(syndrome_copy, erasures[s]);
+        for (size_t e = 0; e < num_edges; e++) {
+            REQUIRE(static_cast<bool>(correction[e]) == expected[e]);
+        }
+    }
+
+    size_t before = num_allocations.load();
+    for (size_t s = 0; s < num_shots; s++) {
+        syndrome = syndromes[s];
+        if (with_erasure) {
+            decoder.Decode(syndrome, erasures[s], correction);
+        } else {
+            decoder.Decode(syndrome, correction);
+        }
+    }
+    size_t after = num_allocations.load();
+    REQUIRE(after - before == 0);
+}
+} // namespace
+
+TEST_CASE("UnionFind decoding into a buffer does not allocate",
+          "[Allocations]") {
+    // Make sure the counting operator new is the one in use.
+    size_t probe_before = num_allocations.load();
+    auto probe = std::make_unique<int>(1);
+    REQUIRE(num_allocations.load() > probe_before);
+
+    SECTION("Toric code") {
+        ToricCode code(9);
+        RequireAllocationFreeDecoding(code, 0.08, false);
+    }
+    SECTION("Planar code with measurement errors") {
+        PlanarCode code(7, 7);
+        RequireAllocationFreeDecoding(code, 0.03, false);
+    }
+    SECTION("Toric code with erasure") {
+        ToricCode code(9);
+        RequireAllocationFreeDecoding(code, 0.05, true);
+    }
+}
+
+TEST_CASE("UnionFind decoding into a buffer checks its size",
+          "[Allocations]") {
+    ToricCode code(3);
+    Decoders::UnionFindDecoder decoder(code.GetZStabilizerDecodingGraph());
+    std::vector<bool> syndrome(
+        code.GetZStabilizerDecodingGraph().GetNumVertices());
+    std::vector<uint8_t> correction(1);
+    REQUIRE_THROWS_AS(decoder.Decode(syndrome, correction),
+                      std::invalid_argument);
+}
+
+TEST_CASE("HugePageArena alignment", "[Allocations]") {
+    HugePageArena arena;
+    std::pmr::memory_resource &resource = arena;
+    for (size_t size : {1, 3, 64, 100, 4096}) {
+        auto address = reinterpret_cast<uintptr_t>(resource.allocate(size, 1));
+        REQUIRE(address % HugePageArena::kMinAlignment == 0);
+    }
+    auto large = reinterpret_cast<uintptr_t>(
+        resource.allocate(3 * HugePageArena::kHugePageSize, 8));
+    REQUIRE(large % HugePageArena::kHugePageSize == 0);
+    REQUIRE(arena.GetBytesReserved() % HugePageArena::kHugePageSize == 0);
+    REQUIRE(arena.GetBytesReserved() >= 4 * HugePageArena::kHugePageSize);
+}
+
+TEST_CASE("UnionFind decoder with a HugePageArena", "[Allocations]") {
+    PlanarCode code(9, 9);
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+
+    HugePageArena arena;
+    Decoders::UnionFindDecoder decoder(graph, {}, 2.0, &arena);
+    REQUIRE(arena.GetBytesAllocated() >= num_edges * sizeof(float));
+
+    for (size_t s = 0; s < 50; s++) {
+        ErasureErrorModel erasure_model(num_edges, 0.02, 100 + s);
+        const auto &[erasure_errors, erasure] = erasure_model.GetErrors();
+        BitFlipErrorModel bit_flip_model(num_edges, 0.03, 200 + s, erasure);
+        auto errors = Utils::SetXor(bit_flip_model.GetErrors(), erasure_errors);
+        auto syndrome =
+            code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+        auto syndrome_copy = syndrome;
+
+        Decoders::UnionFindDecoder reference(graph);
+        auto expected = reference.Decode(syndrome_copy, erasure);
+        REQUIRE(decoder.Decode(syndrome, erasure) == expected);
+    }
+}
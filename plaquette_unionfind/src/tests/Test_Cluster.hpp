@@ -2,6 +2,7 @@
 #include "DecodingGraph.hpp"
 #include "ErrorModels.hpp"
 #include "PeelingDecoder.hpp"
+#include "PlanarCode.hpp"
 #include "StabilizerCode.hpp"
 #include "ToricCode.hpp"
 #include "UnionFindDecoder.hpp"
@@ -252,3 +253,83 @@ TEST_CASE("GetSmallestClusterWithOddParity returns the correct cluster ID") {
 
     REQUIRE(cluster_set.GetSmallestClusterWithOddParity() == 4);
 }
+
+TEMPLATE_TEST_CASE("Vertex state layouts", "[VertexState]", VertexStateArrays,
+                   PackedVertexState) {
+    TestType state(4, std::pmr::get_default_resource());
+    REQUIRE(state.size() == 4);
+    REQUIRE(state.GetClusterIds()[2] == -1);
+
+    state.ClusterId(2) = 1;
+    state.Parity(1) += 3;
+    state.Growth(1) += 1.5;
+    state.SetPhysicalBoundary(3);
+
+    REQUIRE(state.GetClusterIds()[2] == 1);
+    REQUIRE(state.GetParities()[1] == 3);
+    REQUIRE(state.GetGrowths()[1] == 1.5);
+    REQUIRE(state.GetPhysicalBoundary()[3]);
+    REQUIRE(!state.IsPhysicalBoundary(2));
+
+    state.Reset();
+    for (size_t v = 0; v < state.size(); v++) {
+        REQUIRE(state.ClusterId(v) == -1);
+        REQUIRE(state.GetParities()[v] == 0);
+        REQUIRE(state.Growth(v) == 0.0);
+        REQUIRE(!state.IsPhysicalBoundary(v));
+    }
+}
+
+TEST_CASE("PaddedAdjacency row widths", "[PaddedAdjacency]") {
+    ToricCode toric(5);
+    PaddedAdjacency toric_rows(toric.GetZStabilizerDecodingGraph());
+    REQUIRE(toric_rows.GetMaxDegree() == 4);
+
+    PlanarCode planar(5, 5);
+    const auto &graph = planar.GetZStabilizerDecodingGraph();
+    PaddedAdjacency planar_rows(graph);
+    REQUIRE(planar_rows.GetMaxDegree() == 6);
+    for (size_t v = 0; v < graph.GetNumVertices(); v++) {
+        auto row = planar_rows.GetRow<6>(v);
+        const auto &edges = graph.GetEdgesTouchingVertex(v);
+        const auto &vertices = graph.GetVerticesTouchingVertex(v);
+        REQUIRE(row.size() == edges.size());
+        for (size_t i = 0; i < row.size(); i++) {
+            REQUIRE(row.GetEdge(i) == edges[i]);
+            REQUIRE(row.GetVertex(i) == vertices[i]);
+        }
+    }
+
+    std::vector<std::pair<size_t, size_t>> star;
+    for (size_t v = 1; v < 11; v++) {
+        star.push_back({0, v});
+    }
+    DecodingGraph star_graph(11, star, std::vector<bool>(11, false));
+    PaddedAdjacency star_rows(star_graph);
+    REQUIRE(star_rows.GetMaxDegree() == 0);
+}
+
+TEST_CASE("Fixed-degree rows do not change the decoding",
+          "[PaddedAdjacency]") {
+    PlanarCode code(7, 7);
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_edges = graph.GetNumEdges();
+
+    UnionFindDecoder fixed_decoder(graph);
+    UnionFindDecoder csr_decoder(graph);
+    csr_decoder.GetClusterSet().SetFixedDegreeRows(false);
+    REQUIRE(fixed_decoder.GetClusterSet().GetFixedDegree() == 6);
+    REQUIRE(csr_decoder.GetClusterSet().GetFixedDegree() == 0);
+
+    for (size_t s = 0; s < 50; s++) {
+        ErasureErrorModel erasure_model(num_edges, 0.02, 300 + s);
+        const auto &[erasure_errors, erasure] = erasure_model.GetErrors();
+        BitFlipErrorModel bit_flip_model(num_edges, 0.03, 400 + s, erasure);
+        auto errors = Utils::SetXor(bit_flip_model.GetErrors(), erasure_errors);
+        auto syndrome =
+            code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+        auto syndrome_copy = syndrome;
+        REQUIRE(fixed_decoder.Decode(syndrome, erasure) ==
+                csr_decoder.Decode(syndrome_copy, erasure));
+    }
+}
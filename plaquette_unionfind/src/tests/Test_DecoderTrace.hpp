@@ -0,0 +1,47 @@
+#include "DecoderTrace.hpp"
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace Plaquette;
+
+TEST_CASE("Trace buffer keeps the most recent events", "[DecoderTrace]") {
+    TraceBuffer buffer(4, 0);
+    for (int64_t i = 0; i < 6; i++) {
+        buffer.Record({"event", static_cast<uint64_t>(i), 1, i});
+    }
+    REQUIRE(buffer.GetNumRecorded() == 6);
+    REQUIRE(buffer.GetSize() == 4);
+    for (size_t i = 0; i < buffer.GetSize(); i++) {
+        REQUIRE(buffer[i].id == static_cast<int64_t>(i) + 2);
+    }
+
+    buffer.Clear();
+    REQUIRE(buffer.GetSize() == 0);
+}
+
+TEST_CASE("Trace recorder exports Chrome trace events", "[DecoderTrace]") {
+    auto &recorder = TraceRecorder::Get();
+    recorder.Clear();
+
+    { ScopedTraceEvent event("main_thread_event", 7); }
+    std::thread worker([] { ScopedTraceEvent event("worker_event"); });
+    worker.join();
+
+    std::stringstream out;
+    recorder.WriteChromeTrace(out);
+    std::string trace = out.str();
+    REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+    REQUIRE(trace.find("\"name\": \"main_thread_event\", \"ph\": \"X\"") !=
+            std::string::npos);
+    REQUIRE(trace.find("\"args\": {\"id\": 7}") != std::string::npos);
+    REQUIRE(trace.find("\"name\": \"worker_event\"") != std::string::npos);
+    REQUIRE(trace.find("\"thread_name\"") != std::string::npos);
+
+    recorder.Clear();
+    std::stringstream cleared;
+    recorder.WriteChromeTrace(cleared);
+    REQUIRE(cleared.str().find("main_thread_event") == std::string::npos);
+}
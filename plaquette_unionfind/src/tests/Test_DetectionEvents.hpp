@@ -0,0 +1,179 @@
+#include "DetectionEvents.hpp"
+#include "ErrorModels.hpp"
+#include "PlanarCode.hpp"
+#include "RotatedPlanarCode.hpp"
+#include "UnionFindDecoder.hpp"
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using namespace Plaquette;
+using namespace Plaquette::Decoders;
+
+namespace {
+
+/**
+ * @brief Simulates the measurement record of phenomenological noise and
+ * returns the flipped edges of the space-time graph that it corresponds to.
+ *
+ * Data errors accumulate from round to round, every imperfect round adds
+ * measurement errors to the syndrome of the accumulated errors, and the data
+ * qubits are read out after the data errors of the last round.
+ */
+template <typename Code>
+std::vector<size_t>
+SimulateRecord(const Code &code, size_t rounds, double p, int seed,
+               std::vector<uint64_t> &measurements,
+               std::vector<uint64_t> &data_measurements) {
+    Code layer(code.GetCodeDistance(), 1);
+    const auto &graph = layer.GetZStabilizerDecodingGraph();
+    size_t num_qubits = graph.GetNumEdges();
+    DetectionEventBuilder layout(graph, 1);
+    size_t num_stabilizers = layout.GetNumStabilizers();
+    size_t num_round_words = layout.GetNumRoundWords();
+
+    ErrorModels::GeometricBitFlipErrorModel<> data_model(num_qubits, p, seed);
+    ErrorModels::GeometricBitFlipErrorModel<> measurement_model(
+        num_stabilizers, p, seed + 1);
+    std::vector<bool> accumulated(num_qubits, false);
+    std::vector<size_t> flipped;
+    std::vector<size_t> edges;
+    measurements.clear();
+    for (size_t r = 0; r < rounds; r++) {
+        data_model.GetErrors(flipped);
+        for (auto q : flipped) {
+            accumulated[q] = !accumulated[q];
+            edges.push_back(r * num_qubits + q);
+        }
+        if (r + 1 == rounds) {
+            break;
+        }
+        std::vector<size_t> errors;
+        for (size_t q = 0; q < num_qubits; q++) {
+            if (accumulated[q]) {
+                errors.push_back(q);
+            }
+        }
+        std::vector<uint64_t> syndrome;
+        layer.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z, syndrome);
+        syndrome.resize(num_round_words);
+        measurement_model.GetErrors(flipped);
+        for (auto s : flipped) {
+            FlipPackedBit(syndrome, s);
+            edges.push_back(rounds * num_qubits + r * num_stabilizers + s);
+        }
+        measurements.insert(measurements.end(), syndrome.begin(),
+                            syndrome.end());
+    }
+    data_measurements.assign(GetNumPackedWords(num_qubits), 0);
+    for (size_t q = 0; q < num_qubits; q++) {
+        if (accumulated[q]) {
+            SetPackedBit(data_measurements, q);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    return edges;
+}
+
+} // namespace
+
+TEST_CASE("Packed bits are XORed at any offset") {
+    std::vector<uint64_t> source = {~uint64_t{0}, 0b101};
+    for (size_t offset : {0, 1, 63, 64, 100}) {
+        std::vector<uint64_t> words(GetNumPackedWords(offset + 67), 0);
+        XorPackedBits(source, 67, words, offset);
+        for (size_t i = 0; i < words.size() * 64; i++) {
+            bool expected = i >= offset && i < offset + 67 &&
+                            (i - offset < 64 || i - offset == 64 ||
+                             i - offset == 66);
+            REQUIRE(GetPackedBit(words, i) == expected);
+        }
+    }
+}
+
+TEST_CASE("Detection events from measurement records") {
+    size_t distance = 5;
+    size_t rounds = 4;
+    PlanarCode code(distance, rounds);
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    DetectionEventBuilder builder(graph, rounds);
+    REQUIRE(builder.GetNumStabilizers() == distance * (distance - 1));
+    REQUIRE(builder.GetNumQubits() ==
+            distance * distance + (distance - 1) * (distance - 1));
+    REQUIRE(builder.GetNumVertices() == graph.GetNumVertices());
+
+    UnionFindDecoder decoder(graph);
+    std::vector<uint64_t> measurements;
+    std::vector<uint64_t> data_measurements;
+    std::vector<uint64_t> events;
+    std::vector<uint64_t> expected_events;
+    std::vector<bool> syndrome;
+    std::vector<bool> expected_syndrome;
+    std::vector<uint8_t> correction(graph.GetNumEdges());
+    for (int shot = 0; shot < 200; shot++) {
+        auto edges = SimulateRecord(code, rounds, 0.03, 2 * shot,
+                                    measurements, data_measurements);
+        code.MeasureSyndrome(edges, StabilizerCode::Stabilizer::Z,
+                             expected_events);
+        code.MeasureSyndrome(edges, StabilizerCode::Stabilizer::Z,
+                             expected_syndrome);
+
+        builder.GetDetectionEvents(measurements, data_measurements, events);
+        REQUIRE(events == expected_events);
+        builder.GetSyndrome(measurements, data_measurements, syndrome);
+        REQUIRE(syndrome == expected_syndrome);
+
+        decoder.Decode(syndrome, correction);
+        // The correction removes every detection event.
+        std::vector<size_t> residual = edges;
+        for (size_t e = 0; e < correction.size(); e++) {
+            if (correction[e]) {
+                residual.push_back(e);
+            }
+        }
+        code.MeasureSyndrome(residual, StabilizerCode::Stabilizer::Z, events);
+        REQUIRE(std::all_of(events.begin(), events.end(),
+                            [](uint64_t word) { return word == 0; }));
+    }
+}
+
+TEST_CASE("Detection events with a measured final round") {
+    size_t rounds = 3;
+    RotatedPlanarCode code(3, rounds);
+    RotatedPlanarCode layer(3, 1);
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    DetectionEventBuilder builder(graph, rounds);
+    size_t num_words = builder.GetNumRoundWords();
+
+    std::vector<uint64_t> measurements;
+    std::vector<uint64_t> data_measurements;
+    std::vector<uint64_t> expected_events;
+    std::vector<uint64_t> events;
+    SimulateRecord(code, rounds, 0.1, 5, measurements, data_measurements);
+    builder.GetDetectionEvents(measurements, data_measurements,
+                               expected_events);
+
+    // Measuring the stabilizers of the readout without errors instead gives
+    // the same events. Stabilizers come first in the layer's syndrome.
+    std::vector<size_t> errors;
+    for (size_t q = 0; q < builder.GetNumQubits(); q++) {
+        if (GetPackedBit(data_measurements, q)) {
+            errors.push_back(q);
+        }
+    }
+    std::vector<uint64_t> final_round;
+    layer.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z, final_round);
+    final_round.resize(num_words);
+    std::vector<uint64_t> perfect = measurements;
+    perfect.insert(perfect.end(), final_round.begin(), final_round.end());
+    builder.GetDetectionEvents(perfect, {}, events);
+    REQUIRE(events == expected_events);
+
+    REQUIRE_THROWS_AS(builder.GetDetectionEvents(measurements, {}, events),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        builder.GetDetectionEvents(perfect, data_measurements, events),
+        std::invalid_argument);
+    REQUIRE_THROWS_AS(DetectionEventBuilder(graph, 2), std::invalid_argument);
+}
@@ -0,0 +1,143 @@
+#include "DecodingGraph.hpp"
+#include "DetectorErrorModel.hpp"
+#include "UnionFindDecoder.hpp"
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace Plaquette;
+using namespace Plaquette::Decoders;
+
+namespace {
+const std::string test_data_dir = PLAQUETTE_UNIONFIND_TEST_DATA_DIR;
+}
+
+TEST_CASE("DetectorErrorModel repetition code with repeat blocks",
+          "[DetectorErrorModel]") {
+    auto dem =
+        DetectorErrorModel::FromFile(test_data_dir + "/repetition_code.dem");
+    const auto &graph = dem.GetDecodingGraph();
+
+    SECTION("Repeat blocks and shift_detectors are expanded") {
+        REQUIRE(dem.GetNumDetectors() == 8);
+        REQUIRE(dem.GetNumObservables() == 1);
+        REQUIRE(dem.GetNumBoundaryVertices() == 8);
+        REQUIRE(graph.GetNumVertices() == 16);
+        REQUIRE(graph.GetNumEdges() == 18);
+        REQUIRE(graph.IsVertexOnBoundary(7) == false);
+        REQUIRE(graph.IsVertexOnBoundary(8) == true);
+
+        // The last time-like edge of the second repetition.
+        auto edge = graph.GetEdgeFromVertexPair({5, 7});
+        REQUIRE(dem.GetEdgeProbabilities()[edge] == Approx(0.02));
+        REQUIRE(dem.GetEdgeObservables()[edge] == 0);
+    }
+
+    SECTION("Detector coordinates are shifted") {
+        const auto &coords = dem.GetDetectorCoords();
+        REQUIRE(coords.size() == 8);
+        REQUIRE(coords[0] == std::vector<double>{1, 0});
+        REQUIRE(coords[3] == std::vector<double>{3, 1});
+        REQUIRE(coords[6] == std::vector<double>{1, 3});
+    }
+
+    SECTION("Growth increments follow the log-likelihood weights") {
+        const auto &increments = dem.GetEdgeGrowthIncrements();
+        auto space_edge = graph.GetEdgeFromVertexPair({0, 1});
+        auto time_edge = graph.GetEdgeFromVertexPair({0, 2});
+        REQUIRE(increments[time_edge] == Approx(1.0));
+        REQUIRE(increments[space_edge] ==
+                Approx(std::log(0.98 / 0.02) / std::log(0.99 / 0.01)));
+    }
+
+    SECTION("Decoding predicts observable flips") {
+        std::vector<bool> detection_events(dem.GetNumDetectors(), false);
+        detection_events[0] = true;
+        auto syndrome = dem.GetSyndrome(detection_events);
+
+        UnionFindDecoder decoder(graph, dem.GetEdgeGrowthIncrements());
+        auto correction = decoder.Decode(syndrome);
+        REQUIRE(dem.GetObservableFlips(correction) == 1);
+
+        detection_events[0] = false;
+        detection_events[6] = true;
+        detection_events[7] = true;
+        syndrome = dem.GetSyndrome(detection_events);
+        UnionFindDecoder decoder_2(graph, dem.GetEdgeGrowthIncrements());
+        correction = decoder_2.Decode(syndrome);
+        REQUIRE(dem.GetObservableFlips(correction) == 0);
+    }
+}
+
+TEST_CASE("DetectorErrorModel decomposed and parallel errors",
+          "[DetectorErrorModel]") {
+    auto dem = DetectorErrorModel::FromFile(test_data_dir + "/decomposed.dem");
+    const auto &graph = dem.GetDecodingGraph();
+
+    REQUIRE(dem.GetNumDetectors() == 3);
+    REQUIRE(graph.GetNumEdges() == 2);
+
+    auto bulk_edge = graph.GetEdgeFromVertexPair({0, 1});
+    REQUIRE(dem.GetEdgeProbabilities()[bulk_edge] ==
+            Approx(0.1 * 0.8 + 0.2 * 0.9));
+    REQUIRE(dem.GetEdgeObservables()[bulk_edge] == 0);
+
+    auto boundary_edge = graph.GetEdgeFromVertexPair({2, 3});
+    REQUIRE(graph.IsVertexOnBoundary(3));
+    REQUIRE(dem.GetEdgeProbabilities()[boundary_edge] ==
+            Approx(0.1 * 0.95 + 0.05 * 0.9));
+    REQUIRE(dem.GetEdgeObservables()[boundary_edge] == 1);
+
+    REQUIRE(dem.GetDetectorCoords()[0] == std::vector<double>{0, 0, 0});
+    REQUIRE(dem.GetDetectorCoords()[1].empty());
+}
+
+TEST_CASE("DetectorErrorModel keeps undetectable errors",
+          "[DetectorErrorModel]") {
+    auto dem = DetectorErrorModel::FromString("error(0.1) D0 D1 L0\n"
+                                              "error(0.2) L0\n"
+                                              "error(0.05) L0 ^ D1 L1\n"
+                                              "error(0.3) D0 D0 L1\n"
+                                              "error(0.4) D1\n"
+                                              "error(0.1) D1 D2 D1 D0\n");
+    REQUIRE(dem.GetNumObservables() == 2);
+    REQUIRE(dem.GetDecodingGraph().GetNumEdges() == 3);
+    REQUIRE(dem.GetDecodingGraph().GetEdgeFromVertexPair({0, 2}) == 2);
+
+    const auto &errors = dem.GetUndetectableErrors();
+    REQUIRE(errors.size() == 2);
+    REQUIRE(errors[0].observables == 1);
+    REQUIRE(errors[0].probability == Approx(0.2 * 0.95 + 0.05 * 0.8));
+    REQUIRE(errors[1].observables == 2);
+    REQUIRE(errors[1].probability == Approx(0.3));
+}
+
+TEST_CASE("DetectorErrorModel rejects malformed input",
+          "[DetectorErrorModel]") {
+    REQUIRE_THROWS(DetectorErrorModel::FromString("error(0.1) D0 D1 D2\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("error D0 D1\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("repeat 2 {\nerror(0.1) D0"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("}\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("error(0.1) X0\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("unknown D0\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString(
+        "repeat -1 {\n error(0.1) D0 D1\n}\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString(
+        "repeat 0 {\n error(0.1) D0 D1\n}\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString(
+        "error(0.1) D0 D1\nshift_detectors -1\nerror(0.1) D1 D2\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("error(0.1) D-1 D0\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("error(0.1) D+1 D0\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString("detector D4000000000\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString(
+        "shift_detectors 4000000000\ndetector D1\n"));
+    REQUIRE_THROWS(DetectorErrorModel::FromString(
+        "shift_detectors 18446744073709551615\nshift_detectors 2\n"));
+    REQUIRE_THROWS(
+        DetectorErrorModel::FromString("error(0.1) D0 D0 D1 D2 D3\n"));
+
+    auto dem = DetectorErrorModel::FromString(
+        "repeat 1000 {\n error(0.1) D0 D1\n shift_detectors 1\n}\n");
+    REQUIRE(dem.GetNumDetectors() == 1001);
+    REQUIRE(dem.GetDecodingGraph().GetNumEdges() == 1000);
+}
@@ -0,0 +1,380 @@
+#include <algorithm>
+#include <numeric>
+#include "ErrorModels.hpp"
+#include "Random.hpp"
+#include <catch2/catch.hpp>
+
+using namespace Plaquette;
+using namespace Plaquette::ErrorModels;
+
+TEST_CASE("Xoshiro256PlusPlus") {
+    Xoshiro256PlusPlus generator(0);
+    REQUIRE(generator() == 0x53175d61490b23dfULL);
+    REQUIRE(generator() == 0x61da6f3dc380d507ULL);
+    REQUIRE(generator() == 0x5c0fdf91ec9a7bfcULL);
+
+    Xoshiro256PlusPlus a(5);
+    Xoshiro256PlusPlus b(5);
+    a.Jump();
+    REQUIRE(a() != b());
+    // Jumping commutes with stepping.
+    b.Jump();
+    REQUIRE(a() == b());
+
+    for (int i = 0; i < 1000; i++) {
+        double u = generator.NextDouble();
+        REQUIRE(u >= 0.0);
+        REQUIRE(u < 1.0);
+    }
+}
+
+TEST_CASE("Philox4x32-10") {
+    // Known-answer vectors of the reference implementation.
+    auto block = Philox4x32({0, 0, 0, 0}, {0, 0});
+    REQUIRE(block == std::array<uint32_t, 4>{0x6627e8d5, 0xe169c58d,
+                                             0xbc57ac4c, 0x9b00dbd8});
+    block = Philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                       {0xffffffff, 0xffffffff});
+    REQUIRE(block == std::array<uint32_t, 4>{0x408f276d, 0x41c83b0e,
+                                             0xa20bc7c6, 0x6d5451fd});
+    block = Philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                       {0xa4093822, 0x299f31d0});
+    REQUIRE(block == std::array<uint32_t, 4>{0xd16cfe09, 0x94fdcceb,
+                                             0x5001e420, 0x24126ea1});
+
+    SECTION("Outputs depend only on seed, shot and substream") {
+        PhiloxGenerator generator(42);
+        generator.Seek(1000, 1);
+        std::vector<uint64_t> outputs;
+        for (int i = 0; i < 10; i++) {
+            outputs.push_back(generator());
+        }
+        PhiloxGenerator other(42, 1000, 1);
+        for (int i = 0; i < 10; i++) {
+            REQUIRE(other() == outputs[i]);
+        }
+        REQUIRE(PhiloxGenerator(42, 1000, 0)() != outputs[0]);
+        REQUIRE(PhiloxGenerator(42, 1001, 1)() != outputs[0]);
+        REQUIRE(PhiloxGenerator(43, 1000, 1)() != outputs[0]);
+    }
+
+    SECTION("Shots can be sampled in any order") {
+        GeometricBitFlipErrorModel model(200, 0.1, PhiloxGenerator(5));
+        std::vector<std::vector<size_t>> forward(10);
+        for (size_t shot = 0; shot < 10; shot++) {
+            model.GetGenerator().Seek(shot);
+            model.GetErrors(forward[shot]);
+        }
+        std::vector<size_t> flipped;
+        for (size_t shot = 10; shot-- > 0;) {
+            model.GetGenerator().Seek(shot);
+            model.GetErrors(flipped);
+            REQUIRE(flipped == forward[shot]);
+        }
+
+        GeometricErasureErrorModel erasure_model(200, 0.2, PhiloxGenerator(5));
+        std::vector<size_t> erased;
+        std::vector<size_t> erased_again;
+        std::vector<size_t> flipped_again;
+        erasure_model.GetGenerator().Seek(3, 1);
+        erasure_model.GetErrors(erased, flipped);
+        erasure_model.GetErrors(erased_again, flipped_again);
+        erasure_model.GetGenerator().Seek(3, 1);
+        erasure_model.GetErrors(erased_again, flipped_again);
+        REQUIRE(erased == erased_again);
+        REQUIRE(flipped == flipped_again);
+    }
+}
+
+TEST_CASE("Geometric bit-flip error model") {
+    size_t num_qubits = 1000;
+
+    SECTION("Outputs agree and are reproducible") {
+        GeometricBitFlipErrorModel sparse_model(num_qubits, 0.05, 7);
+        GeometricBitFlipErrorModel packed_model(num_qubits, 0.05, 7);
+        GeometricBitFlipErrorModel bool_model(num_qubits, 0.05, 7);
+        std::vector<size_t> flipped;
+        std::vector<uint64_t> words;
+        for (int shot = 0; shot < 20; shot++) {
+            sparse_model.GetErrors(flipped);
+            packed_model.GetPackedErrors(words);
+            auto errors = bool_model.GetErrors();
+            REQUIRE(std::is_sorted(flipped.begin(), flipped.end()));
+            REQUIRE(words.size() == GetNumPackedWords(num_qubits));
+            size_t num_flipped = 0;
+            for (size_t q = 0; q < num_qubits; q++) {
+                bool bit = (words[q / 64] >> (q % 64)) & 1;
+                REQUIRE(bit == errors[q]);
+                num_flipped += errors[q];
+            }
+            REQUIRE(num_flipped == flipped.size());
+            for (auto q : flipped) {
+                REQUIRE(errors[q]);
+            }
+        }
+
+        GeometricBitFlipErrorModel reseeded(num_qubits, 0.05, 8);
+        GeometricBitFlipErrorModel same(num_qubits, 0.05, 8);
+        REQUIRE(reseeded.GetErrors() == same.GetErrors());
+    }
+
+    SECTION("Error rate") {
+        for (double p : {1e-3, 0.02, 0.3}) {
+            GeometricBitFlipErrorModel model(num_qubits, p, 11);
+            std::vector<size_t> flipped;
+            size_t num_flipped = 0;
+            size_t num_shots = 2000;
+            for (size_t shot = 0; shot < num_shots; shot++) {
+                model.GetErrors(flipped);
+                num_flipped += flipped.size();
+            }
+            double rate = static_cast<double>(num_flipped) /
+                          (num_shots * num_qubits);
+            REQUIRE(rate == Approx(p).epsilon(0.05));
+        }
+    }
+
+    SECTION("Extreme probabilities") {
+        std::vector<size_t> flipped;
+        GeometricBitFlipErrorModel never(num_qubits, 0.0, 1);
+        never.GetErrors(flipped);
+        REQUIRE(flipped.empty());
+        GeometricBitFlipErrorModel always(num_qubits, 1.0, 1);
+        always.GetErrors(flipped);
+        REQUIRE(flipped.size() == num_qubits);
+    }
+}
+
+TEST_CASE("Geometric erasure error model") {
+    size_t num_qubits = 500;
+    GeometricErasureErrorModel sparse_model(num_qubits, 0.1, 3);
+    GeometricErasureErrorModel packed_model(num_qubits, 0.1, 3);
+    GeometricErasureErrorModel bool_model(num_qubits, 0.1, 3);
+    std::vector<size_t> erased;
+    std::vector<size_t> flipped;
+    std::vector<uint64_t> erasure_words;
+    std::vector<uint64_t> flip_words;
+    size_t num_erased = 0;
+    size_t num_flipped = 0;
+    for (int shot = 0; shot < 200; shot++) {
+        sparse_model.GetErrors(erased, flipped);
+        packed_model.GetPackedErrors(erasure_words, flip_words);
+        auto [flips, erasure] = bool_model.GetErrors();
+        for (size_t q = 0; q < num_qubits; q++) {
+            REQUIRE(((erasure_words[q / 64] >> (q % 64)) & 1) == erasure[q]);
+            REQUIRE(((flip_words[q / 64] >> (q % 64)) & 1) == flips[q]);
+            REQUIRE((!flips[q] || erasure[q]));
+        }
+        REQUIRE(std::includes(erased.begin(), erased.end(), flipped.begin(),
+                              flipped.end()));
+        num_erased += erased.size();
+        num_flipped += flipped.size();
+    }
+    REQUIRE(num_erased / (200.0 * num_qubits) == Approx(0.1).epsilon(0.05));
+    REQUIRE(static_cast<double>(num_flipped) / num_erased ==
+            Approx(0.5).epsilon(0.05));
+}
+
+TEST_CASE("Coupled bit-flip error model") {
+    size_t num_qubits = 2000;
+    std::vector<double> probabilities = {0.0, 0.01, 0.01, 0.05, 0.2};
+    CoupledBitFlipErrorModel model(num_qubits, probabilities, 9);
+    std::vector<std::vector<size_t>> increments;
+    std::vector<size_t> counts(probabilities.size(), 0);
+    size_t num_shots = 500;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        model.GetErrors(increments);
+        REQUIRE(increments.size() == probabilities.size());
+        REQUIRE(increments[0].empty());
+        REQUIRE(increments[2].empty());
+        std::vector<size_t> all;
+        for (size_t k = 0; k < increments.size(); k++) {
+            REQUIRE(std::is_sorted(increments[k].begin(),
+                                   increments[k].end()));
+            all.insert(all.end(), increments[k].begin(), increments[k].end());
+            counts[k] += all.size();
+        }
+        std::sort(all.begin(), all.end());
+        REQUIRE(std::adjacent_find(all.begin(), all.end()) == all.end());
+    }
+    for (size_t k = 1; k < probabilities.size(); k++) {
+        double rate = static_cast<double>(counts[k]) / (num_shots * num_qubits);
+        REQUIRE(rate == Approx(probabilities[k]).epsilon(0.05));
+    }
+
+    REQUIRE_THROWS_AS(CoupledBitFlipErrorModel(10, {0.2, 0.1}, 1),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Fixed-weight error model") {
+    size_t num_qubits = 50;
+    FixedWeightErrorModel model(num_qubits, 7, 4);
+    std::vector<size_t> flipped;
+    std::vector<size_t> counts(num_qubits, 0);
+    size_t num_shots = 20000;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        model.GetErrors(flipped);
+        REQUIRE(flipped.size() == 7);
+        REQUIRE(std::is_sorted(flipped.begin(), flipped.end()));
+        REQUIRE(std::adjacent_find(flipped.begin(), flipped.end()) ==
+                flipped.end());
+        REQUIRE(flipped.back() < num_qubits);
+        for (auto q : flipped) {
+            counts[q]++;
+        }
+    }
+    // Every qubit is flipped with probability 7 / 50.
+    for (auto count : counts) {
+        REQUIRE(static_cast<double>(count) / num_shots ==
+                Approx(0.14).epsilon(0.1));
+    }
+
+    model.SetWeight(num_qubits);
+    model.GetErrors(flipped);
+    REQUIRE(flipped.size() == num_qubits);
+    model.SetWeight(0);
+    model.GetErrors(flipped);
+    REQUIRE(flipped.empty());
+    REQUIRE_THROWS_AS(model.SetWeight(num_qubits + 1), std::invalid_argument);
+}
+
+TEST_CASE("Heterogeneous bit-flip error model") {
+    // Rates spread over several buckets, with unequal rates in a bucket.
+    std::vector<double> probabilities;
+    for (size_t q = 0; q < 60; q++) {
+        const double rates[] = {0.0, 0.3, 0.2, 0.05, 0.04, 1e-3, 1.0};
+        probabilities.push_back(rates[q % 7]);
+    }
+    size_t num_qubits = probabilities.size();
+
+    SECTION("Outputs agree and are reproducible") {
+        HeterogeneousBitFlipErrorModel sparse_model(probabilities, 3);
+        HeterogeneousBitFlipErrorModel packed_model(probabilities, 3);
+        HeterogeneousBitFlipErrorModel bool_model(probabilities, 3);
+        std::vector<size_t> flipped;
+        std::vector<uint64_t> words;
+        std::vector<bool> errors;
+        for (int shot = 0; shot < 100; shot++) {
+            sparse_model.GetErrors(flipped);
+            packed_model.GetPackedErrors(words);
+            bool_model.GetErrors(errors);
+            REQUIRE(std::is_sorted(flipped.begin(), flipped.end()));
+            std::vector<size_t> from_words;
+            std::vector<size_t> from_bools;
+            for (size_t q = 0; q < num_qubits; q++) {
+                if (GetPackedBit(words, q)) {
+                    from_words.push_back(q);
+                }
+                if (errors[q]) {
+                    from_bools.push_back(q);
+                }
+            }
+            REQUIRE(from_words == flipped);
+            REQUIRE(from_bools == flipped);
+        }
+    }
+
+    SECTION("Error rates") {
+        HeterogeneousBitFlipErrorModel model(probabilities, 11);
+        std::vector<size_t> counts(num_qubits, 0);
+        std::vector<size_t> flipped;
+        size_t num_shots = 20000;
+        for (size_t shot = 0; shot < num_shots; shot++) {
+            model.GetErrors(flipped);
+            for (auto q : flipped) {
+                counts[q]++;
+            }
+        }
+        // Pool the qubits of every rate.
+        for (size_t r = 0; r < 7; r++) {
+            size_t count = 0;
+            size_t trials = 0;
+            for (size_t q = r; q < num_qubits; q += 7) {
+                count += counts[q];
+                trials += num_shots;
+            }
+            double p = probabilities[r];
+            double rate = static_cast<double>(count) / trials;
+            // Within four standard deviations, exact for rates 0 and 1.
+            REQUIRE(std::abs(rate - p) <= 4 * std::sqrt(p * (1 - p) / trials));
+        }
+    }
+
+    SECTION("Growth increments follow the rates") {
+        std::vector<double> rates = {0.1, 0.01, 0.001};
+        HeterogeneousBitFlipErrorModel model(rates, 1);
+        auto increments = model.GetGrowthIncrements();
+        REQUIRE(increments ==
+                Utils::GetGrowthIncrementsFromProbabilities(rates));
+        REQUIRE(increments[0] == 1.0f);
+        REQUIRE(increments[1] < increments[0]);
+        REQUIRE(increments[2] < increments[1]);
+    }
+
+    REQUIRE(BucketedSkipper(std::vector<double>{0.3, 0.26, 0.05, 0.0})
+                .GetNumBuckets() == 2);
+    REQUIRE_THROWS_AS(HeterogeneousBitFlipErrorModel({0.1, 1.5}, 1),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(HeterogeneousBitFlipErrorModel({-0.1}, 1),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Heterogeneous erasure error model") {
+    std::vector<double> probabilities = {0.5, 0.0, 0.1, 1.0, 0.02};
+    HeterogeneousErasureErrorModel sparse_model(probabilities, 5);
+    HeterogeneousErasureErrorModel packed_model(probabilities, 5);
+    std::vector<size_t> erased;
+    std::vector<size_t> flipped;
+    std::vector<uint64_t> erasure_words;
+    std::vector<uint64_t> flip_words;
+    std::vector<size_t> erasure_counts(probabilities.size(), 0);
+    size_t num_flips = 0;
+    size_t num_shots = 20000;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        sparse_model.GetErrors(erased, flipped);
+        packed_model.GetPackedErrors(erasure_words, flip_words);
+        REQUIRE(std::is_sorted(erased.begin(), erased.end()));
+        REQUIRE(std::includes(erased.begin(), erased.end(), flipped.begin(),
+                              flipped.end()));
+        for (size_t q = 0; q < probabilities.size(); q++) {
+            bool is_erased =
+                std::binary_search(erased.begin(), erased.end(), q);
+            bool is_flipped =
+                std::binary_search(flipped.begin(), flipped.end(), q);
+            REQUIRE(GetPackedBit(erasure_words, q) == is_erased);
+            REQUIRE(GetPackedBit(flip_words, q) == is_flipped);
+            erasure_counts[q] += is_erased;
+        }
+        num_flips += flipped.size();
+        // The certain erasure is always present.
+        REQUIRE(std::binary_search(erased.begin(), erased.end(), size_t{3}));
+    }
+    for (size_t q = 0; q < probabilities.size(); q++) {
+        double rate = static_cast<double>(erasure_counts[q]) / num_shots;
+        REQUIRE(rate == Approx(probabilities[q]).margin(0.01));
+    }
+    size_t num_erasures = std::accumulate(erasure_counts.begin(),
+                                          erasure_counts.end(), size_t{0});
+    REQUIRE(static_cast<double>(num_flips) / num_erasures ==
+            Approx(0.5).epsilon(0.05));
+}
+
+TEST_CASE("Space-time error rates") {
+    // Two qubits, one stabilizer and three rounds.
+    std::vector<double> data = {0.1, 0.2};
+    std::vector<double> measurement = {0.3};
+    REQUIRE(GetSpaceTimeProbabilities(data, measurement, 2, 1, 3) ==
+            std::vector<double>{0.1, 0.2, 0.1, 0.2, 0.1, 0.2, 0.3, 0.3});
+
+    std::vector<double> data_per_round = {0.1, 0.2, 0.3, 0.4, 0.5, 0.6};
+    std::vector<double> measurement_per_round = {0.01, 0.02};
+    REQUIRE(GetSpaceTimeProbabilities(data_per_round, measurement_per_round, 2,
+                                      1, 3) ==
+            std::vector<double>{0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.01, 0.02});
+
+    REQUIRE(GetSpaceTimeProbabilities(data, {}, 2, 1, 1) == data);
+    REQUIRE_THROWS_AS(GetSpaceTimeProbabilities(data, measurement, 3, 1, 3),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(GetSpaceTimeProbabilities(data, {}, 2, 1, 3),
+                      std::invalid_argument);
+}
@@ -0,0 +1,91 @@
+#include "ImportanceSampling.hpp"
+#include <catch2/catch.hpp>
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+TEST_CASE("Binomial probabilities") {
+    REQUIRE(GetBinomialProbability(10, 3, 0.2) == Approx(0.201326592));
+    REQUIRE(GetBinomialProbability(10, 0, 0.0) == 1.0);
+    REQUIRE(GetBinomialProbability(10, 1, 0.0) == 0.0);
+    REQUIRE(GetBinomialProbability(10, 10, 1.0) == 1.0);
+    REQUIRE(GetBinomialProbability(10, 11, 0.5) == 0.0);
+}
+
+TEST_CASE("Fixed-weight Monte Carlo") {
+    FixedWeightOptions options;
+    options.min_weight = 1;
+    options.max_weight = 14;
+    options.shots_per_weight = 2000;
+    options.chunk_size = 300;
+    options.seed = 8;
+
+    SECTION("Light errors are corrected") {
+        auto result = RunFixedWeightMonteCarlo("planar", 5, 1, options);
+        REQUIRE(result.num_edges == 41);
+        REQUIRE(result.GetMaxWeight() == 14);
+        REQUIRE(result.GetFailureRate(1) == 0.0);
+        REQUIRE(result.GetFailureRate(2) == 0.0);
+        REQUIRE(result.GetFailureRate(3) > 0.0);
+        REQUIRE(result.GetFailureRate(14) > result.GetFailureRate(3));
+        REQUIRE_THROWS_AS(result.GetFailureRate(15), std::invalid_argument);
+    }
+
+    SECTION("By default, weights start at (distance + 1) / 2") {
+        options.min_weight = 0;
+        REQUIRE(RunFixedWeightMonteCarlo("planar", 5, 1, options).min_weight ==
+                3);
+        REQUIRE(RunFixedWeightMonteCarlo("toric", 4, 2, options).min_weight ==
+                2);
+    }
+
+    SECTION("Independent of the number of threads and the chunk size") {
+        options.num_threads = 1;
+        auto serial = RunFixedWeightMonteCarlo("toric", 4, 2, options);
+        options.num_threads = 3;
+        options.chunk_size = 77;
+        auto parallel = RunFixedWeightMonteCarlo("toric", 4, 2, options);
+        REQUIRE(serial.num_failures == parallel.num_failures);
+
+        // More weights extend the run.
+        options.min_weight = 3;
+        options.max_weight = 20;
+        auto extended = RunFixedWeightMonteCarlo("toric", 4, 2, options);
+        for (size_t w = 3; w <= 14; w++) {
+            REQUIRE(extended.GetFailureRate(w) == serial.GetFailureRate(w));
+        }
+    }
+
+    SECTION("Agrees with direct sampling") {
+        options.min_weight = 2;
+        options.max_weight = 20;
+        auto result = RunFixedWeightMonteCarlo("rotated", 5, 1, options);
+        MonteCarloOptions direct_options;
+        direct_options.num_shots = 40000;
+        direct_options.seed = 8;
+        for (double p : {0.03, 0.06}) {
+            auto direct = RunMonteCarlo("rotated", 5, 1, p, direct_options);
+            auto [low, high] = direct.GetConfidenceInterval(3.29);
+            double rate = result.GetLogicalErrorRate(p);
+            double error = 3.29 * result.GetStandardError(p);
+            REQUIRE(rate + error >= low);
+            REQUIRE(rate - error <= high);
+            REQUIRE(result.GetTruncationBound(p) < 1e-6);
+        }
+
+        // Far below threshold the estimate stays resolved.
+        auto [low, high] = result.GetConfidenceInterval(1e-4);
+        REQUIRE(low > 0.0);
+        REQUIRE(high < 1e-6);
+    }
+
+    SECTION("Invalid arguments") {
+        options.max_weight = 100;
+        REQUIRE_THROWS_AS(RunFixedWeightMonteCarlo("planar", 3, 1, options),
+                          std::invalid_argument);
+        options.min_weight = 5;
+        options.max_weight = 4;
+        REQUIRE_THROWS_AS(RunFixedWeightMonteCarlo("planar", 3, 1, options),
+                          std::invalid_argument);
+    }
+}
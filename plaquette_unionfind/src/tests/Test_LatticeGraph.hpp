@@ -0,0 +1,143 @@
+#include "ErrorModels.hpp"
+#include "LatticeGraph.hpp"
+#include "PlanarCode.hpp"
+#include "TestHelpers.hpp"
+#include "ToricCode.hpp"
+#include "UnionFindDecoder.hpp"
+#include <algorithm>
+#include <catch2/catch.hpp>
+
+using namespace Plaquette;
+
+namespace {
+
+/**
+ * @brief Checks that an implicit graph answers every query like an explicit
+ * one, including the order of the rows.
+ */
+void RequireSameGraph(const LatticeGraph &lattice,
+                      const DecodingGraph &graph) {
+    REQUIRE(lattice.GetNumVertices() == graph.GetNumVertices());
+    REQUIRE(lattice.GetNumEdges() == graph.GetNumEdges());
+    for (size_t e = 0; e < graph.GetNumEdges(); e++) {
+        REQUIRE(lattice.GetVerticesConnectedByEdge(e) ==
+                graph.GetVerticesConnectedByEdge(e));
+    }
+    for (size_t v = 0; v < graph.GetNumVertices(); v++) {
+        REQUIRE(lattice.IsVertexOnBoundary(v) == graph.IsVertexOnBoundary(v));
+        auto lattice_edges = lattice.GetEdgesTouchingVertex(v);
+        auto lattice_vertices = lattice.GetVerticesTouchingVertex(v);
+        auto edges = graph.GetEdgesTouchingVertex(v);
+        auto vertices = graph.GetVerticesTouchingVertex(v);
+        REQUIRE(lattice_edges.size() == edges.size());
+        for (size_t i = 0; i < edges.size(); i++) {
+            REQUIRE(lattice_edges[i] == edges[i]);
+            REQUIRE(lattice_vertices[i] == vertices[i]);
+        }
+    }
+}
+
+/**
+ * @brief Decodes random syndromes of a code on its explicit graph and on the
+ * equivalent LatticeGraph and requires identical corrections.
+ */
+template <typename Code>
+void RequireSameDecoding(const Code &code, const LatticeGraph &lattice,
+                         float p) {
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    Decoders::UnionFindDecoder explicit_decoder(graph);
+    Decoders::BasicUnionFindDecoder<LatticeGraph> implicit_decoder(lattice);
+    REQUIRE(implicit_decoder.GetClusterSet().GetFixedDegree() == 0);
+
+    ErrorModels::BitFlipErrorModel error_model(graph.GetNumEdges(), p, 2024);
+    for (size_t shot = 0; shot < 100; shot++) {
+        auto errors = error_model.GetErrors();
+        auto syndrome =
+            code.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+        auto implicit_syndrome = syndrome;
+        auto expected = explicit_decoder.Decode(syndrome);
+        auto correction = implicit_decoder.Decode(implicit_syndrome);
+        REQUIRE(correction == expected);
+    }
+}
+
+} // namespace
+
+TEST_CASE("LatticeGraph matches the toric code graph") {
+    for (size_t size : {3, 4, 7}) {
+        ToricCode code(size);
+        LatticeGraph lattice(size, true);
+        REQUIRE(lattice.IsPeriodic());
+        RequireSameGraph(lattice, code.GetZStabilizerDecodingGraph());
+        RequireSameDecoding(code, lattice, 0.08);
+    }
+}
+
+TEST_CASE("LatticeGraph matches the planar code graph") {
+    for (size_t size : {2, 3, 6}) {
+        for (size_t rounds : {1, 2, 5}) {
+            PlanarCode code(size, rounds);
+            LatticeGraph lattice(size, false, rounds);
+            REQUIRE(lattice.GetNumRounds() == rounds);
+            RequireSameGraph(lattice, code.GetZStabilizerDecodingGraph());
+            RequireSameDecoding(code, lattice, 0.05);
+        }
+    }
+}
+
+TEST_CASE("LatticeGraph space-time toric graph") {
+    LatticeGraph lattice(5, true, 4);
+    REQUIRE(lattice.GetNumVertices() == 4 * 25);
+    REQUIRE(lattice.GetNumEdges() == 4 * 50 + 3 * 25);
+    RequireSameGraph(lattice, lattice.ToDecodingGraph());
+    RequireSameGraph(lattice, ToricCode(5, 4).GetZStabilizerDecodingGraph());
+
+    SECTION("Vertices have degree 4 in space and up to 2 in time") {
+        REQUIRE(lattice.GetEdgesTouchingVertex(0).size() == 5);
+        REQUIRE(lattice.GetEdgesTouchingVertex(30).size() == 6);
+        REQUIRE(lattice.GetEdgesTouchingVertex(99).size() == 5);
+    }
+
+    SECTION("Edges touching an edge") {
+        auto graph = lattice.ToDecodingGraph();
+        for (size_t e = 0; e < lattice.GetNumEdges(); e++) {
+            auto row = lattice.GetEdgesTouchingEdge(e);
+            std::vector<size_t> edges, expected;
+            for (size_t i = 0; i < row.size(); i++) {
+                edges.push_back(row[i]);
+            }
+            auto expected_row = graph.GetEdgesTouchingEdge(e);
+            for (size_t i = 0; i < expected_row.size(); i++) {
+                expected.push_back(expected_row[i]);
+            }
+            std::sort(edges.begin(), edges.end());
+            std::sort(expected.begin(), expected.end());
+            REQUIRE(edges == expected);
+        }
+    }
+
+    SECTION("Decoding with erasures clears the syndrome") {
+        auto graph = lattice.ToDecodingGraph();
+        Decoders::BasicUnionFindDecoder<LatticeGraph> decoder(lattice);
+        ErrorModels::ErasureErrorModel error_model(lattice.GetNumEdges(), 0.1,
+                                                   7);
+        for (size_t shot = 0; shot < 50; shot++) {
+            auto [errors, erasure] = error_model.GetErrors();
+            auto syndrome = MeasureSyndrome(graph, errors);
+            auto correction = decoder.Decode(syndrome, erasure);
+            for (size_t e = 0; e < errors.size(); e++) {
+                errors[e] = errors[e] ^ correction[e];
+            }
+            syndrome = MeasureSyndrome(graph, errors);
+            for (size_t v = 0; v < syndrome.size(); v++) {
+                REQUIRE(syndrome[v] == false);
+            }
+        }
+    }
+}
+
+TEST_CASE("LatticeGraph rejects invalid sizes") {
+    REQUIRE_THROWS_AS(LatticeGraph(2, true), std::invalid_argument);
+    REQUIRE_THROWS_AS(LatticeGraph(1, false), std::invalid_argument);
+    REQUIRE_THROWS_AS(LatticeGraph(3, false, 0), std::invalid_argument);
+}
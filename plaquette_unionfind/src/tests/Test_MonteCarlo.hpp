@@ -0,0 +1,259 @@
+#include "MonteCarlo.hpp"
+#include <catch2/catch.hpp>
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+TEST_CASE("Wilson score interval") {
+    auto [low, high] = GetWilsonInterval(10, 100);
+    REQUIRE(low == Approx(0.0552).epsilon(1e-3));
+    REQUIRE(high == Approx(0.1744).epsilon(1e-3));
+
+    std::tie(low, high) = GetWilsonInterval(0, 1000);
+    REQUIRE(low == 0.0);
+    REQUIRE(high == Approx(0.00383).epsilon(1e-2));
+
+    // The bounds are exact at zero successes or failures, for any n and z.
+    for (size_t n : {1, 7, 100, 12345}) {
+        for (double z : {1.0, 1.96, 3.29}) {
+            REQUIRE(GetWilsonInterval(0, n, z).first == 0.0);
+            REQUIRE(GetWilsonInterval(n, n, z).second == 1.0);
+        }
+    }
+
+    std::tie(low, high) = GetWilsonInterval(0, 0);
+    REQUIRE(low == 0.0);
+    REQUIRE(high == 1.0);
+
+    REQUIRE(GetNormalQuantile(0.95) == Approx(1.959964).epsilon(1e-6));
+    REQUIRE(GetNormalQuantile(0.999) == Approx(3.290527).epsilon(1e-6));
+}
+
+TEST_CASE("Clopper-Pearson interval") {
+    auto [low, high] = GetClopperPearsonInterval(10, 100);
+    REQUIRE(low == Approx(0.04900).epsilon(1e-3));
+    REQUIRE(high == Approx(0.17622).epsilon(1e-3));
+
+    std::tie(low, high) = GetClopperPearsonInterval(0, 1000);
+    REQUIRE(low == 0.0);
+    REQUIRE(high == Approx(1.0 - std::pow(0.025, 1e-3)).epsilon(1e-6));
+
+    std::tie(low, high) = GetClopperPearsonInterval(50, 50, 0.99);
+    REQUIRE(low == Approx(std::pow(0.005, 1.0 / 50)).epsilon(1e-6));
+    REQUIRE(high == 1.0);
+
+    // Never narrower than the Wilson interval.
+    auto [wilson_low, wilson_high] =
+        GetInterval(37, 2000, Interval::Wilson, 0.95);
+    std::tie(low, high) = GetInterval(37, 2000, Interval::ClopperPearson, 0.95);
+    REQUIRE(high - low > wilson_high - wilson_low);
+}
+
+TEST_CASE("Monte Carlo logical error rates") {
+    MonteCarloOptions options;
+    options.num_shots = 3000;
+    options.chunk_size = 256;
+    options.seed = 17;
+
+    SECTION("No errors, no failures") {
+        auto result = RunMonteCarlo("rotated", 5, 3, 0.0, options);
+        REQUIRE(result.num_shots == 3000);
+        REQUIRE(result.num_failures == 0);
+        REQUIRE(result.code == "rotated");
+        REQUIRE(result.distance == 5);
+        REQUIRE(result.rounds == 3);
+    }
+
+    SECTION("Independent of the number of threads and the chunk size") {
+        options.num_threads = 1;
+        auto serial = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        options.num_threads = 4;
+        auto parallel = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        REQUIRE(serial.num_failures > 0);
+        REQUIRE(serial.num_failures == parallel.num_failures);
+        options.chunk_size = 100;
+        auto rechunked = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        REQUIRE(serial.num_failures == rechunked.num_failures);
+
+        options.seed = 18;
+        auto reseeded = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        REQUIRE(reseeded.num_failures != serial.num_failures);
+    }
+
+    SECTION("Larger codes fail less often below threshold") {
+        options.num_threads = 2;
+        for (std::string code : {"planar", "rotated", "toric"}) {
+            auto small = RunMonteCarlo(code, 4, 1, 0.03, options);
+            auto large = RunMonteCarlo(code, 8, 1, 0.03, options);
+            auto [low, high] = small.GetConfidenceInterval();
+            REQUIRE(low <= small.GetLogicalErrorRate());
+            REQUIRE(small.GetLogicalErrorRate() <= high);
+            REQUIRE(large.num_failures < small.num_failures);
+        }
+    }
+
+    SECTION("Erasures are decoded") {
+        options.erasure_probability = 0.1;
+        auto result = RunMonteCarlo("toric", 6, 1, 0.0, options);
+        REQUIRE(result.num_failures < result.num_shots / 20);
+    }
+
+    SECTION("Bit-sliced shots") {
+        options.bit_sliced = true;
+        options.num_shots = 3001;
+        options.num_threads = 1;
+        auto zero = RunMonteCarlo("rotated", 5, 3, 0.0, options);
+        REQUIRE(zero.num_failures == 0);
+
+        auto serial = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        options.num_threads = 3;
+        options.chunk_size = 100;
+        auto parallel = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        REQUIRE(serial.num_shots == 3001);
+        REQUIRE(serial.num_failures == parallel.num_failures);
+
+        // The same rate as shot by shot sampling, within the 99.9%
+        // intervals.
+        options.num_shots = 20000;
+        options.erasure_probability = 0.05;
+        auto sliced = RunMonteCarlo("toric", 6, 1, 0.03, options);
+        options.bit_sliced = false;
+        auto per_shot = RunMonteCarlo("toric", 6, 1, 0.03, options);
+        auto [low, high] = per_shot.GetConfidenceInterval(3.29);
+        REQUIRE(sliced.num_failures > 0);
+        REQUIRE(sliced.GetLogicalErrorRate() >= low);
+        REQUIRE(sliced.GetLogicalErrorRate() <= high);
+    }
+
+    SECTION("Invalid arguments") {
+        REQUIRE_THROWS_AS(RunMonteCarlo("hexagonal", 5, 1, 0.01, options),
+                          std::invalid_argument);
+        REQUIRE_THROWS_AS(RunMonteCarlo("planar", 5, 1, 1.5, options),
+                          std::invalid_argument);
+    }
+}
+
+TEST_CASE("Coupled Monte Carlo sweeps") {
+    MonteCarloOptions options;
+    options.num_shots = 4000;
+    options.chunk_size = 256;
+    options.seed = 5;
+    std::vector<double> probabilities = {0.05, 0.0, 0.02, 0.03, 0.02};
+
+    SECTION("Results follow the order of the rates") {
+        auto results =
+            RunMonteCarloSweep("planar", 5, 1, probabilities, options);
+        REQUIRE(results.size() == probabilities.size());
+        for (size_t k = 0; k < results.size(); k++) {
+            REQUIRE(results[k].p == probabilities[k]);
+            REQUIRE(results[k].num_shots == 4000);
+            REQUIRE(results[k].code == "planar");
+        }
+        REQUIRE(results[1].num_failures == 0);
+        REQUIRE(results[2].num_failures == results[4].num_failures);
+        REQUIRE(results[2].num_failures < results[0].num_failures);
+    }
+
+    SECTION("Independent of the number of threads and the chunk size") {
+        options.num_threads = 1;
+        auto serial =
+            RunMonteCarloSweep("toric", 4, 2, probabilities, options);
+        options.num_threads = 3;
+        options.chunk_size = 99;
+        auto parallel =
+            RunMonteCarloSweep("toric", 4, 2, probabilities, options);
+        for (size_t k = 0; k < serial.size(); k++) {
+            REQUIRE(serial[k].num_failures == parallel[k].num_failures);
+        }
+    }
+
+    SECTION("Every rate matches an independent run") {
+        options.num_shots = 20000;
+        options.erasure_probability = 0.05;
+        std::vector<double> sweep = {0.01, 0.03, 0.05};
+        auto results = RunMonteCarloSweep("rotated", 5, 1, sweep, options);
+        for (size_t k = 0; k < sweep.size(); k++) {
+            auto independent =
+                RunMonteCarlo("rotated", 5, 1, sweep[k], options);
+            auto [low, high] = independent.GetConfidenceInterval(3.29);
+            REQUIRE(results[k].num_failures > 0);
+            REQUIRE(results[k].GetLogicalErrorRate() >= low);
+            REQUIRE(results[k].GetLogicalErrorRate() <= high);
+        }
+    }
+
+    SECTION("Invalid arguments") {
+        REQUIRE_THROWS_AS(RunMonteCarloSweep("planar", 3, 1, {0.1, 2.0},
+                                             options),
+                          std::invalid_argument);
+        options.bit_sliced = true;
+        REQUIRE_THROWS_AS(RunMonteCarloSweep("planar", 3, 1, {0.1}, options),
+                          std::invalid_argument);
+    }
+}
+
+TEST_CASE("Adaptive Monte Carlo runs") {
+    MonteCarloOptions options;
+    options.chunk_size = 256;
+    options.seed = 23;
+    StoppingRule rule;
+    rule.batch_size = 1000;
+    rule.max_shots = 20000;
+
+    SECTION("Stops at the target number of failures") {
+        rule.target_failures = 50;
+        auto result =
+            RunMonteCarloAdaptive("planar", 5, 1, 0.05, options, rule);
+        REQUIRE(result.stop_reason == "target_failures");
+        REQUIRE(result.num_failures >= 50);
+        REQUIRE(result.num_shots % 1000 == 0);
+        REQUIRE(result.num_shots < 20000);
+
+        // The same shots as a single run.
+        options.num_shots = result.num_shots;
+        options.num_threads = 3;
+        auto fixed = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        REQUIRE(fixed.num_failures == result.num_failures);
+    }
+
+    SECTION("Stops at the target relative error") {
+        rule.target_relative_error = 0.2;
+        rule.interval = Interval::ClopperPearson;
+        auto result =
+            RunMonteCarloAdaptive("toric", 4, 1, 0.05, options, rule);
+        REQUIRE(result.stop_reason == "target_relative_error");
+        auto [low, high] =
+            result.GetConfidenceInterval(Interval::ClopperPearson, 0.95);
+        REQUIRE((high - low) / 2 <= 0.2 * result.GetLogicalErrorRate());
+    }
+
+    SECTION("Stops at the budget") {
+        rule.target_failures = 10;
+        rule.max_shots = 2500;
+        auto result =
+            RunMonteCarloAdaptive("rotated", 5, 1, 0.0, options, rule);
+        REQUIRE(result.stop_reason == "max_shots");
+        REQUIRE(result.num_shots == 2500);
+        REQUIRE(result.num_failures == 0);
+    }
+
+    SECTION("Bit-sliced batches") {
+        options.bit_sliced = true;
+        rule.batch_size = 1000;
+        rule.target_failures = 20;
+        auto result =
+            RunMonteCarloAdaptive("planar", 5, 1, 0.05, options, rule);
+        REQUIRE(result.stop_reason == "target_failures");
+        REQUIRE(result.num_shots % 1024 == 0);
+        options.num_shots = result.num_shots;
+        auto fixed = RunMonteCarlo("planar", 5, 1, 0.05, options);
+        REQUIRE(fixed.num_failures == result.num_failures);
+    }
+
+    SECTION("Invalid arguments") {
+        rule.batch_size = 0;
+        REQUIRE_THROWS_AS(
+            RunMonteCarloAdaptive("planar", 5, 1, 0.05, options, rule),
+            std::invalid_argument);
+    }
+}
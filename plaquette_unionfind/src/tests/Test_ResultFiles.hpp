@@ -0,0 +1,158 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "ResultFiles.hpp"
+#include <catch2/catch.hpp>
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+TEST_CASE("Shard ranges") {
+    for (size_t alignment : {1, 64}) {
+        for (size_t num_shots : {0, 1, 1000, 1001}) {
+            size_t next = 0;
+            for (size_t shard = 0; shard < 7; shard++) {
+                auto [begin, end] =
+                    GetShardRange(num_shots, shard, 7, alignment);
+                REQUIRE(begin == next);
+                REQUIRE(begin <= end);
+                REQUIRE((begin % alignment == 0 || begin == num_shots));
+                next = end;
+            }
+            REQUIRE(next == num_shots);
+        }
+    }
+    REQUIRE_THROWS_AS(GetShardRange(100, 3, 3), std::invalid_argument);
+}
+
+TEST_CASE("Shot records") {
+    ShotRecord record;
+    record.code = "rotated";
+    record.distance = 7;
+    record.rounds = 7;
+    record.p = 0.1 + 0.2;
+    record.erasure_probability = 0.01;
+    record.seed = 12345678901234ULL;
+    record.coupled = true;
+    record.planned_shots = 3000;
+    record.first_shot = 5000;
+    record.num_shots = 1000;
+    record.num_failures = 17;
+    record.seconds = 0.25;
+
+    SECTION("Lines round trip") {
+        auto line = FormatShotRecord(record);
+        REQUIRE(line.find('\n') == std::string::npos);
+        ShotRecord parsed;
+        REQUIRE(ParseShotRecord(line, parsed));
+        REQUIRE(parsed.GetKey() == record.GetKey());
+        REQUIRE(parsed.planned_shots == 3000);
+        REQUIRE(parsed.first_shot == 5000);
+        REQUIRE(parsed.num_shots == 1000);
+        REQUIRE(parsed.num_failures == 17);
+        REQUIRE(parsed.seconds == 0.25);
+
+        REQUIRE_FALSE(ParseShotRecord(line.substr(0, line.size() - 1), parsed));
+        REQUIRE_FALSE(ParseShotRecord(line.substr(0, 40), parsed));
+        REQUIRE_FALSE(ParseShotRecord("", parsed));
+    }
+
+    SECTION("Merging and resuming") {
+        std::vector<ShotRecord> records;
+        for (size_t first : {2000, 0, 1000}) {
+            record.first_shot = first;
+            record.num_failures = first / 100;
+            records.push_back(record);
+        }
+        ShotRecord other = record;
+        other.p = 0.2;
+        other.planned_shots = 1000;
+        other.first_shot = 0;
+        records.push_back(other);
+
+        auto results = MergeShotRecords(records);
+        REQUIRE(results.size() == 2);
+        REQUIRE(results[0].code == "rotated");
+        REQUIRE(results[0].p == record.p);
+        REQUIRE(results[0].num_shots == 3000);
+        REQUIRE(results[0].num_failures == 30);
+        REQUIRE(results[1].num_shots == 1000);
+
+        // The last shard of a point is missing.
+        std::vector<ShotRecord> head(records.begin() + 1, records.end());
+        REQUIRE_THROWS_AS(MergeShotRecords(head), std::invalid_argument);
+        std::vector<std::string> gaps;
+        REQUIRE(MergeShotRecords(head, &gaps)[0].num_shots == 2000);
+        REQUIRE(gaps.size() == 1);
+        REQUIRE(gaps[0].find("[2000, 3000)") != std::string::npos);
+        REQUIRE(MergeShotRecords(head, nullptr, 0, 2000)[0].num_shots == 2000);
+        head.back().planned_shots = 2000;
+        gaps.clear();
+        REQUIRE(MergeShotRecords(head, &gaps).size() == 2);
+        REQUIRE(gaps.size() == 2);
+
+        REQUIRE(GetResumeShot(records, record, 0, 5000) == 3000);
+        REQUIRE(GetResumeShot(records, record, 0, 2500) == 2500);
+        REQUIRE(GetResumeShot(records, record, 3000, 5000) == 3000);
+        REQUIRE(GetResumeShot(records, other, 0, 5000) == 1000);
+        records.erase(records.begin() + 1);
+        REQUIRE_THROWS_AS(GetResumeShot(records, record, 0, 5000),
+                          std::invalid_argument);
+
+        REQUIRE_THROWS_AS(MergeShotRecords(records), std::invalid_argument);
+        gaps.clear();
+        auto partial = MergeShotRecords(records, &gaps);
+        REQUIRE(partial[0].num_shots == 2000);
+        REQUIRE(gaps.size() == 1);
+        REQUIRE(gaps[0].find("[0, 1000)") != std::string::npos);
+        std::vector<ShotRecord> shard(records.begin(), records.begin() + 2);
+        REQUIRE(MergeShotRecords(shard, nullptr, 1000)[0].num_shots == 2000);
+
+        records.push_back(records[0]);
+        REQUIRE_THROWS_AS(MergeShotRecords(records, &gaps),
+                          std::invalid_argument);
+    }
+
+    SECTION("Appending after an interrupted line") {
+        auto path = (std::filesystem::temp_directory_path() /
+                     "plaquette_unionfind_records.jsonl")
+                        .string();
+        {
+            std::ofstream out(path, std::ios::trunc);
+            record.first_shot = 0;
+            out << FormatShotRecord(record) << "\n"
+                << FormatShotRecord(record).substr(0, 30);
+        }
+        REQUIRE(ReadShotRecords(path).size() == 1);
+        {
+            ShotRecordWriter writer(path);
+            record.first_shot = 1000;
+            writer.Write(record);
+        }
+        auto records = ReadShotRecords(path);
+        REQUIRE(records.size() == 2);
+        REQUIRE(records[1].first_shot == 1000);
+        std::remove(path.c_str());
+        REQUIRE(ReadShotRecords(path).empty());
+    }
+}
+
+TEST_CASE("Sharded Monte Carlo runs") {
+    MonteCarloOptions options;
+    options.num_shots = 3000;
+    options.seed = 6;
+    options.bit_sliced = GENERATE(false, true);
+    auto full = RunMonteCarlo("planar", 5, 1, 0.05, options);
+
+    size_t num_failures = 0;
+    for (size_t shard = 0; shard < 4; shard++) {
+        auto [begin, end] = GetShardRange(3000, shard, 4,
+                                          options.bit_sliced ? 64 : 1);
+        options.first_shot = begin;
+        options.num_shots = end - begin;
+        num_failures += RunMonteCarlo("planar", 5, 1, 0.05, options)
+                            .num_failures;
+    }
+    REQUIRE(num_failures == full.num_failures);
+}
@@ -0,0 +1,86 @@
+#include "SampleFormats.hpp"
+#include <catch2/catch.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Plaquette;
+
+namespace {
+std::vector<bool> ReadAll(const std::string &data, size_t num_bits,
+                          SampleFormat format) {
+    SampleReader reader(data.data(), data.size(), num_bits, format);
+    std::vector<bool> all;
+    std::vector<bool> shot;
+    while (reader.ReadShot(shot)) {
+        all.insert(all.end(), shot.begin(), shot.end());
+    }
+    return all;
+}
+} // namespace
+
+TEST_CASE("Sample formats encode shots like Stim", "[SampleFormats]") {
+    std::vector<bool> shot = {false, false, true, false};
+
+    SECTION("01") {
+        std::string out;
+        WriteShot(out, shot, SampleFormat::ZeroOne);
+        REQUIRE(out == "0010\n");
+    }
+
+    SECTION("b8") {
+        std::string out;
+        WriteShot(out, shot, SampleFormat::B8);
+        REQUIRE(out == std::string(1, '\x04'));
+    }
+
+    SECTION("r8") {
+        std::string out;
+        WriteShot(out, shot, SampleFormat::R8);
+        REQUIRE(out == std::string("\x02\x01", 2));
+
+        std::vector<bool> long_run(300, false);
+        long_run[255] = true;
+        out.clear();
+        WriteShot(out, long_run, SampleFormat::R8);
+        REQUIRE(out == std::string("\xff\x00\x2c", 3));
+    }
+
+    SECTION("Observable masks") {
+        std::string out;
+        WriteShot(out, uint64_t(0b101), 3, SampleFormat::ZeroOne);
+        REQUIRE(out == "101\n");
+    }
+}
+
+TEST_CASE("Sample formats round trip", "[SampleFormats]") {
+    std::mt19937 gen(7);
+    std::bernoulli_distribution dist(0.1);
+    size_t num_bits = GENERATE(1, 8, 13, 600);
+    size_t num_shots = 50;
+
+    std::vector<bool> expected;
+    for (size_t i = 0; i < num_bits * num_shots; i++) {
+        expected.push_back(dist(gen));
+    }
+
+    for (auto format :
+         {SampleFormat::ZeroOne, SampleFormat::B8, SampleFormat::R8}) {
+        std::string data;
+        for (size_t s = 0; s < num_shots; s++) {
+            std::vector<bool> shot(expected.begin() + s * num_bits,
+                                   expected.begin() + (s + 1) * num_bits);
+            WriteShot(data, shot, format);
+        }
+        REQUIRE(ReadAll(data, num_bits, format) == expected);
+    }
+}
+
+TEST_CASE("Sample formats reject malformed data", "[SampleFormats]") {
+    REQUIRE_THROWS(ParseSampleFormat("ptb64"));
+    REQUIRE_THROWS(ReadAll("0010", 4, SampleFormat::ZeroOne));
+    REQUIRE_THROWS(ReadAll("0x10\n", 4, SampleFormat::ZeroOne));
+    REQUIRE_THROWS(ReadAll(std::string("\x05", 1), 4, SampleFormat::R8));
+    REQUIRE_THROWS(ReadAll(std::string("\x01", 1), 16, SampleFormat::B8));
+}
@@ -0,0 +1,194 @@
+#include "PlanarCode.hpp"
+#include "SpaceTimeSampler.hpp"
+#include "UnionFindDecoder.hpp"
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace Plaquette;
+using namespace Plaquette::Decoders;
+
+TEST_CASE("Space-time sampler on a small graph") {
+    // Detectors 0 and 1 and boundary vertex 2.
+    std::vector<std::pair<size_t, size_t>> edges = {{0, 1}, {1, 2}, {0, 2}};
+    DecodingGraph graph(3, edges, {false, false, true});
+
+    SpaceTimeSampler sampler(graph, {1.0, 0.0, 1.0}, {0, 0, 1}, 1);
+    std::vector<uint64_t> detection_events;
+    REQUIRE(sampler.Sample(detection_events) == 1);
+    REQUIRE(sampler.GetFlippedEdges() == std::vector<size_t>{0, 2});
+    // Vertex 0 is flipped twice and the boundary never fires.
+    REQUIRE(detection_events == std::vector<uint64_t>{0b010});
+
+    std::vector<bool> syndrome;
+    REQUIRE(sampler.Sample(syndrome) == 1);
+    REQUIRE(syndrome == std::vector<bool>{false, true, false});
+
+    std::vector<uint8_t> correction = {1, 0, 1};
+    REQUIRE(sampler.GetObservableFlips(correction) == 1);
+
+    REQUIRE_THROWS_AS(SpaceTimeSampler(graph, {0.1, 0.1}, {}, 1),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(SpaceTimeSampler(graph, {0.1, 0.1, 0.1}, {0, 0, 0, 1}, 1),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Space-time sampler on a phenomenological planar code") {
+    size_t distance = 5;
+    size_t rounds = 5;
+    PlanarCode code(distance, rounds);
+    const auto &graph = code.GetZStabilizerDecodingGraph();
+    size_t num_qubits = distance * distance + (distance - 1) * (distance - 1);
+    size_t num_stabilizers = distance * (distance - 1);
+
+    // Different data error rates per round and measurement rates per
+    // stabilizer.
+    std::vector<double> data(rounds * num_qubits);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = 0.01 + 0.002 * (i / num_qubits);
+    }
+    std::vector<double> measurement(num_stabilizers);
+    for (size_t s = 0; s < num_stabilizers; s++) {
+        measurement[s] = s % 2 == 0 ? 0.02 : 0.005;
+    }
+    auto probabilities = ErrorModels::GetSpaceTimeProbabilities(
+        data, measurement, num_qubits, num_stabilizers, rounds);
+    REQUIRE(probabilities.size() == graph.GetNumEdges());
+
+    auto sampler = SpaceTimeSampler<PhiloxGenerator>::FromCode(
+        code, probabilities, PhiloxGenerator(7));
+    REQUIRE(sampler.GetNumVertices() == graph.GetNumVertices());
+    UnionFindDecoder decoder(graph, sampler.GetGrowthIncrements());
+
+    std::vector<uint64_t> detection_events;
+    std::vector<uint64_t> expected_events;
+    std::vector<bool> syndrome;
+    std::vector<uint8_t> correction(graph.GetNumEdges());
+    size_t num_flips = 0;
+    size_t num_shots = 2000;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        sampler.GetGenerator().Seek(shot, 0);
+        auto observables = sampler.Sample(detection_events);
+        std::vector<size_t> flipped = sampler.GetFlippedEdges();
+        num_flips += flipped.size();
+
+        // The events and observables are those of the flipped edges.
+        code.MeasureSyndrome(flipped, StabilizerCode::Stabilizer::Z,
+                             expected_events);
+        REQUIRE(detection_events == expected_events);
+        REQUIRE((observables != 0) ==
+                code.MeasureLogical(flipped, StabilizerCode::Channel::Z));
+
+        // Seeking back reproduces the shot as a decoder syndrome.
+        sampler.GetGenerator().Seek(shot, 0);
+        REQUIRE(sampler.Sample(syndrome) == observables);
+        REQUIRE(sampler.GetFlippedEdges() == flipped);
+        decoder.Decode(syndrome, correction);
+        bool failed =
+            (observables ^ sampler.GetObservableFlips(correction)) != 0;
+        REQUIRE(failed == code.MeasureResidualLogical(
+                              flipped, correction, StabilizerCode::Channel::Z));
+    }
+    double expected_flips = 0.0;
+    for (auto p : probabilities) {
+        expected_flips += p;
+    }
+    REQUIRE(static_cast<double>(num_flips) / num_shots ==
+            Approx(expected_flips).epsilon(0.03));
+}
+
+TEST_CASE("Space-time sampler on a detector error model") {
+    auto dem = DetectorErrorModel::FromString("error(0.2) D0 D1 L0\n"
+                                              "error(0.1) D1 D2\n"
+                                              "error(0.05) D2\n"
+                                              "error(0.3) D0\n");
+    auto sampler = SpaceTimeSampler<>::FromDetectorErrorModel(
+        dem, Xoshiro256PlusPlus(3));
+    REQUIRE(sampler.GetNumEdges() == 4);
+
+    std::vector<bool> syndrome;
+    std::vector<size_t> counts(dem.GetNumDetectors(), 0);
+    size_t num_observable_flips = 0;
+    size_t num_shots = 20000;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        num_observable_flips += sampler.Sample(syndrome);
+        for (size_t v = dem.GetNumDetectors(); v < syndrome.size(); v++) {
+            REQUIRE(!syndrome[v]);
+        }
+        for (size_t d = 0; d < dem.GetNumDetectors(); d++) {
+            counts[d] += syndrome[d];
+        }
+    }
+    // A detector fires if an odd number of its errors occurs.
+    auto odd = [](double p, double q) { return p * (1 - q) + q * (1 - p); };
+    REQUIRE(static_cast<double>(num_observable_flips) / num_shots ==
+            Approx(0.2).epsilon(0.05));
+    REQUIRE(static_cast<double>(counts[0]) / num_shots ==
+            Approx(odd(0.2, 0.3)).epsilon(0.05));
+    REQUIRE(static_cast<double>(counts[1]) / num_shots ==
+            Approx(odd(0.2, 0.1)).epsilon(0.05));
+    REQUIRE(static_cast<double>(counts[2]) / num_shots ==
+            Approx(odd(0.1, 0.05)).epsilon(0.05));
+}
+
+TEST_CASE("Space-time sampler draws undetectable errors") {
+    auto dem = DetectorErrorModel::FromString("error(0.1) D0 D1\n"
+                                              "error(0.05) L0\n"
+                                              "error(0.2) D1 L1\n");
+    auto sampler = SpaceTimeSampler<>::FromDetectorErrorModel(
+        dem, Xoshiro256PlusPlus(5));
+    REQUIRE(sampler.GetNumEdges() == 2);
+    REQUIRE(sampler.GetEdgeProbabilities().size() == 2);
+    REQUIRE(sampler.GetGrowthIncrements().size() == 2);
+
+    std::vector<uint64_t> detection_events;
+    size_t num_shots = 40000;
+    size_t num_l0_flips = 0;
+    size_t num_l1_flips = 0;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        uint64_t observables = sampler.Sample(detection_events);
+        num_l0_flips += observables & 1;
+        num_l1_flips += (observables >> 1) & 1;
+        for (auto e : sampler.GetFlippedEdges()) {
+            REQUIRE(e < sampler.GetNumEdges());
+        }
+    }
+    REQUIRE(static_cast<double>(num_l0_flips) / num_shots ==
+            Approx(0.05).epsilon(0.1));
+    REQUIRE(static_cast<double>(num_l1_flips) / num_shots ==
+            Approx(0.2).epsilon(0.05));
+}
+
+TEST_CASE("Space-time sampler keeps decomposed errors correlated") {
+    // error(0.1) D0 D1 ^ D2 L0, error(0.2) D0 D1 and error(0.05) D2, whose
+    // edges are merged into D0-D1 and D2-boundary.
+    auto dem = DetectorErrorModel::FromFile(
+        std::string(PLAQUETTE_UNIONFIND_TEST_DATA_DIR) + "/decomposed.dem");
+    REQUIRE(dem.GetErrorMechanisms().size() == 3);
+    REQUIRE(dem.GetErrorMechanisms()[0].edges.size() == 2);
+    auto sampler = SpaceTimeSampler<>::FromDetectorErrorModel(
+        dem, Xoshiro256PlusPlus(11));
+
+    std::vector<bool> syndrome;
+    size_t num_shots = 100000;
+    size_t num_all_fire = 0;
+    size_t num_d0_fires = 0;
+    size_t num_l0_flips = 0;
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        uint64_t observables = sampler.Sample(syndrome);
+        num_all_fire += syndrome[0] && syndrome[1] && syndrome[2];
+        num_d0_fires += syndrome[0];
+        num_l0_flips += observables & 1;
+        REQUIRE(syndrome[0] == syndrome[1]);
+    }
+    // All detectors fire if the decomposed error occurs alone, or both
+    // other errors occur without it. Independent merged edges would give
+    // 0.26 * 0.14 instead, and flip L0 with the D2 edge at rate 0.14.
+    double all_fire = 0.1 * 0.8 * 0.95 + 0.9 * 0.2 * 0.05;
+    REQUIRE(static_cast<double>(num_all_fire) / num_shots ==
+            Approx(all_fire).epsilon(0.05));
+    REQUIRE(static_cast<double>(num_d0_fires) / num_shots ==
+            Approx(0.1 * 0.8 + 0.9 * 0.2).epsilon(0.03));
+    REQUIRE(static_cast<double>(num_l0_flips) / num_shots ==
+            Approx(0.1).epsilon(0.05));
+}
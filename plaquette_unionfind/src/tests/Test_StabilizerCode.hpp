@@ -1,6 +1,12 @@
+#include "ErrorModels.hpp"
 #include "LatticeVisualizer.hpp"
+#include "PlanarCode.hpp"
+#include "RotatedPlanarCode.hpp"
 #include "StabilizerCode.hpp"
 #include "ToricCode.hpp"
+#include "UnionFindDecoder.hpp"
+#include <algorithm>
+#include <array>
 #include <catch2/catch.hpp>
 
 using namespace Plaquette;
@@ -104,3 +110,297 @@ TEST_CASE("StabilizerCode tests") {
         }
     }
 }
+
+TEST_CASE("ToricCode with measurement rounds") {
+    ToricCode tc(4, 3);
+    const auto &graph = tc.GetZStabilizerDecodingGraph();
+    REQUIRE(tc.GetNumOfQubits() == 2 * 4 * 4);
+    REQUIRE(tc.GetNumRounds() == 3);
+    REQUIRE(graph.GetNumVertices() == 3 * 16);
+    REQUIRE(graph.GetNumEdges() == 3 * 32 + 2 * 16);
+
+    // The single round error of "StabilizerCode tests" in the last round.
+    std::vector<bool> errors(graph.GetNumEdges(), false);
+    errors[2 * 32 + 24] = true;
+    auto syndrome = tc.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+    REQUIRE(syndrome[2 * 16 + 12] == true);
+    REQUIRE(syndrome[2 * 16 + 15] == true);
+    REQUIRE(tc.MeasureLogical(errors, StabilizerCode::Channel::X));
+
+    // A measurement error is detected by the two rounds it separates.
+    std::fill(errors.begin(), errors.end(), false);
+    errors[3 * 32 + 16 + 5] = true;
+    syndrome = tc.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+    REQUIRE(std::count(syndrome.begin(), syndrome.end(), true) == 2);
+    REQUIRE(syndrome[16 + 5] == true);
+    REQUIRE(syndrome[2 * 16 + 5] == true);
+    REQUIRE_THROWS_AS(ToricCode(4, 0), std::invalid_argument);
+}
+
+TEST_CASE("PlanarCode") {
+
+    SECTION("Single round graph sizes") {
+        PlanarCode pc(4);
+        const auto &graph = pc.GetZStabilizerDecodingGraph();
+        REQUIRE(pc.GetNumOfQubits() == 4 * 4 + 3 * 3);
+        REQUIRE(graph.GetNumVertices() == 4 * 3 + 2 * 4);
+        REQUIRE(graph.GetNumEdges() == 25);
+        REQUIRE(pc.GetXStabilizerDecodingGraph().GetNumEdges() == 25);
+        REQUIRE(pc.GetCodeDistance() == 4);
+    }
+
+    SECTION("Space-time graph sizes") {
+        PlanarCode pc(5, 4);
+        const auto &graph = pc.GetZStabilizerDecodingGraph();
+        REQUIRE(graph.GetNumVertices() == 4 * (5 * 4 + 2 * 5));
+        REQUIRE(graph.GetNumEdges() == 4 * 41 + 3 * 20);
+        REQUIRE(graph.GetVerticesConnectedByEdge(4 * 41) ==
+                std::make_pair<size_t, size_t>(0, 30));
+    }
+
+    SECTION("Logical operators have no syndrome") {
+        PlanarCode pc(5, 3);
+        const auto &graph = pc.GetZStabilizerDecodingGraph();
+
+        // A column of X errors from the top to the bottom boundary in the
+        // second round.
+        std::vector<bool> errors(graph.GetNumEdges(), false);
+        for (size_t y = 0; y < 9; y += 2) {
+            errors[41 + (y / 2) * 9] = true;
+        }
+        auto syndrome =
+            pc.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+        for (size_t v = 0; v < syndrome.size(); v++) {
+            REQUIRE(syndrome[v] == false);
+        }
+        REQUIRE(pc.MeasureLogical(errors, StabilizerCode::Channel::Z));
+
+        // A measurement error is detected by the two rounds it separates.
+        std::fill(errors.begin(), errors.end(), false);
+        errors[3 * 41 + 7] = true;
+        syndrome = pc.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+        REQUIRE(syndrome[7] == true);
+        REQUIRE(syndrome[30 + 7] == true);
+        REQUIRE(pc.MeasureLogical(errors, StabilizerCode::Channel::Z) ==
+                false);
+    }
+
+    SECTION("Decoded residuals have no syndrome") {
+        PlanarCode pc(7, 6);
+        const auto &graph = pc.GetZStabilizerDecodingGraph();
+        Decoders::UnionFindDecoder decoder(graph);
+        for (size_t i = 0; i < 50; i++) {
+            ErrorModels::BitFlipErrorModel error_model(graph.GetNumEdges(),
+                                                       0.03, 99 + i);
+            auto errors = error_model.GetErrors();
+            auto syndrome =
+                pc.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+            auto correction = decoder.Decode(syndrome);
+            for (size_t e = 0; e < errors.size(); e++) {
+                errors[e] = errors[e] ^ correction[e];
+            }
+            syndrome =
+                pc.MeasureSyndrome(errors, StabilizerCode::Stabilizer::Z);
+            for (size_t v = 0; v < syndrome.size(); v++) {
+                REQUIRE(syndrome[v] == false);
+            }
+        }
+    }
+}
+
+TEST_CASE("RotatedPlanarCode") {
+
+    SECTION("Single round graph sizes") {
+        for (size_t d : {2, 3, 5, 8}) {
+            RotatedPlanarCode rpc(d);
+            const auto &z_graph = rpc.GetZStabilizerDecodingGraph();
+            const auto &x_graph = rpc.GetXStabilizerDecodingGraph();
+            size_t num_stabilizers = (d * d - 1) / 2;
+            if (d % 2 == 0) {
+                // Even distances have one stabilizer more of one type.
+                num_stabilizers = rpc.GetZStabilizerCoords().size();
+                REQUIRE(rpc.GetXStabilizerCoords().size() +
+                            num_stabilizers ==
+                        d * d - 1);
+            }
+            REQUIRE(rpc.GetNumOfQubits() == d * d);
+            REQUIRE(rpc.GetZStabilizerCoords().size() == num_stabilizers);
+            REQUIRE(z_graph.GetNumVertices() == num_stabilizers + 2 * d);
+            REQUIRE(z_graph.GetNumEdges() == d * d);
+            REQUIRE(x_graph.GetNumEdges() == d * d);
+            REQUIRE(rpc.GetCodeDistance() == d);
+
+            // Stabilizers have weight 2 or 4, boundary vertices weight 1.
+            for (size_t v = 0; v < z_graph.GetNumVertices(); v++) {
+                size_t degree = z_graph.GetEdgesTouchingVertex(v).size();
+                if (z_graph.IsVertexOnBoundary(v)) {
+                    REQUIRE(degree == 1);
+                } else {
+                    REQUIRE((degree == 2 || degree == 4));
+                }
+            }
+        }
+    }
+
+    SECTION("Space-time graph sizes") {
+        RotatedPlanarCode rpc(5, 4);
+        const auto &graph = rpc.GetXStabilizerDecodingGraph();
+        REQUIRE(rpc.GetNumRounds() == 4);
+        REQUIRE(graph.GetNumVertices() == 4 * (12 + 2 * 5));
+        REQUIRE(graph.GetNumEdges() == 4 * 25 + 3 * 12);
+        REQUIRE(graph.GetVerticesConnectedByEdge(4 * 25 + 12) ==
+                std::make_pair<size_t, size_t>(22, 44));
+    }
+
+    SECTION("Logical operators have no syndrome") {
+        RotatedPlanarCode rpc(5, 3);
+        size_t num_edges = rpc.GetZStabilizerDecodingGraph().GetNumEdges();
+
+        // A column of X errors in the second round and a row of Z errors in
+        // the third.
+        std::vector<bool> x_errors(num_edges, false);
+        std::vector<bool> z_errors(num_edges, false);
+        for (size_t k = 0; k < 5; k++) {
+            x_errors[25 + k * 5 + 2] = true;
+            z_errors[2 * 25 + 3 * 5 + k] = true;
+        }
+        auto z_syndrome =
+            rpc.MeasureSyndrome(x_errors, StabilizerCode::Stabilizer::Z);
+        auto x_syndrome =
+            rpc.MeasureSyndrome(z_errors, StabilizerCode::Stabilizer::X);
+        for (size_t v = 0; v < z_syndrome.size(); v++) {
+            REQUIRE(z_syndrome[v] == false);
+            REQUIRE(x_syndrome[v] == false);
+        }
+        REQUIRE(rpc.MeasureLogical(x_errors, StabilizerCode::Channel::Z));
+        REQUIRE(rpc.MeasureLogical(z_errors, StabilizerCode::Channel::X));
+
+        // A single error is detected.
+        std::fill(x_errors.begin(), x_errors.end(), false);
+        x_errors[25 + 12] = true;
+        z_syndrome =
+            rpc.MeasureSyndrome(x_errors, StabilizerCode::Stabilizer::Z);
+        REQUIRE(std::count(z_syndrome.begin(), z_syndrome.end(), true) == 2);
+    }
+
+    SECTION("Decoded residuals have no syndrome") {
+        RotatedPlanarCode rpc(7, 7);
+        for (auto stabilizer :
+             {StabilizerCode::Stabilizer::Z, StabilizerCode::Stabilizer::X}) {
+            const auto &graph = stabilizer == StabilizerCode::Stabilizer::Z
+                                    ? rpc.GetZStabilizerDecodingGraph()
+                                    : rpc.GetXStabilizerDecodingGraph();
+            Decoders::UnionFindDecoder decoder(graph);
+            for (size_t i = 0; i < 50; i++) {
+                ErrorModels::BitFlipErrorModel error_model(graph.GetNumEdges(),
+                                                           0.03, 7 + i);
+                auto errors = error_model.GetErrors();
+                auto syndrome = rpc.MeasureSyndrome(errors, stabilizer);
+                auto correction = decoder.Decode(syndrome);
+                for (size_t e = 0; e < errors.size(); e++) {
+                    errors[e] = errors[e] ^ correction[e];
+                }
+                syndrome = rpc.MeasureSyndrome(errors, stabilizer);
+                for (size_t v = 0; v < syndrome.size(); v++) {
+                    REQUIRE(syndrome[v] == false);
+                }
+            }
+        }
+    }
+
+    SECTION("Invalid sizes") {
+        REQUIRE_THROWS_AS(RotatedPlanarCode(1), std::invalid_argument);
+        REQUIRE_THROWS_AS(RotatedPlanarCode(3, 0), std::invalid_argument);
+    }
+}
+
+template <typename Code> void CheckSparseMeasurements(const Code &code) {
+    for (auto stabilizer :
+         {StabilizerCode::Stabilizer::Z, StabilizerCode::Stabilizer::X}) {
+        auto channel = stabilizer == StabilizerCode::Stabilizer::Z
+                           ? StabilizerCode::Channel::Z
+                           : StabilizerCode::Channel::X;
+        const auto &graph = stabilizer == StabilizerCode::Stabilizer::Z
+                                ? code.GetZStabilizerDecodingGraph()
+                                : code.GetXStabilizerDecodingGraph();
+        size_t num_edges = graph.GetNumEdges();
+        Decoders::UnionFindDecoder decoder(graph);
+        ErrorModels::GeometricBitFlipErrorModel error_model(num_edges, 0.05,
+                                                            21);
+        std::vector<size_t> flipped;
+        std::vector<uint64_t> packed_syndrome;
+        std::vector<bool> sparse_syndrome;
+        std::vector<uint8_t> correction(num_edges);
+        for (size_t shot = 0; shot < 30; shot++) {
+            error_model.GetErrors(flipped);
+            std::vector<bool> errors(num_edges, false);
+            for (auto e : flipped) {
+                errors[e] = true;
+            }
+
+            auto syndrome = code.MeasureSyndrome(errors, stabilizer);
+            code.MeasureSyndrome(flipped, stabilizer, packed_syndrome);
+            code.MeasureSyndrome(flipped, stabilizer, sparse_syndrome);
+            REQUIRE(sparse_syndrome == syndrome);
+            for (size_t v = 0; v < syndrome.size(); v++) {
+                REQUIRE(GetPackedBit(packed_syndrome, v) == syndrome[v]);
+            }
+            REQUIRE(code.MeasureLogical(flipped, channel) ==
+                    code.MeasureLogical(errors, channel));
+
+            decoder.Decode(syndrome, correction);
+            for (size_t e = 0; e < num_edges; e++) {
+                errors[e] = errors[e] ^ static_cast<bool>(correction[e]);
+            }
+            REQUIRE(code.MeasureResidualLogical(flipped, correction,
+                                                channel) ==
+                    code.MeasureLogical(errors, channel));
+        }
+
+        // 64 shots bit-sliced into one word per edge agree with the shots
+        // measured one at a time.
+        ErrorModels::GeometricBitFlipErrorModel sliced_model(64 * num_edges,
+                                                             0.05, 22);
+        std::vector<uint64_t> error_words;
+        std::vector<uint64_t> syndrome_words;
+        std::vector<uint64_t> logical_words;
+        sliced_model.GetPackedErrors(error_words);
+        code.MeasureBitSlicedSyndrome(error_words, stabilizer, syndrome_words);
+        code.MeasureBitSlicedLogicals(error_words, channel, logical_words);
+        std::array<std::vector<size_t>, 64> lane_errors;
+        std::array<std::vector<size_t>, 64> lane_defects;
+        UnpackBitSlices(error_words, ~uint64_t{0}, lane_errors);
+        UnpackBitSlices(syndrome_words, ~uint64_t{0}, lane_defects);
+        for (size_t lane = 0; lane < 64; lane++) {
+            code.MeasureSyndrome(lane_errors[lane], stabilizer,
+                                 sparse_syndrome);
+            std::vector<size_t> defects;
+            for (size_t v = 0; v < sparse_syndrome.size(); v++) {
+                if (sparse_syndrome[v]) {
+                    defects.push_back(v);
+                }
+            }
+            REQUIRE(defects == lane_defects[lane]);
+            bool flipped_logical = false;
+            for (auto word : logical_words) {
+                flipped_logical |= (word >> lane) & 1;
+            }
+            REQUIRE(flipped_logical ==
+                    code.MeasureLogical(lane_errors[lane], channel));
+        }
+
+        // Listing an edge twice cancels it.
+        std::vector<size_t> twice = {3, 3};
+        code.MeasureSyndrome(twice, stabilizer, sparse_syndrome);
+        REQUIRE(std::count(sparse_syndrome.begin(), sparse_syndrome.end(),
+                           true) == 0);
+    }
+}
+
+TEST_CASE("Sparse syndrome and logical measurements") {
+    SECTION("PlanarCode") { CheckSparseMeasurements(PlanarCode(5, 3)); }
+    SECTION("RotatedPlanarCode") {
+        CheckSparseMeasurements(RotatedPlanarCode(5, 3));
+    }
+    SECTION("ToricCode") { CheckSparseMeasurements(ToricCode(4, 2)); }
+}
@@ -0,0 +1,118 @@
+#include "Threshold.hpp"
+#include <catch2/catch.hpp>
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+namespace {
+
+/// Rates of the scaling ansatz with 10^8 shots per point.
+std::vector<MonteCarloResult> GetScalingRates(double threshold, double nu) {
+    std::vector<MonteCarloResult> results;
+    for (size_t distance : {5, 7, 9, 11}) {
+        for (int i = 0; i < 9; i++) {
+            double p = 0.08 + 0.005 * i;
+            double x = (p - threshold) * std::pow(distance, 1.0 / nu);
+            double rate = 0.1 + 0.2 * x + 0.3 * x * x;
+            MonteCarloResult result;
+            result.distance = distance;
+            result.p = p;
+            result.num_shots = 100000000;
+            result.num_failures = std::llround(rate * result.num_shots);
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+} // namespace
+
+TEST_CASE("Linear systems") {
+    std::array<std::array<double, 3>, 3> matrix = {
+        {{0.0, 2.0, 1.0}, {1.0, 1.0, 0.0}, {3.0, 0.0, 1.0}}};
+    std::array<double, 3> rhs = {5.0, 3.0, 6.0};
+    REQUIRE(SolveLinearSystem(matrix, rhs));
+    REQUIRE(rhs[0] == Approx(1.4));
+    REQUIRE(rhs[1] == Approx(1.6));
+    REQUIRE(rhs[2] == Approx(1.8));
+
+    std::array<std::array<double, 2>, 2> singular = {{{1.0, 2.0}, {2.0, 4.0}}};
+    std::array<double, 2> singular_rhs = {1.0, 2.0};
+    REQUIRE_FALSE(SolveLinearSystem(singular, singular_rhs));
+}
+
+TEST_CASE("Threshold fits") {
+    auto results = GetScalingRates(0.1, 1.4);
+
+    SECTION("Crossing of two distances") {
+        double crossing = FindCrossing(results, 5, 11);
+        REQUIRE(crossing == Approx(0.1).margin(1e-3));
+        REQUIRE(FindCrossing(results, 5, 13) < 0.0);
+    }
+
+    SECTION("Finite-size scaling") {
+        auto fit = FitThreshold(results);
+        REQUIRE(fit.converged);
+        REQUIRE(fit.degrees_of_freedom == results.size() - 5);
+        REQUIRE(fit.threshold == Approx(0.1).margin(1e-4));
+        REQUIRE(fit.nu == Approx(1.4).epsilon(0.02));
+        REQUIRE(fit.coefficients[0] == Approx(0.1).epsilon(0.01));
+        REQUIRE(fit.threshold_error > 0.0);
+        REQUIRE(fit.threshold_error < 1e-3);
+    }
+
+    SECTION("Too few points") {
+        results.resize(9);
+        REQUIRE_FALSE(FitThreshold(results).converged);
+    }
+}
+
+TEST_CASE("Threshold search") {
+    ThresholdOptions options;
+    options.distances = {4, 6};
+    options.min_p = 0.05;
+    options.max_p = 0.15;
+    options.num_points = 5;
+    options.num_iterations = 3;
+    options.stopping_rule.max_shots = 4000;
+    options.stopping_rule.batch_size = 2000;
+    options.monte_carlo.seed = 2;
+
+    SECTION("Converges to the crossing") {
+        options.monte_carlo.num_threads = 1;
+        auto serial = FindThreshold("toric", options);
+        REQUIRE(serial.fit.converged);
+        REQUIRE(serial.fit.threshold > 0.08);
+        REQUIRE(serial.fit.threshold < 0.12);
+        REQUIRE(serial.max_p - serial.min_p < 0.1);
+        REQUIRE(serial.min_p <= serial.fit.threshold);
+        REQUIRE(serial.fit.threshold <= serial.max_p);
+
+        // Points in the final window were continued.
+        size_t max_shots = 0;
+        for (const auto &point : serial.points) {
+            max_shots = std::max(max_shots, point.num_shots);
+        }
+        REQUIRE(max_shots > 4000);
+
+        options.monte_carlo.num_threads = 3;
+        auto parallel = FindThreshold("toric", options);
+        REQUIRE(parallel.points.size() == serial.points.size());
+        for (size_t i = 0; i < serial.points.size(); i++) {
+            REQUIRE(parallel.points[i].num_shots == serial.points[i].num_shots);
+            REQUIRE(parallel.points[i].num_failures ==
+                    serial.points[i].num_failures);
+        }
+        REQUIRE(parallel.fit.threshold == serial.fit.threshold);
+    }
+
+    SECTION("Invalid arguments") {
+        options.distances = {5};
+        REQUIRE_THROWS_AS(FindThreshold("toric", options),
+                          std::invalid_argument);
+        options.distances = {5, 7};
+        options.min_p = 0.2;
+        REQUIRE_THROWS_AS(FindThreshold("toric", options),
+                          std::invalid_argument);
+    }
+}
@@ -265,6 +265,95 @@ TEST_CASE("UnionFind ToricCode Class Size=5") {
     }
 }
 
+TEST_CASE("UnionFind decoder reused across shots") {
+
+    size_t num_trials = 200;
+    size_t num_qubits = 2 * 7 * 7;
+    ToricCode tc(7);
+    const auto &decoding_graph = tc.GetZStabilizerDecodingGraph();
+
+    Decoders::UnionFindDecoder reused_decoder(decoding_graph);
+    for (size_t i = 0; i < num_trials; i++) {
+        BitFlipErrorModel error_model(num_qubits, 0.12, 4242 + 17 * i);
+        const auto &error = error_model.GetErrors();
+        std::vector<bool> syndrome = MeasureSyndrome(decoding_graph, error);
+        // Peeling consumes the syndrome, so each decoder gets its own copy.
+        std::vector<bool> syndrome_copy = syndrome;
+
+        Decoders::UnionFindDecoder fresh_decoder(decoding_graph);
+        auto expected = fresh_decoder.Decode(syndrome);
+        auto correction = reused_decoder.Decode(syndrome_copy);
+        REQUIRE(correction == expected);
+    }
+}
+
+TEST_CASE("UnionFind decoder statistics") {
+
+    size_t num_trials = 50;
+    size_t num_qubits = 2 * 7 * 7;
+    ToricCode tc(7);
+    const auto &decoding_graph = tc.GetZStabilizerDecodingGraph();
+
+    Decoders::UnionFindDecoder decoder_0(decoding_graph);
+    Decoders::UnionFindDecoder decoder_1(decoding_graph);
+    size_t num_defects = 0;
+    for (size_t i = 0; i < num_trials; i++) {
+        BitFlipErrorModel error_model(num_qubits, 0.1, 777 + 13 * i);
+        const auto &error = error_model.GetErrors();
+        std::vector<bool> syndrome = MeasureSyndrome(decoding_graph, error);
+        num_defects += std::accumulate(syndrome.begin(), syndrome.end(), 0);
+        auto &decoder = (i % 2 == 0) ? decoder_0 : decoder_1;
+        decoder.Decode(syndrome);
+    }
+
+    DecoderStatistics total = decoder_0.GetStatistics();
+    total.Merge(decoder_1.GetStatistics());
+
+    if constexpr (DecoderStatistics::kEnabled) {
+        REQUIRE(total.num_shots == num_trials);
+        REQUIRE(total.num_growth_iterations > 0);
+        REQUIRE(total.num_merges > 0);
+        REQUIRE(total.num_find_calls >= 2 * total.num_merges);
+        REQUIRE(total.find_path_length_max <= total.find_path_length_total);
+        REQUIRE(total.boundary_size_max > 0);
+        REQUIRE(total.GetStageCycles(DecoderStatistics::Stage::GrowCluster) >
+                0);
+
+        // Every defect ends up in exactly one final cluster.
+        size_t num_clusters = std::accumulate(
+            total.cluster_size_histogram.begin(),
+            total.cluster_size_histogram.end(), size_t(0));
+        REQUIRE(num_clusters > 0);
+        REQUIRE(num_clusters <= num_defects);
+    } else {
+        REQUIRE(total.num_shots == 0);
+        REQUIRE(total.num_growth_iterations == 0);
+    }
+
+    decoder_0.ResetStatistics();
+    REQUIRE(decoder_0.GetStatistics().num_shots == 0);
+}
+
+TEST_CASE("DecoderStatistics merge") {
+    DecoderStatistics a;
+    DecoderStatistics b;
+    a.num_shots = 2;
+    a.find_path_length_max = 5;
+    a.RecordClusterSize(1);
+    a.RecordClusterSize(3);
+    b.num_shots = 3;
+    b.find_path_length_max = 4;
+    b.RecordClusterSize(2);
+    b.RecordClusterSize(1024);
+
+    a.Merge(b);
+    REQUIRE(a.num_shots == 5);
+    REQUIRE(a.find_path_length_max == 5);
+    REQUIRE(a.cluster_size_histogram[0] == 1);
+    REQUIRE(a.cluster_size_histogram[1] == 2);
+    REQUIRE(a.cluster_size_histogram[10] == 1);
+}
+
 TEST_CASE("UnionFind ToricCode Class With Erasure Size=5") {
 
     size_t num_trials = 1000;
@@ -1,9 +1,21 @@
 #define CATCH_CONFIG_RUNNER
 #include <catch2/catch.hpp>
 
+#include "Test_Allocations.hpp"
 #include "Test_Cluster.hpp"
 #include "Test_ClusterBoundary.hpp"
+#include "Test_DecoderTrace.hpp"
+#include "Test_DetectionEvents.hpp"
+#include "Test_DetectorErrorModel.hpp"
+#include "Test_ErrorModels.hpp"
+#include "Test_ImportanceSampling.hpp"
+#include "Test_LatticeGraph.hpp"
+#include "Test_MonteCarlo.hpp"
+#include "Test_ResultFiles.hpp"
+#include "Test_SampleFormats.hpp"
+#include "Test_SpaceTimeSampler.hpp"
 #include "Test_StabilizerCode.hpp"
+#include "Test_Threshold.hpp"
 #include "Test_UnionFind.hpp"
 
 int main(int argc, char *argv[]) {
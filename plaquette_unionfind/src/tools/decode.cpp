@@ -0,0 +1,261 @@
+/**
+ * @file decode.cpp
+ * @brief Streaming batch decoder for Stim detection event files.
+ *
+ * Usage:
+ *
+ *     plaquette_unionfind_decode --dem circuit.dem --in events.b8
+ *         [--in-format b8] [--out predictions.01] [--out-format 01]
+ *         [--threads N] [--chunk SHOTS] [--stats stats.json]
+ *         [--trace trace.json]
+ *
+ * The detection events are memory-mapped. The worker threads are started
+ * once and claim chunks of `chunk` shots from the shared reader in turn.
+ * Each thread owns one decoder and shot buffer that are reused for all of
+ * its chunks, and writes the predicted observable flips of a chunk as soon
+ * as all earlier chunks are written, so the output keeps the input order.
+ *
+ * With --stats the decoder statistics of all threads are merged and written
+ * as JSON. They are only collected if the tool was built with
+ * PLAQUETTE_UNIONFIND_ENABLE_STATISTICS. Likewise, --trace writes the most
+ * recent decoder events of every thread as a Chrome trace if the tool was
+ * built with PLAQUETTE_UNIONFIND_ENABLE_TRACING.
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DecoderTrace.hpp"
+#include "DetectorErrorModel.hpp"
+#include "MappedFile.hpp"
+#include "SampleFormats.hpp"
+#include "UnionFindDecoder.hpp"
+
+using namespace Plaquette;
+using namespace Plaquette::Decoders;
+
+namespace {
+
+struct Options {
+    std::string dem_path;
+    std::string in_path;
+    std::string out_path = "-";
+    SampleFormat in_format = SampleFormat::B8;
+    SampleFormat out_format = SampleFormat::ZeroOne;
+    size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_size = 4096;
+    std::string stats_path;
+    std::string trace_path;
+};
+
+void PrintUsage(const char *program) {
+    std::cerr
+        << "Usage: " << program
+        << " --dem FILE --in FILE [--in-format 01|b8|r8] [--out FILE]\n"
+           "       [--out-format 01|b8|r8] [--threads N] [--chunk SHOTS]\n"
+           "       [--stats FILE] [--trace FILE]\n"
+           "\n"
+           "Decodes Stim detection events with the union-find decoder and\n"
+           "writes the predicted observable flips. The output defaults to\n"
+           "stdout in the 01 format; the input format defaults to b8.\n";
+}
+
+Options ParseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--dem") {
+            options.dem_path = value;
+        } else if (arg == "--in") {
+            options.in_path = value;
+        } else if (arg == "--out") {
+            options.out_path = value;
+        } else if (arg == "--in-format") {
+            options.in_format = ParseSampleFormat(value);
+        } else if (arg == "--out-format") {
+            options.out_format = ParseSampleFormat(value);
+        } else if (arg == "--threads") {
+            options.num_threads = std::max(1ul, std::stoul(value));
+        } else if (arg == "--chunk") {
+            options.chunk_size = std::max(1ul, std::stoul(value));
+        } else if (arg == "--stats") {
+            options.stats_path = value;
+        } else if (arg == "--trace") {
+            options.trace_path = value;
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    if (options.dem_path.empty() || options.in_path.empty()) {
+        throw std::invalid_argument("Both --dem and --in are required");
+    }
+    return options;
+}
+
+/**
+ * @brief Decodes a contiguous range of shots and writes their predictions
+ * to a thread-local output buffer.
+ */
+void DecodeChunk(const DetectorErrorModel &dem, UnionFindDecoder &decoder,
+                 const std::vector<std::vector<bool>> &shots, size_t begin,
+                 size_t end, SampleFormat out_format, std::string &out) {
+    PLAQUETTE_UNIONFIND_TRACE(ScopedTraceEvent trace_event("decode_chunk");)
+    out.clear();
+    for (size_t s = begin; s < end; s++) {
+        auto syndrome = dem.GetSyndrome(shots[s]);
+        auto correction = decoder.Decode(syndrome);
+        WriteShot(out, dem.GetObservableFlips(correction),
+                  dem.GetNumObservables(), out_format);
+    }
+}
+
+int Run(const Options &options) {
+    auto dem = DetectorErrorModel::FromFile(options.dem_path);
+    if (dem.GetNumDetectors() == 0) {
+        throw std::invalid_argument("The detector error model has no "
+                                    "detectors");
+    }
+
+    MappedFile input(options.in_path);
+    SampleReader reader(input.GetData(), input.GetSize(),
+                        dem.GetNumDetectors(), options.in_format);
+
+    std::ofstream out_file;
+    if (options.out_path != "-") {
+        out_file.open(options.out_path, std::ios::binary);
+        if (!out_file) {
+            throw std::runtime_error("Could not open '" + options.out_path +
+                                     "' for writing");
+        }
+    }
+    std::ostream &out = options.out_path == "-" ? std::cout : out_file;
+
+    std::vector<UnionFindDecoder> decoders;
+    decoders.reserve(options.num_threads);
+    for (size_t t = 0; t < options.num_threads; t++) {
+        decoders.emplace_back(dem.GetDecodingGraph(),
+                              dem.GetEdgeGrowthIncrements());
+    }
+
+    std::mutex read_mutex;  // Guards the reader and next_chunk.
+    std::mutex write_mutex; // Guards the output, next_write and error.
+    std::condition_variable chunk_written;
+    size_t next_chunk = 0;
+    size_t next_write = 0;
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+
+    auto worker = [&](size_t thread) {
+        std::vector<std::vector<bool>> shots(options.chunk_size);
+        std::string output;
+        try {
+            while (true) {
+                size_t chunk = 0;
+                size_t num_shots = 0;
+                {
+                    std::lock_guard<std::mutex> lock(read_mutex);
+                    if (failed || reader.IsAtEnd()) {
+                        break;
+                    }
+                    chunk = next_chunk++;
+                    while (num_shots < options.chunk_size &&
+                           reader.ReadShot(shots[num_shots])) {
+                        num_shots++;
+                    }
+                }
+                DecodeChunk(dem, decoders[thread], shots, 0, num_shots,
+                            options.out_format, output);
+
+                std::unique_lock<std::mutex> lock(write_mutex);
+                chunk_written.wait(
+                    lock, [&] { return failed || next_write == chunk; });
+                if (failed) {
+                    break;
+                }
+                {
+                    PLAQUETTE_UNIONFIND_TRACE(
+                        ScopedTraceEvent trace_event("write_output");)
+                    out.write(output.data(), output.size());
+                }
+                next_write++;
+                chunk_written.notify_all();
+            }
+        } catch (...) {
+            // Stop the other workers, which may wait for a chunk that this
+            // thread will never write.
+            std::lock_guard<std::mutex> lock(write_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            failed = true;
+            chunk_written.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < options.num_threads; t++) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    out.flush();
+
+    if (!options.stats_path.empty()) {
+        DecoderStatistics statistics;
+        for (const auto &decoder : decoders) {
+            statistics.Merge(decoder.GetStatistics());
+        }
+        std::ofstream stats_file(options.stats_path);
+        if (!stats_file) {
+            throw std::runtime_error("Could not open '" + options.stats_path +
+                                     "' for writing");
+        }
+        statistics.WriteJson(stats_file);
+        stats_file << "\n";
+    }
+
+    if (!options.trace_path.empty()) {
+        std::ofstream trace_file(options.trace_path);
+        if (!trace_file) {
+            throw std::runtime_error("Could not open '" + options.trace_path +
+                                     "' for writing");
+        }
+        TraceRecorder::Get().WriteChromeTrace(trace_file);
+    }
+    return out ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    try {
+        return Run(ParseOptions(argc, argv));
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+}
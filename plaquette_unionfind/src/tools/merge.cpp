@@ -0,0 +1,189 @@
+/**
+ * @file merge.cpp
+ * @brief Combines the record files of sharded simulations.
+ *
+ * Usage:
+ *
+ *     plaquette_unionfind_merge shard0.jsonl shard1.jsonl ...
+ *         [--interval wilson|clopper-pearson] [--confidence C]
+ *         [--allow-gaps] [--out results.json]
+ *
+ * Every line of the inputs is a record written by
+ * plaquette_unionfind_simulate --records: the failures of a range of shots
+ * of one point. Records are grouped by code, distance, rounds, rates, seed
+ * and sampling mode and summed, which gives the statistics of a single run
+ * over the union of the shots. Incomplete last lines of interrupted runs are
+ * skipped, and shots that appear in two records, e.g. when a file is passed
+ * twice, are reported as an error. So are shots of the planned run that no
+ * record covers, e.g. of a shard file that was not passed or whose run was
+ * interrupted; with --allow-gaps the missing ranges are only reported on
+ * stderr and the points are merged over the shots that are present.
+ *
+ * A summary line per point is printed to stderr, and the failure counts,
+ * logical error rates and intervals are written as JSON. The intervals are
+ * computed as in plaquette_unionfind_simulate, 95% Wilson by default, so a
+ * merged file matches an unsharded run with the same options.
+ */
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ResultFiles.hpp"
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+namespace {
+
+struct Options {
+    std::vector<std::string> paths;
+    std::string out_path = "-";
+    Interval interval = Interval::Wilson;
+    double confidence = 0.95;
+    bool allow_gaps = false;
+};
+
+void PrintUsage(const char *program) {
+    std::cerr << "Usage: " << program
+              << " shard.jsonl [shard.jsonl ...]\n"
+                 "       [--interval wilson|clopper-pearson] [--confidence C]\n"
+                 "       [--allow-gaps] [--out results.json]\n"
+                 "\n"
+                 "Sums the shot records of sharded simulations per point and\n"
+                 "writes the combined logical error rates as JSON.\n";
+}
+
+Options ParseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if (arg == "--allow-gaps") {
+            options.allow_gaps = true;
+        } else if (arg == "--out" || arg == "--interval" || arg == "--confidence") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--out") {
+                options.out_path = value;
+            } else if (arg == "--interval") {
+                if (value == "wilson") {
+                    options.interval = Interval::Wilson;
+                } else if (value == "clopper-pearson") {
+                    options.interval = Interval::ClopperPearson;
+                } else {
+                    throw std::invalid_argument("Unknown interval '" + value +
+                                                "'");
+                }
+            } else {
+                options.confidence = std::stod(value);
+                if (!(options.confidence > 0.0 && options.confidence < 1.0)) {
+                    throw std::invalid_argument(
+                        "The confidence must be in (0, 1)");
+                }
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            throw std::invalid_argument("Unknown option " + arg);
+        } else {
+            options.paths.push_back(arg);
+        }
+    }
+    if (options.paths.empty()) {
+        throw std::invalid_argument("No record files given");
+    }
+    return options;
+}
+
+std::string GetIntervalName(Interval interval) {
+    return interval == Interval::Wilson ? "wilson" : "clopper-pearson";
+}
+
+void WriteResults(std::ostream &out, const Options &options,
+                  const std::vector<ShotRecord> &records,
+                  const std::vector<MonteCarloResult> &results) {
+    out << "{\n  \"simulation\": \"plaquette_unionfind_merge\",\n"
+        << "  \"decoder\": \"plaquette-unionfind\",\n"
+        << "  \"noise\": \"phenomenological\",\n"
+        << "  \"num_records\": " << records.size() << ",\n"
+        << "  \"interval\": \"" << GetIntervalName(options.interval)
+        << "\",\n"
+        << "  \"confidence\": " << options.confidence
+        << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        auto [low, high] =
+            r.GetConfidenceInterval(options.interval, options.confidence);
+        out << (i == 0 ? "\n" : ",\n") << "    {\"code\": \"" << r.code
+            << "\", \"distance\": " << r.distance
+            << ", \"rounds\": " << r.rounds << ", \"p\": " << r.p
+            << ", \"erasure\": " << r.erasure_probability
+            << ", \"shots\": " << r.num_shots
+            << ", \"failures\": " << r.num_failures
+            << ",\n     \"logical_error_rate\": " << r.GetLogicalErrorRate()
+            << ", \"ci_low\": " << low << ", \"ci_high\": " << high
+            << ", \"seconds\": " << r.seconds << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int Run(const Options &options) {
+    std::vector<ShotRecord> records;
+    for (const auto &path : options.paths) {
+        std::ifstream in(path);
+        if (!in) {
+            throw std::runtime_error("Could not open '" + path + "'");
+        }
+        auto file_records = ReadShotRecords(path);
+        std::cerr << path << ": " << file_records.size() << " records\n";
+        records.insert(records.end(), file_records.begin(),
+                       file_records.end());
+    }
+    std::vector<std::string> gaps;
+    auto results =
+        MergeShotRecords(records, options.allow_gaps ? &gaps : nullptr);
+    for (const auto &gap : gaps) {
+        std::cerr << "warning: " << gap << "\n";
+    }
+    for (const auto &result : results) {
+        auto [low, high] = result.GetConfidenceInterval(options.interval,
+                                                        options.confidence);
+        std::cerr << result.code << " d=" << result.distance
+                  << " rounds=" << result.rounds << " p=" << result.p
+                  << " failures=" << result.num_failures << "/"
+                  << result.num_shots
+                  << " rate=" << result.GetLogicalErrorRate() << " [" << low
+                  << ", " << high << "]\n";
+    }
+
+    if (options.out_path == "-") {
+        std::cout.precision(9);
+        WriteResults(std::cout, options, records, results);
+        return 0;
+    }
+    std::ofstream out(options.out_path);
+    if (!out) {
+        throw std::runtime_error("Could not open '" + options.out_path +
+                                 "' for writing");
+    }
+    out.precision(9);
+    WriteResults(out, options, records, results);
+    return out ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    try {
+        return Run(ParseOptions(argc, argv));
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+}
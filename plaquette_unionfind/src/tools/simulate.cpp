@@ -0,0 +1,490 @@
+/**
+ * @file simulate.cpp
+ * @brief Multithreaded Monte Carlo estimate of logical error rates.
+ *
+ * Usage:
+ *
+ *     plaquette_unionfind_simulate [--code planar|rotated|toric]
+ *         [--distances 3,5,7] [--rounds 1,d] [--p 0.01,0.02]
+ *         [--erasure 0.0] [--shots N] [--threads N] [--chunk SHOTS]
+ *         [--seed S] [--bit-sliced | --coupled] [--out results.json]
+ *         [--batch N] [--target-failures N] [--target-rel-error E]
+ *         [--max-seconds T] [--interval wilson|clopper-pearson]
+ *         [--confidence C] [--shard I/N] [--records shard.jsonl]
+ *         [--checkpoint SHOTS]
+ *
+ * For every point of the (distance, rounds, p) grid the code is built once
+ * and the shots are sampled, decoded and checked for logical failures by
+ * Simulation::RunMonteCarlo on all threads. The noise of every shot is a
+ * pure function of the seed and the shot index, so a run is reproducible for
+ * a fixed seed regardless of the number of threads and the chunk size. A
+ * rounds value of "d" means as many rounds as the distance. With --bit-sliced
+ * the noise, syndromes and logical parities of 64 shots are computed at once
+ * in bit-sliced words and only the shots with defects are decoded. With
+ * --coupled all rates of a (distance, rounds) point are sampled from the same
+ * random draws by Simulation::RunMonteCarloSweep, which decodes each distinct
+ * error pattern once; the seconds reported are then those of the sweep.
+ *
+ * Setting --target-failures, --target-rel-error or --max-seconds makes every
+ * point adaptive: Simulation::RunMonteCarloAdaptive runs batches of --batch
+ * shots until a target is met, with --shots as the budget of the point.
+ *
+ * Campaigns spread over several machines split the shots of every point
+ * with --shard I/N: shard I runs the I-th of N contiguous ranges of shot
+ * indices, so its noise is that of the same shots in a single run. With
+ * --records every --checkpoint shots of a point are appended as one line to
+ * an append-only JSON Lines file, and a rerun with the same options resumes
+ * after the last complete line. plaquette_unionfind_merge sums the record
+ * files of all shards into the statistics of the full run.
+ *
+ * A summary line per point is printed to stderr, and the failure counts,
+ * logical error rates and intervals are written as JSON. Each point is
+ * written and flushed as soon as it finishes, so a long scan can be followed
+ * and keeps the finished points if it is interrupted.
+ */
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MonteCarlo.hpp"
+#include "ResultFiles.hpp"
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+namespace {
+
+struct Options {
+    std::string code = "planar";
+    std::vector<size_t> distances = {3, 5, 7};
+    std::vector<std::string> rounds = {"1"};
+    std::vector<double> probabilities = {0.05};
+    MonteCarloOptions monte_carlo;
+    bool coupled = false;
+    StoppingRule stopping_rule;
+    bool adaptive = false;
+    size_t shard_index = 0;
+    size_t num_shards = 1;
+    std::string records_path; ///< Checkpoints are appended here if set.
+    size_t checkpoint = 0;    ///< Shots per record; 0 for one per point.
+    std::string out_path = "-";
+};
+
+void PrintUsage(const char *program) {
+    std::cerr
+        << "Usage: " << program
+        << " [--code planar|rotated|toric] [--distances 3,5,7]\n"
+           "       [--rounds 1,d] [--p 0.01,0.02] [--erasure P] [--shots N]\n"
+           "       [--threads N] [--chunk SHOTS] [--seed S]\n"
+           "       [--bit-sliced | --coupled] [--out results.json]\n"
+           "       [--batch N] [--target-failures N] [--target-rel-error E]\n"
+           "       [--max-seconds T] [--interval wilson|clopper-pearson]\n"
+           "       [--confidence C] [--shard I/N] [--records shard.jsonl]\n"
+           "       [--checkpoint SHOTS]\n"
+           "\n"
+           "Estimates logical error rates under bit-flip noise, with\n"
+           "measurement errors for several rounds, and writes them as JSON.\n"
+           "With a target, every point runs batches until the target or the\n"
+           "budget of --shots is reached. With --shard and --records, shards\n"
+           "of the shots checkpoint to append-only files, resume after an\n"
+           "interruption and are combined by plaquette_unionfind_merge.\n";
+}
+
+std::vector<std::string> SplitList(const std::string &value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+Options ParseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if (arg == "--bit-sliced") {
+            options.monte_carlo.bit_sliced = true;
+            continue;
+        }
+        if (arg == "--coupled") {
+            options.coupled = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--code") {
+            if (value != "planar" && value != "rotated" &&
+                value != "toric") {
+                throw std::invalid_argument("Unknown code '" + value + "'");
+            }
+            options.code = value;
+        } else if (arg == "--distances") {
+            options.distances.clear();
+            for (const auto &item : SplitList(value)) {
+                options.distances.push_back(std::stoul(item));
+            }
+        } else if (arg == "--rounds") {
+            options.rounds = SplitList(value);
+        } else if (arg == "--p") {
+            options.probabilities.clear();
+            for (const auto &item : SplitList(value)) {
+                options.probabilities.push_back(std::stod(item));
+            }
+        } else if (arg == "--erasure") {
+            options.monte_carlo.erasure_probability = std::stod(value);
+        } else if (arg == "--shots") {
+            options.monte_carlo.num_shots = std::stoul(value);
+        } else if (arg == "--threads") {
+            options.monte_carlo.num_threads = std::stoul(value);
+        } else if (arg == "--chunk") {
+            options.monte_carlo.chunk_size = std::max(1ul, std::stoul(value));
+        } else if (arg == "--seed") {
+            options.monte_carlo.seed = std::stoull(value);
+        } else if (arg == "--out") {
+            options.out_path = value;
+        } else if (arg == "--batch") {
+            options.stopping_rule.batch_size = std::stoul(value);
+        } else if (arg == "--target-failures") {
+            options.stopping_rule.target_failures = std::stoul(value);
+            options.adaptive = true;
+        } else if (arg == "--target-rel-error") {
+            options.stopping_rule.target_relative_error = std::stod(value);
+            options.adaptive = true;
+        } else if (arg == "--max-seconds") {
+            options.stopping_rule.max_seconds = std::stod(value);
+            options.adaptive = true;
+        } else if (arg == "--interval") {
+            if (value == "wilson") {
+                options.stopping_rule.interval = Interval::Wilson;
+            } else if (value == "clopper-pearson") {
+                options.stopping_rule.interval = Interval::ClopperPearson;
+            } else {
+                throw std::invalid_argument("Unknown interval '" + value +
+                                            "'");
+            }
+        } else if (arg == "--shard") {
+            size_t slash = value.find('/');
+            if (slash == std::string::npos) {
+                throw std::invalid_argument("Expected --shard I/N");
+            }
+            options.shard_index = std::stoul(value.substr(0, slash));
+            options.num_shards = std::stoul(value.substr(slash + 1));
+            if (options.num_shards == 0 ||
+                options.shard_index >= options.num_shards) {
+                throw std::invalid_argument("Invalid shard " + value);
+            }
+        } else if (arg == "--records") {
+            options.records_path = value;
+        } else if (arg == "--checkpoint") {
+            options.checkpoint = std::stoul(value);
+        } else if (arg == "--confidence") {
+            options.stopping_rule.confidence = std::stod(value);
+            if (!(options.stopping_rule.confidence > 0.0 &&
+                  options.stopping_rule.confidence < 1.0)) {
+                throw std::invalid_argument("The confidence must be in (0, 1)");
+            }
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    if (options.distances.empty() || options.rounds.empty() ||
+        options.probabilities.empty()) {
+        throw std::invalid_argument("Empty distance, rounds or p list");
+    }
+    options.stopping_rule.max_shots = options.monte_carlo.num_shots;
+    return options;
+}
+
+size_t ParseRounds(const std::string &rounds, size_t distance) {
+    if (rounds == "d") {
+        return distance;
+    }
+    return std::stoul(rounds);
+}
+
+std::string GetIntervalName(Interval interval) {
+    return interval == Interval::Wilson ? "wilson" : "clopper-pearson";
+}
+
+void WriteHeader(std::ostream &out, const Options &options) {
+    out << "{\n  \"simulation\": \"plaquette_unionfind_simulate\",\n"
+        << "  \"decoder\": \"plaquette-unionfind\",\n"
+        << "  \"code\": \"" << options.code << "\",\n"
+        << "  \"noise\": \"phenomenological\",\n"
+        << "  \"seed\": " << options.monte_carlo.seed << ",\n"
+        << "  \"bit_sliced\": "
+        << (options.monte_carlo.bit_sliced ? "true" : "false") << ",\n"
+        << "  \"coupled\": " << (options.coupled ? "true" : "false")
+        << ",\n"
+        << "  \"adaptive\": " << (options.adaptive ? "true" : "false")
+        << ",\n"
+        << "  \"shard\": " << options.shard_index << ",\n"
+        << "  \"num_shards\": " << options.num_shards << ",\n"
+        << "  \"interval\": \""
+        << GetIntervalName(options.stopping_rule.interval) << "\",\n"
+        << "  \"confidence\": " << options.stopping_rule.confidence
+        << ",\n  \"results\": [";
+    out.flush();
+}
+
+void WriteResult(std::ostream &out, const Options &options,
+                 const MonteCarloResult &r, bool first) {
+    auto [low, high] = r.GetConfidenceInterval(
+        options.stopping_rule.interval, options.stopping_rule.confidence);
+    out << (first ? "\n" : ",\n") << "    {\"distance\": " << r.distance
+        << ", \"rounds\": " << r.rounds << ", \"p\": " << r.p
+        << ", \"erasure\": " << r.erasure_probability
+        << ", \"shots\": " << r.num_shots
+        << ", \"failures\": " << r.num_failures
+        << ",\n     \"logical_error_rate\": " << r.GetLogicalErrorRate()
+        << ", \"ci_low\": " << low << ", \"ci_high\": " << high
+        << ", \"seconds\": " << r.seconds;
+    if (!r.stop_reason.empty()) {
+        out << ", \"stop_reason\": \"" << r.stop_reason << "\"";
+    }
+    out << "}";
+    out.flush();
+}
+
+void WriteFooter(std::ostream &out) { out << "\n  ]\n}\n"; }
+
+void PrintSummary(const Options &options, const MonteCarloResult &result) {
+    auto [low, high] = result.GetConfidenceInterval(
+        options.stopping_rule.interval, options.stopping_rule.confidence);
+    std::cerr << options.code << " d=" << result.distance
+              << " rounds=" << result.rounds << " p=" << result.p
+              << " failures=" << result.num_failures << "/"
+              << result.num_shots << " rate=" << result.GetLogicalErrorRate()
+              << " [" << low << ", " << high << "] "
+              << result.num_shots / result.seconds << " shots/s";
+    if (!result.stop_reason.empty()) {
+        std::cerr << " (" << result.stop_reason << ")";
+    }
+    std::cerr << "\n";
+}
+
+bool IsSharded(const Options &options) {
+    return options.num_shards > 1 || !options.records_path.empty();
+}
+
+/**
+ * @brief Runs this shard's shots of every rate of a (distance, rounds)
+ * point, resuming after the shots already in the records and appending a
+ * record per checkpoint.
+ *
+ * The code is built once and shared by all segments. Coupled rates share
+ * their segments. A rate that is ahead of the others, when a run was
+ * interrupted between the records of one segment, is not written again.
+ */
+template <typename Code>
+std::vector<MonteCarloResult>
+RunShard(const Code &code, const Options &options, size_t distance,
+         size_t rounds, const std::vector<ShotRecord> &previous,
+         ShotRecordWriter *writer) {
+    size_t alignment = options.monte_carlo.bit_sliced ? 64 : 1;
+    auto [begin, end] =
+        GetShardRange(options.monte_carlo.num_shots, options.shard_index,
+                      options.num_shards, alignment);
+    size_t segment = options.checkpoint == 0 ? end - begin : options.checkpoint;
+    segment = (segment + alignment - 1) / alignment * alignment;
+    segment = std::max(segment, alignment);
+
+    std::vector<std::vector<double>> groups;
+    if (options.coupled) {
+        groups.push_back(options.probabilities);
+    } else {
+        for (auto p : options.probabilities) {
+            groups.push_back({p});
+        }
+    }
+
+    std::vector<MonteCarloResult> results;
+    for (const auto &group : groups) {
+        std::vector<ShotRecord> points(group.size());
+        std::vector<size_t> resume(group.size());
+        std::vector<std::vector<ShotRecord>> records(group.size());
+        for (size_t k = 0; k < group.size(); k++) {
+            auto &point = points[k];
+            point.code = options.code;
+            point.distance = distance;
+            point.rounds = rounds;
+            point.p = group[k];
+            point.erasure_probability =
+                options.monte_carlo.erasure_probability;
+            point.seed = options.monte_carlo.seed;
+            point.bit_sliced = options.monte_carlo.bit_sliced;
+            point.coupled = options.coupled;
+            point.planned_shots = options.monte_carlo.num_shots;
+            resume[k] = GetResumeShot(previous, point, begin, end);
+            for (const auto &record : previous) {
+                if (record.GetKey() == point.GetKey() &&
+                    record.first_shot >= begin && record.first_shot < end) {
+                    records[k].push_back(record);
+                }
+            }
+        }
+
+        while (true) {
+            size_t first = *std::min_element(resume.begin(), resume.end());
+            if (first >= end) {
+                break;
+            }
+            size_t last = std::min(first + segment, end);
+            for (auto shot : resume) {
+                if (shot > first) {
+                    last = std::min(last, shot);
+                }
+            }
+            MonteCarloOptions monte_carlo = options.monte_carlo;
+            monte_carlo.first_shot = first;
+            monte_carlo.num_shots = last - first;
+            std::vector<MonteCarloResult> segment_results;
+            if (options.coupled) {
+                segment_results = RunMonteCarloSweep(code, group, monte_carlo);
+            } else {
+                segment_results.push_back(
+                    RunMonteCarlo(code, group[0], monte_carlo));
+            }
+            for (size_t k = 0; k < group.size(); k++) {
+                if (resume[k] != first) {
+                    continue;
+                }
+                ShotRecord record = points[k];
+                record.first_shot = first;
+                record.num_shots = last - first;
+                record.num_failures = segment_results[k].num_failures;
+                record.seconds = segment_results[k].seconds;
+                if (writer != nullptr) {
+                    writer->Write(record);
+                }
+                records[k].push_back(record);
+                resume[k] = last;
+            }
+        }
+
+        for (size_t k = 0; k < group.size(); k++) {
+            auto merged = MergeShotRecords(records[k], nullptr, begin, end);
+            MonteCarloResult result;
+            if (merged.empty()) {
+                result.code = options.code;
+                result.distance = distance;
+                result.rounds = rounds;
+                result.p = group[k];
+                result.erasure_probability =
+                    options.monte_carlo.erasure_probability;
+            } else {
+                result = merged[0];
+            }
+            results.push_back(result);
+        }
+    }
+    return results;
+}
+
+void RunPoints(std::ostream &out, const Options &options) {
+    bool first = true;
+    auto report = [&](const MonteCarloResult &result) {
+        PrintSummary(options, result);
+        WriteResult(out, options, result, first);
+        first = false;
+    };
+    std::vector<ShotRecord> previous;
+    std::unique_ptr<ShotRecordWriter> writer;
+    if (!options.records_path.empty()) {
+        previous = ReadShotRecords(options.records_path);
+        writer = std::make_unique<ShotRecordWriter>(options.records_path);
+    }
+    WriteHeader(out, options);
+    for (auto distance : options.distances) {
+        for (const auto &rounds_value : options.rounds) {
+            size_t rounds = ParseRounds(rounds_value, distance);
+            if (IsSharded(options)) {
+                auto shard = WithCode(
+                    options.code, distance, rounds, [&](const auto &code) {
+                        return RunShard(code, options, distance, rounds,
+                                        previous, writer.get());
+                    });
+                for (const auto &result : shard) {
+                    report(result);
+                }
+                continue;
+            }
+            if (options.coupled) {
+                auto sweep = RunMonteCarloSweep(options.code, distance, rounds,
+                                                options.probabilities,
+                                                options.monte_carlo);
+                for (const auto &result : sweep) {
+                    report(result);
+                }
+                continue;
+            }
+            for (auto p : options.probabilities) {
+                if (options.adaptive) {
+                    report(RunMonteCarloAdaptive(options.code, distance,
+                                                 rounds, p, options.monte_carlo,
+                                                 options.stopping_rule));
+                } else {
+                    report(RunMonteCarlo(options.code, distance, rounds, p,
+                                         options.monte_carlo));
+                }
+            }
+        }
+    }
+    WriteFooter(out);
+}
+
+int Run(const Options &options) {
+    if (options.coupled && options.monte_carlo.bit_sliced) {
+        throw std::invalid_argument(
+            "--coupled and --bit-sliced cannot be combined");
+    }
+    if (options.coupled && options.adaptive) {
+        throw std::invalid_argument(
+            "--coupled cannot be combined with a stopping target");
+    }
+    if (options.adaptive && IsSharded(options)) {
+        throw std::invalid_argument(
+            "--shard and --records need a fixed number of shots");
+    }
+
+    if (options.out_path == "-") {
+        std::cout.precision(9);
+        RunPoints(std::cout, options);
+        return 0;
+    }
+    std::ofstream out(options.out_path);
+    if (!out) {
+        throw std::runtime_error("Could not open '" + options.out_path +
+                                 "' for writing");
+    }
+    out.precision(9);
+    RunPoints(out, options);
+    return out ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    try {
+        return Run(ParseOptions(argc, argv));
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+}
@@ -0,0 +1,199 @@
+/**
+ * @file threshold.cpp
+ * @brief Locates the threshold of a code family under bit-flip noise.
+ *
+ * Usage:
+ *
+ *     plaquette_unionfind_threshold [--code planar|rotated|toric]
+ *         [--distances 5,7,9] [--rounds 1|d] [--p-min 0.01] [--p-max 0.15]
+ *         [--points N] [--iterations N] [--erasure P] [--shots N]
+ *         [--batch N] [--target-failures N] [--target-rel-error E]
+ *         [--threads N] [--seed S] [--bit-sliced] [--out threshold.json]
+ *
+ * Simulation::FindThreshold samples every distance at evenly spaced rates of
+ * a window, fits the crossing of the logical error rates with a finite-size
+ * scaling ansatz and narrows the window around it, continuing the points
+ * that stay in the window. Every point of an iteration runs until the
+ * stopping rule is met or --shots are used, and points run in parallel.
+ *
+ * The fit of every iteration is printed to stderr, and the threshold, the
+ * exponent nu with their standard errors and all sampled points are written
+ * as JSON.
+ */
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Threshold.hpp"
+
+using namespace Plaquette;
+using namespace Plaquette::Simulation;
+
+namespace {
+
+struct Options {
+    std::string code = "rotated";
+    ThresholdOptions threshold;
+    std::string out_path = "-";
+};
+
+void PrintUsage(const char *program) {
+    std::cerr
+        << "Usage: " << program
+        << " [--code planar|rotated|toric] [--distances 5,7,9]\n"
+           "       [--rounds 1|d] [--p-min P] [--p-max P] [--points N]\n"
+           "       [--iterations N] [--erasure P] [--shots N] [--batch N]\n"
+           "       [--target-failures N] [--target-rel-error E]\n"
+           "       [--threads N] [--seed S] [--bit-sliced]\n"
+           "       [--out threshold.json]\n"
+           "\n"
+           "Samples logical error rates near the crossing of several\n"
+           "distances and fits the threshold with its standard error.\n";
+}
+
+std::vector<std::string> SplitList(const std::string &value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+Options ParseOptions(int argc, char *argv[]) {
+    Options options;
+    auto &threshold = options.threshold;
+    threshold.stopping_rule.max_shots = 100000;
+    threshold.stopping_rule.target_relative_error = 0.05;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            PrintUsage(argv[0]);
+            std::exit(0);
+        }
+        if (arg == "--bit-sliced") {
+            threshold.monte_carlo.bit_sliced = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--code") {
+            if (value != "planar" && value != "rotated" &&
+                value != "toric") {
+                throw std::invalid_argument("Unknown code '" + value + "'");
+            }
+            options.code = value;
+        } else if (arg == "--distances") {
+            threshold.distances.clear();
+            for (const auto &item : SplitList(value)) {
+                threshold.distances.push_back(std::stoul(item));
+            }
+        } else if (arg == "--rounds") {
+            threshold.rounds = value == "d" ? 0 : std::stoul(value);
+        } else if (arg == "--p-min") {
+            threshold.min_p = std::stod(value);
+        } else if (arg == "--p-max") {
+            threshold.max_p = std::stod(value);
+        } else if (arg == "--points") {
+            threshold.num_points = std::stoul(value);
+        } else if (arg == "--iterations") {
+            threshold.num_iterations = std::stoul(value);
+        } else if (arg == "--erasure") {
+            threshold.monte_carlo.erasure_probability = std::stod(value);
+        } else if (arg == "--shots") {
+            threshold.stopping_rule.max_shots = std::stoul(value);
+        } else if (arg == "--batch") {
+            threshold.stopping_rule.batch_size = std::stoul(value);
+        } else if (arg == "--target-failures") {
+            threshold.stopping_rule.target_failures = std::stoul(value);
+        } else if (arg == "--target-rel-error") {
+            threshold.stopping_rule.target_relative_error = std::stod(value);
+        } else if (arg == "--threads") {
+            threshold.monte_carlo.num_threads = std::stoul(value);
+        } else if (arg == "--seed") {
+            threshold.monte_carlo.seed = std::stoull(value);
+        } else if (arg == "--out") {
+            options.out_path = value;
+        } else {
+            throw std::invalid_argument("Unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+void WriteResult(std::ostream &out, const Options &options,
+                 const ThresholdResult &result) {
+    const auto &fit = result.fit;
+    out << "{\n  \"simulation\": \"plaquette_unionfind_threshold\",\n"
+        << "  \"decoder\": \"plaquette-unionfind\",\n"
+        << "  \"code\": \"" << options.code << "\",\n"
+        << "  \"noise\": \"phenomenological\",\n"
+        << "  \"seed\": " << options.threshold.monte_carlo.seed << ",\n"
+        << "  \"converged\": " << (fit.converged ? "true" : "false") << ",\n"
+        << "  \"threshold\": " << fit.threshold << ",\n"
+        << "  \"threshold_error\": " << fit.threshold_error << ",\n"
+        << "  \"nu\": " << fit.nu << ",\n"
+        << "  \"nu_error\": " << fit.nu_error << ",\n"
+        << "  \"chi_squared\": " << fit.chi_squared << ",\n"
+        << "  \"degrees_of_freedom\": " << fit.degrees_of_freedom << ",\n"
+        << "  \"window\": [" << result.min_p << ", " << result.max_p
+        << "],\n  \"results\": [";
+    for (size_t i = 0; i < result.points.size(); i++) {
+        const auto &r = result.points[i];
+        auto [low, high] = r.GetConfidenceInterval();
+        out << (i == 0 ? "\n" : ",\n") << "    {\"distance\": " << r.distance
+            << ", \"rounds\": " << r.rounds << ", \"p\": " << r.p
+            << ", \"erasure\": " << r.erasure_probability
+            << ", \"shots\": " << r.num_shots
+            << ", \"failures\": " << r.num_failures
+            << ",\n     \"logical_error_rate\": " << r.GetLogicalErrorRate()
+            << ", \"ci_low\": " << low << ", \"ci_high\": " << high
+            << ", \"seconds\": " << r.seconds << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int Run(const Options &options) {
+    auto result = FindThreshold(options.code, options.threshold);
+    const auto &fit = result.fit;
+    std::cerr << options.code << " threshold=" << fit.threshold << " +- "
+              << fit.threshold_error << " nu=" << fit.nu << " +- "
+              << fit.nu_error << " chi2/dof=" << fit.chi_squared << "/"
+              << fit.degrees_of_freedom << " window=[" << result.min_p << ", "
+              << result.max_p << "]" << (fit.converged ? "" : " (no fit)")
+              << "\n";
+
+    if (options.out_path == "-") {
+        std::cout.precision(9);
+        WriteResult(std::cout, options, result);
+        return 0;
+    }
+    std::ofstream out(options.out_path);
+    if (!out) {
+        throw std::runtime_error("Could not open '" + options.out_path +
+                                 "' for writing");
+    }
+    out.precision(9);
+    WriteResult(out, options, result);
+    return out ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    try {
+        return Run(ParseOptions(argc, argv));
+    } catch (const std::exception &e) {
+        std::cerr << "error: " << e.what() << "\n";
+        PrintUsage(argv[0]);
+        return 1;
+    }
+}
@@ -20,6 +20,21 @@ import time
 import plaquette_graph as pcg
 from plaquette_unionfind_bindings import UnionFindDecoder
 from plaquette_unionfind_bindings import PeelingDecoder
+from plaquette_unionfind_bindings import DecoderStatistics
+from plaquette_unionfind_bindings import statistics_enabled
+from plaquette_unionfind_bindings import MonteCarloResult
+from plaquette_unionfind_bindings import FixedWeightResult
+from plaquette_unionfind_bindings import ThresholdFit
+from plaquette_unionfind_bindings import ThresholdResult
+from plaquette_unionfind_bindings import simulate
+from plaquette_unionfind_bindings import simulate_sweep
+from plaquette_unionfind_bindings import simulate_adaptive
+from plaquette_unionfind_bindings import simulate_fixed_weight
+from plaquette_unionfind_bindings import find_threshold
+from plaquette_unionfind_bindings import fit_threshold
+from plaquette_unionfind_bindings import SpaceTimeSampler
+from plaquette_unionfind_bindings import space_time_probabilities
+from plaquette_unionfind_bindings import DetectionEventBuilder
 
 
 class UnionFindDecoderComponentInterface(decoderbase.DecoderBackendInterface):
@@ -224,3 +224,124 @@ class TestPlanarNoErasureSize4:
 
         for i in range(num_vertices):
             assert mf[i] == modified_erasure_check[i]
+
+    def test_statistics(self, get_decoding_graph):
+        num_vertices, dg = get_decoding_graph
+        syndrome = [False] * num_vertices
+        syndrome[1] = syndrome[2] = True
+        uf = pcu.UnionFindDecoder(dg)
+        uf.decode(list(syndrome))
+        uf.decode(list(syndrome))
+
+        total = pcu.DecoderStatistics()
+        total.merge(uf.get_statistics())
+        if pcu.unionfind.statistics_enabled:
+            assert total.num_shots == 2
+            assert total.num_growth_iterations > 0
+            assert total.stage_cycles["grow_cluster"] > 0
+        else:
+            assert total.num_shots == 0
+
+        uf.reset_statistics()
+        assert uf.get_statistics().num_shots == 0
+
+
+class TestSimulate:
+    def test_reproducible(self):
+        serial = pcu.simulate("planar", 5, 0.05, shots=2000, threads=1, seed=3)
+        parallel = pcu.simulate("planar", 5, 0.05, shots=2000, threads=4, seed=3)
+        assert serial.num_shots == 2000
+        assert 0 < serial.num_failures < serial.num_shots
+        assert serial.num_failures == parallel.num_failures
+
+        low, high = serial.confidence_interval()
+        assert low <= serial.logical_error_rate <= high
+
+    def test_rounds_and_erasure(self):
+        result = pcu.simulate("rotated", 3, 0.0, shots=500, rounds=3, erasure_probability=0.05)
+        assert result.code == "rotated"
+        assert result.rounds == 3
+        assert result.num_failures < 50
+
+    def test_bit_sliced(self):
+        serial = pcu.simulate("planar", 5, 0.05, shots=2000, threads=1, bit_sliced=True)
+        parallel = pcu.simulate("planar", 5, 0.05, shots=2000, threads=4, bit_sliced=True)
+        assert 0 < serial.num_failures < serial.num_shots
+        assert serial.num_failures == parallel.num_failures
+
+    def test_coupled_sweep(self):
+        results = pcu.simulate_sweep("planar", 5, [0.05, 0.0, 0.02], shots=2000, seed=3)
+        assert [r.p for r in results] == [0.05, 0.0, 0.02]
+        assert results[1].num_failures == 0
+        assert results[2].num_failures < results[0].num_failures
+
+    def test_adaptive(self):
+        result = pcu.simulate_adaptive("planar", 5, 0.05, max_shots=100000, batch_size=1000,
+                                       target_failures=50, seed=3)
+        assert result.stop_reason == "target_failures"
+        assert result.num_failures >= 50
+        fixed = pcu.simulate("planar", 5, 0.05, shots=result.num_shots, seed=3)
+        assert fixed.num_failures == result.num_failures
+        low, high = result.clopper_pearson_interval(0.95)
+        assert low <= result.logical_error_rate <= high
+
+    def test_fixed_weight(self):
+        result = pcu.simulate_fixed_weight("planar", 5, max_weight=14, shots_per_weight=1000)
+        assert result.num_edges == 41
+        assert result.max_weight == 14
+        assert result.min_weight == 3
+        assert result.failure_rate(14) > result.failure_rate(3) > 0.0
+        low, high = result.confidence_interval(1e-3)
+        assert 0.0 < low <= result.logical_error_rate(1e-3) <= high
+
+    def test_find_threshold(self):
+        result = pcu.find_threshold("toric", [4, 6], min_p=0.05, max_p=0.15, num_points=5,
+                                    num_iterations=2, max_shots=4000, batch_size=2000, seed=2)
+        assert result.fit.converged
+        assert 0.08 < result.fit.threshold < 0.12
+        refit = pcu.fit_threshold(result.points)
+        assert refit.converged
+
+    def test_space_time_sampler(self):
+        # Two detectors and a boundary vertex, the boundary edge flips L0.
+        dg = pcg.DecodingGraph(3, [(0, 1), (1, 2)], [False, False, True])
+        sampler = pcu.SpaceTimeSampler(dg, [1.0, 1.0], [0, 1], seed=1)
+        syndrome, observables = sampler.sample()
+        assert syndrome == [True, False, False]
+        assert observables == 1
+        assert sampler.get_flipped_edges() == [0, 1]
+        decoder = pcu.UnionFindDecoder(dg, sampler.get_growth_increments(), 2.0)
+        correction = decoder.decode(syndrome)
+        assert sampler.get_observable_flips(correction) == observables
+
+        words, observables = sampler.sample_packed()
+        assert words == [0b001]
+
+        dem = pcu.SpaceTimeSampler.from_detector_error_model(
+            "error(1) D0 D1 L0\nerror(0) D1\n", seed=2)
+        syndrome, observables = dem.sample()
+        assert syndrome[:2] == [True, True]
+        assert observables == 1
+
+    def test_space_time_probabilities(self):
+        rates = pcu.space_time_probabilities([0.1, 0.2], [0.3], 2, 1, 2)
+        assert rates == [0.1, 0.2, 0.1, 0.2, 0.3]
+
+    def test_detection_events(self):
+        # A repetition code: three qubits, two stabilizers and two rounds.
+        edges = [(2, 0), (0, 1), (1, 3), (6, 4), (4, 5), (5, 7), (0, 4), (1, 5)]
+        boundary = [False, False, True, True] * 2
+        dg = pcg.DecodingGraph(8, edges, boundary)
+        builder = pcu.DetectionEventBuilder(dg, 2)
+        assert builder.num_stabilizers == 2
+        assert builder.num_qubits == 3
+        # Stabilizer 0 fires in the first round only: a measurement error.
+        assert builder.detection_events([0b01], [0b000]) == [0b10001]
+        assert builder.syndrome([0b01, 0b01]) == [True] + [False] * 7
+        decoder = pcu.UnionFindDecoder(dg)
+        correction = builder.decode(decoder, [0b01], [0b000])
+        assert [i for i, c in enumerate(correction) if c] == [6]
+
+    def test_unknown_code(self):
+        with pytest.raises(ValueError):
+            pcu.simulate("hexagonal", 3, 0.01)